@@ -0,0 +1,188 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCV/examples/rle-benchmark.cpp                       **
+** Module : ICLCV                                                  **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#include <ICLCV/RunLengthEncoder.h>
+#include <ICLCV/RegionDetectorTools.h>
+#include <ICLCore/Img.h>
+#include <ICLUtils/Time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace icl;
+using namespace icl::utils;
+using namespace icl::core;
+using namespace icl::cv;
+using namespace icl::cv::region_detector_tools;
+
+// compares the RunLengthEncoder's run scanning (SIMD if available) with the
+// former scalar run scanning on binary, label and noisy images. Both are
+// measured with the same encoding loop; RunLengthEncoder::encode additionally
+// includes the encoder's buffer handling. The results of both scans and of
+// RunLengthEncoder::encode are checked for equality
+
+// former scalar run scanning
+struct ScalarScan{
+  template<class T>
+  static inline const T *find(const T *first, const T *last, T val){
+    return find_first_not_no_opt(first,last,val);
+  }
+  static inline const icl8u *find(const icl8u *first, const icl8u *last, icl8u val){
+    return find_first_not_4_bytes(first,last,val);
+  }
+};
+
+// run scanning as used by the RunLengthEncoder (SIMD if available)
+struct CurrentScan{
+  template<class T>
+  static inline const T *find(const T *first, const T *last, T val){
+    return find_first_not(first,last,val);
+  }
+};
+
+// reference encoding of the image ROI using the given run scanning (returns the number of line segments)
+template<class Scan, class T>
+int encode(const Img<T> &image, std::vector<WorkingLineSegment> &buf){
+  const Rect r = image.getROI();
+  buf.resize(r.width*r.height);
+  int n = 0;
+  for(int y=0;y<r.height;++y){
+    const T *pBegin = &image(r.x,r.y+y,0), *pEnd = pBegin + r.width, *p = pBegin;
+    while(p < pEnd){
+      const T *q = Scan::find(p+1,pEnd,*p);
+      buf[n++].init(r.x+(int)(p-pBegin),r.y+y,r.x+(int)(q-pBegin),*p);
+      p = q;
+    }
+  }
+  return n;
+}
+
+bool equal_segments(const WorkingLineSegment &a, const WorkingLineSegment &b){
+  return a.x == b.x && a.xend == b.xend && a.y == b.y && a.val == b.val;
+}
+
+// compares two reference encodings
+bool equal_encoding(const std::vector<WorkingLineSegment> &a, int na, const std::vector<WorkingLineSegment> &b, int nb){
+  if(na != nb) return false;
+  for(int i=0;i<na;++i){
+    if(!equal_segments(a[i],b[i])) return false;
+  }
+  return true;
+}
+
+// compares the RunLengthEncoder's result with a reference encoding
+bool equal_encoding(const RunLengthEncoder &rle, const std::vector<WorkingLineSegment> &buf, int n, int h){
+  int i = 0;
+  for(int y=0;y<h;++y){
+    for(const WorkingLineSegment *s=rle.begin(y); s != rle.end(y); ++s, ++i){
+      if(i >= n || !equal_segments(*s,buf[i])) return false;
+    }
+  }
+  return i == n;
+}
+
+enum Content { binary, labels, noise };
+
+template<class T>
+Img<T> create_image(const Size &size, Content c){
+  Img<T> image(size,1);
+  for(int y=0;y<size.height;++y){
+    for(int x=0;x<size.width;++x){
+      switch(c){
+        case binary: // a few large blobs
+          image(x,y,0) = 255*(((x-size.width/2)*(x-size.width/2)+(y-size.height/2)*(y-size.height/2)) % 40000 < 20000);
+          break;
+        case labels: // 20 labels in 37x23 cells
+          image(x,y,0) = (x/37 + 7*(y/23)) % 20;
+          break;
+        case noise:
+          image(x,y,0) = rand() % 4;
+          break;
+      }
+    }
+  }
+  return image;
+}
+
+template<class T>
+void bench(const char *depthName, const Size &size, Content c, const char *contentName, bool roi){
+  Img<T> image = create_image<T>(size,c);
+  if(roi) image.setROI(Rect(5,3,size.width-10,size.height-7));
+  const int pixels = image.getROISize().getDim();
+
+  std::vector<WorkingLineSegment> scalarBuf, buf;
+  int nScalar = 0, n = 0, iterations = 0;
+  Time t = Time::now();
+  while((Time::now()-t).toMilliSecondsDouble() < 500 || iterations < 3){
+    nScalar = encode<ScalarScan>(image,scalarBuf);
+    ++iterations;
+  }
+  const double scalarMs = (Time::now()-t).toMilliSecondsDouble()/iterations;
+
+  iterations = 0;
+  t = Time::now();
+  while((Time::now()-t).toMilliSecondsDouble() < 500 || iterations < 3){
+    n = encode<CurrentScan>(image,buf);
+    ++iterations;
+  }
+  const double currentMs = (Time::now()-t).toMilliSecondsDouble()/iterations;
+
+  RunLengthEncoder rle;
+  iterations = 0;
+  t = Time::now();
+  while((Time::now()-t).toMilliSecondsDouble() < 500 || iterations < 3){
+    rle.encode(&image);
+    ++iterations;
+  }
+  const double rleMs = (Time::now()-t).toMilliSecondsDouble()/iterations;
+
+  std::printf("%-4s %-7s %-8s %8d segments | MPix/s: scalar scan %7.1f, current scan %7.1f, RunLengthEncoder::encode %7.1f | %s\n",
+              depthName, contentName, roi ? "roi" : "full-roi", n,
+              pixels/scalarMs/1000, pixels/currentMs/1000, pixels/rleMs/1000,
+              (equal_encoding(scalarBuf,nScalar,buf,n) &&
+               equal_encoding(rle,buf,n,image.getROIHeight())) ? "ok" : "MISMATCH");
+}
+
+template<class T>
+void bench_all(const char *depthName, const Size &size){
+  static const char *names[] = { "binary", "labels", "noise" };
+  for(int c=binary;c<=noise;++c){
+    for(int roi=0;roi<2;++roi){
+      bench<T>(depthName,size,(Content)c,names[c],roi);
+    }
+  }
+}
+
+int main(){
+  const Size size(1920,1080);
+  bench_all<icl8u>("8u",size);
+  bench_all<icl16s>("16s",size);
+  bench_all<icl32s>("32s",size);
+}
@@ -31,6 +31,7 @@
 #include <ICLIO/FileList.h>
 #include <ICLFilter/ProximityOp.h>
 #include <ICLCV/CV.h>
+#include <ICLCV/PyramidTemplateSearch.h>
 #include <ICLFilter/BinaryLogicalOp.h>
 #ifdef ICL_HAVE_IPP
 #include <ippi.h>
@@ -122,8 +123,8 @@ namespace icl{
         bufOffs.y += templ.getROISize().height/2;
         useBuffer->setROI(Rect(bufOffs,bufSize));
       }
-      for(int i=0;i<src.getChannels();i++){
   #ifdef ICL_HAVE_IPP
+      for(int i=0;i<src.getChannels();i++){
         if(useCrossCorrCoeffInsteadOfSqrDistance){
           ippiCrossCorrValid_Norm_8u_C1RSfs(src.getROIData(i),src.getLineStep(),
                                             src.getROISize(), templ.getROIData(i),
@@ -137,12 +138,25 @@ namespace icl{
                                               useBuffer->getROIData(i),
                                               useBuffer->getLineStep(),-8);
         }
+      }
   #else
-
-
-    ERROR_LOG("not supported without IPP");
-  #endif
+      // same scaling as the IPP functions above (scale factor 2^8)
+      ProximityOp prox(useCrossCorrCoeffInsteadOfSqrDistance ? ProximityOp::crossCorr : ProximityOp::sqrDistance,
+                       ProximityOp::valid);
+      ImgBase *proxResult = 0;
+      prox.apply(&src,&templ,&proxResult);
+      const Img32f &r = *proxResult->as32f();
+      for(int i=0;i<src.getChannels();i++){
+        for(int y=0;y<bufSize.height;++y){
+          const icl32f *s = r.getData(i) + y*bufSize.width;
+          icl8u *d = useBuffer->getROIData(i) + y*useBuffer->getWidth();
+          for(int x=0;x<bufSize.width;++x){
+            d[x] = clipped_cast<icl32f,icl8u>(s[x]*256 + 0.5f);
+          }
+        }
       }
+      delete proxResult;
+  #endif
 
       Img8u &m = *useBuffer;
 
@@ -284,6 +298,32 @@ namespace icl{
       return results;
     }
 
+    std::vector<Rect> matchTemplatePyramid(const Img8u &src,
+                                           const Img8u &templ,
+                                           float significance,
+                                           int levels,
+                                           int maxCandidates,
+                                           bool useCrossCorrCoeffInsteadOfSqrDistance){
+      std::vector<Rect> resultVec;
+      ICLASSERT_RETURN_VAL(src.getChannels() == templ.getChannels(), resultVec);
+      ICLASSERT_RETURN_VAL(src.getROIWidth() >= templ.getROIWidth() &&
+                           src.getROIHeight() >= templ.getROIHeight(), resultVec);
+
+      PyramidTemplateSearch search(useCrossCorrCoeffInsteadOfSqrDistance ? ProximityOp::crossCorr : ProximityOp::sqrDistance,
+                                   levels, maxCandidates);
+      search.setTemplates(std::vector<SmartPtr<Img8u> >(1,SmartPtr<Img8u>(const_cast<Img8u*>(&templ),false)));
+      search.setImage(src);
+
+      const std::vector<PyramidTemplateSearch::Candidate> cs = search.search(std::vector<int>(1,0));
+      const float t = useCrossCorrCoeffInsteadOfSqrDistance ? significance : 1-significance;
+      for(size_t i=0;i<cs.size();++i){
+        if(cs[i].proximityValue == t || search.isBetter(cs[i].proximityValue,t)){
+          resultVec.push_back(Rect(cs[i].pos,templ.getROISize()) & src.getImageRect());
+        }
+      }
+      return resultVec;
+    }
+
 
 
 
@@ -258,6 +258,36 @@ namespace icl{
                                            bool useCrossCorrCoeffInsteadOfSqrDistance=false);
 
 
+    /// coarse-to-fine template matching on a Gaussian image pyramid
+    /** Instead of thresholding the full resolution proximity map, the
+        template is matched against the coarsest level of a Gaussian image
+        pyramid of src's ROI, and only the best maxCandidates local maxima
+        are refined at the finer levels (see PyramidTemplateSearch). This is
+        much faster than matchTemplate for large images. However, at most
+        maxCandidates results can be found, and matches that are too small
+        to survive the subsampling may be missed.
+
+        The same significance rules as for matchTemplate apply: the
+        normalized cross correlation must be at least significance, or the
+        normalized square distance must be at most 1-significance.
+        For multi-channel images, the per-channel proximity values
+        are averaged.
+
+        @param src source image where the template should be found in
+        @param templ template to search in the src image
+        @param significance significance level in range [0,1]
+        @param levels number of pyramid levels (reduced automatically for small templates)
+        @param maxCandidates number of candidates that are refined
+        @param useCrossCorrCoeffInsteadOfSqrDistance see matchTemplate
+        @return rects of the template size at the matched positions,
+                sorted by match quality (best first)
+    **/
+    std::vector<utils::Rect> ICLCV_API matchTemplatePyramid(const core::Img8u &src,
+                                                  const core::Img8u &templ,
+                                                  float significance,
+                                                  int levels=3,
+                                                  int maxCandidates=16,
+                                                  bool useCrossCorrCoeffInsteadOfSqrDistance=false);
 
   } // namespace cv
 } // namespace icl
@@ -133,6 +133,7 @@ namespace icl{
 
     Point32f ImageRegion::getCOG() const{
       // {{{ open
+      if(m_data->moments) return m_data->moments->getCOG(m_data->id);
       ImageRegionData::SimpleInformation *simple = m_data->ensureSimple();
       if(simple->cog) return *simple->cog;
 
@@ -157,6 +158,7 @@ namespace icl{
 
     const Rect &ImageRegion::getBoundingBox() const{
       // {{{ open
+      if(m_data->moments) return m_data->moments->boundingBoxes[m_data->id];
       ImageRegionData::SimpleInformation *simple = m_data->ensureSimple();
       if(simple->boundingBox) return *simple->boundingBox;
 
@@ -195,6 +197,7 @@ namespace icl{
 
     const RegionPCAInfo &ImageRegion::getPCAInfo() const {
       // {{{ open
+      if(m_data->moments) return m_data->moments->getPCAInfo(m_data->id);
       ImageRegionData::SimpleInformation *simple = m_data->ensureSimple();
       if(simple->pcainfo) return *simple->pcainfo;
 
@@ -226,17 +229,7 @@ namespace icl{
       avgYY/=nPts;
       avgXY/=nPts;
 
-
-      double fSxx = avgXX - avgX*avgX;
-      double fSyy = avgYY - avgY*avgY;
-      double fSxy = avgXY - avgX*avgY;
-
-      double fP = 0.5*(fSxx+fSyy);
-      double fD = 0.5*(fSxx-fSyy);
-      fD = ::sqrt(fD*fD + fSxy*fSxy);
-      double fA  = fP + fD;
-
-      return *(simple->pcainfo = new RegionPCAInfo(2*::sqrt(fP + fD),2*::sqrt(fP - fD),::atan2(fA-fSxx,fSxy),avgX,avgY));
+      return *(simple->pcainfo = new RegionPCAInfo(RegionPCAInfo::fromMoments(avgX,avgY,avgXX,avgXY,avgYY)));
     }
     // }}}
 
@@ -71,6 +71,9 @@ namespace icl{
         gravity is only calculated if the corresponding getter-function getCOG() is called.
         The results of all features are automatically stored internally. By this means, all features
         must only be computed once, even if the corresponding getter function is called several times.
+        If the parent RegionDetector uses its parallel labelling mode (see RegionDetector::setNumThreads),
+        size, center of gravity and bounding box are computed for all regions in a single batch,
+        and the PCA information is derived from the batch computed moments on demand.
 
         \section GRAPH Region Graph Information
         Some ImageRegion features are only available if the parent RegionDetector was
@@ -32,6 +32,8 @@
 #include <ICLCV/ImageRegionData.h>
 #include <ICLCV/ImageRegionPart.h>
 
+#include <limits>
+
 using namespace icl::utils;
 using namespace icl::core;
 
@@ -85,6 +87,62 @@ namespace icl{
 
 
 
+    void RegionMomentTable::resize(int n){
+      sizes.resize(n);
+      sumX.resize(n);
+      sumY.resize(n);
+      sumXX.resize(n);
+      sumXY.resize(n);
+      sumYY.resize(n);
+      boundingBoxes.resize(n);
+      pca.resize(n);
+      pcaValid.assign(n,0);
+    }
+
+    void RegionMomentTable::accumulate(ImageRegionData &region){
+      const int i = region.id;
+      const std::vector<LineSegment> &segments = region.segments;
+      int n = 0, minX = std::numeric_limits<int>::max(), minY = minX;
+      int maxX = std::numeric_limits<int>::min(), maxY = maxX;
+      double sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0;
+      for(std::vector<LineSegment>::const_iterator it = segments.begin(); it != segments.end(); ++it){
+        const int len = it->len();
+        const double y = it->y;
+        // sums over k = x..xend-1 of k and k*k in closed form
+        const double a = it->x, b = it->xend-1;
+        const double s1 = 0.5*(a+b)*len;
+        const double s2 = (b*(b+1)*(2*b+1) - (a-1)*a*(2*a-1))/6.0;
+        n += len;
+        sx += s1;
+        sy += len*y;
+        sxx += s2;
+        sxy += y*s1;
+        syy += len*y*y;
+        if(it->x < minX) minX = it->x;
+        if(it->xend > maxX) maxX = it->xend;
+        if(it->y < minY) minY = it->y;
+        if(it->y > maxY) maxY = it->y;
+      }
+      sizes[i] = n;
+      sumX[i] = sx;
+      sumY[i] = sy;
+      sumXX[i] = sxx;
+      sumXY[i] = sxy;
+      sumYY[i] = syy;
+      boundingBoxes[i] = Rect(minX,minY,maxX-minX,maxY-minY+1);
+      region.size = n;
+    }
+
+    const RegionPCAInfo &RegionMomentTable::getPCAInfo(int i){
+      if(!pcaValid[i]){
+        const double n = sizes[i];
+        const double avgX = sumX[i]/n, avgY = sumY[i]/n;
+        pca[i] = RegionPCAInfo::fromMoments(avgX, avgY, sumXX[i]/n, sumXY[i]/n, sumYY[i]/n);
+        pcaValid[i] = 1;
+      }
+      return pca[i];
+    }
+
     void ImageRegionData::showTree(int indent) const{
       ICLASSERT_RETURN(graph);
       for(int i=0;i<indent-1;++i) std::cout << "   ";
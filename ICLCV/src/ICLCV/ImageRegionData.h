@@ -44,6 +44,42 @@
 namespace icl{
   namespace cv{
 
+    /** \cond */
+    struct ImageRegionData;
+    /** \endcond */
+
+    /// Structure-of-arrays containing the moment features of all regions of a detection step \ingroup G_RD
+    /** The table is filled in a single batch by the RegionDetector's parallel
+        labelling mode (see RegionDetector::setNumThreads). All arrays are
+        indexed by region ID. ImageRegion::getCOG(), ImageRegion::getBoundingBox() and
+        ImageRegion::getPCAInfo() use the table instead of re-scanning the
+        region's line segments. The PCA information is derived on demand. */
+    struct ICLCV_API RegionMomentTable{
+      std::vector<int> sizes;                //!< pixel counts
+      std::vector<double> sumX;              //!< sum of x
+      std::vector<double> sumY;              //!< sum of y
+      std::vector<double> sumXX;             //!< sum of x*x
+      std::vector<double> sumXY;             //!< sum of x*y
+      std::vector<double> sumYY;             //!< sum of y*y
+      std::vector<utils::Rect> boundingBoxes; //!< bounding boxes
+      std::vector<RegionPCAInfo> pca;        //!< PCA information (valid if pcaValid is set)
+      std::vector<icl8u> pcaValid;           //!< flags for lazy PCA computation
+
+      /// resizes all arrays and invalidates the PCA information
+      void resize(int n);
+
+      /// accumulates the moments of the given region from its line segments (and sets its size)
+      void accumulate(ImageRegionData &region);
+
+      /// returns the center of gravity of region i
+      inline utils::Point32f getCOG(int i) const{
+        return utils::Point32f(sumX[i]/sizes[i], sumY[i]/sizes[i]);
+      }
+
+      /// returns the PCA information of region i (computed on first access)
+      const RegionPCAInfo &getPCAInfo(int i);
+    };
+
     /// Utility class for shallow copied data of image region class  \ingroup G_RD
     /** Note: a nested class of ImageRegion is not possible as we need forward
         declarations of this class. Nested classes cannot be 'forward-declared' */
@@ -53,6 +89,7 @@ namespace icl{
     public:
       friend class RegionDetector;
       friend struct ImageRegion;
+      friend struct RegionMomentTable;
       friend bool region_search_border(std::set<IRD*>&,IRD*);
       friend void collect_subregions_recursive(std::set<IRD*>&,IRD*);
       friend bool is_region_contained(IRD*,IRD*);
@@ -169,13 +206,40 @@ namespace icl{
 
       CornerDetectorCSS *css; //!< for corner detection
 
+      /// batch computed moment features (only set in parallel labelling mode, indexed by id)
+      RegionMomentTable *moments;
+
       /// Utility factory function
       static ImageRegionData *createInstance(CornerDetectorCSS *css, ImageRegionPart *topRegionPart, int id, bool createGraphInfo, const core::ImgBase *image);
 
       /// Constructor
       inline ImageRegionData(CornerDetectorCSS *css, int value, int id, unsigned int segmentSize, bool createGraph,const core::ImgBase *image):
         value(value),id(id),size(0),image(image),segments(segmentSize),graph(createGraph ? new RegionGraphInfo : 0),
-      simple(0),complex(0),css(css){}
+      simple(0),complex(0),css(css),moments(0){}
+
+      /// re-initializes a formerly used instance (the segment buffer's capacity is reused)
+      inline void reinit(int value, int id, unsigned int segmentSize, bool createGraph,
+                         const core::ImgBase *image, RegionMomentTable *moments){
+        this->value = value;
+        this->id = id;
+        this->size = 0;
+        this->image = image;
+        this->segments.resize(segmentSize);
+        this->meta = utils::Any();
+        if(!createGraph){
+          ICL_DELETE(graph);
+        }else if(graph){
+          graph->isBorder = false;
+          graph->neighbours.clear();
+          graph->children.clear();
+          graph->parent = 0;
+        }else{
+          graph = new RegionGraphInfo;
+        }
+        ICL_DELETE(simple);
+        ICL_DELETE(complex);
+        this->moments = moments;
+      }
 
       /// Destructor
       inline ~ImageRegionData(){
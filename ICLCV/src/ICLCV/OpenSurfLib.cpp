@@ -45,6 +45,8 @@
 
 
 #include <ICLCV/OpenSurfLib.h>
+#include <ICLCV/SurfFeatureMatcher.h>
+#include <ICLUtils/ThreadPool.h>
 
 #include <iostream>
 #include <fstream>
@@ -69,7 +71,8 @@ namespace icl{
                      const int octaves = OCTAVES,
                      const int intervals = INTERVALS,
                      const int init_sample = INIT_SAMPLE,
-                     const float thres = THRES);
+                     const float thres = THRES,
+                     const int numThreads = 1);
 
          /// Constructor with image
          FastHessian(IplImage *img,
@@ -77,7 +80,8 @@ namespace icl{
                      const int octaves = OCTAVES,
                      const int intervals = INTERVALS,
                      const int init_sample = INIT_SAMPLE,
-                     const float thres = THRES);
+                     const float thres = THRES,
+                     const int numThreads = 1);
 
          /// Destructor
          ~FastHessian();
@@ -96,11 +100,16 @@ namespace icl{
 
          private:
 
+         /** \cond */
+         struct BuildResponseRows;
+         /** \endcond */
+
          /// Build map of DoH responses
+         /** The layers are split into chunks of rows that are processed in parallel */
          void buildResponseMap();
 
-         /// Calculate DoH responses for supplied layer
-         void buildResponseLayer(ResponseLayer *r);
+         /// Calculate DoH responses for the rows [rowBegin,rowEnd) of the supplied layer
+         void buildResponseLayer(ResponseLayer *r, int rowBegin, int rowEnd);
 
          /// 3x3x3 Extrema test
          int isExtremum(int r, int c, ResponseLayer *t, ResponseLayer *m, ResponseLayer *b);
@@ -133,6 +142,47 @@ namespace icl{
 
          /// Threshold value for blob resonses
          float thresh;
+
+         /// Number of threads used for the response map
+         int numThreads;
+       };
+
+
+       /// computes the sum of pixels within the rectangle (like BoxIntegral)
+       /** If CHECKED is false, the rectangle must fulfill row >= 1, col >= 1,
+           row+rows <= img->height and col+cols <= img->width. In this case, the
+           bounds checks are skipped */
+       template<bool CHECKED>
+       inline float box_integral(IplImage *img, int row, int col, int rows, int cols){
+         return BoxIntegral(img, row, col, rows, cols);
+       }
+
+       template<>
+       inline float box_integral<false>(IplImage *img, int row, int col, int rows, int cols){
+         const int step = img->widthStep/sizeof(float);
+         const float *a = (const float *) img->imageData + (row-1) * step + (col-1);
+         const float *c = a + rows * step;
+         return std::max(0.f, a[0] - a[cols] - c[0] + c[cols]);
+       }
+
+
+
+       /// processes chunks of response layer rows (used by FastHessian::buildResponseMap)
+       struct FastHessian::BuildResponseRows{
+         struct Chunk{
+           ResponseLayer *layer;
+           int rowBegin;
+           int rowEnd;
+         };
+
+         FastHessian &fh;
+         const std::vector<Chunk> &chunks;
+
+         void operator()(int begin, int end) const{
+           for(int i=begin;i<end;++i){
+             fh.buildResponseLayer(chunks[i].layer, chunks[i].rowBegin, chunks[i].rowEnd);
+           }
+         }
        };
 
 
@@ -140,8 +190,8 @@ namespace icl{
       //! Constructor without image
       FastHessian::FastHessian(std::vector<Ipoint> &ipts,
                                const int octaves, const int intervals, const int init_sample,
-                               const float thresh)
-        :i_width(0), i_height(0), ipts(ipts)
+                               const float thresh, const int numThreads)
+        :i_width(0), i_height(0), ipts(ipts), numThreads(numThreads)
       {
         // Save parameter set
         saveParameters(octaves, intervals, init_sample, thresh);
@@ -152,8 +202,8 @@ namespace icl{
       //! Constructor with image
       FastHessian::FastHessian(IplImage *img, std::vector<Ipoint> &ipts,
                                const int octaves, const int intervals, const int init_sample,
-                               const float thresh)
-        : i_width(0), i_height(0),ipts(ipts)
+                               const float thresh, const int numThreads)
+        : i_width(0), i_height(0),ipts(ipts),numThreads(numThreads)
       {
         // Save parameter set
         saveParameters(octaves, intervals, init_sample, thresh);
@@ -293,17 +343,27 @@ namespace icl{
             responseMap.push_back(new ResponseLayer(w/16, h/16, s*16, 387));
           }
 
-        // Extract responses from the image
+        // Extract responses from the image:
+        // all layers of all octaves are split into chunks of 16 rows, which
+        // are distributed dynamically (the layers' sizes differ a lot)
+        static const int CHUNK_ROWS = 16;
+        std::vector<BuildResponseRows::Chunk> chunks;
         for (unsigned int i = 0; i < responseMap.size(); ++i)
           {
-            buildResponseLayer(responseMap[i]);
+            for (int r = 0; r < responseMap[i]->height; r += CHUNK_ROWS)
+              {
+                BuildResponseRows::Chunk c = { responseMap[i], r, std::min(r + CHUNK_ROWS, responseMap[i]->height) };
+                chunks.push_back(c);
+              }
           }
+        BuildResponseRows f = { *this, chunks };
+        utils::parallel_for(0, (int)chunks.size(), f, 1, numThreads);
       }
 
 
 
-      //! Calculate DoH responses for supplied layer
-      void FastHessian::buildResponseLayer(ResponseLayer *rl)
+      //! Calculate DoH responses for the rows [rowBegin,rowEnd) of the supplied layer
+      void FastHessian::buildResponseLayer(ResponseLayer *rl, int rowBegin, int rowEnd)
       {
         float *responses = rl->responses;         // response storage
         unsigned char *laplacian = rl->laplacian; // laplacian sign storage
@@ -314,23 +374,41 @@ namespace icl{
         float inverse_area = 1.f/(w*w);           // normalisation factor
         float Dxx, Dyy, Dxy;
 
-        for(int r, c, ar = 0, index = 0; ar < rl->height; ++ar)
+        // all boxes of the filter are within the rows/columns [r-b, r+b)
+        // resp. [c-b, c+b), so the bounds checks can be skipped for r,c in (b, size-b)
+        for(int r, c, ar = rowBegin, index = rowBegin * rl->width; ar < rowEnd; ++ar)
           {
+            r = ar * step;
+            const bool inner_row = (r > b && r + b < i_height);
+
             for(int ac = 0; ac < rl->width; ++ac, index++)
               {
                 // get the image coordinates
-                r = ar * step;
                 c = ac * step;
 
                 // Compute response components
-                Dxx = BoxIntegral(img, r - l + 1, c - b, 2*l - 1, w)
-                - BoxIntegral(img, r - l + 1, c - l / 2, 2*l - 1, l)*3;
-                Dyy = BoxIntegral(img, r - b, c - l + 1, w, 2*l - 1)
-                - BoxIntegral(img, r - l / 2, c - l + 1, l, 2*l - 1)*3;
-                Dxy = + BoxIntegral(img, r - l, c + 1, l, l)
-                + BoxIntegral(img, r + 1, c - l, l, l)
-                - BoxIntegral(img, r - l, c - l, l, l)
-                - BoxIntegral(img, r + 1, c + 1, l, l);
+                if(inner_row && c > b && c + b < i_width)
+                  {
+                    Dxx = box_integral<false>(img, r - l + 1, c - b, 2*l - 1, w)
+                    - box_integral<false>(img, r - l + 1, c - l / 2, 2*l - 1, l)*3;
+                    Dyy = box_integral<false>(img, r - b, c - l + 1, w, 2*l - 1)
+                    - box_integral<false>(img, r - l / 2, c - l + 1, l, 2*l - 1)*3;
+                    Dxy = + box_integral<false>(img, r - l, c + 1, l, l)
+                    + box_integral<false>(img, r + 1, c - l, l, l)
+                    - box_integral<false>(img, r - l, c - l, l, l)
+                    - box_integral<false>(img, r + 1, c + 1, l, l);
+                  }
+                else
+                  {
+                    Dxx = BoxIntegral(img, r - l + 1, c - b, 2*l - 1, w)
+                    - BoxIntegral(img, r - l + 1, c - l / 2, 2*l - 1, l)*3;
+                    Dyy = BoxIntegral(img, r - b, c - l + 1, w, 2*l - 1)
+                    - BoxIntegral(img, r - l / 2, c - l + 1, l, 2*l - 1)*3;
+                    Dxy = + BoxIntegral(img, r - l, c + 1, l, l)
+                    + BoxIntegral(img, r + 1, c - l, l, l)
+                    - BoxIntegral(img, r - l, c - l, l, l)
+                    - BoxIntegral(img, r + 1, c + 1, l, l);
+                  }
 
                 // Normalise the filter responses with respect to their size
                 Dxx *= inverse_area;
@@ -343,7 +421,7 @@ namespace icl{
 
 #ifdef RL_DEBUG
                 // create list of the image coords for each response
-                rl->coords.push_back(std::make_pair<int,int>(r,c));
+                rl->coords[index] = std::make_pair(r,c);
 #endif
               }
           }
@@ -551,35 +629,20 @@ namespace icl{
       //! Populate IpPairVec with matched ipts
       void getMatches(IpVec &ipts1, IpVec &ipts2, IpPairVec &matches)
       {
-        float dist, d1, d2;
-        Ipoint *match = 0;
+        SurfFeatureMatcher matcher;
+        matcher.setReferenceFeatures(ipts2);
 
-        matches.clear();
+        std::vector<int> idx;
+        matcher.findMatches(ipts1, 0.65f, idx);
 
+        matches.clear();
         for(unsigned int i = 0; i < ipts1.size(); i++)
           {
-            d1 = d2 = FLT_MAX;
-
-            for(unsigned int j = 0; j < ipts2.size(); j++)
-              {
-                dist = ipts1[i] - ipts2[j];
-
-                if(dist<d1) // if this feature matches better than current best
-                  {
-                    d2 = d1;
-                    d1 = dist;
-                    match = &ipts2[j];
-                  }
-                else if(dist<d2) // this feature matches better than second best
-                  {
-                    d2 = dist;
-                  }
-              }
-
             // If match has a d1:d2 ratio < 0.65 ipoints are a match
-            if(d1/d2 < 0.65)
+            if(idx[i] >= 0)
               {
                 // Store the change in position
+                Ipoint *match = &ipts2[idx[i]];
                 ipts1[i].dx = match->x - ipts1[i].x;
                 ipts1[i].dy = match->y - ipts1[i].y;
                 matches.push_back(std::make_pair(ipts1[i], *match));
@@ -668,14 +731,28 @@ namespace icl{
 
 
       //! Constructor
-      Surf::Surf(IplImage *img, IpVec &ipts)
-        : ipts(ipts)
+      Surf::Surf(IplImage *img, IpVec &ipts, int numThreads)
+        : ipts(ipts), numThreads(numThreads)
       {
         this->img = img;
       }
 
 
 
+      /// describes a range of Ipoints (used by Surf::getDescriptors)
+      struct Surf::DescribeRange{
+        Surf &surf;
+        bool upright;
+
+        void operator()(int begin, int end) const{
+          for(int i=begin;i<end;++i){
+            surf.describe(surf.ipts[i], upright);
+          }
+        }
+      };
+
+
+
       //! Describe all features in the supplied vector
       void Surf::getDescriptors(bool upright)
       {
@@ -685,39 +762,44 @@ namespace icl{
         // Get the size of the vector for fixed loop bounds
         int ipts_size = (int)ipts.size();
 
-        if (upright)
-          {
-            // U-SURF loop just gets descriptors
-            for (int i = 0; i < ipts_size; ++i)
-              {
-                // Set the Ipoint to be described
-                index = i;
+        // U-SURF just gets descriptors, while the main SURF-64
+        // loop assigns orientations and gets descriptors
+        DescribeRange f = { *this, upright };
+        utils::parallel_for(0, ipts_size, f, 4, numThreads);
+      }
 
-                // Extract upright (i.e. not rotation invariant) descriptors
-                getDescriptor(true);
-              }
-          }
-        else
-          {
-            // Main SURF-64 loop assigns orientations and gets descriptors
-            for (int i = 0; i < ipts_size; ++i)
-              {
-                // Set the Ipoint to be described
-                index = i;
 
-                // Assign Orientations and extract rotation invariant descriptors
-                getOrientation();
-                getDescriptor(false);
-              }
+
+      //! Assign orientation (if not upright) and descriptor to the given Ipoint
+      void Surf::describe(Ipoint &ipt, bool upright)
+      {
+        const int x = fRound(ipt.x), y = fRound(ipt.y);
+
+        if (!upright)
+          {
+            // haar samples (size 4*s) are within 5*s around the Ipoint
+            const int m = 7 * fRound(ipt.scale);
+            if (x - m >= 1 && x + m <= img->width && y - m >= 1 && y + m <= img->height)
+              getOrientation<false>(ipt);
+            else
+              getOrientation<true>(ipt);
           }
+
+        // haar samples (size 2*scale) are within sqrt(2)*12*scale around the Ipoint
+        const int m = (int)ceil(17.f * ipt.scale) + 1 + fRound(ipt.scale);
+        if (x - m >= 1 && x + m <= img->width && y - m >= 1 && y + m <= img->height)
+          getDescriptor<false>(ipt, upright);
+        else
+          getDescriptor<true>(ipt, upright);
       }
 
 
 
       //! Assign the supplied Ipoint an orientation
-      void Surf::getOrientation()
+      template<bool CHECKED>
+      void Surf::getOrientation(Ipoint &point)
       {
-        Ipoint *ipt = &ipts[index];
+        Ipoint *ipt = &point;
         float gauss = 0.f, scale = ipt->scale;
         const int s = fRound(scale), r = fRound(ipt->y), c = fRound(ipt->x);
         std::vector<float> resX(109), resY(109), Ang(109);
@@ -732,8 +814,8 @@ namespace icl{
                 if(i*i + j*j < 36)
                   {
                     gauss = static_cast<float>(gauss25[id[i+6]][id[j+6]]);
-                    resX[idx] = gauss * haarX(r+j*s, c+i*s, 4*s);
-                    resY[idx] = gauss * haarY(r+j*s, c+i*s, 4*s);
+                    resX[idx] = gauss * haarX<CHECKED>(r+j*s, c+i*s, 4*s);
+                    resY[idx] = gauss * haarY<CHECKED>(r+j*s, c+i*s, 4*s);
                     Ang[idx] = getAngle(resX[idx], resY[idx]);
                     ++idx;
                   }
@@ -786,7 +868,8 @@ namespace icl{
 
       //! Get the modified descriptor. See Agrawal ECCV 08
       //! Modified descriptor contributed by Pablo Fernandez
-      void Surf::getDescriptor(bool bUpright)
+      template<bool CHECKED>
+      void Surf::getDescriptor(Ipoint &point, bool bUpright)
       {
         int y, x, sample_x, sample_y, count=0;
         int i = 0, ix = 0, j = 0, jx = 0, xs = 0, ys = 0;
@@ -795,7 +878,7 @@ namespace icl{
         float rx = 0.f, ry = 0.f, rrx = 0.f, rry = 0.f, len = 0.f;
         float cx = -0.5f, cy = 0.f; //Subregion centers for the 4x4 gaussian weighting
 
-        Ipoint *ipt = &ipts[index];
+        Ipoint *ipt = &point;
         scale = ipt->scale;
         x = fRound(ipt->x);
         y = fRound(ipt->y);
@@ -846,8 +929,8 @@ namespace icl{
 
                         //Get the gaussian weighted x and y responses
                         gauss_s1 = gaussian(xs-sample_x,ys-sample_y,2.5f*scale);
-                        rx = haarX(sample_y, sample_x, 2*fRound(scale));
-                        ry = haarY(sample_y, sample_x, 2*fRound(scale));
+                        rx = haarX<CHECKED>(sample_y, sample_x, 2*fRound(scale));
+                        ry = haarY<CHECKED>(sample_y, sample_x, 2*fRound(scale));
 
                         //Get the gaussian weighted x and y responses on rotated axis
                         rrx = gauss_s1*(-rx*si + ry*co);
@@ -903,19 +986,21 @@ namespace icl{
 
 
       //! Calculate Haar wavelet responses in x direction
+      template<bool CHECKED>
       inline float Surf::haarX(int row, int column, int s)
       {
-        return BoxIntegral(img, row-s/2, column, s, s/2)
-        -1 * BoxIntegral(img, row-s/2, column-s/2, s, s/2);
+        return box_integral<CHECKED>(img, row-s/2, column, s, s/2)
+        -1 * box_integral<CHECKED>(img, row-s/2, column-s/2, s, s/2);
       }
 
 
 
       //! Calculate Haar wavelet responses in y direction
+      template<bool CHECKED>
       inline float Surf::haarY(int row, int column, int s)
       {
-        return BoxIntegral(img, row, column-s/2, s/2, s)
-        -1 * BoxIntegral(img, row-s/2, column-s/2, s/2, s);
+        return box_integral<CHECKED>(img, row, column-s/2, s/2, s)
+        -1 * box_integral<CHECKED>(img, row-s/2, column-s/2, s/2, s);
       }
 
 
@@ -1273,19 +1358,20 @@ namespace icl{
                       int octaves, /* number of octaves to calculate */
                       int intervals, /* number of intervals per octave */
                       int init_sample, /* initial sampling step */
-                      float thres /* blob response threshold */)
+                      float thres, /* blob response threshold */
+                      int numThreads /* number of threads */)
       {
         // Create integral-image representation of the image
         IplImage *int_img = Integral(img);
 
         // Create Fast Hessian Object
-        FastHessian fh(int_img, ipts, octaves, intervals, init_sample, thres);
+        FastHessian fh(int_img, ipts, octaves, intervals, init_sample, thres, numThreads);
 
         // Extract interest points and store in vector ipts
         fh.getIpoints();
 
         // Create Surf Descriptor Object
-        Surf des(int_img, ipts);
+        Surf des(int_img, ipts, numThreads);
 
         // Extract the descriptors for the ipts
         des.getDescriptors(upright);
@@ -1301,13 +1387,14 @@ namespace icl{
                    int octaves, /* number of octaves to calculate */
                    int intervals, /* number of intervals per octave */
                    int init_sample, /* initial sampling step */
-                   float thres /* blob response threshold */)
+                   float thres, /* blob response threshold */
+                   int numThreads /* number of threads */)
       {
         // Create integral image representation of the image
         IplImage *int_img = Integral(img);
 
         // Create Fast Hessian Object
-        FastHessian fh(int_img, ipts, octaves, intervals, init_sample, thres);
+        FastHessian fh(int_img, ipts, octaves, intervals, init_sample, thres, numThreads);
 
         // Extract interest points and store in vector ipts
         fh.getIpoints();
@@ -1322,13 +1409,14 @@ namespace icl{
       //! Library function describes interest points in vector
       void surfDes(IplImage *img,  /* image to find Ipoints in */
                    std::vector<Ipoint> &ipts, /* reference to vector of Ipoints */
-                   bool upright) /* run in rotation invariant mode? */
+                   bool upright, /* run in rotation invariant mode? */
+                   int numThreads) /* number of threads */
       {
         // Create integral image representation of the image
         IplImage *int_img = Integral(img);
 
         // Create Surf Descriptor Object
-        Surf des(int_img, ipts);
+        Surf des(int_img, ipts, numThreads);
 
         // Extract the descriptors for the ipts
         des.getDescriptors(upright);
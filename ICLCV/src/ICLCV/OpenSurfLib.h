@@ -67,6 +67,8 @@ namespace icl{
        /** \endcond */
 
 
+       /// Populate matches with the ipts1 features whose nearest neighbour in ipts2 passes the 0.65 ratio test
+       /** The matching itself is done by a SurfFeatureMatcher */
        ICLCV_API void getMatches(IpVec &ipts1, IpVec &ipts2, IpPairVec &matches);
 
        ICLCV_API int translateCorners(IpPairVec &matches, const CvPoint src_corners[4], CvPoint dst_corners[4]);
@@ -145,6 +147,9 @@ namespace icl{
 
            memset(responses,0,sizeof(float)*width*height);
            memset(laplacian,0,sizeof(unsigned char)*width*height);
+#ifdef RL_DEBUG
+           coords.resize(width*height);
+#endif
          }
 
          inline ~ResponseLayer(){
@@ -206,25 +211,41 @@ namespace icl{
          public:
 
          /// Standard Constructor (img is an integral image)
-         Surf(IplImage *img, std::vector<Ipoint> &ipts);
+         /** numThreads is the number of threads used by getDescriptors
+             (1: sequential, 0: all threads of the utils::ThreadPool) */
+         Surf(IplImage *img, std::vector<Ipoint> &ipts, int numThreads = 1);
 
          /// Describe all features in the supplied vector
          void getDescriptors(bool bUpright = false);
 
          private:
 
-         /// Assign the current Ipoint an orientation
-         void getOrientation();
+         /** \cond */
+         struct DescribeRange;
+         /** \endcond */
+
+         /// Assign and describe the given Ipoint
+         /** Uses the unchecked integral image access, if all samples of the
+             Ipoint are far enough from the image border */
+         void describe(Ipoint &ipt, bool bUpright);
+
+         /// Assign the given Ipoint an orientation
+         template<bool CHECKED>
+         void getOrientation(Ipoint &ipt);
 
          /// Get the descriptor. See Agrawal ECCV 08
-         void getDescriptor(bool bUpright = false);
+         template<bool CHECKED>
+         void getDescriptor(Ipoint &ipt, bool bUpright = false);
 
          /// Calculate the value of the 2d gaussian at x,y
          inline float gaussian(int x, int y, float sig);
          inline float gaussian(float x, float y, float sig);
 
          /// Calculate Haar wavelet responses in x and y directions
+         /** If CHECKED is false, the whole filter must be within the image */
+         template<bool CHECKED>
          inline float haarX(int row, int column, int size);
+         template<bool CHECKED>
          inline float haarY(int row, int column, int size);
 
          /// Get the angle from the +ve x-axis of the vector given by [X Y]
@@ -237,8 +258,8 @@ namespace icl{
          /// Ipoints vector
          IpVec &ipts;
 
-         /// Index of current Ipoint in the vector
-         int index;
+         /// Number of threads used for the descriptors
+         int numThreads;
        };
 
        static const int OCTAVES = 5;
@@ -253,7 +274,8 @@ namespace icl{
                        int octaves = OCTAVES, /* number of octaves to calculate */
                        int intervals = INTERVALS, /* number of intervals per octave */
                        int init_sample = INIT_SAMPLE, /* initial sampling step */
-                       float thres = THRES /* blob response threshold */);
+                       float thres = THRES, /* blob response threshold */
+                       int numThreads = 1 /* 1: sequential, 0: all threads of the ThreadPool */);
 
        /// Library function builds vector of interest points
        ICLCV_API void surfDet(IplImage *img,  /* image to find Ipoints in */
@@ -261,12 +283,14 @@ namespace icl{
                     int octaves = OCTAVES, /* number of octaves to calculate */
                     int intervals = INTERVALS, /* number of intervals per octave */
                     int init_sample = INIT_SAMPLE, /* initial sampling step */
-                    float thres = THRES /* blob response threshold */);
+                    float thres = THRES, /* blob response threshold */
+                    int numThreads = 1 /* 1: sequential, 0: all threads of the ThreadPool */);
 
        /// Library function describes interest points in vector
        ICLCV_API void surfDes(IplImage *img,  /* image to find Ipoints in */
                     std::vector<Ipoint> &ipts, /* reference to vector of Ipoints */
-                    bool upright = false); /* run in rotation invariant mode? */
+                    bool upright = false, /* run in rotation invariant mode? */
+                    int numThreads = 1); /* 1: sequential, 0: all threads of the ThreadPool */
 
 
        /// Display error message and terminate program
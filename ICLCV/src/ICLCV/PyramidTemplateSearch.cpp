@@ -0,0 +1,315 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCV/src/ICLCV/PyramidTemplateSearch.cpp              **
+** Module : ICLCV                                                  **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+#include <ICLCV/PyramidTemplateSearch.h>
+
+#include <algorithm>
+
+namespace icl{
+
+  using namespace utils;
+  using namespace core;
+  using namespace filter;
+
+  namespace cv{
+
+    namespace{
+      /// orders candidates by proximity value (best first)
+      struct CandidateOrder{
+        const PyramidTemplateSearch *search;
+        bool operator()(const PyramidTemplateSearch::Candidate &a,
+                        const PyramidTemplateSearch::Candidate &b) const{
+          return search->isBetter(a.proximityValue,b.proximityValue);
+        }
+      };
+
+      /// greedy non-maximum suppression on sorted candidates
+      std::vector<PyramidTemplateSearch::Candidate>
+      suppress_overlapping(const std::vector<PyramidTemplateSearch::Candidate> &sorted,
+                           int dx, int dy, int maxCount){
+        std::vector<PyramidTemplateSearch::Candidate> result;
+        for(size_t i=0;i<sorted.size() && (int)result.size() < maxCount;++i){
+          bool overlaps = false;
+          for(size_t j=0;j<result.size() && !overlaps;++j){
+            overlaps = ::abs(sorted[i].pos.x - result[j].pos.x) <= dx &&
+                       ::abs(sorted[i].pos.y - result[j].pos.y) <= dy;
+          }
+          if(!overlaps) result.push_back(sorted[i]);
+        }
+        return result;
+      }
+
+      inline int clamp_index(int i, int n){
+        return i < 0 ? 0 : i >= n ? n-1 : i;
+      }
+    }
+
+    PyramidTemplateSearch::PyramidTemplateSearch(ProximityOp::optype ot, int levels,
+                                                 int maxCandidates, int radius):
+      m_prox(ot,ProximityOp::valid),m_levels(1),m_maxCandidates(1),m_radius(1),m_buf(0){
+      setLevels(levels);
+      setMaxCandidates(maxCandidates);
+      setRadius(radius);
+    }
+
+    PyramidTemplateSearch::~PyramidTemplateSearch(){
+      ICL_DELETE(m_buf);
+    }
+
+    void PyramidTemplateSearch::setOpType(ProximityOp::optype ot){
+      m_prox.setOpType(ot);
+    }
+
+    ProximityOp::optype PyramidTemplateSearch::getOpType() const{
+      return m_prox.getOpType();
+    }
+
+    void PyramidTemplateSearch::setLevels(int levels){
+      m_levels = iclMax(1,levels);
+    }
+
+    void PyramidTemplateSearch::setMaxCandidates(int maxCandidates){
+      m_maxCandidates = iclMax(1,maxCandidates);
+    }
+
+    void PyramidTemplateSearch::setRadius(int radius){
+      m_radius = iclMax(1,radius);
+    }
+
+    void PyramidTemplateSearch::setNumThreads(int numThreads){
+      m_prox.setNumThreads(numThreads);
+    }
+
+    void PyramidTemplateSearch::setTemplates(const std::vector<SmartPtr<Img8u> > &templates){
+      m_templates = templates;
+      m_templatePyr.clear();
+    }
+
+    bool PyramidTemplateSearch::isBetter(float a, float b) const{
+      return m_prox.getOpType() == ProximityOp::sqrDistance ? a < b : a > b;
+    }
+
+    void PyramidTemplateSearch::pyrDown(const Img8u &src, Img8u &dst){
+      const int w = src.getROIWidth(), h = src.getROIHeight();
+      const int dw = (w+1)/2, dh = (h+1)/2;
+      dst.setChannels(src.getChannels());
+      dst.setSize(Size(dw,dh));
+      dst.setFullROI();
+      if(!w || !h) return;
+
+      // horizontal pass on all rows (evaluated at even columns only),
+      // vertical pass at even rows; kernel [1 4 6 4 1]/16 in both directions
+      std::vector<int> rows(dw*h);
+      std::vector<int> xs(w+4);
+      for(int x=-2;x<w+2;++x) xs[x+2] = clamp_index(x,w);
+      const int lineStep = src.getWidth();
+      for(int c=0;c<src.getChannels();++c){
+        const icl8u *s = src.getROIData(c);
+        for(int y=0;y<h;++y){
+          const icl8u *r = s + y*lineStep;
+          int *o = rows.data() + y*dw;
+          for(int x=0;x<dw;++x){
+            const int *i = xs.data() + 2*x;
+            o[x] = r[i[0]] + 4*(r[i[1]]+r[i[3]]) + 6*r[i[2]] + r[i[4]];
+          }
+        }
+        icl8u *d = dst.getData(c);
+        for(int y=0;y<dh;++y){
+          const int *r0 = rows.data() + clamp_index(2*y-2,h)*dw;
+          const int *r1 = rows.data() + clamp_index(2*y-1,h)*dw;
+          const int *r2 = rows.data() + clamp_index(2*y,h)*dw;
+          const int *r3 = rows.data() + clamp_index(2*y+1,h)*dw;
+          const int *r4 = rows.data() + clamp_index(2*y+2,h)*dw;
+          icl8u *o = d + y*dw;
+          for(int x=0;x<dw;++x){
+            o[x] = (icl8u)((r0[x] + 4*(r1[x]+r3[x]) + 6*r2[x] + r4[x] + 128) >> 8);
+          }
+        }
+      }
+    }
+
+    void PyramidTemplateSearch::updateTemplatePyramids(){
+      if(m_templatePyr.size() == m_templates.size() &&
+         (m_templatePyr.empty() || (int)m_templatePyr[0].size() == m_levels)) return;
+      m_templatePyr.resize(m_templates.size());
+      for(size_t i=0;i<m_templates.size();++i){
+        std::vector<Img8u> &pyr = m_templatePyr[i];
+        pyr.resize(m_levels);
+        pyr[0] = *m_templates[i];
+        for(int l=1;l<m_levels;++l){
+          pyrDown(pyr[l-1],pyr[l]);
+        }
+      }
+    }
+
+    void PyramidTemplateSearch::setImage(const Img8u &image){
+      m_imageOffset = image.getROIOffset();
+      m_imagePyr.resize(m_levels);
+      m_imagePyr[0] = image;
+      for(int l=1;l<m_levels;++l){
+        pyrDown(m_imagePyr[l-1],m_imagePyr[l]);
+      }
+    }
+
+    const Img32f &PyramidTemplateSearch::proximity(const Img8u &image, const Img8u &templ){
+      m_prox.apply(&image,&templ,&m_buf);
+      const Img32f &r = *m_buf->as32f();
+      if(r.getChannels() == 1) return r;
+      m_avg.setChannels(1);
+      m_avg.setSize(r.getSize());
+      const int dim = r.getDim(), channels = r.getChannels();
+      icl32f *d = m_avg.begin(0);
+      std::copy(r.begin(0),r.end(0),d);
+      for(int c=1;c<channels;++c){
+        const icl32f *s = r.begin(c);
+        for(int i=0;i<dim;++i) d[i] += s[i];
+      }
+      const float f = 1.0f/channels;
+      for(int i=0;i<dim;++i) d[i] *= f;
+      return m_avg;
+    }
+
+    PyramidTemplateSearch::Candidate PyramidTemplateSearch::refine(const Candidate &c, int level,
+                                                                   int indexStep, bool cyclicIndices){
+      const int n = (int)m_templates.size();
+      int indices[3] = { c.templateIndex, c.templateIndex-indexStep, c.templateIndex+indexStep };
+      const int numIndices = indexStep > 0 ? 3 : 1;
+
+      Img8u image = m_imagePyr[level];
+      const Rect bounds(level ? Point::null : m_imageOffset, image.getROISize());
+
+      Candidate best = c;
+      bool found = false;
+      for(int k=0;k<numIndices;++k){
+        int idx = indices[k];
+        if(cyclicIndices){
+          idx = ((idx % n) + n) % n;
+        }else if(idx < 0 || idx >= n){
+          continue;
+        }
+        if(k && idx == c.templateIndex) continue;
+
+        const Img8u &t = m_templatePyr[idx][level];
+        const Size ts = t.getROISize();
+        const Rect win = Rect(c.pos.x-m_radius, c.pos.y-m_radius,
+                              ts.width+2*m_radius, ts.height+2*m_radius) & Rect(Point::null,bounds.getSize());
+        if(win.width < ts.width || win.height < ts.height) continue;
+
+        image.setROI(win + bounds.ul());
+        const Img32f &m = proximity(image,t);
+        const icl32f *v = m.begin(0);
+        const int mw = m.getWidth(), dim = m.getDim();
+        for(int i=0;i<dim;++i){
+          if(!found || isBetter(v[i],best.proximityValue)){
+            best = Candidate(win.ul() + Point(i%mw,i/mw), idx, v[i]);
+            found = true;
+          }
+        }
+      }
+      return best;
+    }
+
+    std::vector<PyramidTemplateSearch::Candidate>
+    PyramidTemplateSearch::search(const std::vector<int> &coarseTemplateIndices,
+                                  int indexStep, int minIndexStep, bool cyclicIndices){
+      std::vector<Candidate> cs;
+      ICLASSERT_RETURN_VAL(m_templates.size() && m_imagePyr.size(), cs);
+      updateTemplatePyramids();
+
+      // number of levels that can actually be used
+      int levels = 1;
+      while(levels < m_levels && levels < (int)m_imagePyr.size()){
+        const Size ts = m_templatePyr[0][levels].getROISize();
+        const Size is = m_imagePyr[levels].getROISize();
+        if(ts.width < 4 || ts.height < 4 || is.width < ts.width || is.height < ts.height) break;
+        ++levels;
+      }
+      const int top = levels-1;
+      const int n = (int)m_templates.size();
+
+      // full search of the reduced template set at the coarsest level
+      for(size_t i=0;i<coarseTemplateIndices.size();++i){
+        const int idx = coarseTemplateIndices[i];
+        if(idx < 0 || idx >= n) continue;
+        const Img8u &t = m_templatePyr[idx][top];
+        const Img8u &image = m_imagePyr[top];
+        if(image.getROIWidth() < t.getROIWidth() || image.getROIHeight() < t.getROIHeight()) continue;
+
+        const Img32f &m = proximity(image,t);
+        const int w = m.getWidth(), h = m.getHeight();
+        const icl32f *v = m.begin(0);
+        for(int y=0;y<h;++y){
+          for(int x=0;x<w;++x){
+            const float p = v[x+w*y];
+            bool isMax = true;
+            // p must be strictly better than the neighbours that precede it
+            // in raster order, so that each plateau yields a single candidate
+            for(int yy=iclMax(0,y-1);yy<=iclMin(h-1,y+1) && isMax;++yy){
+              for(int xx=iclMax(0,x-1);xx<=iclMin(w-1,x+1);++xx){
+                if(xx == x && yy == y) continue;
+                const float q = v[xx+w*yy];
+                const bool before = yy < y || (yy == y && xx < x);
+                if(before ? !isBetter(p,q) : isBetter(q,p)){ isMax = false; break; }
+              }
+            }
+            if(isMax) cs.push_back(Candidate(Point(x,y),idx,p));
+          }
+        }
+      }
+      CandidateOrder order = { this };
+      std::stable_sort(cs.begin(),cs.end(),order);
+      cs = suppress_overlapping(cs,1,1,m_maxCandidates);
+
+      // refinement towards the finest level
+      int step = indexStep;
+      for(int l=top-1;l>=0;--l){
+        if(step > minIndexStep) step = iclMax(minIndexStep,step/2);
+        for(size_t i=0;i<cs.size();++i){
+          cs[i].pos = cs[i].pos*2;
+          cs[i] = refine(cs[i],l,step,cyclicIndices);
+        }
+      }
+      while(step > minIndexStep){
+        step = iclMax(minIndexStep,step/2);
+        for(size_t i=0;i<cs.size();++i){
+          cs[i] = refine(cs[i],0,step,cyclicIndices);
+        }
+      }
+
+      std::stable_sort(cs.begin(),cs.end(),order);
+      const Size ts = m_templatePyr[0][0].getROISize();
+      cs = suppress_overlapping(cs,(ts.width-1)/2,(ts.height-1)/2,(int)cs.size());
+      for(size_t i=0;i<cs.size();++i){
+        cs[i].pos += m_imageOffset;
+      }
+      return cs;
+    }
+
+  } // namespace cv
+}
@@ -0,0 +1,179 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCV/src/ICLCV/PyramidTemplateSearch.h                **
+** Module : ICLCV                                                  **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+#pragma once
+
+#include <ICLUtils/Uncopyable.h>
+#include <ICLUtils/SmartPtr.h>
+#include <ICLCore/Img.h>
+#include <ICLFilter/ProximityOp.h>
+#include <vector>
+
+namespace icl{
+  namespace cv{
+
+    /// Coarse-to-fine template search on a Gaussian image pyramid
+    /** The PyramidTemplateSearch is the search engine behind the pyramid
+        mode of the TemplateTracker and behind cv::matchTemplatePyramid.
+        It matches a set of templates (e.g. the rotation lookup table of the
+        TemplateTracker) against an image and returns the best matches.
+
+        \section ALG Algorithm
+        -# setTemplates creates a Gaussian pyramid of every template once
+           and caches all of its levels
+        -# setImage creates the Gaussian pyramid of the image's ROI (once per frame)
+        -# search matches a (reduced) subset of the templates
+           against the whole coarsest pyramid level and keeps the
+           best local maxima as candidates
+        -# each candidate is then refined level by level: only a small
+           window of (2*radius+1)^2 positions around the up-scaled
+           candidate position is evaluated, and the template index is refined
+           by testing its neighbours at index distance s. s is halved from
+           level to level until it reaches the given minimum index step
+        -# overlapping results are suppressed at the finest level
+
+        Each pyramid level is created by a 5x5 binomial low-pass filter and
+        2:1 subsampling (see pyrDown). The number of levels that is actually used is
+        reduced automatically, so that the coarsest template keeps at least 4x4
+        pixels and fits into the coarsest image.
+
+        \section PROX Proximity Values
+        The proximity measure is given by the wrapped filter::ProximityOp's
+        optype. For sqrDistance lower values are better, for crossCorr and
+        crossCorrCoeff higher values are better. Multi-channel images
+        are compared channel-wise, and the per-channel results are averaged.
+    */
+    class ICLCV_API PyramidTemplateSearch : public utils::Uncopyable{
+      public:
+
+      /// A single search result
+      struct Candidate{
+        /// Constructor
+        Candidate(const utils::Point &pos=utils::Point::null, int templateIndex=-1, float proximityValue=0):
+          pos(pos),templateIndex(templateIndex),proximityValue(proximityValue){}
+        utils::Point pos;     //!< upper left template position (image coordinates)
+        int templateIndex;    //!< index of the matched template
+        float proximityValue; //!< proximity value at full resolution
+      };
+
+      /// Creates a new instance with given parameters
+      /** @param ot proximity measure
+          @param levels number of pyramid levels (1 means, that no pyramid is used)
+          @param maxCandidates number of candidates that are refined
+          @param radius refinement search radius in pixels */
+      PyramidTemplateSearch(filter::ProximityOp::optype ot=filter::ProximityOp::crossCorrCoeff,
+                            int levels=3, int maxCandidates=8, int radius=2);
+
+      /// Destructor
+      ~PyramidTemplateSearch();
+
+      /// sets the used proximity measure
+      void setOpType(filter::ProximityOp::optype ot);
+
+      /// returns the used proximity measure
+      filter::ProximityOp::optype getOpType() const;
+
+      /// sets the number of pyramid levels (the template cache is updated lazily)
+      void setLevels(int levels);
+
+      /// returns the number of pyramid levels
+      int getLevels() const { return m_levels; }
+
+      /// sets the number of candidates that are refined
+      void setMaxCandidates(int maxCandidates);
+
+      /// returns the number of candidates that are refined
+      int getMaxCandidates() const { return m_maxCandidates; }
+
+      /// sets the refinement search radius
+      void setRadius(int radius);
+
+      /// returns the refinement search radius
+      int getRadius() const { return m_radius; }
+
+      /// sets the number of threads for the coarse level proximity computation
+      void setNumThreads(int numThreads);
+
+      /// sets the templates (the images are shared, their pyramids are cached)
+      /** The templates' ROIs are used. All templates should have the
+          same ROI size and channel count */
+      void setTemplates(const std::vector<utils::SmartPtr<core::Img8u> > &templates);
+
+      /// returns the number of templates
+      int getNumTemplates() const { return (int)m_templates.size(); }
+
+      /// creates the image pyramid for the given image's ROI
+      /** The first level shares the given image's data until the next call */
+      void setImage(const core::Img8u &image);
+
+      /// actual search function
+      /** @param coarseTemplateIndices template indices that are matched
+                 at the coarsest level (the reduced set)
+          @param indexStep initial index refinement step (usually the
+                 step width within coarseTemplateIndices)
+          @param minIndexStep smallest index refinement step
+          @param cyclicIndices if true, template indices wrap around at
+                 the ends (e.g. for a 360 deg rotation lookup table)
+          @return candidates sorted by proximity value (best first) */
+      std::vector<Candidate> search(const std::vector<int> &coarseTemplateIndices,
+                                    int indexStep=0, int minIndexStep=1,
+                                    bool cyclicIndices=false);
+
+      /// returns whether a is a better proximity value than b
+      bool isBetter(float a, float b) const;
+
+      /// reduces the given image's ROI by 5x5 binomial filtering and 2:1 subsampling
+      /** The result has size ((w+1)/2)x((h+1)/2); edge pixels are replicated */
+      static void pyrDown(const core::Img8u &src, core::Img8u &dst);
+
+      private:
+
+      /// ensures, that the template pyramids have m_levels levels
+      void updateTemplatePyramids();
+
+      /// computes the averaged proximity map of the given level image ROI and template
+      const core::Img32f &proximity(const core::Img8u &image, const core::Img8u &templ);
+
+      /// refines a candidate at the given level
+      Candidate refine(const Candidate &c, int level, int indexStep, bool cyclicIndices);
+
+      filter::ProximityOp m_prox;                            //!< internal proximity op
+      int m_levels;                                          //!< number of pyramid levels
+      int m_maxCandidates;                                   //!< number of refined candidates
+      int m_radius;                                          //!< refinement radius
+      std::vector<utils::SmartPtr<core::Img8u> > m_templates; //!< original templates
+      std::vector<std::vector<core::Img8u> > m_templatePyr;   //!< [template][level] cache
+      std::vector<core::Img8u> m_imagePyr;                    //!< current image pyramid
+      utils::Point m_imageOffset;                             //!< ROI offset of the current image
+      core::ImgBase *m_buf;                                   //!< proximity result buffer
+      core::Img32f m_avg;                                     //!< channel averaged proximity map
+    };
+
+  } // namespace cv
+}
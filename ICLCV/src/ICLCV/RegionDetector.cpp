@@ -39,6 +39,7 @@
 
 #include <ICLUtils/Range.h>
 #include <ICLUtils/StringUtils.h>
+#include <ICLUtils/ThreadPool.h>
 
 #include <algorithm>
 
@@ -63,11 +64,123 @@ namespace icl{
           }
         }
       };
+
+      /// union-find: returns the root of i (with path halving)
+      inline int uf_find(int *parent, int i){
+        while(parent[i] != i){
+          parent[i] = parent[parent[i]];
+          i = parent[i];
+        }
+        return i;
+      }
+
+      /// union-find: the root with the smaller index (first in raster order) becomes the new root
+      inline void uf_unite(int *parent, int a, int b){
+        a = uf_find(parent,a);
+        b = uf_find(parent,b);
+        if(a < b) parent[b] = a;
+        else if(b < a) parent[a] = b;
+      }
+
+      /// unites equal valued, 4-adjacent line segments of the rows y-1 and y
+      inline void unite_rows(RunLengthEncoder &rle, const WorkingLineSegment *base, int *parent, int y){
+        WorkingLineSegment *l = rle.begin(y-1);
+        WorkingLineSegment *c = rle.begin(y);
+        WorkingLineSegment *cEnd = rle.end(y);
+        while(c < cEnd){
+          do{
+            if(l->val == c->val) uf_unite(parent,(int)(l-base),(int)(c-base));
+          }while(c->xend > l->xend && ++l);
+          if(c->xend == l->xend) ++l;
+          ++c;
+        }
+      }
+
+      /// common data of the parallel labelling steps (rows [strips[i],strips[i+1]) form strip i)
+      struct LabelStrips{
+        RunLengthEncoder *rle;
+        WorkingLineSegment *base;
+        int *parent;
+        const int *strips;
+        int *rootCounts;
+        int *values;
+      };
+
+      /// creates the union-find forest of each strip
+      struct UniteStrips : public LabelStrips{
+        void operator()(int begin, int end) const{
+          for(int i=begin;i<end;++i){
+            for(int y=strips[i];y<strips[i+1];++y){
+              for(WorkingLineSegment *s=rle->begin(y); s != rle->end(y); ++s){
+                const int k = (int)(s-base);
+                parent[k] = k;
+              }
+              if(y > strips[i]) unite_rows(*rle,base,parent,y);
+            }
+          }
+        }
+      };
+
+      /// counts the roots of each strip
+      struct CountRoots : public LabelStrips{
+        void operator()(int begin, int end) const{
+          for(int i=begin;i<end;++i){
+            int n = 0;
+            for(int y=strips[i];y<strips[i+1];++y){
+              for(WorkingLineSegment *s=rle->begin(y); s != rle->end(y); ++s){
+                n += (parent[s-base] == s-base);
+              }
+            }
+            rootCounts[i] = n;
+          }
+        }
+      };
+
+      /// assigns region IDs to the roots (rootCounts contains the first ID of each strip)
+      struct LabelRoots : public LabelStrips{
+        void operator()(int begin, int end) const{
+          for(int i=begin;i<end;++i){
+            int id = rootCounts[i];
+            for(int y=strips[i];y<strips[i+1];++y){
+              for(WorkingLineSegment *s=rle->begin(y); s != rle->end(y); ++s){
+                if(parent[s-base] == s-base){
+                  values[id] = s->val;
+                  s->regID = id++;
+                }
+              }
+            }
+          }
+        }
+      };
+
+      /// copies the roots' region IDs to all other line segments (parent is not modified anymore)
+      struct LabelSegments : public LabelStrips{
+        void operator()(int begin, int end) const{
+          for(int i=begin;i<end;++i){
+            for(int y=strips[i];y<strips[i+1];++y){
+              for(WorkingLineSegment *s=rle->begin(y); s != rle->end(y); ++s){
+                int k = (int)(s-base);
+                if(parent[k] == k) continue;
+                while(parent[k] != k) k = parent[k];
+                s->regID = base[k].regID;
+              }
+            }
+          }
+        }
+      };
+
+      /// computes the moment features of a range of regions
+      struct AccumulateMoments{
+        ImageRegionData **regions;
+        RegionMomentTable *moments;
+        void operator()(int begin, int end) const;
+      };
     }
 
     using namespace region_detector_tools;
 
     struct RegionDetector::Data{
+      int numThreads;
       const ImgBase *image;
       Point roiOffset;
       Rect roi;
@@ -81,13 +194,24 @@ namespace icl{
 
       std::vector<ImageRegionData*> regionData;
 
+      // parallel labelling (see labelRegions)
+      std::vector<int> parent;                  //!< union-find forest over the line segment slots
+      std::vector<int> strips;                  //!< first row of each strip (+ end row)
+      std::vector<int> rootCounts;              //!< roots per strip / first region ID of each strip
+      std::vector<int> values;                  //!< region values
+      std::vector<int> cursors;                 //!< segment count and write position per region
+      std::vector<ImageRegionData*> pool;       //!< recycled region data
+      RegionMomentTable moments;                //!< batch computed moment features
 
-      Data():image(0){}
+      Data():numThreads(1),image(0){}
 
       ~Data(){
         for(unsigned int i=0;i<regionData.size();++i){
           delete regionData[i];
         }
+        for(unsigned int i=0;i<pool.size();++i){
+          delete pool[i];
+        }
       }
       CornerDetectorCSS css;
     };
@@ -138,6 +262,14 @@ namespace icl{
       setPropertyValue("create region graph", on ? "on" : "off");
     }
 
+    void RegionDetector::setNumThreads(int numThreads){
+      m_data->numThreads = iclMax(0,numThreads);
+    }
+
+    int RegionDetector::getNumThreads() const{
+      return m_data->numThreads;
+    }
+
     RegionDetector::~RegionDetector(){
       delete m_data;
     }
@@ -250,6 +382,94 @@ namespace icl{
       }
     }
 
+    void AccumulateMoments::operator()(int begin, int end) const{
+      for(int i=begin;i<end;++i){
+        moments->accumulate(*regions[i]);
+      }
+    }
+
+    void RegionDetector::labelRegions(){
+      Data &d = *m_data;
+      d.regions.clear();
+      d.filteredRegions.clear();
+      for(unsigned int i=0;i<d.regionData.size();++i){
+        delete d.regionData[i];
+      }
+      d.regionData.clear();
+
+      const bool crg = getPropertyValue("create region graph") == "on";
+      RunLengthEncoder &rle = d.rle;
+      const int W = d.roi.width, H = d.roi.height;
+      const int numThreads = d.numThreads;
+      const int nStrips = iclMin(H, numThreads > 0 ? numThreads : ThreadPool::instance().getConcurrency());
+
+      d.parent.resize(W*H);
+      d.strips.resize(nStrips+1);
+      d.rootCounts.resize(nStrips);
+      for(int i=0;i<=nStrips;++i){
+        d.strips[i] = (int)(((long)i*H)/nStrips);
+      }
+
+      WorkingLineSegment *base = rle.begin(0);
+      LabelStrips ls = { &rle, base, d.parent.data(), d.strips.data(), d.rootCounts.data(), 0 };
+
+      // union-find within the strips, then across strip borders
+      UniteStrips unite; static_cast<LabelStrips&>(unite) = ls;
+      parallel_for(0,nStrips,unite,1,numThreads);
+      for(int i=1;i<nStrips;++i){
+        unite_rows(rle,base,ls.parent,d.strips[i]);
+      }
+
+      // region IDs in raster order
+      CountRoots count; static_cast<LabelStrips&>(count) = ls;
+      parallel_for(0,nStrips,count,1,numThreads);
+      int numRegions = 0;
+      for(int i=0;i<nStrips;++i){
+        const int n = d.rootCounts[i];
+        d.rootCounts[i] = numRegions;
+        numRegions += n;
+      }
+      d.values.resize(numRegions);
+      ls.values = d.values.data();
+      LabelRoots roots; static_cast<LabelStrips&>(roots) = ls;
+      parallel_for(0,nStrips,roots,1,numThreads);
+      LabelSegments segs; static_cast<LabelStrips&>(segs) = ls;
+      parallel_for(0,nStrips,segs,1,numThreads);
+
+      // collect line segments into (recycled) region data structures
+      d.cursors.assign(numRegions,0);
+      for(int y=0;y<H;++y){
+        for(const WorkingLineSegment *s=rle.begin(y); s != rle.end(y); ++s){
+          ++d.cursors[s->regID];
+        }
+      }
+      d.moments.resize(numRegions);
+      while((int)d.pool.size() < numRegions){
+        d.pool.push_back(new ImageRegionData(&d.css,0,0,0,false,0));
+      }
+      for(int i=0;i<numRegions;++i){
+        d.pool[i]->reinit(d.values[i],i,d.cursors[i],crg,d.image,&d.moments);
+        d.cursors[i] = 0;
+      }
+      for(int y=0;y<H;++y){
+        for(WorkingLineSegment *s=rle.begin(y); s != rle.end(y); ++s){
+          const int id = s->regID;
+          ImageRegionData *r = d.pool[id];
+          r->segments[d.cursors[id]++] = *s;
+          s->ird = r;
+        }
+      }
+
+      // batch computation of the moment features
+      AccumulateMoments acc = { d.pool.data(), &d.moments };
+      parallel_for(0,numRegions,acc,256,numThreads);
+
+      d.regions.resize(numRegions);
+      for(int i=0;i<numRegions;++i){
+        d.regions[i] = ImageRegion(d.pool[i]);
+      }
+    }
+
     void RegionDetector::linkRegions(){
       //BENCHMARK_THIS_FUNCTION;
       RunLengthEncoder &rle = m_data->rle;
@@ -366,25 +586,35 @@ namespace icl{
         tTotal = t;
       }
       // run length encoding
-      m_data->rle.encode(image);
+      m_data->rle.encode(image,m_data->numThreads);
 
       if(trackTimes){
         setPropertyValue("track times.rle", msec_string_and_reset(t));
       }
 
-      // find all image region parts
-      analyseRegions();
+      if(m_data->numThreads == 1){
+        // find all image region parts
+        analyseRegions();
 
-      if(trackTimes){
-        setPropertyValue("track times.analyse regions", msec_string_and_reset(t));
-      }
+        if(trackTimes){
+          setPropertyValue("track times.analyse regions", msec_string_and_reset(t));
+        }
 
 
-      // join parts and create image regions
-      joinRegions();
+        // join parts and create image regions
+        joinRegions();
 
-      if(trackTimes){
-        setPropertyValue("track times.join regions", msec_string_and_reset(t));
+        if(trackTimes){
+          setPropertyValue("track times.join regions", msec_string_and_reset(t));
+        }
+      }else{
+        // parallel labelling and feature computation
+        labelRegions();
+
+        if(trackTimes){
+          setPropertyValue("track times.analyse regions", msec_string_and_reset(t));
+          setPropertyValue("track times.join regions", "-");
+        }
       }
 
 
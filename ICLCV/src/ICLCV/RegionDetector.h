@@ -175,6 +175,24 @@ namespace icl{
         \subsection FILTERING Filtering Regions
         Lastly, all ImageRegionData structures are filtered w.r.t. the given size and
         value constraints.
+
+        \subsection PAR Parallel Labelling
+        If the number of threads is set to a value other than 1 (see setNumThreads),
+        region analysis and region joining are replaced by a union-find based labelling:
+        -# the image rows are run-length encoded in parallel strips
+        -# within each strip, equal valued adjacent line segments are united in
+           parallel (each strip's union-find forest only references its own segments)
+        -# the segments of adjacent strip borders are united
+        -# region IDs are assigned in raster order of the regions' first line segments,
+           and the line segments are collected into their regions
+        -# the moment features (size, center of gravity, bounding box and second order
+           moments for the PCA) of all regions are computed in a single parallel batch into
+           a structure-of-arrays (RegionMomentTable).
+
+        The ImageRegionData structures of this mode are recycled from call to call, so
+        that no per-region memory is allocated once the buffers have grown large
+        enough. The detected regions are identical to the ones of the sequential mode,
+        however, the region IDs and the line segment order within a region might differ.
     */
     class ICLCV_API RegionDetector : public utils::Uncopyable, public utils::Configurable{
 
@@ -200,6 +218,13 @@ namespace icl{
       /// set up the region-graph creation flag
       void setCreateGraph(bool on);
 
+      /// sets the number of threads used (see \ref PAR)
+      /** 1 (default) selects the sequential algorithm, 0 means all available threads */
+      void setNumThreads(int numThreads);
+
+      /// returns the number of threads used
+      int getNumThreads() const;
+
       /// sets the internally used parameters for CSS-based corner detection
       /** The internal corner detector is used if ImageRegion::getBoundaryCorners is
           called on detected regions. Note, this can also be adjusted by the
@@ -232,6 +257,10 @@ namespace icl{
       /** see \ref JO */
       void joinRegions();
 
+      /// parallel union-find based replacement of analyseRegions and joinRegions
+      /** see \ref PAR */
+      void labelRegions();
+
       /// detects region neighbours
       /** see \ref LINKING */
       void linkRegions();
@@ -33,6 +33,11 @@
 
 #include <ICLUtils/CompatMacros.h>
 #include <ICLUtils/BasicTypes.h>
+#include <ICLUtils/SSETypes.h>
+
+#if defined ICL_HAVE_SSE2 && defined _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace icl{
   namespace cv{
@@ -105,13 +110,8 @@ namespace icl{
   #undef REGION_DETECTOR_2_ONE_R
       }
 
-  #define REGION_DETECTOR_2_USE_OPT_4_BYTES
-
-
-  #ifdef REGION_DETECTOR_2_USE_OPT_4_BYTES
-
-      template<>
-      inline const icl8u *find_first_not(const icl8u *first, const icl8u *last, icl8u val){
+      /// scalar 8u version that compares 4 pixels at once (used if SSE2 is not available)
+      inline const icl8u *find_first_not_4_bytes(const icl8u *first, const icl8u *last, icl8u val){
   #ifdef ICL_32BIT
         while( first < last && (int)first & 0x3 ){
   #else
@@ -133,6 +133,89 @@ namespace icl{
         return p8u;
         //  return find_first_not_no_opt(reinterpret_cast<const icl8u*>(p32),last,val);
       }
+
+  #ifdef ICL_HAVE_SSE2
+
+      /// index of the lowest set bit (m must not be 0)
+      inline int lowest_set_bit(unsigned int m){
+  #ifdef _MSC_VER
+        unsigned long i;
+        _BitScanForward(&i,m);
+        return (int)i;
+  #else
+        return __builtin_ctz(m);
+  #endif
+      }
+
+      /// SSE2 compare traits for find_first_not_sse2
+      template<class T> struct SSERunCompare;
+
+      /** \cond */
+      template<> struct SSERunCompare<icl8u>{
+        static inline __m128i set(icl8u v) { return _mm_set1_epi8((char)v); }
+        static inline __m128i eq(__m128i a, __m128i b) { return _mm_cmpeq_epi8(a,b); }
+      };
+      template<> struct SSERunCompare<icl16s>{
+        static inline __m128i set(icl16s v) { return _mm_set1_epi16(v); }
+        static inline __m128i eq(__m128i a, __m128i b) { return _mm_cmpeq_epi16(a,b); }
+      };
+      template<> struct SSERunCompare<icl32s>{
+        static inline __m128i set(icl32s v) { return _mm_set1_epi32(v); }
+        static inline __m128i eq(__m128i a, __m128i b) { return _mm_cmpeq_epi32(a,b); }
+      };
+      /** \endcond */
+
+      /// SSE2 version: compares 32 bytes per iteration and locates the first mismatch using movemask
+      template<class T>
+      inline const T *find_first_not_sse2(const T *first, const T *last, T val){
+        // short runs (noisy images): check the first pixel before setting up the vector compare
+        if(first == last || *first != val) return first;
+        ++first;
+
+        const int N = 16/sizeof(T);
+        const __m128i v = SSERunCompare<T>::set(val);
+        while(last - first >= 2*N){
+          const __m128i a = SSERunCompare<T>::eq(_mm_loadu_si128((const __m128i*)first),v);
+          const __m128i b = SSERunCompare<T>::eq(_mm_loadu_si128((const __m128i*)(first+N)),v);
+          const unsigned int m = (unsigned int)_mm_movemask_epi8(_mm_and_si128(a,b));
+          if(m != 0xFFFF){
+            const unsigned int ma = (unsigned int)_mm_movemask_epi8(a) ^ 0xFFFF;
+            if(ma) return first + lowest_set_bit(ma)/sizeof(T);
+            return first + N + lowest_set_bit(m ^ 0xFFFF)/sizeof(T);
+          }
+          first += 2*N;
+        }
+        if(last - first >= N){
+          const unsigned int m = (unsigned int)_mm_movemask_epi8(SSERunCompare<T>::eq(_mm_loadu_si128((const __m128i*)first),v)) ^ 0xFFFF;
+          if(m) return first + lowest_set_bit(m)/sizeof(T);
+          first += N;
+        }
+        while(first < last && *first == val) ++first;
+        return first;
+      }
+
+      template<>
+      inline const icl8u *find_first_not(const icl8u *first, const icl8u *last, icl8u val){
+        return find_first_not_sse2(first,last,val);
+      }
+
+      template<>
+      inline const icl16s *find_first_not(const icl16s *first, const icl16s *last, icl16s val){
+        return find_first_not_sse2(first,last,val);
+      }
+
+      template<>
+      inline const icl32s *find_first_not(const icl32s *first, const icl32s *last, icl32s val){
+        return find_first_not_sse2(first,last,val);
+      }
+
+  #else
+
+      template<>
+      inline const icl8u *find_first_not(const icl8u *first, const icl8u *last, icl8u val){
+        return find_first_not_4_bytes(first,last,val);
+      }
+
   #endif
 
     }
@@ -33,5 +33,19 @@
 namespace icl{
   namespace cv{
     const RegionPCAInfo RegionPCAInfo::null;
+
+    RegionPCAInfo RegionPCAInfo::fromMoments(double avgX, double avgY, double avgXX, double avgXY, double avgYY){
+      double fSxx = avgXX - avgX*avgX;
+      double fSyy = avgYY - avgY*avgY;
+      double fSxy = avgXY - avgX*avgY;
+
+      double fP = 0.5*(fSxx+fSyy);
+      double fD = 0.5*(fSxx-fSyy);
+      fD = ::sqrt(fD*fD + fSxy*fSxy);
+      double fA  = fP + fD;
+
+      // fP - fD can become slightly negative for line-shaped regions due to rounding
+      return RegionPCAInfo(2*::sqrt(fP + fD),2*::sqrt(fP > fD ? fP - fD : 0.0),::atan2(fA-fSxx,fSxy),avgX,avgY);
+    }
   } // namespace cv
 }
@@ -58,6 +58,14 @@ namespace icl{
 
       /// null PCAInfo
       static const RegionPCAInfo null;
+
+      /// creates the PCA information from the region's first and second order moments
+      /** @param avgX mean x
+          @param avgY mean y
+          @param avgXX mean of x*x
+          @param avgXY mean of x*y
+          @param avgYY mean of y*y */
+      static RegionPCAInfo fromMoments(double avgX, double avgY, double avgXX, double avgXY, double avgYY);
     };
   } // namespace cv
 }
@@ -31,6 +31,7 @@
 
 #include <ICLCV/RunLengthEncoder.h>
 #include <ICLCV/RegionDetectorTools.h>
+#include <ICLUtils/ThreadPool.h>
 
 
 
@@ -60,26 +61,19 @@ namespace icl{
       m_imageROI = roi;
     }
 
-    void RunLengthEncoder::resetLineSegments(){
-      for(int y=0;y<m_imageROI.height;++y){
-        std::for_each(begin(y),end(y),std::mem_fun_ref(&WorkingLineSegment::reset));
-      }
-    }
-
     template<class T>
-    void RunLengthEncoder::encode_internal(const Img<T> &image){
+    void RunLengthEncoder::encode_internal(const Img<T> &image, int yBegin, int yEnd){
       if(image.hasFullROI()){
         // optimized version form images without ROI
         const int W = image.getWidth();
-        const int H = image.getHeight();
 
         WLS *sldata = m_data.data(), *sls = 0;
 
-        const T *p = image.begin(0);
+        const T *p = image.begin(0) + yBegin*W;
         const T *pEnd(0),*pLast(0),*pBegin(0);
         T curr(0);
 
-        for(int y=0;y<H;++y){
+        for(int y=yBegin;y<yEnd;++y){
           pBegin = p;    // pixel pointer to current image line begin
           pEnd = p+W;    // pixel pointer to current image line end
           curr = *p++;
@@ -106,17 +100,15 @@ namespace icl{
         const int rx = roi.x;
         const int ry = roi.y;
         const int rw = roi.width;
-        const int rh = roi.height;
 
         WLS *sldata = m_data.data(), *sls = 0;
 
-        const T *p = &*image.beginROI(0);
+        const T *p = &*image.beginROI(0) + yBegin*image.getWidth();
         const T *pEnd(0),*pLast(0),*pBegin(0);
         T curr(0);
 
-        const int yEnd = ry+rh;
         const int xStep = image.getWidth()-rw;
-        for(int y=ry;y<yEnd;++y){
+        for(int y=ry+yBegin;y<ry+yEnd;++y){
           pBegin = p;    // pixel pointer to current image line begin
           pEnd = p+rw;   // pixel pointer to current image line end
           curr = *p++;
@@ -135,14 +127,28 @@ namespace icl{
       }
     }
 
-    void RunLengthEncoder::encode(const ImgBase *image){
+    template<class T>
+    struct RunLengthEncoder::EncodeRows{
+      RunLengthEncoder *rle;
+      const Img<T> *image;
+      void operator()(int yBegin, int yEnd) const{
+        rle->encode_internal(*image,yBegin,yEnd);
+      }
+    };
+
+    template<class T>
+    void RunLengthEncoder::encode_parallel(const Img<T> &image, int numThreads){
+      EncodeRows<T> rows = { this, &image };
+      parallel_for(0,image.getROIHeight(),rows,0,numThreads);
+    }
+
+    void RunLengthEncoder::encode(const ImgBase *image, int numThreads){
       ICLASSERT_THROW(image,ICLException(" RunLengthEncoder::encode :image is NULL"));
 
-      resetLineSegments();
       prepare(image->getROI());
 
       switch(image->getDepth()){
-  #define ICL_INSTANTIATE_DEPTH(D) case depth##D: encode_internal<icl##D>(*image->asImg<icl##D>());  break;
+  #define ICL_INSTANTIATE_DEPTH(D) case depth##D: encode_parallel<icl##D>(*image->asImg<icl##D>(),numThreads);  break;
         ICL_INSTANTIATE_ALL_INT_DEPTHS;
   #undef ICL_INSTANTIATE_DEPTH
         default:
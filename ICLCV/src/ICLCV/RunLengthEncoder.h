@@ -73,6 +73,10 @@ namespace icl {
         As the used WorkingLineSegment class provides only an int-value parameter,
         the RunLengthEncoder is <b>not</b> able to process icl32f and icl64f images
 
+        \section MT Multi-Threading
+        As each image row is encoded independently, the rows can be encoded by
+        several threads (see RunLengthEncoder::encode).
+
         \section ROI ROI Support
         The RunLengthEncoder provides ROI support. The internal encoding function is implemented
         twice (with and without ROI handling) because handling of an images ROI entails a few
@@ -110,20 +114,26 @@ namespace icl {
       /// current image ROI, the RunLengthEncoder is optimized for (adatped automatically)
       utils::Rect m_imageROI;
 
-      /// internal run-length-encoding template
+      /// internal run-length-encoding template (encodes the ROI rows [yBegin,yEnd))
+      template<class T>
+      void encode_internal(const core::Img<T> &image, int yBegin, int yEnd);
+
+      /// splits the rows into strips that are encoded in parallel
       template<class T>
-      void encode_internal(const core::Img<T> &image);
+      void encode_parallel(const core::Img<T> &image, int numThreads);
+
+      /// functor for encode_parallel
+      template<class T> struct EncodeRows;
 
       /// internal preparation function (automatically called)
       void prepare(const utils::Rect &roi);
 
-      /// resets all formerly used line segments (automatically called)
-      void resetLineSegments();
-
       public:
 
       /// main encoding function
-      void encode(const core::ImgBase *image);
+      /** Image rows are encoded independently; if numThreads is not 1, they are
+          split into strips that are encoded in parallel (0 means all available threads) */
+      void encode(const core::ImgBase *image, int numThreads=1);
 
       /// Returns a begin()-pointer for the first encoded image line
       /** row-indices are always relative to the image ROI's offset (see \ref ROI) */
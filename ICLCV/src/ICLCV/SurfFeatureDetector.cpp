@@ -30,6 +30,7 @@
 
 
 #include <ICLCV/SurfFeatureDetector.h>
+#include <ICLCV/SurfFeatureMatcher.h>
 #include <ICLCore/Img.h>
 #include <ICLCore/CCFunctions.h>
 #include <ICLUtils/Range.h>
@@ -60,6 +61,7 @@ namespace icl{
       bool opensurf_backend;
       IplImage *opensurf_refimage;
       IplImage *opensurf_imagebuffer;
+      SurfFeatureMatcher opensurf_matcher;
 #endif
 
 #ifdef ICL_HAVE_OPENCL
@@ -91,8 +93,9 @@ namespace icl{
       int intervals;
       int sampleStep;
       float threshold;
+      int numThreads;
 
-      Data(){
+      Data():numThreads(1){
 #ifdef ICL_HAVE_OPENCV
         opensurf_refimage = 0;
         opensurf_imagebuffer = 0;
@@ -121,7 +124,8 @@ namespace icl{
           refFeatures.clear();
           static const bool upright = false;
           opensurf::surfDetDes(opensurf_refimage, refFeatures, upright,
-                               octaves, intervals, sampleStep,threshold);
+                               octaves, intervals, sampleStep,threshold,numThreads);
+          opensurf_matcher.setReferenceFeatures(refFeatures);
         }
 #endif
 
@@ -294,6 +298,17 @@ namespace icl{
 
 
 
+    void SurfFeatureDetector::setNumThreads(int numThreads){
+      m_data->numThreads = iclMax(0,numThreads);
+#ifdef ICL_HAVE_OPENCV
+      m_data->opensurf_matcher.setNumThreads(m_data->numThreads);
+#endif
+    }
+
+    int SurfFeatureDetector::getNumThreads() const{
+      return m_data->numThreads;
+    }
+
     SurfFeatureDetector::~SurfFeatureDetector(){
       delete m_data;
     }
@@ -308,7 +323,8 @@ namespace icl{
         static const bool upright = false;
         opensurf::surfDetDes(m_data->opensurf_imagebuffer,m_data->currFeatures, upright,
                              m_data->octaves, m_data->intervals,
-                             m_data->sampleStep, m_data->threshold);
+                             m_data->sampleStep, m_data->threshold,
+                             m_data->numThreads);
         return m_data->currFeatures;
       }
 #endif
@@ -446,27 +462,7 @@ namespace icl{
 
 #ifdef ICL_HAVE_OPENCV
       if(m_data->opensurf_backend){
-        for(size_t j=0;j<cur.size();++j){
-          float ds[2] = { Range32f::limits().maxVal, Range32f::limits().maxVal };
-          const SurfFeature &c = cur[j];
-          const SurfFeature *match  = 0;
-          for(size_t i=0;i<ref.size();++i){
-            const SurfFeature &r = ref[i];
-            float d = r - c;
-            if(d < ds[0]){
-              ds[1] = ds[0];
-              ds[0] = d;
-              match = &r;
-            }else if(d < ds[1]){
-              ds[1] = d;
-            }
-          }
-          if(ds[0]/ds[1] < significance){
-            matches.push_back(std::make_pair(c,*match));
-            matches.back().first.dx = match->x - c.x;
-            matches.back().first.dy = match->y - c.y;
-          }
-        }
+        m_data->opensurf_matcher.match(cur,ref,significance,matches);
       }
 #endif
       return matches;
@@ -84,6 +84,15 @@ namespace icl{
         void setSampleStep(int sampleStep);
 
         void setThreshold(float threshold);
+
+        /// sets the number of threads used by the opensurf backend
+        /** 1 (default) means sequential, 0 means all threads of the utils::ThreadPool.
+            The threads are used for the detection (response layers and
+            descriptors) and for matching (see SurfFeatureMatcher) */
+        void setNumThreads(int numThreads);
+
+        /// returns the number of threads used by the opensurf backend
+        int getNumThreads() const;
       };
 
   }
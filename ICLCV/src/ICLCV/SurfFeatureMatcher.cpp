@@ -0,0 +1,141 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCV/src/ICLCV/SurfFeatureMatcher.cpp                 **
+** Module : ICLCV                                                  **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+#include <ICLCV/SurfFeatureMatcher.h>
+#include <ICLUtils/ThreadPool.h>
+#include <ICLUtils/SSETypes.h>
+#include <ICLUtils/Macros.h>
+#include <limits>
+#include <cstring>
+
+namespace icl{
+  namespace cv{
+
+    using namespace utils;
+
+    namespace{
+      /// squared distance of 16 descriptor components
+      inline float sqr_dist_16(const float *a, const float *b){
+#ifdef ICL_HAVE_SSE2
+        __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a),   _mm_loadu_ps(b));
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a+4), _mm_loadu_ps(b+4));
+        __m128 d2 = _mm_sub_ps(_mm_loadu_ps(a+8), _mm_loadu_ps(b+8));
+        __m128 d3 = _mm_sub_ps(_mm_loadu_ps(a+12),_mm_loadu_ps(b+12));
+        __m128 s = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d0,d0),_mm_mul_ps(d1,d1)),
+                              _mm_add_ps(_mm_mul_ps(d2,d2),_mm_mul_ps(d3,d3)));
+        s = _mm_add_ps(s,_mm_movehl_ps(s,s));
+        s = _mm_add_ss(s,_mm_shuffle_ps(s,s,1));
+        return _mm_cvtss_f32(s);
+#else
+        float s = 0;
+        for(int i=0;i<16;++i){
+          s += sqr(a[i]-b[i]);
+        }
+        return s;
+#endif
+      }
+
+      /// matches a range of query features (used with parallel_for)
+      struct FindMatches{
+        const SurfFeatureMatcher &m;
+        const std::vector<SurfFeature> &query;
+        float significance;
+        std::vector<int> &dst;
+
+        void operator()(int begin, int end) const{
+          for(int i=begin;i<end;++i){
+            dst[i] = m.findMatch(query[i],significance);
+          }
+        }
+      };
+    }
+
+    SurfFeatureMatcher::SurfFeatureMatcher():m_num(0),m_numThreads(1){}
+
+    void SurfFeatureMatcher::setReferenceFeatures(const std::vector<SurfFeature> &ref){
+      m_num = (int)ref.size();
+      m_table.resize(64*ref.size());
+      for(int i=0;i<m_num;++i){
+        memcpy(&m_table[64*i],ref[i].descriptor,64*sizeof(float));
+      }
+    }
+
+    void SurfFeatureMatcher::setNumThreads(int numThreads){
+      m_numThreads = iclMax(0,numThreads);
+    }
+
+    int SurfFeatureMatcher::findMatch(const SurfFeature &f, float significance, float *dist) const{
+      const float *q = f.descriptor;
+      float d1 = std::numeric_limits<float>::max(), d2 = d1;
+      int best = -1;
+      for(int i=0;i<m_num;++i){
+        const float *r = &m_table[64*i];
+        float d = 0;
+        // d cannot become smaller than d2 once the partial sum exceeds it
+        for(int k=0;k<64 && d < d2;k+=16){
+          d += sqr_dist_16(q+k,r+k);
+        }
+        if(d < d1){
+          d2 = d1;
+          d1 = d;
+          best = i;
+        }else if(d < d2){
+          d2 = d;
+        }
+      }
+      if(best < 0 || !(d1/d2 < significance)) return -1;
+      if(dist) *dist = d1;
+      return best;
+    }
+
+    void SurfFeatureMatcher::findMatches(const std::vector<SurfFeature> &query, float significance,
+                                         std::vector<int> &dst) const{
+      const int n = (int)query.size();
+      dst.resize(n);
+      FindMatches f = { *this, query, significance, dst };
+      parallel_for(0,n,f,8,m_numThreads);
+    }
+
+    void SurfFeatureMatcher::match(const std::vector<SurfFeature> &query, const std::vector<SurfFeature> &ref,
+                                   float significance, std::vector<SurfMatch> &dst) const{
+      dst.clear();
+      ICLASSERT_RETURN((int)ref.size() == m_num);
+      std::vector<int> idx;
+      findMatches(query,significance,idx);
+      for(size_t i=0;i<idx.size();++i){
+        if(idx[i] < 0) continue;
+        const SurfFeature &r = ref[idx[i]];
+        dst.push_back(std::make_pair(query[i],r));
+        dst.back().first.dx = r.x - query[i].x;
+        dst.back().first.dy = r.y - query[i].y;
+      }
+    }
+
+  } // namespace cv
+}
@@ -0,0 +1,98 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCV/src/ICLCV/SurfFeatureMatcher.h                   **
+** Module : ICLCV                                                  **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+#pragma once
+
+#include <ICLUtils/CompatMacros.h>
+#include <ICLCV/SurfFeature.h>
+#include <vector>
+
+namespace icl{
+  namespace cv{
+
+    /// Nearest neighbour matcher for SURF features
+    /** The SurfFeatureMatcher is used by the SurfFeatureDetector's
+        CPU (opensurf) backend and by opensurf::getMatches. It keeps the
+        descriptors of a set of reference features in a single packed
+        table (see setReferenceFeatures), so that each query
+        descriptor can be compared with all references in a single linear pass.
+
+        For each query feature q, the nearest (d1) and the second nearest (d2)
+        reference feature w.r.t. the squared descriptor distance are determined.
+        q is matched to its nearest neighbour if d1/d2 < significance.
+        The search is exact, but uses two shortcuts:
+        - the distances are computed with SSE2 (if available)
+        - the distance computation of a reference is stopped, as soon as the
+          partial sum exceeds d2 (the remaining components cannot make it smaller)
+
+        Query features are processed in parallel (see setNumThreads)
+    */
+    class ICLCV_API SurfFeatureMatcher{
+      public:
+
+      /// Creates an empty matcher (sequential)
+      SurfFeatureMatcher();
+
+      /// sets the reference features (only their descriptors are copied)
+      void setReferenceFeatures(const std::vector<SurfFeature> &ref);
+
+      /// returns the number of reference features
+      int getNumReferenceFeatures() const { return m_num; }
+
+      /// sets the number of threads used for matching
+      /** 1 (default) means sequential, 0 means all threads of the
+          utils::ThreadPool */
+      void setNumThreads(int numThreads);
+
+      /// returns the number of threads used for matching
+      int getNumThreads() const { return m_numThreads; }
+
+      /// returns the index of the best matching reference feature of f or -1
+      /** if given, the squared descriptor distance of the best match is written to dist */
+      int findMatch(const SurfFeature &f, float significance, float *dist=0) const;
+
+      /// computes the best matching reference feature indices for all given features
+      /** dst[i] is the index of the reference feature associated with query[i] or -1 */
+      void findMatches(const std::vector<SurfFeature> &query, float significance,
+                       std::vector<int> &dst) const;
+
+      /// convenience function, that creates pairs (query-feature, reference feature)
+      /** The query feature's dx and dy values are set to the offset to the reference feature.
+          The given reference features must be the ones passed to setReferenceFeatures */
+      void match(const std::vector<SurfFeature> &query, const std::vector<SurfFeature> &ref,
+                 float significance, std::vector<SurfMatch> &dst) const;
+
+      private:
+      std::vector<float> m_table;   //!< packed descriptors (64 floats per reference feature)
+      int m_num;                    //!< number of reference features
+      int m_numThreads;             //!< number of threads
+    };
+
+  } // namespace cv
+}
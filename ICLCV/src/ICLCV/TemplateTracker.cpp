@@ -28,6 +28,7 @@
 **                                                                 **
 ********************************************************************/
 #include <ICLCV/TemplateTracker.h>
+#include <ICLCV/PyramidTemplateSearch.h>
 
 #include <ICLFilter/ProximityOp.h>
 #include <ICLFilter/RotateOp.h>
@@ -48,6 +49,7 @@ namespace icl{
       SmartPtr<ProximityOp> prox;
       std::vector<SmartPtr<Img8u> > lut;
       TemplateTracker::Result lastResult;
+      PyramidTemplateSearch search; //!< pyramid mode engine (caches the lut's pyramids)
     };
 
 
@@ -77,8 +79,19 @@ namespace icl{
                   "step count. The rotation search window size devided\n"
                   "the amount of steps define the angle resolution.");
       addProperty("tracking.fine steps","range:spinbox","[1,100000]:1",fineSteps,0,
-                  "Parameter for coarse to fine search\n"
-                  "(not supported yet)");
+                  "Final rotation step count of the pyramid\n"
+                  "search. The coarse rotation steps are halved\n"
+                  "from level to level until this value is reached\n"
+                  "(only used if pyramid levels > 1).");
+      addProperty("tracking.pyramid levels","range:spinbox","[1,8]:1",1,0,
+                  "Number of Gaussian pyramid levels. If > 1, the\n"
+                  "coarse rotation steps are matched on the coarsest\n"
+                  "level only, and the best candidates are refined\n"
+                  "level by level. 1 means exhaustive search at\n"
+                  "full resolution.");
+      addProperty("tracking.pyramid candidates","range:spinbox","[1,100]:1",5,0,
+                  "Number of coarse level candidates that are\n"
+                  "refined in pyramid mode.");
 
       addChildConfigurable(data->prox.get(),"proximity");
 
@@ -115,10 +128,12 @@ namespace icl{
         roiimage->scaledCopyROI(tmp,interpolateLIN);
         data->lut.push_back(tmp);
       }
+      data->search.setTemplates(data->lut);
     }
 
     void TemplateTracker::setRotationLUT(const std::vector<SmartPtr<Img8u> > &lut){
       data->lut = lut;
+      data->search.setTemplates(data->lut);
     }
 
     void TemplateTracker::showRotationLUT() const{
@@ -165,20 +180,47 @@ namespace icl{
       const int X = last.pos.x;
       const int Y = last.pos.y;
       const int lutSize = (int)data->lut.size();
+      ICLASSERT_RETURN_VAL(lutSize, last);
       const int angleIndex = angle / (2*M_PI) * (lutSize-1);
       const int ROI = getPropertyValue("tracking.position range");
       const float rotationRange = getPropertyValue("tracking.rotation range");
       const int step1 = getPropertyValue("tracking.coarse steps");
-      //const int step2 = getPropertyValue("tracking.fine steps");
+      const int step2 = getPropertyValue("tracking.fine steps");
+      const int levels = getPropertyValue("tracking.pyramid levels");
       //const float angleStepSize = 360./lutSize;
 
-      const Rect roi(X - ROI/2, Y-ROI/2, ROI, ROI);
+      const Rect roi = Rect(X - ROI/2, Y-ROI/2, ROI, ROI) & image.getImageRect();
+      const int stepRadius = lutSize * rotationRange/720;
+
+      if(levels > 1){
+        Img8u roiImage = image;
+        roiImage.setROI(roi);
+
+        std::vector<int> coarseIndices;
+        for(int i = -stepRadius; i <= stepRadius; i+= step1){
+          coarseIndices.push_back(((angleIndex + i) % lutSize + lutSize) % lutSize);
+        }
+        data->search.setOpType(data->prox->getOpType());
+        data->search.setLevels(levels);
+        data->search.setMaxCandidates(getPropertyValue("tracking.pyramid candidates"));
+        data->search.setImage(roiImage);
+        const std::vector<PyramidTemplateSearch::Candidate> cs = data->search.search(coarseIndices,step1,step2,true);
+        if(cs.empty()) return last;
+
+        for(size_t i=0;i<cs.size();++i){
+          const Img8u *t = data->lut.at(cs[i].templateIndex).get();
+          Result curr(cs[i].pos + Point(t->getROIWidth()/2, t->getROIHeight()/2),
+                      (float(cs[i].templateIndex)/lutSize) * 2 * M_PI,
+                      cs[i].proximityValue, t);
+          if(!i) data->lastResult = curr;
+          if(allResults) allResults->push_back(curr);
+        }
+        return data->lastResult;
+      }
 
       SmartPtr<const Img8u> roiImageTmp = image.shallowCopy(roi);
       SmartPtr<Img8u> roiImage = roiImageTmp->deepCopyROI();
 
-      const int stepRadius = lutSize * rotationRange/720;
-
       Result bestResult = last;
       for(int i = -stepRadius; i <= stepRadius; i+= step1){
         int curIndex = angleIndex + i;
@@ -190,7 +232,8 @@ namespace icl{
         Point maxPos;
         float maxValue = data->buf->getMax(0,&maxPos);
 
-        Result curr(maxPos+last.pos,
+        const Img8u *t = data->lut.at(curIndex).get();
+        Result curr(roi.ul() + maxPos + Point(t->getROIWidth()/2, t->getROIHeight()/2),
                     (float(curIndex)/lutSize) * 2 * M_PI,
                     maxValue,
                     data->lut.at(curIndex).get());
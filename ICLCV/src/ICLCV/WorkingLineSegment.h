@@ -59,12 +59,13 @@ namespace icl{
       /// Constructor
       WorkingLineSegment():reg(0){}
 
-      /// intialization function
+      /// intialization function (also resets the payload)
       inline void init(int x, int y, int xend, int val){
         this->x = x;
         this->y = y;
         this->xend = xend;
         this->val = val;
+        this->reg = 0;
       }
 
       /// reset function (sets payload to NULL)
@@ -1 +1,191 @@
 #include "gtest/gtest.h"
+
+#include <ICLCV/CV.h>
+#include <ICLCV/PyramidTemplateSearch.h>
+#include <ICLCV/RegionDetector.h>
+#include <ICLCV/RegionDetectorTools.h>
+#include <ICLCV/SurfFeatureMatcher.h>
+#include <ICLCore/Img.h>
+
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <vector>
+#include <utility>
+
+using namespace icl;
+using namespace icl::utils;
+using namespace icl::core;
+using namespace icl::cv;
+
+namespace {
+  // smooth test image (template matching on a pyramid needs low frequencies)
+  Img8u smooth_texture(const Size &size, int channels, unsigned int seed){
+    srand(seed);
+    Img8u coarse(Size(size.width/8+2,size.height/8+2),channels);
+    for(int c=0;c<channels;++c){
+      for(icl8u *p=coarse.begin(c);p!=coarse.end(c);++p) *p = rand()%256;
+    }
+    Img8u image(size,channels);
+    coarse.scaledCopy(&image,interpolateLIN);
+    return image;
+  }
+
+  // identifies a region by its value and its first pixel in raster order
+  std::pair<int,std::pair<int,int> > region_key(const ImageRegion &r){
+    const std::vector<LineSegment> &ls = r.getLineSegments();
+    Point first(ls[0].x,ls[0].y);
+    for(size_t i=1;i<ls.size();++i){
+      if(ls[i].y < first.y || (ls[i].y == first.y && ls[i].x < first.x)) first = Point(ls[i].x,ls[i].y);
+    }
+    return std::make_pair(r.getVal(),std::make_pair(first.y,first.x));
+  }
+}
+
+TEST(PyramidTemplateSearchTest, MatchTemplatePyramidFindsExactMatch) {
+  Img8u image = smooth_texture(Size(320,240),2,3);
+  image.setROI(Rect(5,3,300,230));
+  const Rect target(123,77,40,30);
+  Img8u templ(target.getSize(),2);
+  for(int c=0;c<2;++c){
+    for(int y=0;y<target.height;++y){
+      for(int x=0;x<target.width;++x){
+        templ(x,y,c) = image(target.x+x,target.y+y,c);
+      }
+    }
+  }
+  for(int levels=1;levels<=4;++levels){
+    for(int crossCorr=0;crossCorr<2;++crossCorr){
+      std::vector<Rect> rs = matchTemplatePyramid(image,templ,0.95,levels,8,crossCorr);
+      ASSERT_FALSE(rs.empty()) << "levels: " << levels << " crossCorr: " << crossCorr;
+      EXPECT_EQ(target,rs[0]) << "levels: " << levels << " crossCorr: " << crossCorr;
+    }
+  }
+}
+
+TEST(PyramidTemplateSearchTest, PyrDownHalvesSizeAndKeepsConstants) {
+  Img8u image(Size(31,20),1);
+  image.clear(-1,77);
+  Img8u half;
+  PyramidTemplateSearch::pyrDown(image,half);
+  EXPECT_EQ(Size(16,10),half.getSize());
+  for(const icl8u *p=half.begin(0);p!=half.end(0);++p){
+    EXPECT_EQ(77,*p);
+  }
+}
+
+TEST(RegionDetectorTest, ParallelLabellingMatchesSequential) {
+  srand(7);
+  Img8u image(Size(173,131),1);
+  for(icl8u *p=image.begin(0);p!=image.end(0);++p) *p = rand()%3;
+  image.setROI(Rect(3,2,160,125));
+
+  RegionDetector seq(1,1<<30,0,255,true), par(1,1<<30,0,255,true);
+  for(int threads=0;threads<=3;threads+=3){
+    par.setNumThreads(threads);
+    const std::vector<ImageRegion> &a = seq.detect(&image);
+    const std::vector<ImageRegion> &b = par.detect(&image);
+    ASSERT_EQ(a.size(),b.size());
+
+    std::map<std::pair<int,std::pair<int,int> >,ImageRegion> rs;
+    for(size_t i=0;i<a.size();++i) rs[region_key(a[i])] = a[i];
+    for(size_t i=0;i<b.size();++i){
+      ASSERT_TRUE(rs.count(region_key(b[i])));
+      const ImageRegion &r = rs[region_key(b[i])];
+      EXPECT_EQ(r.getSize(),b[i].getSize());
+      EXPECT_EQ(r.getBoundingBox(),b[i].getBoundingBox());
+      EXPECT_NEAR(r.getCOG().x,b[i].getCOG().x,1e-3);
+      EXPECT_NEAR(r.getCOG().y,b[i].getCOG().y,1e-3);
+      EXPECT_NEAR(r.getPCAInfo().len1,b[i].getPCAInfo().len1,1e-2);
+      // the sequential mode accumulates the COG in float precision, which
+      // is amplified by the cancellation in the minor axis length
+      EXPECT_NEAR(r.getPCAInfo().len2,b[i].getPCAInfo().len2,5e-2);
+      EXPECT_EQ(r.getNeighbours().size(),b[i].getNeighbours().size());
+      EXPECT_EQ(r.isBorderRegion(),b[i].isBorderRegion());
+    }
+  }
+}
+
+#ifdef ICL_HAVE_SSE2
+namespace {
+  // runs of random length (including runs of 1 and runs longer than 2N)
+  // followed by a tail shorter than N or shorter than 2N, scanned from all
+  // unaligned start positions
+  template<class T>
+  void expect_sse2_scan_equals_scalar(unsigned int seed){
+    using namespace icl::cv::region_detector_tools;
+    const int N = 16/sizeof(T);
+    srand(seed);
+    for(int iter=0;iter<200;++iter){
+      std::vector<T> data;
+      const T val = (T)(rand() % 3);
+      const int run = rand() % 5 ? rand() % (4*N) : 0;
+      data.assign(run,val);
+      const int tail = rand() % 2 ? rand() % N : N + rand() % N;
+      for(int i=0;i<tail;++i) data.push_back(rand() % 4 ? val : (T)(val+1));
+      data.push_back((T)(val+1));
+      for(int i=0;i<N;++i) data.push_back((T)(rand() % 3));
+      const T *begin = data.data(), *end = begin + data.size();
+      for(int offs=0;offs<N && begin+offs<end;++offs){
+        for(const T *last=end;last>=begin+offs && last>end-2*N-1;--last){
+          ASSERT_EQ(find_first_not_no_opt(begin+offs,last,val),
+                    find_first_not_sse2(begin+offs,last,val))
+            << "iter:" << iter << " offs:" << offs << " len:" << (last-begin-offs);
+        }
+      }
+    }
+  }
+}
+
+TEST(RegionDetectorToolsTest, SSE2RunScanMatchesScalar) {
+  expect_sse2_scan_equals_scalar<icl8u>(1);
+  expect_sse2_scan_equals_scalar<icl16s>(2);
+  expect_sse2_scan_equals_scalar<icl32s>(3);
+}
+#endif
+
+TEST(SurfFeatureMatcherTest, MatchesBruteForce) {
+  srand(7);
+  std::vector<SurfFeature> ref(300), query(200);
+  for(size_t i=0;i<ref.size();++i){
+    for(int k=0;k<64;++k) ref[i].descriptor[k] = (rand()%1000)/1000.0f;
+    ref[i].x = i; ref[i].y = 2*i;
+  }
+  // every second query is a slightly disturbed reference feature
+  for(size_t i=0;i<query.size();++i){
+    for(int k=0;k<64;++k){
+      query[i].descriptor[k] = i%2 ? (rand()%1000)/1000.0f : ref[3*i/2].descriptor[k] + (rand()%100)/5000.0f;
+    }
+    query[i].x = query[i].y = 0;
+  }
+
+  SurfFeatureMatcher matcher;
+  matcher.setReferenceFeatures(ref);
+  for(int t=0;t<2;++t){
+    matcher.setNumThreads(t);
+    std::vector<int> idx;
+    matcher.findMatches(query,0.65f,idx);
+    ASSERT_EQ(idx.size(),query.size());
+
+    for(size_t i=0;i<query.size();++i){
+      float d1 = FLT_MAX, d2 = FLT_MAX;
+      int best = -1;
+      for(size_t j=0;j<ref.size();++j){
+        float d = query[i] - ref[j];
+        if(d < d1){ d2 = d1; d1 = d; best = (int)j; }
+        else if(d < d2){ d2 = d; }
+      }
+      EXPECT_EQ(d1/d2 < 0.65f ? best : -1,idx[i]);
+      if(i%2 == 0){
+        EXPECT_EQ((int)(3*i/2),idx[i]);
+      }
+    }
+  }
+
+  std::vector<SurfMatch> matches;
+  matcher.match(query,ref,0.65f,matches);
+  ASSERT_EQ(matches.size(),query.size()/2);
+  EXPECT_FLOAT_EQ(matches[1].first.dx,ref[3].x);
+  EXPECT_FLOAT_EQ(matches[1].first.dy,ref[3].y);
+}
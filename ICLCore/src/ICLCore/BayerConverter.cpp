@@ -29,17 +29,407 @@
 ********************************************************************/
 
 #include <ICLCore/BayerConverter.h>
-#include <ICLCore/CCFunctions.h>
+#include <ICLCore/CCLUT.h>
+#include <ICLUtils/SSETypes.h>
 #include <ICLUtils/Exception.h>
+#include <algorithm>
+#include <vector>
 
 using namespace icl::utils;
 
 namespace icl {
   namespace core{
 
+    namespace{
+
+      /// scalar version of the 16-bit vector type, that is used by the demosaicing kernels
+      struct Vec1{
+        static const int N = 1;
+        int v;
+        Vec1(){}
+        explicit Vec1(int v):v(v){}
+        static inline Vec1 set(int i){ return Vec1(i); }
+        static inline Vec1 load(const icl8u *p){ return Vec1(*p); }
+        static inline Vec1 load_even(const icl8u *p){ return Vec1(p[0]); }
+        static inline Vec1 load_odd(const icl8u *p){ return Vec1(p[1]); }
+        /// mask that selects lanes whose (x+offset) is even
+        static inline Vec1 even_mask(int xOffs){ return Vec1((xOffs&1) ? 0 : -1); }
+        inline void store(icl8u *p) const { *p = v < 0 ? 0 : v > 255 ? 255 : v; }
+      };
+      inline Vec1 operator+(const Vec1 &a, const Vec1 &b){ return Vec1(a.v+b.v); }
+      inline Vec1 operator-(const Vec1 &a, const Vec1 &b){ return Vec1(a.v-b.v); }
+      inline Vec1 operator*(const Vec1 &a, int k){ return Vec1(a.v*k); }
+      inline Vec1 operator<<(const Vec1 &a, int k){ return Vec1(a.v<<k); }
+      inline Vec1 operator>>(const Vec1 &a, int k){ return Vec1(a.v>>k); }
+      inline Vec1 sel(const Vec1 &m, const Vec1 &a, const Vec1 &b){ return Vec1((m.v & a.v) | (~m.v & b.v)); }
+      inline Vec1 gt(const Vec1 &a, const Vec1 &b){ return Vec1(-(a.v>b.v)); }
+      inline Vec1 vabs(const Vec1 &a){ return Vec1(a.v < 0 ? -a.v : a.v); }
+      inline Vec1 clamp8(const Vec1 &a){ return Vec1(a.v < 0 ? 0 : a.v > 255 ? 255 : a.v); }
+      inline Vec1 div3(const Vec1 &a){ return Vec1(a.v/3); }
+
+#ifdef ICL_HAVE_SSE2
+      /// SSE2 version (8 signed 16-bit lanes)
+      struct Vec8{
+        static const int N = 8;
+        __m128i v;
+        Vec8(){}
+        explicit Vec8(const __m128i &v):v(v){}
+        static inline Vec8 set(int i){ return Vec8(_mm_set1_epi16(i)); }
+        static inline Vec8 load(const icl8u *p){
+          return Vec8(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p),_mm_setzero_si128()));
+        }
+        static inline Vec8 load_even(const icl8u *p){
+          return Vec8(_mm_and_si128(_mm_loadu_si128((const __m128i*)p),_mm_set1_epi16(0xff)));
+        }
+        static inline Vec8 load_odd(const icl8u *p){
+          return Vec8(_mm_srli_epi16(_mm_loadu_si128((const __m128i*)p),8));
+        }
+        static inline Vec8 even_mask(int xOffs){
+          const __m128i m = _mm_set_epi16(0,-1,0,-1,0,-1,0,-1);
+          return Vec8((xOffs&1) ? _mm_xor_si128(m,_mm_set1_epi16(-1)) : m);
+        }
+        inline void store(icl8u *p) const { _mm_storel_epi64((__m128i*)p,_mm_packus_epi16(v,v)); }
+      };
+      inline Vec8 operator+(const Vec8 &a, const Vec8 &b){ return Vec8(_mm_add_epi16(a.v,b.v)); }
+      inline Vec8 operator-(const Vec8 &a, const Vec8 &b){ return Vec8(_mm_sub_epi16(a.v,b.v)); }
+      inline Vec8 operator*(const Vec8 &a, int k){ return Vec8(_mm_mullo_epi16(a.v,_mm_set1_epi16(k))); }
+      inline Vec8 operator<<(const Vec8 &a, int k){ return Vec8(_mm_sll_epi16(a.v,_mm_cvtsi32_si128(k))); }
+      inline Vec8 operator>>(const Vec8 &a, int k){ return Vec8(_mm_sra_epi16(a.v,_mm_cvtsi32_si128(k))); }
+      inline Vec8 sel(const Vec8 &m, const Vec8 &a, const Vec8 &b){
+        return Vec8(_mm_or_si128(_mm_and_si128(m.v,a.v),_mm_andnot_si128(m.v,b.v)));
+      }
+      inline Vec8 gt(const Vec8 &a, const Vec8 &b){ return Vec8(_mm_cmpgt_epi16(a.v,b.v)); }
+      inline Vec8 vabs(const Vec8 &a){ return Vec8(_mm_max_epi16(a.v,_mm_sub_epi16(_mm_setzero_si128(),a.v))); }
+      inline Vec8 clamp8(const Vec8 &a){
+        return Vec8(_mm_min_epi16(_mm_max_epi16(a.v,_mm_setzero_si128()),_mm_set1_epi16(255)));
+      }
+      /// exact for 0 <= a < 3*256
+      inline Vec8 div3(const Vec8 &a){ return Vec8(_mm_mulhi_epu16(a.v,_mm_set1_epi16(21846))); }
+#endif
+
+      /// gray value of the given (unclipped) color values
+      template<class V>
+      inline V gray_value(const V &r, const V &g, const V &b){
+        return div3(clamp8(r)+clamp8(g)+clamp8(b));
+      }
+
+      /// distributes the interpolated values to the color channels
+      /** In rows of type R-G-R-G (gbRow = false) the pixels selected by m are red,
+          all others are green. In rows of type G-B-G-B, the pixels selected by m
+          are green, all others are blue.
+          @param c center value
+          @param h value interpolated from the horizontal neighbours (at green pixels)
+          @param v value interpolated from the vertical neighbours (at green pixels)
+          @param x green value interpolated at red/blue pixels
+          @param d blue/red value interpolated at red/blue pixels
+      */
+      template<class V>
+      inline void assign_rgb(bool gbRow, const V &m, const V &c, const V &h, const V &v,
+                             const V &x, const V &d, V &r, V &g, V &b){
+        if(gbRow){
+          r = sel(m,v,d);
+          g = sel(m,c,x);
+          b = sel(m,h,c);
+        }else{
+          r = sel(m,c,h);
+          g = sel(m,x,c);
+          b = sel(m,d,v);
+        }
+      }
+
+      /// each pixel takes the values of the 2x2 cell it is the upper left pixel of
+      struct NNKernel{
+        enum { LEFT=0, TOP=0, RIGHT=1, BOTTOM=1 };
+        template<class V>
+        inline void operator()(const icl8u *s, int w, bool gbRow, const V &m, V &r, V &g, V &b) const{
+          const V c = V::load(s), e = V::load(s+1), so = V::load(s+w), se = V::load(s+w+1);
+          if(gbRow){
+            r = sel(m,so,se); g = sel(m,se,e); b = sel(m,e,c);
+          }else{
+            r = sel(m,c,e); g = sel(m,e,se); b = sel(m,se,so);
+          }
+        }
+      };
+
+      /// like NNKernel, but the two green values of the 2x2 cell are averaged
+      struct SimpleKernel{
+        enum { LEFT=0, TOP=0, RIGHT=1, BOTTOM=1 };
+        template<class V>
+        inline void operator()(const icl8u *s, int w, bool gbRow, const V &m, V &r, V &g, V &b) const{
+          const V c = V::load(s), e = V::load(s+1), so = V::load(s+w), se = V::load(s+w+1);
+          const V one = V::set(1);
+          const V gA = (e+so+one)>>1, gB = (c+se+one)>>1;
+          if(gbRow){
+            r = sel(m,so,se); g = sel(m,gB,gA); b = sel(m,e,c);
+          }else{
+            r = sel(m,c,e); g = sel(m,gA,gB); b = sel(m,se,so);
+          }
+        }
+      };
+
+      /// 3x3 bilinear interpolation
+      struct BilinearKernel{
+        enum { LEFT=1, TOP=1, RIGHT=1, BOTTOM=1 };
+        template<class V>
+        inline void operator()(const icl8u *s, int w, bool gbRow, const V &m, V &r, V &g, V &b) const{
+          const V c = V::load(s);
+          const V n = V::load(s-w), so = V::load(s+w), we = V::load(s-1), e = V::load(s+1);
+          const V diag = V::load(s-w-1) + V::load(s-w+1) + V::load(s+w-1) + V::load(s+w+1);
+          const V one = V::set(1), two = V::set(2);
+          assign_rgb(gbRow, m, c, (we+e+one)>>1, (n+so+one)>>1,
+                     (n+so+we+e+two)>>2, (diag+two)>>2, r, g, b);
+        }
+      };
+
+      /// 5x5 high quality linear interpolation (Malvar, He and Cutler)
+      struct HQLinearKernel{
+        enum { LEFT=2, TOP=2, RIGHT=2, BOTTOM=2 };
+        template<class V>
+        inline void operator()(const icl8u *s, int w, bool gbRow, const V &m, V &r, V &g, V &b) const{
+          const V c = V::load(s);
+          const V n = V::load(s-w), so = V::load(s+w), we = V::load(s-1), e = V::load(s+1);
+          const V nn = V::load(s-2*w), ss = V::load(s+2*w), ww = V::load(s-2), ee = V::load(s+2);
+          const V diag = V::load(s-w-1) + V::load(s-w+1) + V::load(s+w-1) + V::load(s+w+1);
+          const V far = nn+ss+ww+ee;
+          const V one = V::set(1), four = V::set(4);
+          const V x = ((c<<2) + ((n+so+we+e)<<1) - far + four) >> 3;
+          const V d = (c*6 + (diag<<1) - ((far*3 + one)>>1) + four) >> 3;
+          const V h = (c*5 + ((we+e)<<2) - ww - ee - diag + ((nn+ss+one)>>1) + four) >> 3;
+          const V v = (c*5 + ((n+so)<<2) - nn - ss - diag + ((ww+ee+one)>>1) + four) >> 3;
+          assign_rgb(gbRow, m, c, h, v, x, d, r, g, b);
+        }
+      };
+
+      /// destination of the demosaicing functors (either planar RGB or gray)
+      struct BayerTarget{
+        icl8u *r, *g, *b, *gray;
+
+        BayerTarget(Img8u &dst){
+          if(dst.getChannels() == 1){
+            r = g = b = 0;
+            gray = dst.begin(0);
+          }else{
+            r = dst.begin(0);
+            g = dst.begin(1);
+            b = dst.begin(2);
+            gray = 0;
+          }
+        }
+
+        inline void clear(int o, int n) const{
+          if(n <= 0) return;
+          if(gray){
+            std::fill(gray+o,gray+o+n,icl8u(0));
+          }else{
+            std::fill(r+o,r+o+n,icl8u(0));
+            std::fill(g+o,g+o+n,icl8u(0));
+            std::fill(b+o,b+o+n,icl8u(0));
+          }
+        }
+
+        template<class V>
+        inline void store(int o, const V &vr, const V &vg, const V &vb) const{
+          if(gray){
+            gray_value(vr,vg,vb).store(gray+o);
+          }else{
+            vr.store(r+o);
+            vg.store(g+o);
+            vb.store(b+o);
+          }
+        }
+      };
+
+      /// demosaics a range of rows using one of the kernels above
+      /** px and py shift the pattern to RGGB. Pixels, whose neighbourhood
+          is not completely inside the image, are set to 0 */
+      template<class K>
+      struct DemosaicRows{
+        const icl8u *src;
+        int w, h, px, py;
+        BayerTarget t;
+        K k;
+
+        DemosaicRows(const icl8u *src, const Size &size, int px, int py, const BayerTarget &t):
+          src(src),w(size.width),h(size.height),px(px),py(py),t(t){}
+
+        void operator()(int yStart, int yEnd) const{
+          for(int y=yStart;y<yEnd;++y){
+            const int o = y*w;
+            if(y < K::TOP || y >= h-K::BOTTOM || w <= K::LEFT+K::RIGHT){
+              t.clear(o,w);
+              continue;
+            }
+            t.clear(o,K::LEFT);
+            t.clear(o+w-K::RIGHT,K::RIGHT);
+            const bool gbRow = (y+py)&1;
+            const int xEnd = w-K::RIGHT;
+            int x = K::LEFT;
+#ifdef ICL_HAVE_SSE2
+            for(;x+Vec8::N<=xEnd;x+=Vec8::N) pixels<Vec8>(o+x,x,gbRow);
+#endif
+            for(;x<xEnd;++x) pixels<Vec1>(o+x,x,gbRow);
+          }
+        }
+
+        template<class V>
+        inline void pixels(int o, int x, bool gbRow) const{
+          V r,g,b;
+          k(src+o,w,gbRow,V::even_mask(x+px),r,g,b);
+          t.store(o,r,g,b);
+        }
+      };
+
+      /// edge sensing interpolation
+      /** The green channel is interpolated along the direction of the smaller
+          gradient first. Red and blue are then interpolated from the color
+          differences to the green channel. The green values of the rows above
+          and below are kept in a small ring buffer, so that the rows can be
+          processed independently by several threads. */
+      struct EdgeSenseRows{
+        enum { BORDER=3 };
+        const icl8u *src;
+        int w, h, px, py;
+        BayerTarget t;
+
+        EdgeSenseRows(const icl8u *src, const Size &size, int px, int py, const BayerTarget &t):
+          src(src),w(size.width),h(size.height),px(px),py(py),t(t){}
+
+        void operator()(int yStart, int yEnd) const{
+          std::vector<icl8u> ring(3*w);
+          int lastGreenRow = -2;
+          for(int y=yStart;y<yEnd;++y){
+            const int o = y*w;
+            if(y < BORDER || y >= h-BORDER || w <= 2*BORDER){
+              t.clear(o,w);
+              continue;
+            }
+            for(int yy=std::max(lastGreenRow+1,y-1);yy<=y+1;++yy){
+              green_row(yy,ring.data()+(yy%3)*w);
+            }
+            lastGreenRow = y+1;
+
+            t.clear(o,BORDER);
+            t.clear(o+w-BORDER,BORDER);
+            const icl8u *g[3] = { ring.data()+((y-1)%3)*w, ring.data()+(y%3)*w, ring.data()+((y+1)%3)*w };
+            const bool gbRow = (y+py)&1;
+            const int xEnd = w-BORDER;
+            int x = BORDER;
+#ifdef ICL_HAVE_SSE2
+            for(;x+Vec8::N<=xEnd;x+=Vec8::N) red_blue<Vec8>(o,x,g,gbRow);
+#endif
+            for(;x<xEnd;++x) red_blue<Vec1>(o,x,g,gbRow);
+          }
+        }
+
+        /// computes the green values of row y for x in [2,w-3]
+        void green_row(int y, icl8u *dst) const{
+          const bool gbRow = (y+py)&1;
+          const int xEnd = w-2;
+          int x = 2;
+#ifdef ICL_HAVE_SSE2
+          for(;x+Vec8::N<=xEnd;x+=Vec8::N) green<Vec8>(src+y*w+x,dst+x,V_mask<Vec8>(x),gbRow);
+#endif
+          for(;x<xEnd;++x) green<Vec1>(src+y*w+x,dst+x,V_mask<Vec1>(x),gbRow);
+        }
+
+        template<class V>
+        inline V V_mask(int x) const { return V::even_mask(x+px); }
+
+        template<class V>
+        inline void green(const icl8u *s, icl8u *dst, const V &m, bool gbRow) const{
+          const V c = V::load(s);
+          const V dh = vabs(((V::load(s-2)+V::load(s+2))>>1) - c);
+          const V dv = vabs(((V::load(s-2*w)+V::load(s+2*w))>>1) - c);
+          const V gi = sel(gt(dh,dv), (V::load(s-w)+V::load(s+w))>>1, (V::load(s-1)+V::load(s+1))>>1);
+          (gbRow ? sel(m,c,gi) : sel(m,gi,c)).store(dst);
+        }
+
+        template<class V>
+        inline void red_blue(int o, int x, const icl8u *const *g, bool gbRow) const{
+          const icl8u *s = src+o+x;
+          const icl8u *gn = g[0]+x, *gc = g[1]+x, *gs = g[2]+x;
+          const V c = V::load(s), gv = V::load(gc);
+          const V dw = V::load(s-1) - V::load(gc-1);
+          const V de = V::load(s+1) - V::load(gc+1);
+          const V dn = V::load(s-w) - V::load(gn);
+          const V ds = V::load(s+w) - V::load(gs);
+          const V dd = (V::load(s-w-1) - V::load(gn-1)) + (V::load(s-w+1) - V::load(gn+1)) +
+                       (V::load(s+w-1) - V::load(gs-1)) + (V::load(s+w+1) - V::load(gs+1));
+          V r,gr,b;
+          assign_rgb(gbRow, V_mask<V>(x), c, gv + ((dw+de)>>1), gv + ((dn+ds)>>1),
+                     gv, gv + (dd>>2), r, gr, b);
+          t.store(o+x,r,gr,b);
+        }
+      };
+
+      /// converts each 2x2 cell into one RGB pixel (the green values are averaged)
+      struct HalfSizeRows{
+        const icl8u *src;
+        int w, px, py;
+        Size dstSize;
+        icl8u *r, *g, *b;
+
+        HalfSizeRows(const icl8u *src, int w, int px, int py, Img8u &dst):
+          src(src),w(w),px(px),py(py),dstSize(dst.getSize()),
+          r(dst.begin(0)),g(dst.begin(1)),b(dst.begin(2)){}
+
+        void operator()(int yStart, int yEnd) const{
+          for(int y=yStart;y<yEnd;++y){
+            const icl8u *s = src+2*y*w;
+            const int o = y*dstSize.width;
+            int x = 0;
+#ifdef ICL_HAVE_SSE2
+            for(;x+Vec8::N<=dstSize.width;x+=Vec8::N) cell<Vec8>(s+2*x,o+x);
+#endif
+            for(;x<dstSize.width;++x) cell<Vec1>(s+2*x,o+x);
+          }
+        }
+
+        template<class V>
+        inline void cell(const icl8u *s, int o) const{
+          const V q[2][2] = { { V::load_even(s), V::load_odd(s) },
+                              { V::load_even(s+w), V::load_odd(s+w) } };
+          q[py][px].store(r+o);
+          ((q[py][1-px] + q[1-py][px] + V::set(1))>>1).store(g+o);
+          q[1-py][1-px].store(b+o);
+        }
+      };
+
+      /// offset of the given pattern with respect to RGGB
+      inline void pattern_offset(BayerConverter::bayerPattern p, int &px, int &py){
+        px = (p == BayerConverter::bayerPattern_GRBG || p == BayerConverter::bayerPattern_BGGR);
+        py = (p == BayerConverter::bayerPattern_GBRG || p == BayerConverter::bayerPattern_BGGR);
+      }
+
+      template<class Rows>
+      inline void demosaic_rows(const Img8u &src, Img8u &dst, BayerConverter::bayerPattern p, int numThreads){
+        int px, py;
+        pattern_offset(p,px,py);
+        Rows rows(src.begin(0),src.getSize(),px,py,BayerTarget(dst));
+        utils::parallel_for_rows(src.getSize(),rows,CC_MIN_PIXELS_PER_STRIPE,numThreads);
+      }
+
+      void demosaic(const Img8u &src, Img8u &dst, BayerConverter::bayerPattern p,
+                    BayerConverter::bayerConverterMethod method, int numThreads){
+        switch(method){
+          case BayerConverter::simple:
+            demosaic_rows<DemosaicRows<SimpleKernel> >(src,dst,p,numThreads); break;
+          case BayerConverter::bilinear:
+            demosaic_rows<DemosaicRows<BilinearKernel> >(src,dst,p,numThreads); break;
+          case BayerConverter::hqLinear:
+            demosaic_rows<DemosaicRows<HQLinearKernel> >(src,dst,p,numThreads); break;
+          case BayerConverter::edgeSense:
+            demosaic_rows<EdgeSenseRows>(src,dst,p,numThreads); break;
+          default:
+            demosaic_rows<DemosaicRows<NNKernel> >(src,dst,p,numThreads); break;
+        }
+      }
+    }
+
     BayerConverter::BayerConverter(const std::string &pattern, const std::string &method){
       m_eBayerPattern = translateBayerPattern(pattern);
       m_eConvMethod = translateBayerConverterMethod(method);
+      m_numThreads = 1;
 #ifdef ICL_HAVE_IPP
       switch(m_eBayerPattern){
         case BayerConverter::bayerPattern_BGGR:
@@ -63,10 +453,10 @@ namespace icl {
 
     BayerConverter::BayerConverter(bayerPattern eBayerPattern,
                                    bayerConverterMethod eConvMethod,
-                                   const Size &s) {
+                                   const Size&) {
       m_eBayerPattern = eBayerPattern;
       m_eConvMethod = eConvMethod;
-      m_buffer.resize(s.getDim()*3);
+      m_numThreads = 1;
 #ifdef ICL_HAVE_IPP
       switch(eBayerPattern){
         case BayerConverter::bayerPattern_BGGR:
@@ -91,802 +481,31 @@ namespace icl {
 
     BayerConverter::~BayerConverter() { }
 
+    void BayerConverter::setNumThreads(int numThreads){
+      m_numThreads = numThreads < 0 ? 1 : numThreads;
+    }
+
     void BayerConverter::apply(const Img8u *src, ImgBase **dst) {
       ICLASSERT_THROW(src,ICLException("BayerConvert::apply: source image was NULL"));
       ensureCompatible(dst, depth8u, src->getSize(), 3, formatRGB);
-      m_buffer.resize(src->getDim()*3);
-
-      switch (m_eConvMethod) {
-        case nearestNeighbor:
-          FUNCTION_LOG("Nearest Neighbor interpolation");
-          nnInterpolation(src);
-          break;
-
-        case bilinear:
-          FUNCTION_LOG("Bilinear interpolation");
-          bilinearInterpolation(src);
-          break;
-
-        case hqLinear:
-          FUNCTION_LOG("High Quality Linear interpolation");
-          hqLinearInterpolation(src);
-          break;
-
-        case edgeSense:
-          FUNCTION_LOG("Edge Sense interpolation");
-          edgeSenseInterpolation(src);
-          break;
-
-        case simple:
-          FUNCTION_LOG("Simple interpolation");
-          simpleInterpolation(src);
-          break;
-
-        default:
-          nnInterpolation(src);
-      }
-
-      interleavedToPlanar(m_buffer.data(), (*dst)->asImg<icl8u>());
+      FUNCTION_LOG("method: " << translateBayerConverterMethod(m_eConvMethod));
+      demosaic(*src, *(*dst)->asImg<icl8u>(), m_eBayerPattern, m_eConvMethod, m_numThreads);
     }
-    void BayerConverter::nnInterpolation(const Img<icl8u> *poBayerImg) {
-      int iWidth = poBayerImg->getWidth();
-      int iHeight = poBayerImg->getHeight();
-      int i, imax, iinc;
-      const int iBayerStep = iWidth;
-      const int iRGBStep = 3 * iWidth;
-      const icl8u *bayer = poBayerImg->getData(0);
-      icl8u *pucRGBInterImg = m_buffer.data();
-
-      int blue = m_eBayerPattern == bayerPattern_BGGR
-        || m_eBayerPattern == bayerPattern_GBRG ? -1 : 1;
-      int start_with_green = m_eBayerPattern == bayerPattern_GBRG
-        || m_eBayerPattern == bayerPattern_GRBG;
-
-      //add black border
-      imax = iWidth * iHeight * 3;
-      for (i = iWidth * (iHeight - 1) * 3; i < imax; i++) {
-        pucRGBInterImg[i] = 0;
-      }
-      iinc = (iWidth - 1) * 3;
-      for (i = (iWidth - 1) * 3; i < imax; i += iinc) {
-        pucRGBInterImg[i++] = 0;
-        pucRGBInterImg[i++] = 0;
-        pucRGBInterImg[i++] = 0;
-      }
-
-      pucRGBInterImg += 1;
-      iWidth -= 1;
-      iHeight -= 1;
-
-      for (; iHeight>=0; iHeight--, bayer += iBayerStep, pucRGBInterImg += iRGBStep) {
-        const icl8u *bayerEnd = bayer + iWidth;
-
-        if (start_with_green) {
-          pucRGBInterImg[-blue] = bayer[1];
-          pucRGBInterImg[0] = bayer[iBayerStep + 1];
-          pucRGBInterImg[blue] = bayer[iBayerStep];
-          bayer++;
-          pucRGBInterImg += 3;
-        }
-
-        if (blue > 0) {
-          for (; bayer <= bayerEnd - 2; bayer += 2, pucRGBInterImg += 6) {
-            pucRGBInterImg[-1] = bayer[0];
-            pucRGBInterImg[0] = bayer[1];
-            pucRGBInterImg[1] = bayer[iBayerStep + 1];
-
-            pucRGBInterImg[2] = bayer[2];
-            pucRGBInterImg[3] = bayer[iBayerStep + 2];
-            pucRGBInterImg[4] = bayer[iBayerStep + 1];
-          }
-        } else {
-          for (; bayer <= bayerEnd - 2; bayer += 2, pucRGBInterImg += 6) {
-            pucRGBInterImg[1] = bayer[0];
-            pucRGBInterImg[0] = bayer[1];
-            pucRGBInterImg[-1] = bayer[iBayerStep + 1];
-
-            pucRGBInterImg[4] = bayer[2];
-            pucRGBInterImg[3] = bayer[iBayerStep + 2];
-            pucRGBInterImg[2] = bayer[iBayerStep + 1];
-          }
-        }
-
-        if (bayer < bayerEnd) {
-          pucRGBInterImg[-blue] = bayer[0];
-          pucRGBInterImg[0] = bayer[1];
-          pucRGBInterImg[blue] = bayer[iBayerStep + 1];
-          bayer++;
-          pucRGBInterImg += 3;
-        }
-
-        bayer -= iWidth;
-        pucRGBInterImg -= iWidth * 3;
 
-        blue = -blue;
-        start_with_green = !start_with_green;
-      }
+    void BayerConverter::applyGray(const Img8u *src, ImgBase **dst) {
+      ICLASSERT_THROW(src,ICLException("BayerConvert::applyGray: source image was NULL"));
+      ensureCompatible(dst, depth8u, src->getSize(), 1, formatGray);
+      demosaic(*src, *(*dst)->asImg<icl8u>(), m_eBayerPattern, m_eConvMethod, m_numThreads);
     }
 
-    void BayerConverter::bilinearInterpolation(const Img<icl8u> *poBayerImg) {
-      int iWidth = poBayerImg->getWidth();
-      int iHeight = poBayerImg->getHeight();
-      const int iBayerStep = iWidth;
-      const int iRGBStep = 3 * iWidth;
-      const icl8u *bayer = poBayerImg->getData(0);
-      icl8u *pucRGBInterImg = m_buffer.data();
-
-      int blue = m_eBayerPattern == bayerPattern_BGGR
-        || m_eBayerPattern == bayerPattern_GBRG ? -1 : 1;
-      int start_with_green = m_eBayerPattern == bayerPattern_GBRG
-        || m_eBayerPattern == bayerPattern_GRBG;
-
-      clearBorders(pucRGBInterImg, iWidth, iHeight, 1);
-      pucRGBInterImg += iRGBStep + 3 + 1;
-      iHeight -= 2;
-      iWidth -= 2;
-
-      for (; iHeight--; bayer += iBayerStep, pucRGBInterImg += iRGBStep) {
-        int t0, t1;
-        const icl8u *bayerEnd = bayer + iWidth;
-
-        if (start_with_green) {
-          /* OpenCV has a bug in the next line, which was
-             t0 = (bayer[0] + bayer[iBayerStep * 2] + 1) >> 1; */
-          t0 = (bayer[1] + bayer[iBayerStep * 2 + 1] + 1) >> 1;
-          t1 = (bayer[iBayerStep] + bayer[iBayerStep + 2] + 1) >> 1;
-          pucRGBInterImg[-blue] = (icl8u) t0;
-          pucRGBInterImg[0] = bayer[iBayerStep + 1];
-          pucRGBInterImg[blue] = (icl8u) t1;
-          bayer++;
-          pucRGBInterImg += 3;
-        }
-
-        if (blue > 0) {
-          for (; bayer <= bayerEnd - 2; bayer += 2, pucRGBInterImg += 6) {
-            t0 = (bayer[0] + bayer[2] + bayer[iBayerStep * 2] +
-                  bayer[iBayerStep * 2 + 2] + 2) >> 2;
-            t1 = (bayer[1] + bayer[iBayerStep] +
-                  bayer[iBayerStep + 2] + bayer[iBayerStep * 2 + 1] +
-                  2) >> 2;
-            pucRGBInterImg[-1] = (icl8u) t0;
-            pucRGBInterImg[0] = (icl8u) t1;
-            pucRGBInterImg[1] = bayer[iBayerStep + 1];
-
-            t0 = (bayer[2] + bayer[iBayerStep * 2 + 2] + 1) >> 1;
-            t1 = (bayer[iBayerStep + 1] + bayer[iBayerStep + 3] +
-                  1) >> 1;
-            pucRGBInterImg[2] = (icl8u) t0;
-            pucRGBInterImg[3] = bayer[iBayerStep + 2];
-            pucRGBInterImg[4] = (icl8u) t1;
-          }
-        } else {
-          for (; bayer <= bayerEnd - 2; bayer += 2, pucRGBInterImg += 6) {
-            t0 = (bayer[0] + bayer[2] + bayer[iBayerStep * 2] +
-                  bayer[iBayerStep * 2 + 2] + 2) >> 2;
-            t1 = (bayer[1] + bayer[iBayerStep] +
-                  bayer[iBayerStep + 2] + bayer[iBayerStep * 2 + 1] +
-                  2) >> 2;
-            pucRGBInterImg[1] = (icl8u) t0;
-            pucRGBInterImg[0] = (icl8u) t1;
-            pucRGBInterImg[-1] = bayer[iBayerStep + 1];
-
-            t0 = (bayer[2] + bayer[iBayerStep * 2 + 2] + 1) >> 1;
-            t1 = (bayer[iBayerStep + 1] + bayer[iBayerStep + 3] +
-                  1) >> 1;
-            pucRGBInterImg[4] = (icl8u) t0;
-            pucRGBInterImg[3] = bayer[iBayerStep + 2];
-            pucRGBInterImg[2] = (icl8u) t1;
-          }
-        }
-
-        if (bayer < bayerEnd) {
-          t0 = (bayer[0] + bayer[2] + bayer[iBayerStep * 2] +
-                bayer[iBayerStep * 2 + 2] + 2) >> 2;
-          t1 = (bayer[1] + bayer[iBayerStep] +
-                bayer[iBayerStep + 2] + bayer[iBayerStep * 2 + 1] +
-                2) >> 2;
-          pucRGBInterImg[-blue] = (icl8u) t0;
-          pucRGBInterImg[0] = (icl8u) t1;
-          pucRGBInterImg[blue] = bayer[iBayerStep + 1];
-          bayer++;
-          pucRGBInterImg += 3;
-        }
-
-        bayer -= iWidth;
-        pucRGBInterImg -= iWidth * 3;
-
-        blue = -blue;
-        start_with_green = !start_with_green;
-      }
-    }
-
-    void BayerConverter::hqLinearInterpolation(const Img<icl8u> *poBayerImg) {
-      int iWidth = poBayerImg->getWidth();
-      int iHeight = poBayerImg->getHeight();
-      const int iBayerStep = iWidth;
-      const int iRGBStep = 3 * iWidth;
-      const icl8u *bayer = poBayerImg->getData(0);
-      icl8u *pucRGBInterImg = m_buffer.data();
-
-      int blue = m_eBayerPattern == bayerPattern_BGGR
-        || m_eBayerPattern == bayerPattern_GBRG ? -1 : 1;
-      int start_with_green = m_eBayerPattern == bayerPattern_GBRG
-        || m_eBayerPattern == bayerPattern_GRBG;
-
-      clearBorders(pucRGBInterImg, iWidth, iHeight, 1);
-      pucRGBInterImg += 2 * iRGBStep + 6 + 1;
-      iHeight -= 4;
-      iWidth -= 4;
-
-      /* We begin with a (+1 line,+1 column) offset with respect to bilinear decoding, so start_with_green is the same, but blue is opposite */
-      blue = -blue;
-
-      for (; iHeight--; bayer += iBayerStep, pucRGBInterImg += iRGBStep) {
-        int t0, t1;
-        const icl8u *bayerEnd = bayer + iWidth;
-        const int iBayerStep2 = iBayerStep * 2;
-        const int iBayerStep3 = iBayerStep * 3;
-        const int iBayerStep4 = iBayerStep * 4;
-
-        if (start_with_green) {
-          /* at green pixel */
-          pucRGBInterImg[0] = bayer[iBayerStep2 + 2];
-          t0 = pucRGBInterImg[0] * 5
-            + ((bayer[iBayerStep + 2] + bayer[iBayerStep3 + 2]) << 2)
-            - bayer[2]
-            - bayer[iBayerStep + 1]
-            - bayer[iBayerStep + 3]
-            - bayer[iBayerStep3 + 1]
-            - bayer[iBayerStep3 + 3]
-            - bayer[iBayerStep4 + 2]
-            + ((bayer[iBayerStep2] + bayer[iBayerStep2 + 4] + 1) >> 1);
-          t1 = pucRGBInterImg[0] * 5 +
-            ((bayer[iBayerStep2 + 1] + bayer[iBayerStep2 + 3]) << 2)
-            - bayer[iBayerStep2]
-            - bayer[iBayerStep + 1]
-            - bayer[iBayerStep + 3]
-            - bayer[iBayerStep3 + 1]
-            - bayer[iBayerStep3 + 3]
-            - bayer[iBayerStep2 + 4]
-            + ((bayer[2] + bayer[iBayerStep4 + 2] + 1) >> 1);
-          t0 = (t0 + 4) >> 3;
-          clip(&t0, &pucRGBInterImg[-blue]);
-          t1 = (t1 + 4) >> 3;
-          clip(&t1, &pucRGBInterImg[blue]);
-          bayer++;
-          pucRGBInterImg += 3;
-        }
-
-        if (blue > 0) {
-          for (; bayer <= bayerEnd - 2; bayer += 2, pucRGBInterImg += 6) {
-            /* B at B */
-            pucRGBInterImg[1] = bayer[iBayerStep2 + 2];
-            /* R at B */
-            t0 = ((bayer[iBayerStep + 1] + bayer[iBayerStep + 3] +
-                   bayer[iBayerStep3 + 1] + bayer[iBayerStep3 + 3]) << 1)
-              -
-              (((bayer[2] + bayer[iBayerStep2] +
-                 bayer[iBayerStep2 + 4] + bayer[iBayerStep4 +
-                                               2]) * 3 + 1) >> 1)
-              + pucRGBInterImg[1] * 6;
-            /* G at B */
-            t1 = ((bayer[iBayerStep + 2] + bayer[iBayerStep2 + 1] +
-                   bayer[iBayerStep2 + 3] + bayer[iBayerStep3 + 2]) << 1)
-              - (bayer[2] + bayer[iBayerStep2] +
-                 bayer[iBayerStep2 + 4] + bayer[iBayerStep4 + 2])
-              + (pucRGBInterImg[1] << 2);
-            t0 = (t0 + 4) >> 3;
-            clip(&t0, &pucRGBInterImg[-1]);
-            t1 = (t1 + 4) >> 3;
-            clip(&t1, &pucRGBInterImg[0]);
-            /* at green pixel */
-            pucRGBInterImg[3] = bayer[iBayerStep2 + 3];
-            t0 = pucRGBInterImg[3] * 5
-              + ((bayer[iBayerStep + 3] + bayer[iBayerStep3 + 3]) << 2)
-              - bayer[3]
-              - bayer[iBayerStep + 2]
-              - bayer[iBayerStep + 4]
-              - bayer[iBayerStep3 + 2]
-              - bayer[iBayerStep3 + 4]
-              - bayer[iBayerStep4 + 3]
-              +
-              ((bayer[iBayerStep2 + 1] + bayer[iBayerStep2 + 5] +
-                1) >> 1);
-            t1 = pucRGBInterImg[3] * 5 +
-              ((bayer[iBayerStep2 + 2] + bayer[iBayerStep2 + 4]) << 2)
-              - bayer[iBayerStep2 + 1]
-              - bayer[iBayerStep + 2]
-              - bayer[iBayerStep + 4]
-              - bayer[iBayerStep3 + 2]
-              - bayer[iBayerStep3 + 4]
-              - bayer[iBayerStep2 + 5]
-              + ((bayer[3] + bayer[iBayerStep4 + 3] + 1) >> 1);
-            t0 = (t0 + 4) >> 3;
-            clip(&t0, &pucRGBInterImg[2]);
-            t1 = (t1 + 4) >> 3;
-            clip(&t1, &pucRGBInterImg[4]);
-          }
-        } else {
-          for (; bayer <= bayerEnd - 2; bayer += 2, pucRGBInterImg += 6) {
-            /* R at R */
-            pucRGBInterImg[-1] = bayer[iBayerStep2 + 2];
-            /* B at R */
-            t0 = ((bayer[iBayerStep + 1] + bayer[iBayerStep + 3] +
-                   bayer[iBayerStep3 + 1] + bayer[iBayerStep3 + 3]) << 1)
-              -
-              (((bayer[2] + bayer[iBayerStep2] +
-                 bayer[iBayerStep2 + 4] + bayer[iBayerStep4 +
-                                               2]) * 3 + 1) >> 1)
-              + pucRGBInterImg[-1] * 6;
-            /* G at R */
-            t1 = ((bayer[iBayerStep + 2] + bayer[iBayerStep2 + 1] +
-                   bayer[iBayerStep2 + 3] + bayer[iBayerStep * 3 +
-                                                 2]) << 1)
-              - (bayer[2] + bayer[iBayerStep2] +
-                 bayer[iBayerStep2 + 4] + bayer[iBayerStep4 + 2])
-              + (pucRGBInterImg[-1] << 2);
-            t0 = (t0 + 4) >> 3;
-            clip(&t0, &pucRGBInterImg[1]);
-            t1 = (t1 + 4) >> 3;
-            clip(&t1, &pucRGBInterImg[0]);
-
-            /* at green pixel */
-            pucRGBInterImg[3] = bayer[iBayerStep2 + 3];
-            t0 = pucRGBInterImg[3] * 5
-              + ((bayer[iBayerStep + 3] + bayer[iBayerStep3 + 3]) << 2)
-              - bayer[3]
-              - bayer[iBayerStep + 2]
-              - bayer[iBayerStep + 4]
-              - bayer[iBayerStep3 + 2]
-              - bayer[iBayerStep3 + 4]
-              - bayer[iBayerStep4 + 3]
-              +
-              ((bayer[iBayerStep2 + 1] + bayer[iBayerStep2 + 5] +
-                1) >> 1);
-            t1 = pucRGBInterImg[3] * 5 +
-              ((bayer[iBayerStep2 + 2] + bayer[iBayerStep2 + 4]) << 2)
-              - bayer[iBayerStep2 + 1]
-              - bayer[iBayerStep + 2]
-              - bayer[iBayerStep + 4]
-              - bayer[iBayerStep3 + 2]
-              - bayer[iBayerStep3 + 4]
-              - bayer[iBayerStep2 + 5]
-              + ((bayer[3] + bayer[iBayerStep4 + 3] + 1) >> 1);
-            t0 = (t0 + 4) >> 3;
-            clip(&t0, &pucRGBInterImg[4]);
-            t1 = (t1 + 4) >> 3;
-            clip(&t1, &pucRGBInterImg[2]);
-          }
-        }
-
-        if (bayer < bayerEnd) {
-          /* B at B */
-          pucRGBInterImg[blue] = bayer[iBayerStep2 + 2];
-          /* R at B */
-          t0 = ((bayer[iBayerStep + 1] + bayer[iBayerStep + 3] +
-                 bayer[iBayerStep3 + 1] + bayer[iBayerStep3 + 3]) << 1)
-            -
-            (((bayer[2] + bayer[iBayerStep2] +
-               bayer[iBayerStep2 + 4] + bayer[iBayerStep4 +
-                                             2]) * 3 + 1) >> 1)
-            + pucRGBInterImg[blue] * 6;
-          /* G at B */
-          t1 = (((bayer[iBayerStep + 2] + bayer[iBayerStep2 + 1] +
-                  bayer[iBayerStep2 + 3] + bayer[iBayerStep3 + 2])) << 1)
-            - (bayer[2] + bayer[iBayerStep2] +
-               bayer[iBayerStep2 + 4] + bayer[iBayerStep4 + 2])
-            + (pucRGBInterImg[blue] << 2);
-          t0 = (t0 + 4) >> 3;
-          clip(&t0, &pucRGBInterImg[-blue]);
-          t1 = (t1 + 4) >> 3;
-          clip(&t1, &pucRGBInterImg[0]);
-          bayer++;
-          pucRGBInterImg += 3;
-        }
-
-        bayer -= iWidth;
-        pucRGBInterImg -= iWidth * 3;
-
-        blue = -blue;
-        start_with_green = !start_with_green;
-      }
-    }
-    void BayerConverter::edgeSenseInterpolation(const Img<icl8u> *poBayerImg) {
-      icl8u *outR, *outG, *outB;
-      int iWidth = poBayerImg->getWidth();
-      int iHeight = poBayerImg->getHeight();
-      const icl8u *bayer = poBayerImg->getData(0);
-      icl8u *pucRGBInterImg = m_buffer.data();
-      register int i3, j3, base;
-      int i, j, dh, dv, tmp;
-      int iWidth3 = iWidth*3;
-
-      // iWidth and iHeight should be even
-      switch (m_eBayerPattern) {
-        case bayerPattern_GRBG:
-        case bayerPattern_BGGR:
-          outR = &pucRGBInterImg[0];
-          outG = &pucRGBInterImg[1];
-          outB = &pucRGBInterImg[2];
-          break;
-        case bayerPattern_GBRG:
-        case bayerPattern_RGGB:
-          outR = &pucRGBInterImg[2];
-          outG = &pucRGBInterImg[1];
-          outB = &pucRGBInterImg[0];
-          break;
-        default:
-          ERROR_LOG("Bad bayer pattern ID:" << m_eBayerPattern);
-          return;
-          break;
-      }
-
-      switch (m_eBayerPattern) {
-        case bayerPattern_GRBG:
-        case bayerPattern_GBRG:
-          // copy original RGB data to output images
-          for (i = 0, i3=0;
-               i < iHeight*iWidth; i += (iWidth<<1), i3 += (iWidth3<<1)) {
-            for (j = 0, j3=0; j < iWidth; j += 2, j3+=6) {
-              base=i3+j3;
-              outG[base]           = bayer[i + j];
-              outG[base + iWidth3 + 3] = bayer[i + j + iWidth + 1];
-              outR[base + 3]       = bayer[i + j + 1];
-              outB[base + iWidth3]     = bayer[i + j + iWidth];
-            }
-          }
-          // process GREEN channel
-          for (i3= 3*iWidth3; i3 < (iHeight - 2)*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=6; j3 < iWidth3 - 9; j3+=6) {
-              base=i3+j3;
-              dh = abs(((outB[base - 6] +
-                         outB[base + 6]) >> 1) -
-                       outB[base]);
-              dv = abs(((outB[base - (iWidth3<<1)] +
-                         outB[base + (iWidth3<<1)]) >> 1) -
-                       outB[base]);
-              tmp = (((outG[base - 3]   + outG[base + 3]) >> 1) * (dh<=dv) +
-                     ((outG[base - iWidth3] + outG[base + iWidth3]) >> 1) *
-                     (dh>dv));
-              //tmp = (dh==dv) ? tmp>>1 : tmp;
-              clip(&tmp, &outG[base]);
-            }
-          }
-
-          for (i3=2*iWidth3; i3 < (iHeight - 3)*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=9; j3 < iWidth3 - 6; j3+=6) {
-              base=i3+j3;
-              dh = abs(((outR[base - 6] +
-                         outR[base + 6]) >>1 ) -
-                       outR[base]);
-              dv = abs(((outR[base - (iWidth3<<1)] +
-                         outR[base + (iWidth3<<1)]) >>1 ) -
-                       outR[base]);
-              tmp = (((outG[base - 3]   + outG[base + 3]) >> 1) * (dh<=dv) +
-                     ((outG[base - iWidth3] + outG[base + iWidth3]) >> 1) *
-                     (dh>dv));
-              //tmp = (dh==dv) ? tmp>>1 : tmp;
-              clip(&tmp, &outG[base]);
-            }
-          }
-          // process RED channel
-          for (i3=0; i3 < (iHeight - 1)*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=6; j3 < iWidth3 - 3; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outR[base - 3] -
-                  outG[base - 3] +
-                  outR[base + 3] -
-                  outG[base + 3]) >> 1);
-              clip(&tmp, &outR[base]);
-            }
-          }
-          for (i3=iWidth3; i3 < (iHeight - 2)*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=3; j3 < iWidth3; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outR[base - iWidth3] -
-                  outG[base - iWidth3] +
-                  outR[base + iWidth3] -
-                  outG[base + iWidth3]) >> 1);
-              clip(&tmp, &outR[base]);
-            }
-            for (j3=6; j3 < iWidth3 - 3; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outR[base - iWidth3 - 3] -
-                  outG[base - iWidth3 - 3] +
-                  outR[base - iWidth3 + 3] -
-                  outG[base - iWidth3 + 3] +
-                  outR[base + iWidth3 - 3] -
-                  outG[base + iWidth3 - 3] +
-                  outR[base + iWidth3 + 3] -
-                  outG[base + iWidth3 + 3]) >> 2);
-              clip(&tmp, &outR[base]);
-            }
-          }
-
-          // process BLUE channel
-          for (i3=iWidth3; i3 < iHeight*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=3; j3 < iWidth3 - 6; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outB[base - 3] -
-                  outG[base - 3] +
-                  outB[base + 3] -
-                  outG[base + 3]) >> 1);
-              clip(&tmp, &outB[base]);
-            }
-          }
-          for (i3=2*iWidth3; i3 < (iHeight - 1)*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=0; j3 < iWidth3 - 3; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outB[base - iWidth3] -
-                  outG[base - iWidth3] +
-                  outB[base + iWidth3] -
-                  outG[base + iWidth3]) >> 1);
-              clip(&tmp, &outB[base]);
-            }
-            for (j3=3; j3 < iWidth3 - 6; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outB[base - iWidth3 - 3] -
-                  outG[base - iWidth3 - 3] +
-                  outB[base - iWidth3 + 3] -
-                  outG[base - iWidth3 + 3] +
-                  outB[base + iWidth3 - 3] -
-                  outG[base + iWidth3 - 3] +
-                  outB[base + iWidth3 + 3] -
-                  outG[base + iWidth3 + 3]) >> 2);
-              clip(&tmp, &outB[base]);
-            }
-          }
-          break;
-
-        case bayerPattern_BGGR:
-        case bayerPattern_RGGB:
-          // copy original RGB data to output images
-          for (i = 0, i3=0;
-               i < iHeight*iWidth; i += (iWidth<<1), i3 += (iWidth3<<1)) {
-            for (j = 0, j3=0; j < iWidth; j += 2, j3+=6) {
-              base=i3+j3;
-              outB[base] = bayer[i + j];
-              outR[base + iWidth3 + 3] = bayer[i + iWidth + (j + 1)];
-              outG[base + 3] = bayer[i + j + 1];
-              outG[base + iWidth3] = bayer[i + iWidth + j];
-            }
-          }
-          // process GREEN channel
-          for (i3=2*iWidth3; i3 < (iHeight - 2)*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=6; j3 < iWidth3 - 9; j3+=6) {
-              base=i3+j3;
-              dh = abs(((outB[base - 6] +
-                         outB[base + 6]) >> 1) -
-                       outB[base]);
-              dv = abs(((outB[base - (iWidth3<<1)] +
-                         outB[base + (iWidth3<<1)]) >> 1) -
-                       outB[base]);
-              tmp = (((outG[base - 3]   + outG[base + 3]) >> 1) * (dh<=dv) +
-                     ((outG[base - iWidth3] + outG[base + iWidth3]) >> 1) *
-                     (dh>dv));
-              clip(&tmp, &outG[base]);
-            }
-          }
-          for (i3=3*iWidth3; i3 < (iHeight - 3)*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=9; j3 < iWidth3 - 6; j3+=6) {
-              base=i3+j3;
-              dh = abs(((outR[base - 6] +
-                         outR[base + 6]) >> 1) -
-                       outR[base]);
-              dv = abs(((outR[base - (iWidth3<<1)] +
-                         outR[base + (iWidth3<<1)]) >> 1) -
-                       outR[base]);
-              tmp = (((outG[base - 3]   + outG[base + 3]) >> 1) * (dh<=dv) +
-                     ((outG[base - iWidth3] + outG[base + iWidth3]) >> 1) *
-                     (dh>dv));
-              clip(&tmp, &outG[base]);
-            }
-          }
-          // process RED channel
-          for (i3=iWidth3; i3 < (iHeight - 1)*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=6; j3 < iWidth3 - 3; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outR[base - 3] -
-                  outG[base - 3] +
-                  outR[base + 3] -
-                  outG[base + 3]) >>1);
-              clip(&tmp, &outR[base]);
-            }
-          }
-          for (i3=2*iWidth3; i3 < (iHeight - 2)*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=3; j3 < iWidth3; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outR[base - iWidth3] -
-                  outG[base - iWidth3] +
-                  outR[base + iWidth3] -
-                  outG[base + iWidth3]) >> 1);
-              clip(&tmp, &outR[base]);
-            }
-            for (j3=6; j3 < iWidth3 - 3; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outR[base - iWidth3 - 3] -
-                  outG[base - iWidth3 - 3] +
-                  outR[base - iWidth3 + 3] -
-                  outG[base - iWidth3 + 3] +
-                  outR[base + iWidth3 - 3] -
-                  outG[base + iWidth3 - 3] +
-                  outR[base + iWidth3 + 3] -
-                  outG[base + iWidth3 + 3]) >> 2);
-              clip(&tmp, &outR[base]);
-            }
-          }
-
-          // process BLUE channel
-          for (i = 0,i3=0;
-               i < iHeight*iWidth; i += (iWidth<<1), i3 += (iWidth3<<1)) {
-            for (j = 1, j3=3; j < iWidth - 2; j += 2, j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outB[base - 3] -
-                  outG[base - 3] +
-                  outB[base + 3] -
-                  outG[base + 3]) >> 1);
-              clip(&tmp, &outB[base]);
-            }
-          }
-          for (i3=iWidth3; i3 < (iHeight - 1)*iWidth3; i3 += (iWidth3<<1)) {
-            for (j3=0; j3 < iWidth3 - 3; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outB[base - iWidth3] -
-                  outG[base - iWidth3] +
-                  outB[base + iWidth3] -
-                  outG[base + iWidth3]) >> 1);
-              clip(&tmp, &outB[base]);
-            }
-            for (j3=3; j3 < iWidth3 - 6; j3+=6) {
-              base=i3+j3;
-              tmp = outG[base] +
-                ((outB[base - iWidth3 - 3] -
-                  outG[base - iWidth3 - 3] +
-                  outB[base - iWidth3 + 3] -
-                  outG[base - iWidth3 + 3] +
-                  outB[base + iWidth3 - 3] -
-                  outG[base + iWidth3 - 3] +
-                  outB[base + iWidth3 + 3] -
-                  outG[base + iWidth3 + 3]) >> 2);
-              clip(&tmp, &outB[base]);
-            }
-          }
-          break;
-        default:
-          ERROR_LOG("Bad bayer pattern ID: " << m_eBayerPattern);
-          return;
-          break;
-      }
-
-      clearBorders(pucRGBInterImg, iWidth, iHeight, 3);
-    }
-
-    void BayerConverter::simpleInterpolation(const Img<icl8u> *poBayerImg) {
-      int iWidth = poBayerImg->getWidth();
-      int iHeight = poBayerImg->getHeight();
-      int i, imax, iinc;
-      const int iBayerStep = iWidth;
-      const int iRGBStep = 3 * iWidth;
-      const icl8u *bayer = poBayerImg->getData(0);
-      icl8u *pucRGBInterImg = m_buffer.data();
-
-      int blue = m_eBayerPattern == bayerPattern_BGGR
-        || m_eBayerPattern == bayerPattern_GBRG ? -1 : 1;
-      int start_with_green = m_eBayerPattern == bayerPattern_GBRG
-        || m_eBayerPattern == bayerPattern_GRBG;
-
-      /* add black border */
-      imax = iWidth * iHeight * 3;
-      for (i = iWidth * (iHeight - 1) * 3; i < imax; i++) {
-        pucRGBInterImg[i] = 0;
-      }
-      iinc = (iWidth - 1) * 3;
-      for (i = (iWidth - 1) * 3; i < imax; i += iinc) {
-        pucRGBInterImg[i++] = 0;
-        pucRGBInterImg[i++] = 0;
-        pucRGBInterImg[i++] = 0;
-      }
-
-      pucRGBInterImg += 1;
-      iWidth -= 1;
-      iHeight -= 1;
-
-      for (; iHeight--; bayer += iBayerStep, pucRGBInterImg += iRGBStep) {
-        const unsigned char *bayerEnd = bayer + iWidth;
-
-        if (start_with_green) {
-          pucRGBInterImg[-blue] = bayer[1];
-          pucRGBInterImg[0] = (bayer[0] + bayer[iBayerStep + 1] + 1) >> 1;
-          pucRGBInterImg[blue] = bayer[iBayerStep];
-          bayer++;
-          pucRGBInterImg += 3;
-        }
-
-        if (blue > 0) {
-          for (; bayer <= bayerEnd - 2; bayer += 2, pucRGBInterImg += 6) {
-            pucRGBInterImg[-1] = bayer[0];
-            pucRGBInterImg[0] = (bayer[1] + bayer[iBayerStep] + 1) >> 1;
-            pucRGBInterImg[1] = bayer[iBayerStep + 1];
-
-            pucRGBInterImg[2] = bayer[2];
-            pucRGBInterImg[3] = (bayer[1] + bayer[iBayerStep + 2] + 1) >> 1;
-            pucRGBInterImg[4] = bayer[iBayerStep + 1];
-          }
-        } else {
-          for (; bayer <= bayerEnd - 2; bayer += 2, pucRGBInterImg += 6) {
-            pucRGBInterImg[1] = bayer[0];
-            pucRGBInterImg[0] = (bayer[1] + bayer[iBayerStep] + 1) >> 1;
-            pucRGBInterImg[-1] = bayer[iBayerStep + 1];
-
-            pucRGBInterImg[4] = bayer[2];
-            pucRGBInterImg[3] = (bayer[1] + bayer[iBayerStep + 2] + 1) >> 1;
-            pucRGBInterImg[2] = bayer[iBayerStep + 1];
-          }
-        }
-
-        if (bayer < bayerEnd) {
-          pucRGBInterImg[-blue] = bayer[0];
-          pucRGBInterImg[0] = (bayer[1] + bayer[iBayerStep] + 1) >> 1;
-          pucRGBInterImg[blue] = bayer[iBayerStep + 1];
-          bayer++;
-          pucRGBInterImg += 3;
-        }
-
-        bayer -= iWidth;
-        pucRGBInterImg -= iWidth * 3;
-
-        blue = -blue;
-        start_with_green = !start_with_green;
-      }
-    }
-  #ifdef ICL_HAVE_IPP
-    void BayerConverter::nnInterpolationIpp(const Img<icl8u> *poBayerImg) {
-      int n = 0;
-      ippGetNumThreads(&n);
-      ippSetNumThreads(1);
-      ippiCFAToRGB_8u_C1C3R(poBayerImg -> getData(0),
-                            Rect(0,0,poBayerImg->getWidth(),
-                                 poBayerImg->getHeight()),
-                            poBayerImg->getSize(),
-                            poBayerImg->getWidth(),
-                            m_buffer.data(),
-                            poBayerImg->getWidth()*3,
-                            m_IppBayerPattern, 0);
-      ippSetNumThreads(n);
-    }
-
-  #endif
-
-    void BayerConverter::clearBorders(icl8u *rgb, int iWidth, int iHeight, int w) {
-      int i, j;
-
-      // black edges are added with a width w:
-      i = 3 * iWidth * w - 1;
-      j = 3 * iWidth * iHeight - 1;
-      while (i >= 0) {
-        rgb[i--] = 0;
-        rgb[j--] = 0;
-      }
-      i = iWidth * (iHeight - 1) * 3 - 1 + w * 3;
-      while (i > iWidth) {
-        j = 6 * w;
-        while (j > 0) {
-          rgb[i--] = 0;
-          j--;
-        }
-        i -= (iWidth - 2 * w) * 3;
-      }
+    void BayerConverter::applyHalfSize(const Img8u *src, ImgBase **dst) {
+      ICLASSERT_THROW(src,ICLException("BayerConvert::applyHalfSize: source image was NULL"));
+      const Size size(src->getWidth()/2, src->getHeight()/2);
+      ensureCompatible(dst, depth8u, size, 3, formatRGB);
+      int px, py;
+      pattern_offset(m_eBayerPattern,px,py);
+      HalfSizeRows rows(src->begin(0),src->getWidth(),px,py,*(*dst)->asImg<icl8u>());
+      utils::parallel_for_rows(size,rows,CC_MIN_PIXELS_PER_STRIPE,m_numThreads);
     }
 
     std::string BayerConverter::translateBayerConverterMethod(BayerConverter::bayerConverterMethod ebcm) {
@@ -950,72 +569,11 @@ namespace icl {
 
     void BayerConverter::convert_bayer_to_gray(const Img8u &src,
                                                Img8u &dst, const
-                                               std::string &pattern){
-      const Size &size = src.getSize();
-      const icl8u *s = src.begin(0);
-      dst.setSize(size);
+                                               std::string &pattern,
+                                               int numThreads){
+      dst.setSize(src.getSize());
       dst.setFormat(formatGray);
-      icl8u *d = dst.begin(0);
-
-      const int w = size.width;
-      const int h = size.height;
-
-      int blue = pattern == "BGGR" || pattern == "GBRG" ? -1 : 1;
-      int green = pattern  == "GBRG" || pattern == "GRBG";
-
-      // set first line to 0
-      std::fill(d,d+w,icl8u(0));
-      // set last line to 0
-      std::fill(d+(h-1)*w,d+h*w,icl8u(0));
-
-      d+=w+1; // 2nd pixel of 2nd row
-      const int w1 = w-1;
-      const int w2 = w*2;
-      int h1 = h-1;
-
-      for (; h1; --h1, s+=w, d+=w){
-        int t0, t1;
-        const icl8u *e = s + w1;
-
-        if (green) {
-          t0 = (s[1] + s[w*2+1] + 1) >> 1;
-          t1 = (s[w] + s[w+2]+ 1) >> 1;
-          *d++ = (t0 + s[w+1] + t1)/3;
-          ++s;
-        }
-
-        if(blue > 0) {
-          for (; s <= e - 2; s += 2){
-            t0 = (s[0] + s[2] + s[w2] + s[w2+2]+2) >> 2;
-            t1 = (s[1] + s[w] + s[w+2] + s[w2+1]+2) >> 2;
-            *d++ = (t0 + t1 + s[w+1])/3;
-
-            t0 = (s[2] + s[w2+2] + 1) >> 1;
-            t1 = (s[w+1] + s[w+3] + 1) >> 1;
-            *d++ = (t0 + t1 + s[w+2])/3;
-          }
-        }else{
-          for (; s <= e - 2; s += 2) {
-            t0 = (s[0] + s[2] + s[w2] + s[w2+2] + 2) >> 2;
-            t1 = (s[1] + s[w] + s[w+2] + s[w2+1] + 2) >> 2;
-            *d++ = (t0 + t1 + s[w+1])/3;
-            t0 = (s[2] + s[w2+2] + 1) >> 1;
-            t1 = (s[w + 1] + s[w+3] + 1) >> 1;
-            *d++ = (t0 + t1 + s[w+2])/3;
-          }
-        }
-        if(s < e) {
-          t0 = (s[0] + s[2] + s[w2] + s[w2+2] + 2) >> 2;
-          t1 = (s[1] + s[w] + s[w+2] + s[w2+1] + 2) >> 2;
-          *d++ = (t0 + t1 + s[w+1])/3;
-          ++s;
-        }
-
-        s -= w1;
-        d -= w1;
-        blue = -blue;
-        green = ! green;
-      }
+      demosaic(src, dst, translateBayerPattern(pattern), bilinear, numThreads < 0 ? 1 : numThreads);
     }
 
   } // namespace core
@@ -38,8 +38,17 @@ namespace icl {
   namespace core{
 
     /// Utiltity class for bayer pattern conversion
-    /** The internal implementation was basically taken from
-        the libdc files */
+    /** The interpolation methods were basically taken from the libdc files.
+        All methods write the planar destination channels directly and
+        process the image row-wise using SSE2 (if available). The rows can
+        be distributed to several threads (see setNumThreads). Pixels whose
+        neighbourhood is not completely inside the image are set to 0 (one
+        pixel for bilinear, two for hqLinear and three for edgeSense;
+        nearestNeighbor and simple clear the last row and column).
+
+        Besides the full size RGB image, a gray image (applyGray) or an RGB image
+        of half size (applyHalfSize) can be created without an intermediate RGB
+        image. The vng method is not implemented, nearestNeighbor is used instead. */
     class ICLCore_API BayerConverter : public utils::Uncopyable{
       public:
 
@@ -65,8 +74,7 @@ namespace icl {
                      const std::string &method="bilinear");
 
       /// creates a new BayerConverter instances
-      /** The given size hint can be used to accellerate the first apply call, where
-          the internal working buffer's size is adapted on demand */
+      /** The size hint is not used anymore, as no internal working buffer is needed */
       BayerConverter(bayerPattern eBayerPattern,
                      bayerConverterMethod eConvMethod=bilinear,
                      const utils::Size &sizeHint = utils::Size::null);
@@ -76,6 +84,22 @@ namespace icl {
       /** given destination image. Dst will become an Img8u */
       void apply(const Img8u *src, ImgBase **dst);
 
+      /// converts the source image into a gray image
+      /** The gray value is the mean of the interpolated color values of the
+          current method. dst will become a formatGray Img8u */
+      void applyGray(const Img8u *src, ImgBase **dst);
+
+      /// converts the source image into an RGB image of half width and height
+      /** Each 2x2 cell of the bayer pattern becomes a single pixel, its two
+          green values are averaged. The converter method is not used here */
+      void applyHalfSize(const Img8u *src, ImgBase **dst);
+
+      /// sets the number of threads used (1: calling thread only (default), 0: all threads)
+      void setNumThreads(int numThreads);
+
+      /// returns the number of threads used
+      inline int getNumThreads() const { return m_numThreads; }
+
       inline void setBayerPattern(bayerPattern eBayerPattern) {
         m_eBayerPattern = eBayerPattern;
       }
@@ -100,41 +124,20 @@ namespace icl {
       static bayerPattern translateBayerPattern(std::string sbp);
 
       /// static utility method to convert a given bayer image to grayscale
-      /** This is much faster than applying the standard bayer method,
-          which will run though the image several times:
-          - creating the interlearved rgb-image
-          - converting the interleaved rgb-image to a planar rgb image
-          - converting the planar rgb image to a one channel gray scale image
-
-          The destination image is adapted in size and format
+      /** The bilinear interpolated color values are averaged directly, no
+          RGB image is created. This is the same as applyGray with the bilinear
+          method. The destination image is adapted in size and format
       **/
-      static void convert_bayer_to_gray(const Img8u &src, Img8u &dst, const std::string &pattern);
+      static void convert_bayer_to_gray(const Img8u &src, Img8u &dst, const std::string &pattern,
+                                        int numThreads=1);
 
       private:
-      /// internal buffer;
-      std::vector<icl8u> m_buffer;
-
       bayerConverterMethod m_eConvMethod;
       bayerPattern m_eBayerPattern;
       #ifdef ICL_HAVE_IPP
         IppiBayerGrid m_IppBayerPattern;
       #endif
-
-      // Interpolation methods
-      void nnInterpolation(const Img8u *poBayerImg);
-      void bilinearInterpolation(const Img8u *poBayerImg);
-      void hqLinearInterpolation(const Img8u *poBayerImg);
-      void edgeSenseInterpolation(const Img8u *poBayerImg);
-      void simpleInterpolation(const Img8u *poBayerImg);
-      #ifdef ICL_HAVE_IPP
-        void nnInterpolationIpp(const Img8u *poBayerImg);
-      #endif
-
-      // Utility functions
-      void clearBorders(icl8u *rgb, int sx, int sy, int w);
-      inline void clip(int *iIn, icl8u *iOut) {
-        *iOut = *iIn = *iIn < 0 ? 0 : *iIn > 255 ? 255 : 0;
-      }
+      int m_numThreads;
     };
 
   } // namespace core
@@ -33,7 +33,11 @@
 #include <ICLCore/Img.h>
 #include <map>
 #include <ICLCore/CCLUT.h>
+#include <ICLCore/CCFunctionsHelpers.h>
 #include <ICLUtils/SSEUtils.h>
+#include <ICLUtils/CPUInfo.h>
+#include <ICLUtils/ThreadPool.h>
+#include <atomic>
 
 using namespace icl::utils;
 
@@ -114,6 +118,125 @@ namespace icl{
       return g_aeAvailableTable[srcFmt*NFMTS + dstFmt];
     }
 
+    static std::atomic<int> g_ccNumThreads(1);
+    static std::atomic<bool> g_ccUseSimd(true);
+
+    void cc_set_num_threads(int numThreads){
+      g_ccNumThreads = numThreads < 0 ? 1 : numThreads;
+    }
+
+    int cc_get_num_threads(){
+      return g_ccNumThreads;
+    }
+
+    void cc_set_use_simd(bool enabled){
+      g_ccUseSimd = enabled;
+    }
+
+    bool cc_get_use_simd(){
+      return g_ccUseSimd;
+    }
+
+    namespace{
+      /// returns the vectorized conversion functions or 0 (see utils::CPUInfo::setEnabled)
+      /** The instruction set is selected once, at the first call. */
+      const CCFunctionsKernels *get_cc_simd_kernels(){
+        static const CCFunctionsKernels *const k =
+          (CPUInfo::isAvailable(CPUInfo::AVX2) && get_cc_functions_kernels_avx2()) ? get_cc_functions_kernels_avx2() :
+          (CPUInfo::isAvailable(CPUInfo::SSE41) && get_cc_functions_kernels_sse41()) ? get_cc_functions_kernels_sse41() :
+          CPUInfo::isAvailable(CPUInfo::SSE2) ? get_cc_functions_kernels_sse2() : 0;
+        return k;
+      }
+
+      /// returns the vectorized conversion functions for the given formats (or false)
+      /** The vectorized functions are used unless disabled with cc_set_use_simd. If IPP is
+          available, cc_s is always used. */
+      bool get_cc_simd_functions(format srcFmt, format dstFmt,
+                                 CCFunctionsKernels::Func8u &f8u, CCFunctionsKernels::Func32f &f32f){
+  #ifdef ICL_HAVE_IPP
+        (void)srcFmt; (void)dstFmt; (void)f8u; (void)f32f;
+        return false;
+  #else
+        if(!g_ccUseSimd) return false;
+        const CCFunctionsKernels *k = get_cc_simd_kernels();
+        if(!k) return false;
+        if(srcFmt == formatRGB && dstFmt == formatGray){
+          f8u = k->rgb_to_gray_8u; f32f = k->rgb_to_gray_32f;
+        }else if(srcFmt == formatRGB && dstFmt == formatYUV){
+          f8u = k->rgb_to_yuv_8u; f32f = k->rgb_to_yuv_32f;
+        }else if(srcFmt == formatYUV && dstFmt == formatRGB){
+          f8u = k->yuv_to_rgb_8u; f32f = k->yuv_to_rgb_32f;
+        }else if(srcFmt == formatRGB && dstFmt == formatHLS){
+          f8u = k->rgb_to_hls_8u; f32f = k->rgb_to_hls_32f;
+        }else if(srcFmt == formatRGB && dstFmt == formatLAB){
+          f8u = k->rgb_to_lab_8u; f32f = k->rgb_to_lab_32f;
+        }else{
+          return false;
+        }
+        return true;
+  #endif
+      }
+
+      /// applies a vectorized conversion function to a range of rows
+      template<class T, class Func>
+      struct CCSimdRows{
+        const Img<T> *src;
+        Img<T> *dst;
+        bool roiOnly;
+        Func f;
+
+        CCSimdRows(const Img<T> *src, Img<T> *dst, bool roiOnly, Func f):
+          src(src),dst(dst),roiOnly(roiOnly),f(f){}
+
+        void operator()(int yStart, int yEnd) const{
+          const T *s[3] = { 0, 0, 0 };
+          T *d[3] = { 0, 0, 0 };
+          if(!roiOnly){
+            // without ROI, the rows are contiguous
+            const int offs = yStart*src->getWidth();
+            for(int c=0;c<src->getChannels();++c) s[c] = src->getData(c)+offs;
+            for(int c=0;c<dst->getChannels();++c) d[c] = dst->getData(c)+offs;
+            f(s,d,(yEnd-yStart)*src->getWidth());
+            return;
+          }
+          const int sw = src->getWidth(), dw = dst->getWidth();
+          for(int c=0;c<src->getChannels();++c) s[c] = src->getROIData(c)+yStart*sw;
+          for(int c=0;c<dst->getChannels();++c) d[c] = dst->getROIData(c)+yStart*dw;
+          for(int y=yStart;y<yEnd;++y){
+            f(s,d,src->getROISize().width);
+            for(int c=0;c<src->getChannels();++c) s[c] += sw;
+            for(int c=0;c<dst->getChannels();++c) d[c] += dw;
+          }
+        }
+      };
+
+      template<class T, class Func>
+      void cc_simd_apply(const Img<T> *src, Img<T> *dst, bool roiOnly, Func f, int numThreads){
+        CCSimdRows<T,Func> rows(src,dst,roiOnly,f);
+        utils::parallel_for_rows(roiOnly ? src->getROISize() : src->getSize(),rows,CC_MIN_PIXELS_PER_STRIPE,numThreads);
+      }
+
+      /// performs the conversion using the vectorized functions (returns false if not supported)
+      bool cc_simd(const ImgBase *src, ImgBase *dst, bool roiOnly, int numThreads){
+        CCFunctionsKernels::Func8u f8u = 0;
+        CCFunctionsKernels::Func32f f32f = 0;
+        if(src->getDepth() != dst->getDepth() ||
+           !get_cc_simd_functions(src->getFormat(),dst->getFormat(),f8u,f32f)) return false;
+        switch(src->getDepth()){
+          case depth8u: cc_simd_apply(src->asImg<icl8u>(),dst->asImg<icl8u>(),roiOnly,f8u,numThreads); return true;
+          case depth32f: cc_simd_apply(src->asImg<icl32f>(),dst->asImg<icl32f>(),roiOnly,f32f,numThreads); return true;
+          default: return false;
+        }
+      }
+    }
+
+    ccimpl cc_available(format srcFmt, format dstFmt, std::string &simdImpl){
+      CCFunctionsKernels::Func8u f8u = 0;
+      CCFunctionsKernels::Func32f f32f = 0;
+      simdImpl = get_cc_simd_functions(srcFmt,dstFmt,f8u,f32f) ? get_cc_simd_kernels()->name : "c++";
+      return cc_available(srcFmt,dstFmt);
+    }
+
     std::map<format, std::map<format,CCLUT*> > g_mapCCLUTs;
 
     bool lut_available(format srcFmt, format dstFmt){
@@ -1281,12 +1404,13 @@ namespace icl{
       src->getROI(pROI, sROI);
 
       long offset  = pROI.y * src->getWidth() + pROI.x;
+      long dstOffset = dst->getROI().y * dstW + dst->getROI().x;
 
       const S *src0 = src->getData(0) + offset;
 
-      D *dst0      = dst->getData(0) + offset;
-      D *dst1      = dst->getData(1) + offset;
-      D *dst2      = dst->getData(2) + offset;
+      D *dst0      = dst->getData(0) + dstOffset;
+      D *dst1      = dst->getData(1) + dstOffset;
+      D *dst2      = dst->getData(2) + dstOffset;
       D *dstEnd    = dst0 + sROI.width + (sROI.height - 1) * dstW;
 
       sse_for(src0, dst0, dst1, dst2, dstEnd,
@@ -1306,12 +1430,13 @@ namespace icl{
       src->getROI(pROI, sROI);
 
       long offset  = pROI.y * src->getWidth() + pROI.x;
+      long dstOffset = dst->getROI().y * dstW + dst->getROI().x;
 
       const S *src0 = src->getData(0) + offset;
       const S *src1 = src->getData(1) + offset;
       const S *src2 = src->getData(2) + offset;
 
-      D *dst0   = dst->getData(0) + offset;
+      D *dst0   = dst->getData(0) + dstOffset;
       D *dstEnd = dst0 + sROI.width + (sROI.height - 1) * dstW;
 
       sse_for(src0, src1, src2, dst0, dstEnd,
@@ -1331,13 +1456,14 @@ namespace icl{
       src->getROI(pROI, sROI);
 
       long offset  = pROI.y * src->getWidth() + pROI.x;
+      long dstOffset = dst->getROI().y * dstW + dst->getROI().x;
 
       const S *src0 = src->getData(0) + offset;
       const S *src1 = src->getData(1) + offset;
       const S *src2 = src->getData(2) + offset;
 
-      D *dst0   = dst->getData(0) + offset;
-      D *dst1   = dst->getData(1) + offset;
+      D *dst0   = dst->getData(0) + dstOffset;
+      D *dst1   = dst->getData(1) + dstOffset;
       D *dstEnd = dst0 + sROI.width + (sROI.height - 1) * dstW;
 
       sse_for(src0, src1, src2, dst0, dst1, dstEnd,
@@ -1357,14 +1483,15 @@ namespace icl{
       src->getROI(pROI, sROI);
 
       long offset  = pROI.y * src->getWidth() + pROI.x;
+      long dstOffset = dst->getROI().y * dstW + dst->getROI().x;
 
       const S *src0 = src->getData(0) + offset;
       const S *src1 = src->getData(1) + offset;
       const S *src2 = src->getData(2) + offset;
 
-      D *dst0   = dst->getData(0) + offset;
-      D *dst1   = dst->getData(1) + offset;
-      D *dst2   = dst->getData(2) + offset;
+      D *dst0   = dst->getData(0) + dstOffset;
+      D *dst1   = dst->getData(1) + dstOffset;
+      D *dst2   = dst->getData(2) + dstOffset;
       D *dstEnd = dst0 + sROI.width + (sROI.height - 1) * dstW;
 
       sse_for(src0, src1, src2, dst0, dst1, dst2, dstEnd,
@@ -3890,15 +4017,72 @@ namespace icl{
 
     // }}}
 
-    template<class S> void cc_s(const Img<S> *src, ImgBase *dst, bool roiOnly){
+    /// returns a shallow image that contains the rows [yStart,yEnd) of the given image's ROI
+    template<class T> Img<T> cc_roi_stripe(const Img<T> *img, int yStart, int yEnd){
+      const Rect r = img->getROI();
+      std::vector<T*> data(img->getChannels());
+      for(int c=0;c<img->getChannels();++c){
+        data[c] = const_cast<T*>(img->begin(c)) + (r.y+yStart)*img->getWidth();
+      }
+      Img<T> stripe(Size(img->getWidth(),yEnd-yStart),img->getChannels(),img->getFormat(),data);
+      stripe.setROI(Rect(r.x,0,r.width,yEnd-yStart));
+      return stripe;
+    }
+
+    /// returns a shallow single-row image that contains the pixels [begin,end) of the given image
+    template<class T> Img<T> cc_flat_stripe(const Img<T> *img, int begin, int end){
+      std::vector<T*> data(img->getChannels());
+      for(int c=0;c<img->getChannels();++c){
+        data[c] = const_cast<T*>(img->begin(c)) + begin;
+      }
+      return Img<T>(Size(end-begin,1),img->getChannels(),img->getFormat(),data);
+    }
+
+    /// converts stripes of rows with cc_sd (used with parallel_for_rows)
+    /** Without ROI, all conversions are pixel-wise on contiguous channels, so the
+        stripes are flat pixel ranges whose bounds are rounded to multiples of 16.
+        This keeps the SSE blocks (and thereby the scalar tail) at the same pixels as
+        in a sequential call, which makes the result independent of the stripe count. */
+    template<class S, class D> struct CCFallbackRows{
+      const Img<S> *src;
+      Img<D> *dst;
+      bool roiOnly;
+
+      static int align_pixel(int i){ return (i + 15) & ~15; }
+
+      void operator()(int yStart, int yEnd) const{
+        if(yStart == 0 && yEnd == (roiOnly ? src->getROIHeight() : src->getHeight())){
+          cc_sd(src,dst,roiOnly);
+        }else if(roiOnly){
+          const Img<S> s = cc_roi_stripe(src,yStart,yEnd);
+          Img<D> d = cc_roi_stripe(dst,yStart,yEnd);
+          cc_sd(&s,&d,true);
+        }else{
+          const int w = src->getWidth();
+          const int begin = align_pixel(yStart*w);
+          const int end = yEnd == src->getHeight() ? src->getDim() : align_pixel(yEnd*w);
+          if(end <= begin) return;
+          const Img<S> s = cc_flat_stripe(src,begin,end);
+          Img<D> d = cc_flat_stripe(dst,begin,end);
+          cc_sd(&s,&d,false);
+        }
+      }
+    };
+
+    template<class S, class D> void cc_sd_parallel(const Img<S> *src, Img<D> *dst, bool roiOnly, int numThreads){
+      CCFallbackRows<S,D> rows = { src, dst, roiOnly };
+      utils::parallel_for_rows(roiOnly ? src->getROISize() : src->getSize(),rows,CC_MIN_PIXELS_PER_STRIPE,numThreads);
+    }
+
+    template<class S> void cc_s(const Img<S> *src, ImgBase *dst, bool roiOnly, int numThreads){
       // {{{ open
 
       switch(dst->getDepth()){      //TODO depth macro
-        case depth8u: cc_sd(src, dst->asImg<icl8u>(),roiOnly); break;
-        case depth16s: cc_sd(src, dst->asImg<icl16s>(),roiOnly); break;
-        case depth32s: cc_sd(src, dst->asImg<icl32s>(),roiOnly); break;
-        case depth32f: cc_sd(src, dst->asImg<icl32f>(),roiOnly); break;
-        case depth64f: cc_sd(src, dst->asImg<icl64f>(),roiOnly); break;
+        case depth8u: cc_sd_parallel(src, dst->asImg<icl8u>(),roiOnly,numThreads); break;
+        case depth16s: cc_sd_parallel(src, dst->asImg<icl16s>(),roiOnly,numThreads); break;
+        case depth32s: cc_sd_parallel(src, dst->asImg<icl32s>(),roiOnly,numThreads); break;
+        case depth32f: cc_sd_parallel(src, dst->asImg<icl32f>(),roiOnly,numThreads); break;
+        case depth64f: cc_sd_parallel(src, dst->asImg<icl64f>(),roiOnly,numThreads); break;
         default:
           ICL_INVALID_DEPTH;
       }
@@ -3906,7 +4090,7 @@ namespace icl{
 
     // }}}
 
-    void cc(const ImgBase *src, ImgBase *dst, bool roiOnly){
+    void cc(const ImgBase *src, ImgBase *dst, bool roiOnly, int numThreads){
       // {{{ open
 
       ICLASSERT_RETURN( src );
@@ -3936,19 +4120,24 @@ namespace icl{
         roiOnly = false;
       }
 
+      if(numThreads < 0){
+        numThreads = g_ccNumThreads;
+      }
+
       if(lut_available(src->getFormat(),dst->getFormat())){
-        g_mapCCLUTs[src->getFormat()][dst->getFormat()]->cc(src,dst,roiOnly);
+        g_mapCCLUTs[src->getFormat()][dst->getFormat()]->cc(src,dst,roiOnly,numThreads);
         return;
       }
 
       switch(cc_available(src->getFormat(), dst->getFormat())){
         case ccAvailable:
+          if(cc_simd(src,dst,roiOnly,numThreads)) break;
           switch(src->getDepth()){ //TODO depth macro
-            case depth8u: cc_s(src->asImg<icl8u>(),dst,roiOnly); break;
-            case depth16s: cc_s(src->asImg<icl16s>(),dst,roiOnly); break;
-            case depth32s: cc_s(src->asImg<icl32s>(),dst,roiOnly); break;
-            case depth32f: cc_s(src->asImg<icl32f>(),dst,roiOnly); break;
-            case depth64f: cc_s(src->asImg<icl64f>(),dst,roiOnly); break;
+            case depth8u: cc_s(src->asImg<icl8u>(),dst,roiOnly,numThreads); break;
+            case depth16s: cc_s(src->asImg<icl16s>(),dst,roiOnly,numThreads); break;
+            case depth32s: cc_s(src->asImg<icl32s>(),dst,roiOnly,numThreads); break;
+            case depth32f: cc_s(src->asImg<icl32f>(),dst,roiOnly,numThreads); break;
+            case depth64f: cc_s(src->asImg<icl64f>(),dst,roiOnly,numThreads); break;
             default:
               ICL_INVALID_DEPTH;
           }
@@ -3956,13 +4145,13 @@ namespace icl{
         case ccEmulated:{
           if(roiOnly){
             ImgBase *buf=imgNew(src->getDepth(), src->getROISize(),formatRGB);
-            cc(src,buf,true);
-            cc(buf,dst,true);
+            cc(src,buf,true,numThreads);
+            cc(buf,dst,true,numThreads);
             delete buf;
           }else{
             ImgBase *buf=imgNew(src->getDepth(), src->getSize(), formatRGB);
-            cc(src,buf);
-            cc(buf,dst);
+            cc(src,buf,false,numThreads);
+            cc(buf,dst,false,numThreads);
             delete buf;
           }
           break;
@@ -430,6 +430,18 @@ namespace icl{
         depended on the specific source and destination format.
 
 
+        \section MT Multithreading
+
+        Conversions of large images can be split into stripes of rows, that are processed in
+        parallel by the threads of utils::ThreadPool::instance(). This is done for the vectorized
+        conversions (see cc_set_use_simd), for conversions using lookup tables (see createLUT)
+        and for the generic C++ conversions (e.g. RGB to LAB), which process each stripe as a shallow
+        sub-image. By default, all conversions are performed by the calling thread. The number of threads can
+        be set globally using cc_set_num_threads or for a single call by passing numThreads to cc.
+        The parallel mode respects the ROI-Support mode. The vectorized and the lookup table based
+        conversions do not allocate any memory.
+
+
         \section IPP IPP Acceleration
 
         Most functions are not IPP accelerated even if IPP support is available because IPP supports most conversions
@@ -446,7 +458,30 @@ namespace icl{
         additional optimizations that causes, that the U- and V- channel range are not full 8bit range [0-255].
         We aim to fix that in future
     */
-    ICLCore_API void cc(const ImgBase *src, ImgBase *dst, bool roiOnly=false);
+    ICLCore_API void cc(const ImgBase *src, ImgBase *dst, bool roiOnly=false, int numThreads=-1);
+
+    /// sets the default number of threads used by cc (see \ref MT)
+    /** 1 (default): conversions are performed by the calling thread,
+        0: all threads of the utils::ThreadPool are used,
+        n > 1: at most n threads (including the calling thread) are used.
+        The numThreads parameter of cc overrides this setting, if it is not negative */
+    ICLCore_API void cc_set_num_threads(int numThreads);
+
+    /// returns the default number of threads used by cc
+    ICLCore_API int cc_get_num_threads();
+
+    /// enables or disables the vectorized conversion functions (true by default, see cc_available)
+    /** The vectorized functions round all pixels consistently and use an exact division
+        and a refined cube root instead of the approximations of the C++ implementation.
+        Their results differ from it by at most 1 for 8u images and by at most 0.5 for
+        32f images (RGB to Gray, RGB to YUV and YUV to RGB are bit-exact except for the
+        last pixels of an image, which the C++ implementation processes differently).
+        Disable them to get the results of former versions. If IPP is available,
+        this setting has no effect. */
+    ICLCore_API void cc_set_use_simd(bool enabled);
+
+    /// returns whether the vectorized conversion functions are enabled
+    ICLCore_API bool cc_get_use_simd();
 
     /// returns whether a lookup table was already created for src and dst format
     /** @param srcFmt source format
@@ -489,6 +524,16 @@ namespace icl{
     /// returns the ccimpl state to a conversion from srcFmt to dstFmt
     ICLCore_API ccimpl cc_available(format srcFmt, format dstFmt);
 
+    /// returns the ccimpl state and the name of the implementation, that is used for srcFmt to dstFmt
+    /** Unless disabled with cc_set_use_simd, the conversions RGB to Gray,
+        RGB to YUV, YUV to RGB, RGB to HLS and RGB to LAB between 8u images and
+        between 32f images are processed by vectorized functions. The best
+        instruction set (AVX2, SSE4.1 or SSE2), that is enabled in utils::CPUInfo at the first call,
+        is used. simdImpl is set to the name of this instruction set ("avx2",
+        "sse4.1" or "sse2"), if the conversion is vectorized this way, and to
+        "c++" otherwise. */
+    ICLCore_API ccimpl cc_available(format srcFmt, format dstFmt, std::string &simdImpl);
+
 
     /// Convert an image in YUV420-format to RGB8 format (ippi accelerated)
     /**
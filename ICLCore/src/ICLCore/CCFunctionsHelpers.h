@@ -0,0 +1,245 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCore/src/ICLCore/CCFunctionsHelpers.h               **
+** Module : ICLCore                                                **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace icl{
+  namespace core{
+
+    /// Internally used table of vectorized color conversion functions
+    /** core::cc uses these functions for the conversions between planar 8u
+        and between planar 32f images. Each function converts n pixels, src and
+        dst contain the channel pointers (for formatGray, only dst[0] is used).
+        All computations are performed in float precision. Integer results are
+        rounded to the nearest integer and saturated.
+
+        There is one table per instruction set. The respective implementations
+        are located in the CCFunctionsHelpers_<isa>.cpp files, which are
+        compiled with the according compiler flags. */
+    struct CCFunctionsKernels{
+      const char *name; //!< name of the instruction set
+
+      /// conversion function types
+      typedef void (*Func8u)(const uint8_t *const *src, uint8_t *const *dst, int n);
+      typedef void (*Func32f)(const float *const *src, float *const *dst, int n);
+
+      Func8u rgb_to_gray_8u;   //!< RGB to Gray (8u)
+      Func32f rgb_to_gray_32f; //!< RGB to Gray (32f)
+      Func8u rgb_to_yuv_8u;    //!< RGB to YUV (8u)
+      Func32f rgb_to_yuv_32f;  //!< RGB to YUV (32f)
+      Func8u yuv_to_rgb_8u;    //!< YUV to RGB (8u)
+      Func32f yuv_to_rgb_32f;  //!< YUV to RGB (32f)
+      Func8u rgb_to_hls_8u;    //!< RGB to HLS (8u)
+      Func32f rgb_to_hls_32f;  //!< RGB to HLS (32f)
+      Func8u rgb_to_lab_8u;    //!< RGB to LAB (8u)
+      Func32f rgb_to_lab_32f;  //!< RGB to LAB (32f)
+    };
+
+    /// returns the SSE2 implementation (or 0 if not available in this build)
+    const CCFunctionsKernels *get_cc_functions_kernels_sse2();
+
+    /// returns the SSE4.1 implementation (or 0 if not available in this build)
+    const CCFunctionsKernels *get_cc_functions_kernels_sse41();
+
+    /// returns the AVX2 implementation (or 0 if not available in this build)
+    const CCFunctionsKernels *get_cc_functions_kernels_avx2();
+
+    namespace {
+      /* The implementation is parameterized with a vector type V, that provides
+         the following static functions:
+         - F set1(float), F add(F,F), F sub(F,F), F mul(F,F), F div(F,F),
+           F min(F,F), F max(F,F)
+         - F eq(F,F), F gt(F,F), F le(F,F) (comparisons returning masks),
+           F select(F mask, F a, F b) (mask ? a : b)
+         - F load(const float*), F load(const uint8_t*), void store(float*, F),
+           void store(uint8_t*, F) (rounds and saturates)
+         - F cbrt_guess(F) (Kahan's bit level initial guess of the cube root)
+         It is instantiated once in each CCFunctionsHelpers_<isa>.cpp file. The
+         anonymous namespace ensures, that the instances, which are compiled with
+         different instruction set flags, are not merged by the linker. */
+
+      /// RGB to Gray: (r+b+g)/3 (same order of operations as the SSE code in CCFunctions.cpp)
+      struct CCOpRGBtoGray{
+        enum { OUT = 1 };
+        template<class V>
+        static inline void apply(const typename V::F *in, typename V::F *out){
+          out[0] = V::mul(V::add(V::add(in[0],in[2]),in[1]),V::set1(1.0f/3.0f));
+        }
+      };
+
+      /// RGB to YUV (U and V are clipped to [0,255])
+      struct CCOpRGBtoYUV{
+        enum { OUT = 3 };
+        template<class V>
+        static inline void apply(const typename V::F *in, typename V::F *out){
+          typedef typename V::F F;
+          const F y = V::add(V::add(V::mul(V::set1(0.299f),in[0]),V::mul(V::set1(0.587f),in[1])),
+                             V::mul(V::set1(0.114f),in[2]));
+          const F lo = V::set1(0.0f), hi = V::set1(255.0f), c = V::set1(128.0f);
+          out[0] = y;
+          out[1] = V::min(V::max(V::add(V::mul(V::set1(0.492f),V::sub(in[2],y)),c),lo),hi);
+          out[2] = V::min(V::max(V::add(V::mul(V::set1(0.877f),V::sub(in[0],y)),c),lo),hi);
+        }
+      };
+
+      /// YUV to RGB (results are clipped to [0,255])
+      struct CCOpYUVtoRGB{
+        enum { OUT = 3 };
+        template<class V>
+        static inline void apply(const typename V::F *in, typename V::F *out){
+          typedef typename V::F F;
+          const F c = V::set1(128.0f), lo = V::set1(0.0f), hi = V::set1(255.0f);
+          const F u = V::sub(in[1],c), v = V::sub(in[2],c);
+          const F r = V::add(in[0],V::mul(V::set1(1.140f),v));
+          const F g = V::sub(V::sub(in[0],V::mul(V::set1(0.394f),u)),V::mul(V::set1(0.581f),v));
+          const F b = V::add(in[0],V::mul(V::set1(2.032f),u));
+          out[0] = V::min(V::max(r,lo),hi);
+          out[1] = V::min(V::max(g,lo),hi);
+          out[2] = V::min(V::max(b,lo),hi);
+        }
+      };
+
+      /// RGB to HLS (see cc_util_rgb_to_hls, all channels in range [0,255])
+      struct CCOpRGBtoHLS{
+        enum { OUT = 3 };
+        template<class V>
+        static inline void apply(const typename V::F *in, typename V::F *out){
+          typedef typename V::F F;
+          const F zero = V::set1(0.0f), one = V::set1(1.0f), two = V::set1(2.0f);
+          const F s255 = V::set1(255.0f), i255 = V::set1(1.0f/255.0f);
+          const F r = V::mul(in[0],i255), g = V::mul(in[1],i255), b = V::mul(in[2],i255);
+          const F m = V::min(V::min(r,g),b), v = V::max(V::max(r,g),b);
+          const F l = V::mul(V::add(m,v),V::set1(0.5f));
+          const F vm = V::sub(v,m);
+          const F valid = V::gt(vm,zero);        // otherwise, h = s = 0
+          const F nonZero = V::gt(l,zero);       // otherwise, h = l = s = 0
+          const F vmInv = V::div(one,V::select(valid,vm,one));
+
+          const F s = V::div(vm,V::select(V::le(l,V::set1(0.5f)),V::add(v,m),V::sub(two,V::add(v,m))));
+          const F r2 = V::mul(V::sub(v,r),vmInv);
+          const F g2 = V::mul(V::sub(v,g),vmInv);
+          const F b2 = V::mul(V::sub(v,b),vmInv);
+
+          const F hr = V::select(V::eq(g,m),V::add(V::set1(5.0f),b2),V::sub(one,g2));
+          const F hg = V::select(V::eq(b,m),V::add(one,r2),V::sub(V::set1(3.0f),b2));
+          const F hb = V::select(V::eq(r,m),V::add(V::set1(3.0f),g2),V::sub(V::set1(5.0f),r2));
+          F h = V::select(V::eq(r,v),hr,V::select(V::eq(g,v),hg,hb));
+          h = V::mul(h,V::set1(255.0f/6.0f));
+          h = V::select(V::eq(h,s255),zero,h);
+
+          const F hs = V::select(nonZero,valid,zero);
+          out[0] = V::select(hs,h,zero);
+          out[1] = V::select(nonZero,V::mul(l,s255),zero);
+          out[2] = V::select(hs,V::mul(s,s255),zero);
+        }
+      };
+
+      /// RGB to LAB (see cc_util_rgb_to_lab, all channels in range [0,255])
+      struct CCOpRGBtoLAB{
+        enum { OUT = 3 };
+
+        template<class V>
+        static inline typename V::F f(typename V::F t){
+          typedef typename V::F F;
+          // cube root: Kahan's initial guess followed by one Halley step (like cbrt in CCFunctions.cpp)
+          const F a = V::cbrt_guess(t);
+          const F a3 = V::mul(V::mul(a,a),a);
+          const F c = V::div(V::mul(a,V::add(a3,V::add(t,t))),V::add(V::add(a3,a3),t));
+          const F lin = V::add(V::mul(V::set1(7.787f),t),V::set1(16.0f/116.0f));
+          return V::select(V::gt(t,V::set1(0.008856f)),c,lin);
+        }
+
+        template<class V>
+        static inline void apply(const typename V::F *in, typename V::F *out){
+          typedef typename V::F F;
+          const F r = in[0], g = in[1], b = in[2];
+          const F x = V::mul(V::add(V::add(V::mul(V::set1(0.412453f/255.0f),r),V::mul(V::set1(0.35758f/255.0f),g)),
+                                    V::mul(V::set1(0.180423f/255.0f),b)),V::set1(1.0f/0.950455f));
+          const F y = V::add(V::add(V::mul(V::set1(0.212671f/255.0f),r),V::mul(V::set1(0.71516f/255.0f),g)),
+                             V::mul(V::set1(0.072169f/255.0f),b));
+          const F z = V::mul(V::add(V::add(V::mul(V::set1(0.019334f/255.0f),r),V::mul(V::set1(0.119193f/255.0f),g)),
+                                    V::mul(V::set1(0.950227f/255.0f),b)),V::set1(1.0f/1.088753f));
+          const F fx = f<V>(x), fy = f<V>(y), fz = f<V>(z);
+          out[0] = V::sub(V::mul(V::set1(116.0f*2.55f),fy),V::set1(16.0f*(255.0f/100.0f)));
+          out[1] = V::add(V::mul(V::set1(500.0f),V::sub(fx,fy)),V::set1(128.0f));
+          out[2] = V::add(V::mul(V::set1(200.0f),V::sub(fy,fz)),V::set1(128.0f));
+        }
+      };
+
+      /// applies Op to n pixels (the remaining pixels are processed using padded buffers)
+      template<class V, class Op, class T>
+      void cc_simd_convert(const T *const *src, T *const *dst, int n){
+        typedef typename V::F F;
+        const int N = V::N;
+        F in[3], out[3];
+        int i=0;
+        for(;i<=n-N;i+=N){
+          for(int c=0;c<3;++c) in[c] = V::load(src[c]+i);
+          Op::template apply<V>(in,out);
+          for(int c=0;c<Op::OUT;++c) V::store(dst[c]+i,out[c]);
+        }
+        if(i < n){
+          T buf[3][N], res[N];
+          for(int c=0;c<3;++c){
+            for(int j=0;j<N;++j) buf[c][j] = i+j < n ? src[c][i+j] : T(0);
+            in[c] = V::load(buf[c]);
+          }
+          Op::template apply<V>(in,out);
+          for(int c=0;c<Op::OUT;++c){
+            V::store(res,out[c]);
+            for(int j=0;i+j<n;++j) dst[c][i+j] = res[j];
+          }
+        }
+      }
+
+      /// creates the function table for the given vector type
+      template<class V>
+      inline CCFunctionsKernels create_cc_functions_kernels(const char *name){
+        CCFunctionsKernels k = {
+          name,
+          cc_simd_convert<V,CCOpRGBtoGray,uint8_t>,
+          cc_simd_convert<V,CCOpRGBtoGray,float>,
+          cc_simd_convert<V,CCOpRGBtoYUV,uint8_t>,
+          cc_simd_convert<V,CCOpRGBtoYUV,float>,
+          cc_simd_convert<V,CCOpYUVtoRGB,uint8_t>,
+          cc_simd_convert<V,CCOpYUVtoRGB,float>,
+          cc_simd_convert<V,CCOpRGBtoHLS,uint8_t>,
+          cc_simd_convert<V,CCOpRGBtoHLS,float>,
+          cc_simd_convert<V,CCOpRGBtoLAB,uint8_t>,
+          cc_simd_convert<V,CCOpRGBtoLAB,float>
+        };
+        return k;
+      }
+    } // anonymous namespace
+
+  } // namespace core
+}
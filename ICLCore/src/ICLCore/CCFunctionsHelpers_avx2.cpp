@@ -0,0 +1,91 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCore/src/ICLCore/CCFunctionsHelpers_avx2.cpp        **
+** Module : ICLCore                                                **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+// This file is compiled with AVX2 support (see ICL_AVX2_FLAGS). It must not
+// include any headers, that define non-template inline functions, which could
+// then be emitted with AVX2 instructions and picked by the linker elsewhere.
+#include <ICLCore/CCFunctionsHelpers.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace icl{
+  namespace core{
+
+  #ifdef __AVX2__
+    namespace{
+      struct AVX2Vec{
+        typedef __m256 F;
+        enum { N = 8 };
+
+        static inline F set1(float f) { return _mm256_set1_ps(f); }
+        static inline F add(F a, F b) { return _mm256_add_ps(a,b); }
+        static inline F sub(F a, F b) { return _mm256_sub_ps(a,b); }
+        static inline F mul(F a, F b) { return _mm256_mul_ps(a,b); }
+        static inline F div(F a, F b) { return _mm256_div_ps(a,b); }
+        static inline F min(F a, F b) { return _mm256_min_ps(a,b); }
+        static inline F max(F a, F b) { return _mm256_max_ps(a,b); }
+        static inline F eq(F a, F b) { return _mm256_cmp_ps(a,b,_CMP_EQ_OQ); }
+        static inline F gt(F a, F b) { return _mm256_cmp_ps(a,b,_CMP_GT_OQ); }
+        static inline F le(F a, F b) { return _mm256_cmp_ps(a,b,_CMP_LE_OQ); }
+        static inline F select(F m, F a, F b) { return _mm256_blendv_ps(b,a,m); }
+
+        static inline F load(const float *p) { return _mm256_loadu_ps(p); }
+        static inline F load(const uint8_t *p){
+          return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p)));
+        }
+        static inline void store(float *p, F v) { _mm256_storeu_ps(p,v); }
+        static inline void store(uint8_t *p, F v){
+          __m256i i = _mm256_cvtps_epi32(v);
+          __m128i s = _mm_packus_epi32(_mm256_castsi256_si128(i),_mm256_extracti128_si256(i,1));
+          _mm_storel_epi64((__m128i*)p,_mm_packus_epi16(s,s));
+        }
+
+        static inline F cbrt_guess(F x){
+          __m256i i = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(x)),
+                                                        _mm256_set1_ps(1.0f/3.0f)));
+          return _mm256_castsi256_ps(_mm256_add_epi32(i,_mm256_set1_epi32(709921077)));
+        }
+      };
+    }
+
+    const CCFunctionsKernels *get_cc_functions_kernels_avx2(){
+      static const CCFunctionsKernels k = create_cc_functions_kernels<AVX2Vec>("avx2");
+      return &k;
+    }
+  #else
+    const CCFunctionsKernels *get_cc_functions_kernels_avx2(){
+      return 0;
+    }
+  #endif
+
+  } // namespace core
+}
@@ -0,0 +1,91 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCore/src/ICLCore/CCFunctionsHelpers_sse2.cpp        **
+** Module : ICLCore                                                **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#include <ICLCore/CCFunctionsHelpers.h>
+#include <ICLUtils/SSETypes.h>
+#include <string.h>
+
+namespace icl{
+  namespace core{
+
+  #ifdef ICL_HAVE_SSE2
+    namespace{
+      struct SSE2Vec{
+        typedef __m128 F;
+        enum { N = 4 };
+
+        static inline F set1(float f) { return _mm_set1_ps(f); }
+        static inline F add(F a, F b) { return _mm_add_ps(a,b); }
+        static inline F sub(F a, F b) { return _mm_sub_ps(a,b); }
+        static inline F mul(F a, F b) { return _mm_mul_ps(a,b); }
+        static inline F div(F a, F b) { return _mm_div_ps(a,b); }
+        static inline F min(F a, F b) { return _mm_min_ps(a,b); }
+        static inline F max(F a, F b) { return _mm_max_ps(a,b); }
+        static inline F eq(F a, F b) { return _mm_cmpeq_ps(a,b); }
+        static inline F gt(F a, F b) { return _mm_cmpgt_ps(a,b); }
+        static inline F le(F a, F b) { return _mm_cmple_ps(a,b); }
+        static inline F select(F m, F a, F b) { return _mm_or_ps(_mm_and_ps(m,a),_mm_andnot_ps(m,b)); }
+
+        static inline F load(const float *p) { return _mm_loadu_ps(p); }
+        static inline F load(const uint8_t *p){
+          int32_t i;
+          memcpy(&i,p,4);
+          const __m128i z = _mm_setzero_si128();
+          __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(i),z);
+          return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v,z));
+        }
+        static inline void store(float *p, F v) { _mm_storeu_ps(p,v); }
+        static inline void store(uint8_t *p, F v){
+          __m128i i = _mm_cvtps_epi32(v);
+          i = _mm_packs_epi32(i,i);
+          i = _mm_packus_epi16(i,i);
+          int32_t r = _mm_cvtsi128_si32(i);
+          memcpy(p,&r,4);
+        }
+
+        static inline F cbrt_guess(F x){
+          __m128i i = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(x)),_mm_set1_ps(1.0f/3.0f)));
+          return _mm_castsi128_ps(_mm_add_epi32(i,_mm_set1_epi32(709921077)));
+        }
+      };
+    }
+
+    const CCFunctionsKernels *get_cc_functions_kernels_sse2(){
+      static const CCFunctionsKernels k = create_cc_functions_kernels<SSE2Vec>("sse2");
+      return &k;
+    }
+  #else
+    const CCFunctionsKernels *get_cc_functions_kernels_sse2(){
+      return 0;
+    }
+  #endif
+
+  } // namespace core
+}
@@ -0,0 +1,95 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCore/src/ICLCore/CCFunctionsHelpers_sse41.cpp       **
+** Module : ICLCore                                                **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+// This file is compiled with SSE4.1 support (see ICL_SSE41_FLAGS). It must not
+// include any headers, that define non-template inline functions, which could
+// then be emitted with SSE4.1 instructions and picked by the linker elsewhere.
+#include <ICLCore/CCFunctionsHelpers.h>
+
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#include <string.h>
+#endif
+
+namespace icl{
+  namespace core{
+
+  #ifdef __SSE4_1__
+    namespace{
+      struct SSE41Vec{
+        typedef __m128 F;
+        enum { N = 4 };
+
+        static inline F set1(float f) { return _mm_set1_ps(f); }
+        static inline F add(F a, F b) { return _mm_add_ps(a,b); }
+        static inline F sub(F a, F b) { return _mm_sub_ps(a,b); }
+        static inline F mul(F a, F b) { return _mm_mul_ps(a,b); }
+        static inline F div(F a, F b) { return _mm_div_ps(a,b); }
+        static inline F min(F a, F b) { return _mm_min_ps(a,b); }
+        static inline F max(F a, F b) { return _mm_max_ps(a,b); }
+        static inline F eq(F a, F b) { return _mm_cmpeq_ps(a,b); }
+        static inline F gt(F a, F b) { return _mm_cmpgt_ps(a,b); }
+        static inline F le(F a, F b) { return _mm_cmple_ps(a,b); }
+        static inline F select(F m, F a, F b) { return _mm_blendv_ps(b,a,m); }
+
+        static inline F load(const float *p) { return _mm_loadu_ps(p); }
+        static inline F load(const uint8_t *p){
+          int32_t i;
+          memcpy(&i,p,4);
+          return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(i)));
+        }
+        static inline void store(float *p, F v) { _mm_storeu_ps(p,v); }
+        static inline void store(uint8_t *p, F v){
+          __m128i i = _mm_cvtps_epi32(v);
+          i = _mm_packus_epi32(i,i);
+          i = _mm_packus_epi16(i,i);
+          int32_t r = _mm_cvtsi128_si32(i);
+          memcpy(p,&r,4);
+        }
+
+        static inline F cbrt_guess(F x){
+          __m128i i = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(x)),_mm_set1_ps(1.0f/3.0f)));
+          return _mm_castsi128_ps(_mm_add_epi32(i,_mm_set1_epi32(709921077)));
+        }
+      };
+    }
+
+    const CCFunctionsKernels *get_cc_functions_kernels_sse41(){
+      static const CCFunctionsKernels k = create_cc_functions_kernels<SSE41Vec>("sse4.1");
+      return &k;
+    }
+  #else
+    const CCFunctionsKernels *get_cc_functions_kernels_sse41(){
+      return 0;
+    }
+  #endif
+
+  } // namespace core
+}
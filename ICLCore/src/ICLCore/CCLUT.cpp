@@ -62,225 +62,64 @@ namespace icl{
       return v;
     }
 
-    template<class T>
-    inline void get_ptrs_3(Img<T> &image, T *&a, T *&b, T *&c){
-      a = image.getData(0);
-      b = image.getData(1);
-      c = image.getData(2);
-    }
-
-    template<class T>
-    inline void get_ptrs_3(const Img<T> &image,const T *&a,const T *&b,const T *&c){
-      a = image.getData(0);
-      b = image.getData(1);
-      c = image.getData(2);
-    }
-
-    template<class T>
-    inline void get_ptrs_2(Img<T> &image,T *&a,T *&b){
-      a = image.getData(0);
-      b = image.getData(1);
-    }
-
-    template<class T>
-    inline void get_ptrs_2(const Img<T> &image,const T *&a,const T *&b){
-      a = image.getData(0);
-      b = image.getData(1);
-    }
-
-    template<class S, class D>
-    void cc_3x3(const Img<S> &src, Img<D> &dst, Img8u &lut, bool roiOnly){
-      if(roiOnly){
-      ERROR_LOG("not yet implemented with roi support!");
-      }else{
-        const S *s1,*s2, *s3;
-        D *d1, *d2, *d3;
-        icl8u *l1, *l2, *l3;
-
-        get_ptrs_3(src,s1,s2,s3);
-        get_ptrs_3(dst,d1,d2,d3);
-        get_ptrs_3(lut,l1,l2,l3);
-
-        const int DIM = src.getDim();
-        register int idx(0);
-        for(int i=0;i<DIM;i++){
-          idx = C2*clipped_cast<S,icl8u>(s1[i]) + C1*clipped_cast<S,icl8u>(s2[i]) + clipped_cast<S,icl8u>(s3[i]);
-          d1[i] = clipped_cast<icl8u,D>(l1[idx]);
-          d2[i] = clipped_cast<icl8u,D>(l2[idx]);
-          d3[i] = clipped_cast<icl8u,D>(l3[idx]);
-        }
-      }
-    }
-
-    template<class S, class D>
-    void cc_3x2(const Img<S> &src, Img<D> &dst, Img8u &lut, bool roiOnly){
-      if(roiOnly){
-        ERROR_LOG("not yet implemented with roi support!");
-      }else{
-        const S *s1,*s2, *s3;
-        D *d1, *d2;
-        icl8u *l1, *l2;
-
-        get_ptrs_3(src,s1,s2,s3);
-        get_ptrs_2(dst,d1,d2);
-        get_ptrs_2(lut,l1,l2);
-
-        const int DIM = src.getDim();
-        register int idx(0);
-        for(int i=0;i<DIM;i++){
-          idx = C2*clipped_cast<S,icl8u>(s1[i]) + C1*clipped_cast<S,icl8u>(s2[i]) + clipped_cast<S,icl8u>(s3[i]);
-          d1[i] = clipped_cast<icl8u,D>(l1[idx]);
-          d2[i] = clipped_cast<icl8u,D>(l2[idx]);
-        }
-      }
-    }
-
-    template<class S, class D>
-    void cc_3x1(const Img<S> &src, Img<D> &dst, Img8u &lut, bool roiOnly){
-      if(roiOnly){
-        ERROR_LOG("not yet implemented with roi support!");
-      }else{
-        const S *s1,*s2, *s3;
-        D *d1 = dst.getData(0);
-        icl8u *l1 = lut.getData(0);
-
-        get_ptrs_3(src,s1,s2,s3);
-
-        const int DIM = src.getDim();
-        register int idx(0);
-        for(int i=0;i<DIM;i++){
-          idx = C2*clipped_cast<S,icl8u>(s1[i]) + C1*clipped_cast<S,icl8u>(s2[i]) + clipped_cast<S,icl8u>(s3[i]);
-          d1[i] = clipped_cast<icl8u,D>(l1[idx]);
-        }
-      }
-    }
-
-    template<class S, class D>
-    void cc_2x3(const Img<S> &src, Img<D> &dst, Img8u &lut, bool roiOnly){
-      if(roiOnly){
-        ERROR_LOG("not yet implemented with roi support!");
-      }else{
-        const S *s1,*s2;
-        D *d1, *d2, *d3;
-        icl8u *l1, *l2, *l3;
-
-        get_ptrs_2(src,s1,s2);
-        get_ptrs_3(dst,d1,d2,d3);
-        get_ptrs_3(lut,l1,l2,l3);
-
-        const int DIM = src.getDim();
-        register int idx(0);
-        for(int i=0;i<DIM;i++){
-        idx = C1*clipped_cast<S,icl8u>(s1[i]) + clipped_cast<S,icl8u>(s2[i]);
-        d1[i] = clipped_cast<icl8u,D>(l1[idx]);
-        d2[i] = clipped_cast<icl8u,D>(l2[idx]);
-        d3[i] = clipped_cast<icl8u,D>(l3[idx]);
-        }
-      }
-    }
-
-    template<class S, class D>
-    void cc_2x2(const Img<S> &src, Img<D> &dst, Img8u &lut, bool roiOnly){
-      if(roiOnly){
-        ERROR_LOG("not yet implemented with roi support!");
-      }else{
-        const S *s1,*s2;
-        D *d1, *d2;
-        icl8u *l1, *l2;
-
-        get_ptrs_2(src,s1,s2);
-        get_ptrs_2(dst,d1,d2);
-        get_ptrs_2(lut,l1,l2);
-
-        const int DIM = src.getDim();
-        register int idx(0);
-        for(int i=0;i<DIM;i++){
-          idx = C1*clipped_cast<S,icl8u>(s1[i]) + clipped_cast<S,icl8u>(s2[i]);
-          d1[i] = clipped_cast<icl8u,D>(l1[idx]);
-          d2[i] = clipped_cast<icl8u,D>(l2[idx]);
-        }
-      }
-    }
-
-    template<class S, class D>
-    void cc_2x1(const Img<S> &src, Img<D> &dst, Img8u &lut, bool roiOnly){
-      if(roiOnly){
-        ERROR_LOG("not yet implemented with roi support!");
-      }else{
-        const S *s1,*s2;
-        D *d1 = dst.getData(0);
-        icl8u *l1 = lut.getData(0);
-
-        get_ptrs_2(src,s1,s2);
-
-        const int DIM = src.getDim();
-        register int idx(0);
-        for(int i=0;i<DIM;i++){
-          idx = C1*clipped_cast<S,icl8u>(s1[i]) + clipped_cast<S,icl8u>(s2[i]);
-          d1[i] = clipped_cast<icl8u,D>(l1[idx]);
-        }
-      }
-    }
-
-    template<class S, class D>
-    void cc_1x3(const Img<S> &src, Img<D> &dst, Img8u &lut, bool roiOnly){
-      if(roiOnly){
-        ERROR_LOG("not yet implemented with roi support!");
-      }else{
-        const S *s1 = src.getData(0);
-        D *d1, *d2, *d3;
-        icl8u *l1, *l2, *l3;
-
-        get_ptrs_3(dst,d1,d2,d3);
-        get_ptrs_3(lut,l1,l2,l3);
-
-        const int DIM = src.getDim();
-        register int idx(0);
-        for(int i=0;i<DIM;i++){
-          idx = clipped_cast<S,icl8u>(s1[i]);
-          d1[i] = clipped_cast<icl8u,D>(l1[idx]);
-          d2[i] = clipped_cast<icl8u,D>(l2[idx]);
-          d3[i] = clipped_cast<icl8u,D>(l3[idx]);
-        }
-      }
-    }
-
-    template<class S, class D>
-    void cc_1x2(const Img<S> &src, Img<D> &dst, Img8u &lut, bool roiOnly){
-      if(roiOnly){
-        ERROR_LOG("not yet implemented with roi support!");
-      }else{
-        const S *s1 = src.getData(0);
-        D *d1, *d2;
-        icl8u *l1, *l2;
-
-        get_ptrs_2(dst,d1,d2);
-        get_ptrs_2(lut,l1,l2);
-
-        const int DIM = src.getDim();
-        register int idx(0);
-        for(int i=0;i<DIM;i++){
-          idx = clipped_cast<S,icl8u>(s1[i]);
-          d1[i] = clipped_cast<icl8u,D>(l1[idx]);
-          d2[i] = clipped_cast<icl8u,D>(l2[idx]);
+    /// lookup table index for NS source channels
+    template<int NS, class S> inline int lut_index(const S *const *s, int x);
+    template<> inline int lut_index<1,icl8u>(const icl8u *const *s, int x){
+      return s[0][x];
+    }
+    template<> inline int lut_index<2,icl8u>(const icl8u *const *s, int x){
+      return C1*s[0][x] + s[1][x];
+    }
+    template<> inline int lut_index<3,icl8u>(const icl8u *const *s, int x){
+      return C2*s[0][x] + C1*s[1][x] + s[2][x];
+    }
+    template<int NS, class S> inline int lut_index(const S *const *s, int x){
+      int idx = 0;
+      for(int c=0;c<NS;++c){
+        idx = C1*idx + clipped_cast<S,icl8u>(s[c][x]);
+      }
+      return idx;
+    }
+
+    /// converts a range of rows using the lookup table (NS source and ND destination channels)
+    template<int NS, int ND, class S, class D>
+    struct CCLUTRows{
+      const Img<S> &src;
+      Img<D> &dst;
+      const Img8u &lut;
+      bool roiOnly;
+
+      CCLUTRows(const Img<S> &src, Img<D> &dst, const Img8u &lut, bool roiOnly):
+        src(src),dst(dst),lut(lut),roiOnly(roiOnly){}
+
+      void operator()(int yStart, int yEnd) const{
+        const S *s[NS];
+        D *d[ND];
+        const icl8u *l[ND];
+        for(int c=0;c<ND;++c) l[c] = lut.getData(c);
+
+        const int sw = src.getWidth(), dw = dst.getWidth();
+        const int w = roiOnly ? src.getROISize().width : sw;
+        for(int c=0;c<NS;++c) s[c] = (roiOnly ? src.getROIData(c) : src.getData(c)) + yStart*sw;
+        for(int c=0;c<ND;++c) d[c] = (roiOnly ? dst.getROIData(c) : dst.getData(c)) + yStart*dw;
+
+        for(int y=yStart;y<yEnd;++y){
+          for(int x=0;x<w;++x){
+            const int idx = lut_index<NS>(s,x);
+            for(int c=0;c<ND;++c){
+              d[c][x] = clipped_cast<icl8u,D>(l[c][idx]);
+            }
+          }
+          for(int c=0;c<NS;++c) s[c] += sw;
+          for(int c=0;c<ND;++c) d[c] += dw;
         }
       }
-    }
-
-    template<class S, class D>
-    void cc_1x1(const Img<S> &src, Img<D> &dst, Img8u &lut, bool roiOnly){
-      if(roiOnly){
-        ERROR_LOG("not yet implemented with roi support!");
-      }else{
-        const S *s1 = src.getData(0);
-        D *d1 = dst.getData(0);
-        icl8u *l1 = lut.getData(0);
+    };
 
-        const int DIM = src.getDim();
-        for(int i=0;i<DIM;i++){
-          d1[i] = clipped_cast<icl8u,D>(l1[clipped_cast<S,icl8u>(s1[i])]);
-        }
-      }
+    template<int NS, int ND, class S, class D>
+    inline void cc_nxm(const Img<S> &src, Img<D> &dst, const Img8u &lut, bool roiOnly, int numThreads){
+      CCLUTRows<NS,ND,S,D> rows(src,dst,lut,roiOnly);
+      utils::parallel_for_rows(roiOnly ? src.getROISize() : src.getSize(),rows,CC_MIN_PIXELS_PER_STRIPE,numThreads);
     }
 
     inline Img8u create_lut_3X(format srcFmt, format dstFmt){
@@ -330,29 +169,29 @@ namespace icl{
     }
 
     template<class S, class D>
-    inline void cc_sd(const Img<S> *src, Img<D> *dst, Img8u &lut, bool roiOnly){
+    inline void cc_sd(const Img<S> *src, Img<D> *dst, const Img8u &lut, bool roiOnly, int numThreads){
       switch(src->getChannels()){
         case 1:
           switch(dst->getChannels()){
-            case 1: cc_1x1(*src, *dst, lut, roiOnly); break;
-            case 2: cc_1x2(*src, *dst, lut, roiOnly); break;
-            case 3: cc_1x3(*src, *dst, lut, roiOnly); break;
+            case 1: cc_nxm<1,1>(*src, *dst, lut, roiOnly, numThreads); break;
+            case 2: cc_nxm<1,2>(*src, *dst, lut, roiOnly, numThreads); break;
+            case 3: cc_nxm<1,3>(*src, *dst, lut, roiOnly, numThreads); break;
             default: throw ICLException("CCLUT internal error (code 1)");
           }
           break;
         case 2:
           switch(dst->getChannels()){
-            case 1: cc_2x1(*src, *dst, lut, roiOnly); break;
-            case 2: cc_2x2(*src, *dst, lut, roiOnly); break;
-            case 3: cc_2x3(*src, *dst, lut, roiOnly); break;
+            case 1: cc_nxm<2,1>(*src, *dst, lut, roiOnly, numThreads); break;
+            case 2: cc_nxm<2,2>(*src, *dst, lut, roiOnly, numThreads); break;
+            case 3: cc_nxm<2,3>(*src, *dst, lut, roiOnly, numThreads); break;
             default: throw ICLException("CCLUT internal error (code 2)");
           }
           break;
         case 3:
           switch(dst->getChannels()){
-            case 1: cc_3x1(*src, *dst, lut, roiOnly); break;
-            case 2: cc_3x2(*src, *dst, lut, roiOnly); break;
-            case 3: cc_3x3(*src, *dst, lut, roiOnly); break;
+            case 1: cc_nxm<3,1>(*src, *dst, lut, roiOnly, numThreads); break;
+            case 2: cc_nxm<3,2>(*src, *dst, lut, roiOnly, numThreads); break;
+            case 3: cc_nxm<3,3>(*src, *dst, lut, roiOnly, numThreads); break;
             default: throw ICLException("CCLUT internal error (code 3)");
           }
           break;
@@ -362,9 +201,9 @@ namespace icl{
     }
 
     template<class S>
-    inline void cc_s(const Img<S> *src, ImgBase *dst, Img8u &lut, bool roiOnly){
+    inline void cc_s(const Img<S> *src, ImgBase *dst, const Img8u &lut, bool roiOnly, int numThreads){
       switch(dst->getDepth()){
-#define ICL_INSTANTIATE_DEPTH(D) case depth##D: cc_sd(src,dst->asImg<icl##D>(),lut,roiOnly); break;
+#define ICL_INSTANTIATE_DEPTH(D) case depth##D: cc_sd(src,dst->asImg<icl##D>(),lut,roiOnly,numThreads); break;
         ICL_INSTANTIATE_ALL_DEPTHS;
 #undef ICL_INSTANTIATE_DEPTH
       }
@@ -380,9 +219,15 @@ namespace icl{
         default: ICL_INVALID_FORMAT;
       }
     }
-    void CCLUT::cc(const ImgBase *src, ImgBase *dst, bool roiOnly){
+    void CCLUT::cc(const ImgBase *src, ImgBase *dst, bool roiOnly, int numThreads){
+      ICLASSERT_RETURN( src && dst );
+      if(roiOnly){
+        ICLASSERT_RETURN( src->getROISize() == dst->getROISize() );
+      }else{
+        ICLASSERT_RETURN( src->getSize() == dst->getSize() );
+      }
       switch(src->getDepth()){
-#define ICL_INSTANTIATE_DEPTH(D) case depth##D: cc_s(src->asImg<icl##D>(),dst, m_oLUT,roiOnly); break;
+#define ICL_INSTANTIATE_DEPTH(D) case depth##D: cc_s(src->asImg<icl##D>(),dst, m_oLUT,roiOnly,numThreads); break;
         ICL_INSTANTIATE_ALL_DEPTHS;
 #undef ICL_INSTANTIATE_DEPTH
       }
@@ -33,16 +33,23 @@
 #include <ICLUtils/CompatMacros.h>
 #include <ICLCore/Img.h>
 #include <ICLUtils/ConsoleProgress.h>
+#include <ICLUtils/ThreadPool.h>
 #include <vector>
 #include <string>
 
 namespace icl{
   namespace core{
 
+    /// minimum number of pixels per stripe of rows of a multithreaded color conversion
+    /** used with utils::parallel_for_rows; numThreads is interpreted as described for cc_set_num_threads */
+    static const int CC_MIN_PIXELS_PER_STRIPE = 16384;
+
     class ICLCore_API CCLUT{
       public:
       CCLUT(format srcFmt, format dstFmt);
-      void cc(const ImgBase *src, ImgBase *dst, bool roiOnly=false);
+
+      /// converts src into dst using the lookup table (see cc_set_num_threads for numThreads)
+      void cc(const ImgBase *src, ImgBase *dst, bool roiOnly=false, int numThreads=1);
 
       private:
       Img8u m_oLUT;
@@ -0,0 +1,282 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCore/src/ICLCore/ChannelAllocator.cpp               **
+** Module : ICLCore                                                **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#include <ICLCore/ChannelAllocator.h>
+#include <ICLUtils/Macros.h>
+#include <ICLUtils/Exception.h>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_set>
+#include <cstdlib>
+
+#ifdef ICL_SYSTEM_WINDOWS
+#include <malloc.h>
+#endif
+#ifdef ICL_SYSTEM_LINUX
+#include <sys/mman.h>
+#endif
+
+namespace icl{
+  namespace core{
+
+    namespace{
+      static const size_t ALIGNMENT = 64;
+      static const size_t HUGE_PAGE_SIZE = 2*1024*1024;
+      static const int NUM_CLASSES = 4*64;
+      static const size_t BLOCK_MAGIC = 0x1c1b10c5;
+
+      /// returns the size class of the given block size (4 classes per power of two)
+      inline int get_size_class(size_t bytes, size_t &classBytes){
+        if(bytes <= 4*ALIGNMENT){
+          const size_t n = bytes ? (bytes+ALIGNMENT-1)/ALIGNMENT : 1;
+          classBytes = n*ALIGNMENT;
+          return (int)n-1;
+        }
+        int e = 0;
+        for(size_t m=bytes-1; m>1; m>>=1) ++e;  // 2^e < bytes <= 2^(e+1)
+        const size_t step = size_t(1) << (e-2);
+        const size_t n = (bytes+step-1)/step;   // 5..8
+        classBytes = n*step;
+        return 4*(e-8) + (int)n - 1;
+      }
+
+      void *aligned_malloc(size_t bytes, size_t alignment){
+#ifdef ICL_SYSTEM_WINDOWS
+        return _aligned_malloc(bytes,alignment);
+#else
+        void *p = 0;
+        return posix_memalign(&p,alignment,bytes) ? 0 : p;
+#endif
+      }
+
+      void aligned_free(void *p){
+#ifdef ICL_SYSTEM_WINDOWS
+        _aligned_free(p);
+#else
+        free(p);
+#endif
+      }
+
+      /// header in front of each block (padded to ALIGNMENT bytes)
+      struct BlockHeader{
+        size_t magic;
+        int sizeClass;  //!< -1 for unpooled blocks
+        size_t bytes;   //!< usable size of the block
+      };
+
+      inline BlockHeader *get_header(void *p){
+        return reinterpret_cast<BlockHeader*>(static_cast<char*>(p) - ALIGNMENT);
+      }
+
+      /// allocates a block of the given size and initializes its header
+      void *allocate_block(size_t bytes, int sizeClass, bool huge){
+        char *base = static_cast<char*>(aligned_malloc(bytes+ALIGNMENT, huge ? HUGE_PAGE_SIZE : ALIGNMENT));
+        if(!base) throw std::bad_alloc();
+#ifdef ICL_SYSTEM_LINUX
+        if(huge) madvise(base,bytes+ALIGNMENT,MADV_HUGEPAGE);
+#endif
+        BlockHeader *h = reinterpret_cast<BlockHeader*>(base);
+        h->magic = BLOCK_MAGIC;
+        h->sizeClass = sizeClass;
+        h->bytes = bytes;
+        return base + ALIGNMENT;
+      }
+
+      void free_block(void *p){
+        aligned_free(get_header(p));
+      }
+    }
+
+    struct ChannelAllocatorImpl{
+      /// free list of a size class
+      struct FreeList{
+        std::mutex mutex;
+        std::vector<void*> blocks;
+      };
+
+      FreeList freeLists[NUM_CLASSES];
+      std::atomic<bool> enabled;
+      std::atomic<bool> hugePages;
+      std::atomic<size_t> maxPooledBytes;
+
+      std::atomic<size_t> requests, hits, bytesRequested, bytesReused, bytesPooled, bytesInUse;
+
+      /// buffers, that were passed to images with ownership
+      std::mutex foreignMutex;
+      std::unordered_set<const void*> foreign;
+      std::atomic<size_t> numForeign;
+
+      ChannelAllocatorImpl():enabled(false),hugePages(false),maxPooledBytes(256*1024*1024),
+                             requests(0),hits(0),bytesRequested(0),bytesReused(0),
+                             bytesPooled(0),bytesInUse(0),numForeign(0){}
+
+      void *allocate(size_t bytes){
+        size_t classBytes = 0;
+        const int c = get_size_class(bytes,classBytes);
+        ICLASSERT_THROW(c < NUM_CLASSES, utils::ICLException("ChannelAllocator: invalid block size"));
+        ++requests;
+        bytesRequested += bytes;
+        {
+          FreeList &l = freeLists[c];
+          std::lock_guard<std::mutex> lock(l.mutex);
+          if(l.blocks.size()){
+            void *p = l.blocks.back();
+            l.blocks.pop_back();
+            ++hits;
+            bytesReused += bytes;
+            bytesPooled -= classBytes;
+            bytesInUse += classBytes;
+            return p;
+          }
+        }
+        void *p = allocate_block(classBytes, c, hugePages && classBytes >= HUGE_PAGE_SIZE);
+        bytesInUse += classBytes;
+        return p;
+      }
+
+      /// reserves space for a block in the free lists (false if the limit would be exceeded)
+      bool reservePooledBytes(size_t bytes){
+        size_t cur = bytesPooled;
+        do{
+          if(cur + bytes > maxPooledBytes) return false;
+        }while(!bytesPooled.compare_exchange_weak(cur,cur+bytes));
+        return true;
+      }
+
+      void release(void *p){
+        const BlockHeader *h = get_header(p);
+        ICLASSERT_RETURN(h->magic == BLOCK_MAGIC);
+        if(h->sizeClass < 0){
+          free_block(p);
+          return;
+        }
+        bytesInUse -= h->bytes;
+        if(reservePooledBytes(h->bytes)){
+          FreeList &l = freeLists[h->sizeClass];
+          std::lock_guard<std::mutex> lock(l.mutex);
+          l.blocks.push_back(p);
+        }else{
+          free_block(p);
+        }
+      }
+
+      void clear(){
+        for(int c=0;c<NUM_CLASSES;++c){
+          FreeList &l = freeLists[c];
+          std::lock_guard<std::mutex> lock(l.mutex);
+          for(size_t i=0;i<l.blocks.size();++i){
+            bytesPooled -= get_header(l.blocks[i])->bytes;
+            free_block(l.blocks[i]);
+          }
+          l.blocks.clear();
+        }
+      }
+
+      static ChannelAllocatorImpl &instance(){
+        // never destroyed: static images may release their channels after
+        // the destruction of all other static objects
+        static ChannelAllocatorImpl *impl = new ChannelAllocatorImpl;
+        return *impl;
+      }
+    };
+
+    double ChannelAllocator::Statistics::getHitRate() const{
+      return requests ? double(hits)/requests : 0;
+    }
+
+    void *ChannelAllocator::allocate(size_t bytes, bool pooled){
+      if(pooled) return ChannelAllocatorImpl::instance().allocate(bytes);
+      return allocate_block(bytes ? bytes : 1, -1, false);
+    }
+
+    void ChannelAllocator::release(void *p){
+      ChannelAllocatorImpl::instance().release(p);
+    }
+
+    void ChannelAllocator::registerForeign(const void *p){
+      ChannelAllocatorImpl &impl = ChannelAllocatorImpl::instance();
+      std::lock_guard<std::mutex> lock(impl.foreignMutex);
+      if(impl.foreign.insert(p).second) ++impl.numForeign;
+    }
+
+    bool ChannelAllocator::unregisterForeign(const void *p){
+      ChannelAllocatorImpl &impl = ChannelAllocatorImpl::instance();
+      if(!impl.numForeign) return false;
+      std::lock_guard<std::mutex> lock(impl.foreignMutex);
+      if(!impl.foreign.erase(p)) return false;
+      --impl.numForeign;
+      return true;
+    }
+
+    bool ChannelAllocator::usePool(Mode mode){
+      return mode == Pooled || (mode == Default && isEnabled());
+    }
+
+    void ChannelAllocator::setEnabled(bool enabled){
+      ChannelAllocatorImpl::instance().enabled = enabled;
+    }
+
+    bool ChannelAllocator::isEnabled(){
+      return ChannelAllocatorImpl::instance().enabled;
+    }
+
+    void ChannelAllocator::setUseHugePages(bool use){
+      ChannelAllocatorImpl::instance().hugePages = use;
+    }
+
+    void ChannelAllocator::setMaxPooledBytes(size_t bytes){
+      ChannelAllocatorImpl::instance().maxPooledBytes = bytes;
+    }
+
+    void ChannelAllocator::clear(){
+      ChannelAllocatorImpl::instance().clear();
+    }
+
+    ChannelAllocator::Statistics ChannelAllocator::getStatistics(){
+      ChannelAllocatorImpl &impl = ChannelAllocatorImpl::instance();
+      Statistics s;
+      s.requests = impl.requests;
+      s.hits = impl.hits;
+      s.bytesRequested = impl.bytesRequested;
+      s.bytesReused = impl.bytesReused;
+      s.bytesPooled = impl.bytesPooled;
+      s.bytesInUse = impl.bytesInUse;
+      return s;
+    }
+
+    void ChannelAllocator::resetStatistics(){
+      ChannelAllocatorImpl &impl = ChannelAllocatorImpl::instance();
+      impl.requests = impl.hits = 0;
+      impl.bytesRequested = impl.bytesReused = 0;
+    }
+
+  } // namespace core
+}
@@ -0,0 +1,147 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCore/src/ICLCore/ChannelAllocator.h                 **
+** Module : ICLCore                                                **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#pragma once
+
+#include <ICLUtils/CompatMacros.h>
+#include <ICLUtils/SmartPtrBase.h>
+#include <cstddef>
+
+namespace icl{
+  namespace core{
+
+    /// Pooled memory allocator for image channels \ingroup IMAGE
+    /** By default, Img<T> allocates a new buffer, whenever a channel is created
+        (e.g. on construction, setSize, setChannels, detach or deepCopy) and frees
+        it, once the last image referencing it is released. For image processing
+        chains that run once per frame, this means, that several megabytes are
+        allocated and freed again for each frame.
+
+        If pooling is enabled, released channel buffers are not freed, but kept
+        in size-classed free lists, from which later requests are served. The pool
+        is shared by all threads, i.e. a channel that was created by a grabber
+        thread can be reused by a processing thread and vice versa.
+
+        \section SC Size Classes
+        Requests are rounded up to the next size class. Each power of two is split
+        into four classes, so that at most 25% of a block remain unused. Pooled
+        blocks are aligned to 64 bytes (cache line and AVX-512 register size).
+        Optionally, huge pages can be requested for blocks of 2MB or more
+        (only supported on Linux, where they are requested using madvise).
+
+        \section EN Enabling the Pool
+        Pooling is disabled by default. It can be enabled globally using
+        setEnabled(true) or for single images using ImgBase::setChannelAllocation.
+        Buffers, that were not allocated by the pool (e.g. buffers, that were
+        passed to an image with ownership) are always released using delete [].
+
+        \section TAG Block Tags
+        All channel buffers, that are allocated by Img<T>, carry a small header in front
+        of the data, that tells whether the block belongs to the pool. Therefore, releasing
+        an unpooled buffer does not involve any lookup or lock, and releasing a pooled
+        buffer only locks the free list of its size class. Only buffers, that are passed
+        to an image with ownership, are registered (see registerForeign).
+
+        \section LIM Memory Limit
+        The number of bytes, that are kept in the free lists is limited (256MB by
+        default, see setMaxPooledBytes). Blocks that would exceed this limit are
+        freed immediately.
+    */
+    class ICLCore_API ChannelAllocator{
+      public:
+
+      /// per image allocation mode (see ImgBase::setChannelAllocation)
+      enum Mode{
+        Default,  //!< use the pool if it is enabled globally
+        Pooled,   //!< always use the pool
+        Unpooled  //!< never use the pool
+      };
+
+      /// allocation statistics
+      struct ICLCore_API Statistics{
+        size_t requests;       //!< number of pooled allocations
+        size_t hits;           //!< number of allocations, that were served from the free lists
+        size_t bytesRequested; //!< accumulated size of all pooled allocations
+        size_t bytesReused;    //!< accumulated size of all allocations that were served from the free lists
+        size_t bytesPooled;    //!< number of bytes, that are currently held in the free lists
+        size_t bytesInUse;     //!< number of bytes in pooled blocks, that are currently in use
+
+        /// returns hits/requests (0 if there were no requests)
+        double getHitRate() const;
+      };
+
+      /// allocates a 64-byte aligned buffer (from the pool if pooled is true)
+      static void *allocate(size_t bytes, bool pooled=true);
+
+      /// releases a block, that was allocated using allocate
+      /** Pooled blocks are returned to the pool, other blocks are freed */
+      static void release(void *p);
+
+      /// registers a buffer, that was allocated with new [] and that is owned by an image
+      static void registerForeign(const void *p);
+
+      /// unregisters p and returns true, if p was registered using registerForeign
+      static bool unregisterForeign(const void *p);
+
+      /// returns whether the given mode results in pooled allocation
+      static bool usePool(Mode mode);
+
+      /// enables or disables pooled channel allocation for all images (disabled by default)
+      static void setEnabled(bool enabled);
+
+      /// returns whether pooled allocation is enabled globally
+      static bool isEnabled();
+
+      /// requests huge pages for blocks of 2MB or more (disabled by default)
+      static void setUseHugePages(bool use);
+
+      /// sets the maximum number of bytes, that are held in the free lists
+      static void setMaxPooledBytes(size_t bytes);
+
+      /// frees all blocks, that are currently held in the free lists
+      static void clear();
+
+      /// returns the current statistics
+      static Statistics getStatistics();
+
+      /// resets the counters (requests, hits, bytesRequested and bytesReused)
+      static void resetStatistics();
+    };
+
+    /// delete operation for image channels, that returns pooled blocks to the ChannelAllocator
+    struct ChannelDelOp : public utils::DelOpBase{
+      template<class T> static void delete_func(T *t){
+        if(ChannelAllocator::unregisterForeign(t)) delete [] t;
+        else ChannelAllocator::release(t);
+      }
+    };
+
+  } // namespace core
+}
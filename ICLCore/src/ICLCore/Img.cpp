@@ -30,6 +30,7 @@
 ********************************************************************/
 
 #include <ICLCore/Img.h>
+#include <ICLCore/ScaledCopy.h>
 #include <functional>
 #include <ICLUtils/Rect32f.h>
 #include <ICLUtils/StringUtils.h>
@@ -111,7 +112,8 @@ namespace icl {
 
       typename std::vector<Type*>::const_iterator it = vptData.begin();
       for(int i=0; i<getChannels(); ++i, ++it) {
-        m_vecChannels.push_back(SmartArray<Type>(*it,passOwnerShip));
+        if(passOwnerShip) ChannelAllocator::registerForeign(*it);
+        m_vecChannels.push_back(SmartPtrBase<Type,ChannelDelOp>(*it,passOwnerShip));
       }
     }
 
@@ -126,7 +128,8 @@ namespace icl {
 
       typename std::vector<Type*>::const_iterator it = vptData.begin();
       for(int i=0; i<getChannels(); ++i, ++it) {
-        m_vecChannels.push_back(SmartArray<Type>(*it,passOwnerShip));
+        if(passOwnerShip) ChannelAllocator::registerForeign(*it);
+        m_vecChannels.push_back(SmartPtrBase<Type,ChannelDelOp>(*it,passOwnerShip));
       }
     }
 
@@ -141,7 +144,8 @@ namespace icl {
 
       typename std::vector<Type*>::const_iterator it = vptData.begin();
       for(int i=0; i<getChannels(); ++i, ++it) {
-        m_vecChannels.push_back(SmartArray<Type>(*it,passOwnerShip));
+        if(passOwnerShip) ChannelAllocator::registerForeign(*it);
+        m_vecChannels.push_back(SmartPtrBase<Type,ChannelDelOp>(*it,passOwnerShip));
       }
     }
 
@@ -192,11 +196,11 @@ namespace icl {
 
       if(c1.isNull()) return;
       m_vecChannels.reserve(getChannels());
-      m_vecChannels.push_back(SmartArray<Type>(const_cast<Type*>(c1.begin()),false));
+      m_vecChannels.push_back(SmartPtrBase<Type,ChannelDelOp>(const_cast<Type*>(c1.begin()),false));
   #define ADD_CHANNEL(i)                                                  \
       if(!c##i.isNull()){                                                 \
         ICLASSERT_THROW(c1.cols() == c##i.cols() && c1.rows() == c##i.rows(), InvalidMatrixDimensionException(__FUNCTION__)); \
-        m_vecChannels.push_back(SmartArray<Type>(const_cast<Type*>(c##i.begin()),false)); \
+        m_vecChannels.push_back(SmartPtrBase<Type,ChannelDelOp>(const_cast<Type*>(c##i.begin()),false)); \
       }
       ADD_CHANNEL(2)    ADD_CHANNEL(3)    ADD_CHANNEL(4)    ADD_CHANNEL(5)
   #undef ADD_CHANNEL
@@ -1094,19 +1098,20 @@ namespace icl {
     // {{{  Auxillary  functions
 
     template<class Type>
-    SmartArray<Type> Img<Type>::createChannel(Type *ptDataToCopy) const {
+    SmartPtrBase<Type,ChannelDelOp> Img<Type>::createChannel(Type *ptDataToCopy) const {
       // {{{ open
       FUNCTION_LOG("");
       int dim = getDim();
-      if(!dim) return SmartArray<Type>();
+      if(!dim) return SmartPtrBase<Type,ChannelDelOp>();
 
-      Type *ptNewData = new Type[dim];
+      Type *ptNewData = static_cast<Type*>(ChannelAllocator::allocate(dim*sizeof(Type),
+                                                                      ChannelAllocator::usePool(getChannelAllocation())));
       if(ptDataToCopy){
         memcpy(ptNewData,ptDataToCopy,dim*sizeof(Type));
       }else{
         std::fill(ptNewData,ptNewData+dim,0);
       }
-      return SmartArray<Type>(ptNewData);
+      return SmartPtrBase<Type,ChannelDelOp>(ptNewData);
     }
 
     // }}}
@@ -1433,177 +1438,17 @@ namespace icl {
 
       CHECK_VALUES_NO_SIZE(src,srcC,srcOffs,srcSize,dst,dstC,dstOffs,dstSize);
 
-      float fSX = ((float)srcSize.width)/(float)(dstSize.width);
-      float fSY = ((float)srcSize.height)/(float)(dstSize.height);
-
-      float (Img<T>::*subPixelMethod)(float fX, float fY, int iChannel) const;
-      switch(eScaleMode) {
-        case interpolateNN:
-          {
-              const T *d = src->getData(srcC);
-              const unsigned int w = src->getWidth();
-
-              ImgIterator<T> itDst(dst->getData(dstC),dst->getSize().width,Rect(dstOffs,dstSize));
-              const ImgIterator<T> itDstEnd = ImgIterator<T>::create_end_roi_iterator(dst->getData(dstC),dst->getWidth(),Rect(dstOffs,dstSize));
-              int xD = 0;
-              int yD = 0;
-              float yS = srcOffs.y + fSY * yD;
-              for(; itDst != itDstEnd ; ++itDst) {
-                *itDst = clipped_cast<float, T>(*(d + (int)(srcOffs.x + fSX * xD) + (int)yS * w));
-                if (++xD == dstSize.width) {
-                  yS = srcOffs.y + fSY * ++yD;
-                  xD = 0;
-                }
-              }
-          }
-          return;
-        case interpolateLIN:
-          {
-              fSX = ((float)srcSize.width-1)/(float)(dstSize.width);
-              fSY = ((float)srcSize.height-1)/(float)(dstSize.height);
-
-              const T *d = src->getData(srcC);
-              const unsigned int w = src->getWidth();
-
-              ImgIterator<T> itDst(dst->getData(dstC),dst->getSize().width,Rect(dstOffs,dstSize));
-              const ImgIterator<T> itDstEnd = ImgIterator<T>::create_end_roi_iterator(dst->getData(dstC),dst->getWidth(),Rect(dstOffs,dstSize));
-              int xD = 0;
-              int yD = 0;
-              float yS = srcOffs.y + fSY * yD;
-              for(; itDst != itDstEnd ; ++itDst) {
-                  float xS = srcOffs.x + fSX * xD;
-                  float fX0 = xS - floor(xS), fX1 = 1.0 - fX0;
-                  float fY0 = yS - floor(yS), fY1 = 1.0 - fY0;
-                  int xll = (int) xS;
-                  int yll = (int) yS;
-
-                  const T *pLL = (d + xll + yll * w);
-                  float a = *pLL;        //  a b
-                  float b = *(++pLL);    //  c d
-                  pLL += w;
-                  float d = *pLL;
-                  float c = *(--pLL);
-
-                  *itDst = clipped_cast<float, T>(fX1 * (fY1*a + fY0*c) + fX0 * (fY1*b + fY0*d));
-
-                  if (++xD == dstSize.width) {
-                    yS = srcOffs.y + fSY * ++yD;
-                    xD = 0;
-                  }
-              }
-          }
-
-          return;
-        case interpolateRA:
-          {
-              float b, e;
-              float ratio = 1/(fSX*fSY);
-              const T *d = src->getData(srcC);
-              const unsigned int w = src->getWidth();
-
-              // rectangle in source image for the destination pixel
-              unsigned int *xBegin = new unsigned int[dstSize.width];
-              unsigned int *xEnd = new unsigned int[dstSize.width];
-              unsigned int *yBegin = new unsigned int[dstSize.height];
-              unsigned int *yEnd = new unsigned int[dstSize.height];
-              // fill quantity of the rectangle edges
-              float *xBMul = new float[dstSize.width];
-              float *xEMul = new float[dstSize.width];
-              float *yBMul = new float[dstSize.height];
-              float *yEMul = new float[dstSize.height];
-
-              for (int i = 0; i < dstSize.width; ++i) {
-                      b = srcOffs.x + i*fSX;
-                      xBegin[i] = b;
-                      xBMul[i] = 1.0f - (b-xBegin[i]);
-                      xEnd[i]   = ceilf((b+fSX)-1);
-                      xEMul[i] = 1.0f - (xEnd[i]-(b+fSX-1));
-              }
-
-              for (int i = 0; i < dstSize.height; ++i) {
-                      e = srcOffs.y + i*fSY;
-                      yBegin[i] = e;
-                      yBMul[i] = 1.0f - (e-yBegin[i]);
-                      yEnd[i]   = ceilf((e+fSY)-1);
-                      yEMul[i] = 1.0f - (yEnd[i]-(e+fSY-1));
-              }
-
-              ImgIterator<T> itDst(dst->getData(dstC),dst->getSize().width,Rect(dstOffs,dstSize));
-              const ImgIterator<T> itDstEnd = ImgIterator<T>::create_end_roi_iterator(dst->getData(dstC),dst->getWidth(),Rect(dstOffs,dstSize));
-              int xD = 0;
-              int yD = 0;
-              for(; itDst != itDstEnd ; ++itDst) {
-                  float sum = 0.0f;
-
-                  unsigned int xB = xBegin[xD];
-                  unsigned int xE = xEnd[xD];
-                  unsigned int yB = yBegin[yD];
-                  unsigned int yE = yEnd[yD];
-
-                  // sum of the first row
-                  sum += (*(d + xB + yB*w))*xBMul[xD];
-                  for (unsigned int x = xB+1; x < xE; ++x) {
-                          sum += (*(d + x + yB*w));
-                  }
-                  sum = (sum + (*(d + xE + yB*w))*xEMul[xD]) * yBMul[yD];
-
-                  for (unsigned int y = yB+1; y < yE; ++y) {
-                          sum += (*(d + xB + y*w))*xBMul[xD];
-                          for (unsigned int x = xB+1; x < xE; ++x) {
-                                  sum += *(d + x + y*w);
-                          }
-                          sum += (*(d + xE + y*w))*xEMul[xD];
-                  }
-
-                  // sum of the last row
-                  float psum = (*(d + xB + yE*w))*xBMul[xD];
-                  for (unsigned int x = xB+1; x < xE; ++x) {
-                          psum += (*(d + x + yE*w));
-                  }
-                  sum += ((psum + (*(d + xE + yE*w))*xEMul[xD]) * yEMul[yD]);
-
-                  *itDst = clipped_cast<float, T>(sum*ratio+0.5f);
-                  if (++xD == dstSize.width) {
-                      ++yD;
-                      xD = 0;
-                  }
-              }
-
-              delete[] xBegin;
-              delete[] xEnd;
-              delete[] yBegin;
-              delete[] yEnd;
-              delete[] xBMul;
-              delete[] xEMul;
-              delete[] yBMul;
-              delete[] yEMul;
-          }
-
-          return;
-        default:{
-          static bool first = true;
-          if(first){
-            first = false;
-            WARNING_LOG("the given interpolation method is not supported without IPP");
-            WARNING_LOG("using nearest neighbour interpolation as fallback!");
-          }
-          subPixelMethod = &Img<T>::subPixelNN;
-          break;
-        }
-      }
-
-      ImgIterator<T> itDst(dst->getData(dstC),dst->getSize().width,Rect(dstOffs,dstSize));
-      const ImgIterator<T> itDstEnd = ImgIterator<T>::create_end_roi_iterator(dst->getData(dstC),dst->getWidth(),Rect(dstOffs,dstSize));
-      int xD = 0;
-      int yD = 0;
-      float yS = srcOffs.y + fSY * yD;
-      for(; itDst != itDstEnd ; ++itDst) {
-        *itDst = clipped_cast<float, T>((src->*subPixelMethod)(srcOffs.x + fSX * xD, yS, srcC));
-        if (++xD == dstSize.width) {
-          yS = srcOffs.y + fSY * ++yD;
-          xD = 0;
+      if(eScaleMode != interpolateNN && eScaleMode != interpolateLIN && eScaleMode != interpolateRA){
+        static bool first = true;
+        if(first){
+          first = false;
+          WARNING_LOG("the given interpolation method is not supported without IPP");
+          WARNING_LOG("using nearest neighbour interpolation as fallback!");
         }
+        eScaleMode = interpolateNN;
       }
+      scaled_copy_channel_roi(src->getData(srcC),src->getWidth(),Rect(srcOffs,srcSize),
+                              dst->getData(dstC),dst->getWidth(),Rect(dstOffs,dstSize),eScaleMode);
     }
 
     // }}}
@@ -77,7 +77,7 @@ namespace icl {
       /* {{{ open */
 
       /// internally used storage for the image channels
-      std::vector<utils::SmartArray<Type> > m_vecChannels;
+      std::vector<utils::SmartPtrBase<Type,ChannelDelOp> > m_vecChannels;
       /// @}
 
       /* }}} */
@@ -87,9 +87,11 @@ namespace icl {
 
       /// Internally creates a new deep copy of a specified Type*
       /** if the give Type* ptDataToCopy is not NULL, the data addressed from it,
-          is copied deeply into the new created data pointer
+          is copied deeply into the new created data pointer. The channel is
+          allocated by the ChannelAllocator, if pooling is enabled for this image
+          (see ImgBase::setChannelAllocation)
           **/
-      utils::SmartArray<Type> createChannel(Type *ptDataToCopy=0) const;
+      utils::SmartPtrBase<Type,ChannelDelOp> createChannel(Type *ptDataToCopy=0) const;
 
       /// returns the start index for a channel loop
       /** In some functions to cases must be regarded:
@@ -1847,9 +1849,10 @@ namespace icl {
 
     /// @{ @name scaling of channel ROIs
     /// scales an image channels ROI into another images ROI (with implicit type conversion) (IPP-OPTIMIZED) \ingroup IMAGE
-    /** This function provides all necessary functionalities for scaling images. Please regard, that the fallback-
-        implementation is very slow. Only scaling operations with identical source and destination type
-        is optimized by corresponding ippResize calls (see also the specialized template functions).
+    /** This function provides all necessary functionalities for scaling images. If IPP is available,
+        icl8u and icl32f images are scaled by corresponding ippResize calls (see also the specialized
+        template functions). Otherwise, the vectorized and optionally multithreaded implementation
+        scaled_copy_channel_roi (see ICLCore/ScaledCopy.h) is used.
         @param src source image
         @param srcC source image channel
         @param srcOffs source images ROI-offset (src->getROIOffset() is <b>not</b> regarded)
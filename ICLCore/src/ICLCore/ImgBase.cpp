@@ -38,7 +38,8 @@ using namespace icl::math;
 namespace icl {
   namespace core{
 
-    ImgBase::ImgBase(depth d, const ImgParams &params):m_oParams(params),m_eDepth(d) { }
+    ImgBase::ImgBase(depth d, const ImgParams &params):
+      m_oParams(params),m_eDepth(d),m_channelAllocation(ChannelAllocator::Default) { }
 
     ImgBase::~ImgBase(){
       FUNCTION_LOG("");
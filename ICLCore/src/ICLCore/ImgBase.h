@@ -34,6 +34,7 @@
 #include <ICLUtils/CompatMacros.h>
 #include <ICLCore/CoreFunctions.h>
 #include <ICLCore/ImgParams.h>
+#include <ICLCore/ChannelAllocator.h>
 #include <ICLUtils/Time.h>
 #include <ICLUtils/Range.h>
 #include <ICLUtils/SmartPtr.h>
@@ -853,6 +854,15 @@ namespace icl {
       virtual bool isIndependent() const=0;
       /// @}
 
+      /// sets whether new channels of this image are allocated by the ChannelAllocator
+      /** The mode affects all channels, that are created later on (e.g. by
+          setSize, setChannels or detach). By default, the global setting
+          (see ChannelAllocator::setEnabled) is used. */
+      void setChannelAllocation(ChannelAllocator::Mode mode) { m_channelAllocation = mode; }
+
+      /// returns the current channel allocation mode
+      ChannelAllocator::Mode getChannelAllocation() const { return m_channelAllocation; }
+
       /// returns whether meta data has been associated to this image
       inline bool hasMetaData() const { return m_metaData.length(); }
 
@@ -899,6 +909,9 @@ namespace icl {
 
       /// additional information associated with this image
       std::string m_metaData;
+
+      /// channel allocation mode
+      ChannelAllocator::Mode m_channelAllocation;
     };
 
     /// puts a string representation of the image into given steam
@@ -0,0 +1,407 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCore/src/ICLCore/ScaledCopy.cpp                     **
+** Module : ICLCore                                                **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#include <ICLCore/ScaledCopy.h>
+#include <ICLUtils/ClippedCast.h>
+#include <ICLUtils/ThreadPool.h>
+#include <ICLUtils/SSETypes.h>
+#include <vector>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+
+using namespace icl::utils;
+
+namespace icl{
+  namespace core{
+
+    namespace{
+      static std::atomic<int> g_scaledCopyNumThreads(1);
+
+      /// interpolation coefficients for one geometry
+      struct ScaleTables{
+        scalemode mode;
+        Rect srcROI, dstROI;
+
+        std::vector<int> xb, yb;     //!< first source column/row (absolute)
+        std::vector<int> xe, ye;     //!< last source column/row (RA only)
+        std::vector<float> xw0, yw0; //!< LIN: fraction, RA: weight of the first column/row
+        std::vector<float> xw1, yw1; //!< LIN: 1-fraction, RA: weight of the last column/row
+        std::vector<int> xw8, yw8;   //!< LIN: 8-bit fixed point fraction
+        float ratio;                 //!< RA: normalization factor
+
+        ScaleTables():mode(interpolateNN){}
+
+        bool matches(scalemode mode, const Rect &srcROI, const Rect &dstROI) const{
+          return this->mode == mode && this->srcROI == srcROI && this->dstROI == dstROI && xb.size();
+        }
+
+        /// the formulas are identical to the ones of the former per pixel implementation
+        void init(scalemode mode, const Rect &srcROI, const Rect &dstROI){
+          this->mode = mode;
+          this->srcROI = srcROI;
+          this->dstROI = dstROI;
+          const int dw = dstROI.width, dh = dstROI.height;
+          xb.resize(dw); yb.resize(dh);
+          switch(mode){
+            case interpolateLIN:{
+              const float fSX = ((float)srcROI.width-1)/(float)(dw);
+              const float fSY = ((float)srcROI.height-1)/(float)(dh);
+              init_lin(srcROI.x,fSX,xb,xw0,xw1,xw8);
+              init_lin(srcROI.y,fSY,yb,yw0,yw1,yw8);
+              break;
+            }
+            case interpolateRA:{
+              const float fSX = ((float)srcROI.width)/(float)(dw);
+              const float fSY = ((float)srcROI.height)/(float)(dh);
+              ratio = 1/(fSX*fSY);
+              init_ra(srcROI.x,srcROI.width,fSX,xb,xe,xw0,xw1);
+              init_ra(srcROI.y,srcROI.height,fSY,yb,ye,yw0,yw1);
+              break;
+            }
+            default:{
+              const float fSX = ((float)srcROI.width)/(float)(dw);
+              const float fSY = ((float)srcROI.height)/(float)(dh);
+              for(int i=0;i<dw;++i) xb[i] = (int)(srcROI.x + fSX * i);
+              for(int i=0;i<dh;++i) yb[i] = (int)(srcROI.y + fSY * i);
+              break;
+            }
+          }
+        }
+
+        static void init_lin(int offs, float f, std::vector<int> &b, std::vector<float> &w0,
+                             std::vector<float> &w1, std::vector<int> &w8){
+          const int n = (int)b.size();
+          w0.resize(n); w1.resize(n); w8.resize(n);
+          for(int i=0;i<n;++i){
+            const float s = offs + f * i;
+            w0[i] = s - floor(s);
+            w1[i] = 1.0 - w0[i];
+            w8[i] = std::min(256,(int)(w0[i]*256+0.5f));
+            b[i] = (int)s;
+          }
+        }
+
+        static void init_ra(int offs, int len, float f, std::vector<int> &b, std::vector<int> &e,
+                            std::vector<float> &w0, std::vector<float> &w1){
+          const int n = (int)b.size();
+          e.resize(n); w0.resize(n); w1.resize(n);
+          for(int i=0;i<n;++i){
+            const float s = offs + i*f;
+            b[i] = (unsigned int)s;
+            w0[i] = 1.0f - (s-b[i]);
+            e[i] = std::min(offs+len-1,(int)ceilf((s+f)-1));
+            w1[i] = 1.0f - (e[i]-(s+f-1));
+          }
+        }
+      };
+
+      /// thread local cache of the last used tables
+      /** A thread, that waits for its parallelFor call, helps processing other
+          tasks of the ThreadPool, which might contain other scaled copies. In this
+          case, the cached tables are in use and temporary tables are created */
+      struct ScaleTableCache{
+        ScaleTables tables;
+        bool inUse;
+        ScaleTableCache():inUse(false){}
+      };
+
+      /// locks the thread local table cache while it is used
+      struct ScaleTableLock{
+        ScaleTableCache &cache;
+        ScaleTables tmp;
+        bool locked;
+        ScaleTableLock(ScaleTableCache &cache):cache(cache),locked(!cache.inUse){
+          cache.inUse = true;
+        }
+        ~ScaleTableLock(){
+          if(locked) cache.inUse = false;
+        }
+        const ScaleTables &get(scalemode mode, const Rect &srcROI, const Rect &dstROI){
+          ScaleTables &t = locked ? cache.tables : tmp;
+          if(!t.matches(mode,srcROI,dstROI)) t.init(mode,srcROI,dstROI);
+          return t;
+        }
+      };
+
+      /// returns a thread local buffer with at least n elements
+      template<class B>
+      inline B *get_row_buffer(int n){
+        static thread_local std::vector<B> buf;
+        if((int)buf.size() < n) buf.resize(n);
+        return buf.data();
+      }
+
+      // {{{ vertical passes: buf = a*wa + b*wb, buf = a*w, buf += a, buf += a*w
+
+      template<class T>
+      inline void blend_rows_c(const T *a, const T *b, float wa, float wb, float *buf, int n){
+        for(int x=0;x<n;++x) buf[x] = wa*a[x] + wb*b[x];
+      }
+
+      template<class T>
+      inline void set_row_c(const T *a, float w, float *buf, int n){
+        for(int x=0;x<n;++x) buf[x] = a[x]*w;
+      }
+
+      template<class T>
+      inline void add_row_c(const T *a, float *buf, int n){
+        for(int x=0;x<n;++x) buf[x] += a[x];
+      }
+
+      template<class T>
+      inline void add_row_c(const T *a, float w, float *buf, int n){
+        for(int x=0;x<n;++x) buf[x] += a[x]*w;
+      }
+
+      template<class T>
+      inline void blend_rows(const T *a, const T *b, float wa, float wb, float *buf, int n){
+        blend_rows_c(a,b,wa,wb,buf,n);
+      }
+
+      template<class T>
+      inline void set_row(const T *a, float w, float *buf, int n){
+        set_row_c(a,w,buf,n);
+      }
+
+      template<class T>
+      inline void add_row(const T *a, float *buf, int n){
+        add_row_c(a,buf,n);
+      }
+
+      template<class T>
+      inline void add_row(const T *a, float w, float *buf, int n){
+        add_row_c(a,w,buf,n);
+      }
+
+#ifdef ICL_HAVE_SSE2
+      /// loads 4 pixels as floats
+      inline __m128 load4(const icl32f *p){ return _mm_loadu_ps(p); }
+      inline __m128 load4(const icl8u *p){
+        const __m128i z = _mm_setzero_si128();
+        const __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*reinterpret_cast<const int*>(p)),z);
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v,z));
+      }
+
+      template<class T>
+      inline void blend_rows_sse(const T *a, const T *b, float wa, float wb, float *buf, int n){
+        const __m128 va = _mm_set1_ps(wa), vb = _mm_set1_ps(wb);
+        int x = 0;
+        for(;x<=n-4;x+=4){
+          _mm_storeu_ps(buf+x,_mm_add_ps(_mm_mul_ps(va,load4(a+x)),_mm_mul_ps(vb,load4(b+x))));
+        }
+        blend_rows_c(a+x,b+x,wa,wb,buf+x,n-x);
+      }
+
+      template<class T>
+      inline void set_row_sse(const T *a, float w, float *buf, int n){
+        const __m128 vw = _mm_set1_ps(w);
+        int x = 0;
+        for(;x<=n-4;x+=4) _mm_storeu_ps(buf+x,_mm_mul_ps(load4(a+x),vw));
+        set_row_c(a+x,w,buf+x,n-x);
+      }
+
+      template<class T>
+      inline void add_row_sse(const T *a, float *buf, int n){
+        int x = 0;
+        for(;x<=n-4;x+=4) _mm_storeu_ps(buf+x,_mm_add_ps(_mm_loadu_ps(buf+x),load4(a+x)));
+        add_row_c(a+x,buf+x,n-x);
+      }
+
+      template<class T>
+      inline void add_row_sse(const T *a, float w, float *buf, int n){
+        const __m128 vw = _mm_set1_ps(w);
+        int x = 0;
+        for(;x<=n-4;x+=4) _mm_storeu_ps(buf+x,_mm_add_ps(_mm_loadu_ps(buf+x),_mm_mul_ps(load4(a+x),vw)));
+        add_row_c(a+x,w,buf+x,n-x);
+      }
+
+#define ICL_SCALE_SSE_SPECIALIZATION(T)                                              \
+      template<> inline void blend_rows(const T *a, const T *b, float wa, float wb, float *buf, int n){ \
+        blend_rows_sse<T>(a,b,wa,wb,buf,n);                                           \
+      }                                                                               \
+      template<> inline void set_row(const T *a, float w, float *buf, int n){         \
+        set_row_sse<T>(a,w,buf,n);                                                    \
+      }                                                                               \
+      template<> inline void add_row(const T *a, float *buf, int n){                  \
+        add_row_sse<T>(a,buf,n);                                                      \
+      }                                                                               \
+      template<> inline void add_row(const T *a, float w, float *buf, int n){         \
+        add_row_sse<T>(a,w,buf,n);                                                    \
+      }
+      ICL_SCALE_SSE_SPECIALIZATION(icl8u)
+      ICL_SCALE_SSE_SPECIALIZATION(icl32f)
+#undef ICL_SCALE_SSE_SPECIALIZATION
+#endif
+
+      /// fixed point vertical pass for icl8u: buf = a*(256-w) + b*w (at most 255*256)
+      inline void blend_rows_8u(const icl8u *a, const icl8u *b, int w, icl16u *buf, int n){
+        int x = 0;
+#ifdef ICL_HAVE_SSE2
+        const __m128i z = _mm_setzero_si128();
+        const __m128i w0 = _mm_set1_epi16(256-w), w1 = _mm_set1_epi16(w);
+        for(;x<=n-16;x+=16){
+          const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a+x));
+          const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b+x));
+          __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va,z),w0),
+                                     _mm_mullo_epi16(_mm_unpacklo_epi8(vb,z),w1));
+          __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va,z),w0),
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(vb,z),w1));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(buf+x),lo);
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(buf+x+8),hi);
+        }
+#endif
+        for(;x<n;++x) buf[x] = (icl16u)(a[x]*(256-w) + b[x]*w);
+      }
+
+      // }}}
+
+      /// converts the rows [yStart,yEnd) of the destination ROI
+      template<class T>
+      struct ScaleRows{
+        const T *src;
+        int srcWidth;
+        T *dst;
+        int dstWidth;
+        const ScaleTables &t;
+
+        ScaleRows(const T *src, int srcWidth, T *dst, int dstWidth, const ScaleTables &t):
+          src(src),srcWidth(srcWidth),dst(dst),dstWidth(dstWidth),t(t){}
+
+        inline T *dst_row(int y) const{
+          return dst + (t.dstROI.y+y)*dstWidth + t.dstROI.x;
+        }
+
+        void nn(int yStart, int yEnd) const{
+          const int w = t.dstROI.width;
+          const int *xb = t.xb.data();
+          for(int y=yStart;y<yEnd;++y){
+            const T *s = src + t.yb[y]*srcWidth;
+            T *d = dst_row(y);
+            for(int x=0;x<w;++x) d[x] = s[xb[x]];
+          }
+        }
+
+        void lin(int yStart, int yEnd) const{
+          const int w = t.dstROI.width, sx = t.srcROI.x, sw = t.srcROI.width;
+          const int *xb = t.xb.data();
+          const float *w0 = t.xw0.data(), *w1 = t.xw1.data();
+          float *buf = get_row_buffer<float>(sw);
+          for(int y=yStart;y<yEnd;++y){
+            const T *s = src + t.yb[y]*srcWidth + sx;
+            blend_rows(s,s+srcWidth,t.yw1[y],t.yw0[y],buf,sw);
+            T *d = dst_row(y);
+            for(int x=0;x<w;++x){
+              const float *b = buf+(xb[x]-sx);
+              d[x] = clipped_cast<float,T>(w1[x]*b[0] + w0[x]*b[1]);
+            }
+          }
+        }
+
+        void ra(int yStart, int yEnd) const{
+          const int w = t.dstROI.width, sx = t.srcROI.x, sw = t.srcROI.width;
+          const int *xb = t.xb.data(), *xe = t.xe.data();
+          const float *w0 = t.xw0.data(), *w1 = t.xw1.data();
+          float *buf = get_row_buffer<float>(sw);
+          for(int y=yStart;y<yEnd;++y){
+            const T *s = src + sx;
+            set_row(s+t.yb[y]*srcWidth,t.yw0[y],buf,sw);
+            for(int r=t.yb[y]+1;r<t.ye[y];++r) add_row(s+r*srcWidth,buf,sw);
+            add_row(s+t.ye[y]*srcWidth,t.yw1[y],buf,sw);
+            T *d = dst_row(y);
+            for(int x=0;x<w;++x){
+              const int b = xb[x]-sx, e = xe[x]-sx;
+              float sum = buf[b]*w0[x];
+              for(int i=b+1;i<e;++i) sum += buf[i];
+              sum += buf[e]*w1[x];
+              d[x] = clipped_cast<float,T>(sum*t.ratio+0.5f);
+            }
+          }
+        }
+
+        void operator()(int yStart, int yEnd) const{
+          switch(t.mode){
+            case interpolateLIN: lin(yStart,yEnd); break;
+            case interpolateRA: ra(yStart,yEnd); break;
+            default: nn(yStart,yEnd); break;
+          }
+        }
+      };
+
+      /// fixed point specialization of the linear interpolation for icl8u
+      template<> void ScaleRows<icl8u>::lin(int yStart, int yEnd) const{
+        const int w = t.dstROI.width, sx = t.srcROI.x, sw = t.srcROI.width;
+        const int *xb = t.xb.data();
+        const int *xw = t.xw8.data();
+        icl16u *buf = get_row_buffer<icl16u>(sw);
+        for(int y=yStart;y<yEnd;++y){
+          const icl8u *s = src + t.yb[y]*srcWidth + sx;
+          blend_rows_8u(s,s+srcWidth,t.yw8[y],buf,sw);
+          icl8u *d = dst_row(y);
+          for(int x=0;x<w;++x){
+            const icl16u *b = buf+(xb[x]-sx);
+            d[x] = (icl8u)((b[0]*(256-xw[x]) + b[1]*xw[x]) >> 16);
+          }
+        }
+      }
+    }
+
+    template<class T>
+    void scaled_copy_channel_roi(const T *src, int srcWidth, const Rect &srcROI,
+                                 T *dst, int dstWidth, const Rect &dstROI,
+                                 scalemode mode, int numThreads){
+      if(!dstROI.getDim() || !srcROI.getDim()) return;
+      if(numThreads < 0) numThreads = g_scaledCopyNumThreads;
+
+      static thread_local ScaleTableCache cache;
+      ScaleTableLock lock(cache);
+      const ScaleTables &t = lock.get(mode,srcROI,dstROI);
+      ScaleRows<T> rows(src,srcWidth,dst,dstWidth,t);
+
+      static const int MIN_PIXELS_PER_STRIPE = 16384;
+      parallel_for_rows(dstROI.getSize(),rows,MIN_PIXELS_PER_STRIPE,numThreads);
+    }
+
+    void scaled_copy_set_num_threads(int numThreads){
+      g_scaledCopyNumThreads = numThreads < 0 ? 1 : numThreads;
+    }
+
+    int scaled_copy_get_num_threads(){
+      return g_scaledCopyNumThreads;
+    }
+
+#define ICL_INSTANTIATE_DEPTH(D)                                                            \
+    template ICLCore_API void scaled_copy_channel_roi<icl##D>(const icl##D*,int,const Rect&, \
+                                                              icl##D*,int,const Rect&,scalemode,int);
+    ICL_INSTANTIATE_ALL_DEPTHS
+#undef ICL_INSTANTIATE_DEPTH
+
+  } // namespace core
+}
@@ -0,0 +1,85 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLCore/src/ICLCore/ScaledCopy.h                       **
+** Module : ICLCore                                                **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#pragma once
+
+#include <ICLUtils/CompatMacros.h>
+#include <ICLUtils/Rect.h>
+#include <ICLCore/Types.h>
+
+namespace icl{
+  namespace core{
+
+    /// Scales a channel ROI into another channel ROI (C++ and SSE2 implementation) \ingroup IMAGE
+    /** This function implements scaledCopyChannelROI, if IPP is not available. The
+        interpolation coefficients (source indices and weights for each destination
+        column and row) are computed once and cached for the last used geometry,
+        so that scaling a sequence of equally sized images (e.g. the frames of
+        a grabber) does not allocate memory and does not compute them again.
+
+        All modes are implemented as a vertical pass, that combines the source rows
+        needed for a destination row into a floating point buffer (vectorized for
+        icl8u and icl32f), followed by a horizontal pass, that reads the buffer at
+        the precomputed positions.
+        - interpolateNN: direct copy of the source pixels (no float conversion)
+        - interpolateLIN: for icl8u, 8-bit fixed point weights are used (deviations to
+          the floating point implementation are at most 1), all other types produce
+          the same result as before
+        - interpolateRA: the region sums are computed separably, which is O(w+h) per
+          pixel instead of O(w*h)
+
+        The destination rows are distributed to numThreads threads of the
+        utils::ThreadPool (see scaled_copy_set_num_threads). Small images are always
+        processed by the calling thread.
+
+        @param src first pixel of the source channel
+        @param srcWidth width of the source image (line length in pixels)
+        @param srcROI source rectangle
+        @param dst first pixel of the destination channel
+        @param dstWidth width of the destination image (line length in pixels)
+        @param dstROI destination rectangle
+        @param mode interpolation mode
+        @param numThreads number of threads (-1: use the global setting, 0: all threads)
+    */
+    template<class T> ICLCore_API
+    void scaled_copy_channel_roi(const T *src, int srcWidth, const utils::Rect &srcROI,
+                                 T *dst, int dstWidth, const utils::Rect &dstROI,
+                                 scalemode mode, int numThreads=-1);
+
+    /// sets the default number of threads used by scaled copies
+    /** 1 (default) means that the calling thread does all the work, 0 means all
+        threads of the utils::ThreadPool, other values limit the number of threads */
+    ICLCore_API void scaled_copy_set_num_threads(int numThreads);
+
+    /// returns the default number of threads used by scaled copies
+    ICLCore_API int scaled_copy_get_num_threads();
+
+  } // namespace core
+}
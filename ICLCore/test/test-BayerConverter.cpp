@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include "ICLCore/BayerConverter.h"
+
+#include <cstdlib>
+
+using namespace icl::core;
+using icl::utils::Size;
+using icl::icl8u;
+
+namespace {
+  // bayer image of a constant color, pixel (0,0) has color pattern[0] ('R', 'G' or 'B')
+  Img8u create_uniform_bayer(const Size &size, const std::string &pattern, int r, int g, int b) {
+    Img8u image(size, 1);
+    for (int y = 0; y < size.height; ++y) {
+      for (int x = 0; x < size.width; ++x) {
+        const char c = pattern[2 * (y % 2) + x % 2];
+        image(x, y, 0) = c == 'R' ? r : c == 'G' ? g : b;
+      }
+    }
+    return image;
+  }
+}
+
+TEST(BayerConverterTest, UniformColorIsReconstructed) {
+  const char *patterns[] = { "RGGB", "GBRG", "GRBG", "BGGR" };
+  const char *methods[] = { "nearestNeighbor", "simple", "bilinear", "hqLinear", "edgeSense" };
+  const Size size(37, 22);
+  for (int p = 0; p < 4; ++p) {
+    const Img8u src = create_uniform_bayer(size, patterns[p], 200, 100, 50);
+    for (int m = 0; m < 5; ++m) {
+      BayerConverter bc(patterns[p], methods[m]);
+      ImgBase *rgb = 0, *gray = 0;
+      bc.apply(&src, &rgb);
+      bc.applyGray(&src, &gray);
+      ASSERT_EQ(3, rgb->getChannels());
+      ASSERT_EQ(1, gray->getChannels());
+      for (int y = 3; y < size.height - 3; ++y) {
+        for (int x = 3; x < size.width - 3; ++x) {
+          ASSERT_EQ(200, (*rgb->as8u())(x, y, 0)) << patterns[p] << " " << methods[m];
+          ASSERT_EQ(100, (*rgb->as8u())(x, y, 1)) << patterns[p] << " " << methods[m];
+          ASSERT_EQ(50, (*rgb->as8u())(x, y, 2)) << patterns[p] << " " << methods[m];
+          ASSERT_EQ(116, (*gray->as8u())(x, y, 0)) << patterns[p] << " " << methods[m];
+        }
+      }
+      delete rgb;
+      delete gray;
+    }
+    BayerConverter bc(patterns[p]);
+    ImgBase *half = 0;
+    bc.applyHalfSize(&src, &half);
+    ASSERT_EQ(Size(18, 11), half->getSize());
+    for (int c = 0; c < 3; ++c) {
+      const icl8u expected = c == 0 ? 200 : c == 1 ? 100 : 50;
+      for (const icl8u *d = half->as8u()->begin(c); d != half->as8u()->end(c); ++d) {
+        ASSERT_EQ(expected, *d);
+      }
+    }
+    delete half;
+  }
+}
+
+TEST(BayerConverterTest, ParallelConversionEqualsSequential) {
+  Img8u src(Size(321, 240), 1);
+  std::srand(7);
+  for (icl8u *p = src.begin(0); p != src.end(0); ++p) *p = std::rand() & 255;
+  const char *methods[] = { "nearestNeighbor", "simple", "bilinear", "hqLinear", "edgeSense" };
+  for (int m = 0; m < 5; ++m) {
+    BayerConverter bc("GRBG", methods[m]);
+    ImgBase *seq = 0, *par = 0;
+    bc.apply(&src, &seq);
+    bc.setNumThreads(0);
+    bc.apply(&src, &par);
+    for (int c = 0; c < 3; ++c) {
+      ASSERT_TRUE(std::equal(seq->as8u()->begin(c), seq->as8u()->end(c), par->as8u()->begin(c))) << methods[m];
+    }
+    delete seq;
+    delete par;
+  }
+}
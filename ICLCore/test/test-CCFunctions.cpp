@@ -0,0 +1,265 @@
+#include "gtest/gtest.h"
+
+#include <ICLCore/CCFunctions.h>
+#include <ICLCore/CCLUT.h>
+#include <ICLCore/Img.h>
+#include <ICLUtils/ThreadPool.h>
+#include <cmath>
+#include <cstdlib>
+
+using namespace icl;
+using namespace icl::utils;
+using namespace icl::core;
+
+namespace {
+  void reference(format dstFmt, float r, float g, float b, float *d) {
+    switch (dstFmt) {
+      case formatGray:
+        d[0] = (r + g + b) / 3;
+        break;
+      case formatYUV:
+        d[0] = 0.299f * r + 0.587f * g + 0.114f * b;
+        d[1] = std::min(std::max(0.492f * (b - d[0]) + 128, 0.0f), 255.0f);
+        d[2] = std::min(std::max(0.877f * (r - d[0]) + 128, 0.0f), 255.0f);
+        break;
+      case formatHLS:
+        cc_util_rgb_to_hls(r, g, b, d[0], d[1], d[2]);
+        break;
+      case formatLAB:
+        cc_util_rgb_to_lab(r, g, b, d[0], d[1], d[2]);
+        break;
+      default:
+        FAIL();
+    }
+  }
+
+  template<class T>
+  void expect_cc(format dstFmt, float tolerance) {
+    Img<T> src(Size(37, 23), formatRGB);
+    for (int c = 0; c < 3; ++c) {
+      for (int i = 0; i < src.getDim(); ++i) src[c][i] = (T)((i * (7 + 4 * c) + 31 * c) % 256);
+    }
+    // gray pixels
+    for (int c = 0; c < 3; ++c) src[c][5] = src[c][6] = 0;
+    for (int c = 0; c < 3; ++c) src[c][7] = 200;
+
+    Img<T> dst(Size(37, 23), dstFmt);
+    cc(&src, &dst);
+
+    src.setROI(Rect(3, 2, 29, 17));
+    Img<T> dstROI(Size(40, 30), dstFmt);
+    dstROI.setROI(Rect(7, 9, 29, 17));
+    cc(&src, &dstROI, true);
+
+    for (int y = 0; y < src.getHeight(); ++y) {
+      for (int x = 0; x < src.getWidth(); ++x) {
+        float d[3];
+        reference(dstFmt, src(x, y, 0), src(x, y, 1), src(x, y, 2), d);
+        for (int c = 0; c < dst.getChannels(); ++c) {
+          float diff = std::abs(d[c] - (float)dst(x, y, c));
+          if (dstFmt == formatHLS && c == 0) diff = std::min(diff, 255 - diff);
+          ASSERT_LE(diff, tolerance) << "x:" << x << " y:" << y << " c:" << c;
+          if (src.getROI().contains(x, y)) {
+            ASSERT_EQ(dst(x, y, c), dstROI(x + 4, y + 7, c));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(CCFunctionsTest, VectorizedConversionsMatchReference) {
+  std::string impl;
+  EXPECT_TRUE(cc_get_use_simd());
+  cc_set_use_simd(false);
+  cc_available(formatRGB, formatLAB, impl);
+  EXPECT_EQ("c++", impl);
+
+  cc_set_use_simd(true);
+  EXPECT_EQ(ccAvailable, cc_available(formatRGB, formatLAB, impl));
+  EXPECT_FALSE(impl.empty());
+  cc_available(formatHLS, formatLAB, impl);
+  EXPECT_EQ("c++", impl);
+
+  const format fmts[] = { formatGray, formatYUV, formatHLS, formatLAB };
+  for (int i = 0; i < 4; ++i) {
+    expect_cc<icl8u>(fmts[i], 1);
+    expect_cc<icl32f>(fmts[i], 0.05f);
+  }
+}
+
+namespace {
+  template<class T>
+  void expect_same_as_default(format srcFmt, format dstFmt, bool roiOnly) {
+    // without tails, the vectorized functions reproduce the default implementation
+    Img<T> src(Size(64, 24), srcFmt);
+    for (int c = 0; c < src.getChannels(); ++c) {
+      for (int i = 0; i < src.getDim(); ++i) src[c][i] = (T)((i * (11 + 6 * c) + 29 * c) % 256);
+    }
+    Img<T> a(src.getSize(), dstFmt), b(src.getSize(), dstFmt);
+    if (roiOnly) {
+      src.setROI(Rect(16, 1, 32, 20));
+      a.setROI(src.getROI());
+      b.setROI(src.getROI());
+    }
+    cc_set_use_simd(false);
+    cc(&src, &a, roiOnly);
+    cc_set_use_simd(true);
+    cc(&src, &b, roiOnly);
+    for (int c = 0; c < a.getChannels(); ++c) {
+      for (int i = 0; i < a.getDim(); ++i) ASSERT_EQ(a[c][i], b[c][i]) << "c:" << c << " i:" << i;
+    }
+  }
+
+  template<class T>
+  void expect_near_default(format dstFmt, bool roiOnly, float tolerance) {
+    Img<T> src(Size(257, 131), formatRGB);
+    srand(3);
+    for (int c = 0; c < 3; ++c) {
+      for (int i = 0; i < src.getDim(); ++i) src[c][i] = (T)(rand() % 256);
+    }
+    Img<T> a(src.getSize(), dstFmt), b(src.getSize(), dstFmt);
+    if (roiOnly) {
+      src.setROI(Rect(3, 5, 250, 120));
+      a.setROI(src.getROI());
+      b.setROI(src.getROI());
+    }
+    cc_set_use_simd(false);
+    cc(&src, &a, roiOnly);
+    cc_set_use_simd(true);
+    cc(&src, &b, roiOnly);
+    for (int c = 0; c < a.getChannels(); ++c) {
+      for (int i = 0; i < a.getDim(); ++i) {
+        float diff = std::abs((float)a[c][i] - (float)b[c][i]);
+        if (dstFmt == formatHLS && c == 0) diff = std::min(diff, 255 - diff);
+        ASSERT_LE(diff, tolerance) << "c:" << c << " i:" << i;
+      }
+    }
+  }
+}
+
+TEST(CCFunctionsTest, VectorizedConversionsStayWithinTolerance) {
+  // the tolerances documented for cc_set_use_simd
+  const format fmts[] = { formatGray, formatYUV, formatHLS, formatLAB };
+  for (int i = 0; i < 4; ++i) {
+    for (int roi = 0; roi < 2; ++roi) {
+      expect_near_default<icl8u>(fmts[i], roi, 1);
+      expect_near_default<icl32f>(fmts[i], roi, 0.5f + 1e-3f);
+    }
+  }
+}
+
+TEST(CCFunctionsTest, VectorizedConversionsAreBitExact) {
+  const format src[] = { formatRGB, formatRGB, formatYUV };
+  const format dst[] = { formatGray, formatYUV, formatRGB };
+  for (int i = 0; i < 3; ++i) {
+    for (int roi = 0; roi < 2; ++roi) {
+      expect_same_as_default<icl8u>(src[i], dst[i], roi);
+      expect_same_as_default<icl32f>(src[i], dst[i], roi);
+    }
+  }
+}
+
+TEST(CCFunctionsTest, YUVRoundTrip) {
+  Img32f src(Size(19, 7), formatRGB);
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) src[c][i] = (float)((i * (5 + 3 * c) + 17 * c) % 256);
+  }
+  Img32f yuv(src.getSize(), formatYUV), rgb(src.getSize(), formatRGB);
+  cc(&src, &yuv);
+  cc(&yuv, &rgb);
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) {
+      float y = yuv[0][i], u = yuv[1][i] - 128, v = yuv[2][i] - 128;
+      float e[3] = { y + 1.140f * v, y - 0.394f * u - 0.581f * v, y + 2.032f * u };
+      ASSERT_NEAR(std::min(std::max(e[c], 0.0f), 255.0f), rgb[c][i], 0.01f);
+    }
+  }
+}
+
+namespace {
+  template<class T>
+  void expect_parallel_cc(format srcFmt, format dstFmt, bool roiOnly) {
+    Img<T> src(Size(411, 307), srcFmt);
+    for (int c = 0; c < src.getChannels(); ++c) {
+      for (int i = 0; i < src.getDim(); ++i) src[c][i] = (T)((i * (13 + 2 * c) + 7 * c) % 256);
+    }
+    Img<T> a(src.getSize(), dstFmt), b(src.getSize(), dstFmt);
+    if (roiOnly) {
+      src.setROI(Rect(5, 9, 400, 290));
+      a.setROI(Rect(1, 2, 400, 290));
+      b.setROI(Rect(1, 2, 400, 290));
+    }
+    cc(&src, &a, roiOnly, 1);
+    cc(&src, &b, roiOnly, 0);
+    for (int c = 0; c < a.getChannels(); ++c) {
+      for (int i = 0; i < a.getDim(); ++i) ASSERT_EQ(a[c][i], b[c][i]);
+    }
+  }
+}
+
+TEST(CCFunctionsTest, ParallelConversionEqualsSequential) {
+  EXPECT_EQ(1, cc_get_num_threads());
+  // ensure that there are workers, even on single core machines
+  if (ThreadPool::instance().getNumThreads() < 3) ThreadPool::instance().setNumThreads(3);
+  for (int roi = 0; roi < 2; ++roi) {
+    expect_parallel_cc<icl8u>(formatRGB, formatLAB, roi);
+    expect_parallel_cc<icl32f>(formatRGB, formatHLS, roi);
+    expect_parallel_cc<icl32f>(formatYUV, formatLAB, roi);
+  }
+  cc_set_use_simd(false);
+
+  // generic c++ conversions are split into stripes of rows
+  for (int roi = 0; roi < 2; ++roi) {
+    expect_parallel_cc<icl8u>(formatRGB, formatLAB, roi);
+    expect_parallel_cc<icl32f>(formatRGB, formatHLS, roi);
+    expect_parallel_cc<icl16s>(formatHLS, formatRGB, roi);
+  }
+  cc_set_use_simd(true);
+
+  createLUT(formatRGB, formatGray);
+  createLUT(formatGray, formatYUV);
+  for (int roi = 0; roi < 2; ++roi) {
+    expect_parallel_cc<icl8u>(formatRGB, formatGray, roi);
+    expect_parallel_cc<icl8u>(formatGray, formatYUV, roi);
+  }
+
+  // lookup table results equal the direct conversion
+  Img8u src(Size(64, 64), formatGray), viaLUT(Size(64, 64), formatYUV), direct(Size(64, 64), formatYUV);
+  for (int i = 0; i < src.getDim(); ++i) src[0][i] = (icl8u)(i % 256);
+  cc(&src, &viaLUT);
+  releaseAllLUTs();
+  cc(&src, &direct);
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) ASSERT_EQ(direct[c][i], viaLUT[c][i]);
+  }
+}
+
+TEST(CCFunctionsTest, ParallelLUTEqualsSequential) {
+  CCLUT lut(formatRGB, formatGray);
+  Img8u src(Size(411, 307), formatRGB);
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) src[c][i] = (icl8u)((i * (5 + 3 * c) + 11 * c) % 256);
+  }
+  Img8u direct(src.getSize(), formatGray);
+  cc(&src, &direct);
+
+  src.setROI(Rect(5, 9, 400, 290));
+  Img8u a(Size(420, 310), formatGray), b(Size(420, 310), formatGray);
+  a.clear(-1, 7);
+  b.clear(-1, 7);
+  a.setROI(Rect(11, 3, 400, 290));
+  b.setROI(Rect(11, 3, 400, 290));
+  lut.cc(&src, &a, true, 1);
+  lut.cc(&src, &b, true, 0);
+  for (int y = 0; y < a.getHeight(); ++y) {
+    for (int x = 0; x < a.getWidth(); ++x) {
+      ASSERT_EQ(a(x, y, 0), b(x, y, 0)) << "x:" << x << " y:" << y;
+      if (a.getROI().contains(x, y)) {
+        ASSERT_EQ(direct(x - 6, y + 6, 0), a(x, y, 0)) << "x:" << x << " y:" << y;
+      } else {
+        ASSERT_EQ(7, a(x, y, 0)) << "x:" << x << " y:" << y;
+      }
+    }
+  }
+}
@@ -1,2 +1,137 @@
 #include "gtest/gtest.h"
 
+#include "ICLCore/Img.h"
+#include "ICLCore/ScaledCopy.h"
+
+using namespace icl::core;
+using icl::utils::Size;
+using icl::icl8u;
+using icl::icl16s;
+using icl::icl32f;
+
+TEST(ImgTest, PooledChannelsAreReused) {
+  ChannelAllocator::clear();
+  ChannelAllocator::resetStatistics();
+  for (int i = 0; i < 3; ++i) {
+    Img32f image;
+    image.setChannelAllocation(ChannelAllocator::Pooled);
+    image.setSize(Size(641, 480));
+    image.setChannels(3);
+    for (int c = 0; c < 3; ++c) {
+      ASSERT_EQ(0u, reinterpret_cast<size_t>(image.begin(c)) % 64);
+      for (int j = 0; j < image.getDim(); ++j) ASSERT_EQ(0.f, image[c][j]);
+    }
+    image.fill(1.f);
+  }
+  ChannelAllocator::Statistics s = ChannelAllocator::getStatistics();
+  EXPECT_EQ(9u, s.requests);
+  EXPECT_EQ(6u, s.hits);
+  EXPECT_EQ(6u * 641 * 480 * sizeof(float), s.bytesReused);
+  EXPECT_EQ(0u, s.bytesInUse);
+  ChannelAllocator::clear();
+  EXPECT_EQ(0u, ChannelAllocator::getStatistics().bytesPooled);
+}
+
+TEST(ImgTest, ForeignChannelsAreNotPooled) {
+  ChannelAllocator::setEnabled(true);
+  ChannelAllocator::resetStatistics();
+  {
+    std::vector<icl8u*> data(1, new icl8u[100]);
+    Img8u image(Size(10, 10), 1, data, true);
+    Img8u copy = image;
+    copy.detach();
+  }
+  ChannelAllocator::setEnabled(false);
+  EXPECT_EQ(1u, ChannelAllocator::getStatistics().requests);
+  EXPECT_EQ(0u, ChannelAllocator::getStatistics().bytesInUse);
+  ChannelAllocator::clear();
+}
+
+TEST(ImgTest, UnpooledChannelsBypassThePool) {
+  ChannelAllocator::resetStatistics();
+  {
+    Img8u pooled, unpooled(Size(33, 17), 2);
+    pooled.setChannelAllocation(ChannelAllocator::Pooled);
+    pooled.setParams(unpooled.getParams());
+    ASSERT_EQ(0u, reinterpret_cast<size_t>(unpooled.begin(1)) % 64);
+    EXPECT_EQ(2u, ChannelAllocator::getStatistics().requests);
+    EXPECT_GT(ChannelAllocator::getStatistics().bytesInUse, 0u);
+  }
+  EXPECT_EQ(2u, ChannelAllocator::getStatistics().requests);
+  EXPECT_EQ(0u, ChannelAllocator::getStatistics().bytesInUse);
+  ChannelAllocator::clear();
+}
+
+namespace {
+  // per pixel reference implementation of the scaling modes
+  template<class T>
+  float reference_scale(const Img<T> &src, const icl::utils::Rect &r, const Size &dstSize,
+                        scalemode mode, int x, int y) {
+    const Channel<T> c = src[0];
+    if (mode == interpolateNN) {
+      const float fx = float(r.width) / dstSize.width, fy = float(r.height) / dstSize.height;
+      return c((int)(r.x + fx * x), (int)(r.y + fy * y));
+    } else if (mode == interpolateLIN) {
+      const float fx = (float(r.width) - 1) / dstSize.width, fy = (float(r.height) - 1) / dstSize.height;
+      const float xs = r.x + fx * x, ys = r.y + fy * y;
+      const float ax = xs - floor(xs), ay = ys - floor(ys);
+      const int xi = (int)xs, yi = (int)ys;
+      return (1 - ax) * ((1 - ay) * c(xi, yi) + ay * c(xi, yi + 1)) +
+             ax * ((1 - ay) * c(xi + 1, yi) + ay * c(xi + 1, yi + 1));
+    }
+    const float fx = float(r.width) / dstSize.width, fy = float(r.height) / dstSize.height;
+    const float bx = r.x + x * fx, by = r.y + y * fy;
+    const int xb = (int)bx, yb = (int)by;
+    const int xe = (int)ceilf(bx + fx - 1), ye = (int)ceilf(by + fy - 1);
+    float sum = 0;
+    for (int j = yb; j <= ye; ++j) {
+      const float wy = (j == yb ? 1 - (by - yb) : 0) + (j == ye ? 1 - (ye - (by + fy - 1)) : 0) +
+                       (j != yb && j != ye ? 1 : 0);
+      for (int i = xb; i <= xe; ++i) {
+        const float wx = (i == xb ? 1 - (bx - xb) : 0) + (i == xe ? 1 - (xe - (bx + fx - 1)) : 0) +
+                         (i != xb && i != xe ? 1 : 0);
+        sum += wx * wy * c(i, j);
+      }
+    }
+    return sum / (fx * fy) + 0.5f;
+  }
+
+  template<class T>
+  void expect_scaled_copy(const Size &srcSize, const icl::utils::Rect &roi, const Size &dstSize,
+                          scalemode mode, float tolerance) {
+    Img<T> src(srcSize, 1);
+    for (int i = 0; i < src.getDim(); ++i) src[0][i] = (T)((i * 7 + (i / srcSize.width) * 13) % 251);
+    src.setROI(roi);
+    Img<T> dst(dstSize, 1), dstMT(dstSize, 1);
+    src.scaledCopyROI(&dst, mode);
+
+    scaled_copy_set_num_threads(0);
+    src.scaledCopyROI(&dstMT, mode);
+    scaled_copy_set_num_threads(1);
+
+    for (int y = 0; y < dstSize.height; ++y) {
+      for (int x = 0; x < dstSize.width; ++x) {
+        const float ref = icl::utils::clipped_cast<float, T>(reference_scale(src, roi, dstSize, mode, x, y));
+        ASSERT_NEAR(ref, (float)dst(x, y, 0), tolerance) << "mode " << mode << " at " << x << "," << y;
+        ASSERT_EQ(dst(x, y, 0), dstMT(x, y, 0));
+      }
+    }
+  }
+}
+
+TEST(ImgTest, ScaledCopyMatchesReference) {
+  const icl::utils::Rect full(0, 0, 320, 240), roi(13, 7, 250, 201);
+  const Size sizes[] = { Size(160, 120), Size(641, 479), Size(97, 211) };
+  for (int i = 0; i < 3; ++i) {
+    for (int r = 0; r < 2; ++r) {
+      const icl::utils::Rect &rect = r ? roi : full;
+      expect_scaled_copy<icl8u>(Size(320, 240), rect, sizes[i], interpolateNN, 0);
+      expect_scaled_copy<icl32f>(Size(320, 240), rect, sizes[i], interpolateNN, 0);
+      expect_scaled_copy<icl8u>(Size(320, 240), rect, sizes[i], interpolateLIN, 1);
+      expect_scaled_copy<icl32f>(Size(320, 240), rect, sizes[i], interpolateLIN, 1e-3);
+      expect_scaled_copy<icl16s>(Size(320, 240), rect, sizes[i], interpolateLIN, 0);
+      expect_scaled_copy<icl8u>(Size(320, 240), rect, sizes[i], interpolateRA, 1);
+      expect_scaled_copy<icl32f>(Size(320, 240), rect, sizes[i], interpolateRA, 0.05);
+    }
+  }
+}
@@ -31,11 +31,17 @@
 #include <ICLFilter/BilateralFilterOp.h>
 
 #include <fstream>
+#include <cmath>
+#include <algorithm>
 
 #include <ICLCore/CCFunctions.h>
 
 #include <ICLMath/FixedVector.h>
 
+#include <ICLUtils/ThreadPool.h>
+#include <ICLUtils/ClippedCast.h>
+#include <ICLUtils/SSETypes.h>
+
 #include <ICLUtils/CLIncludes.h>
 #include <ICLUtils/CLProgram.h>
 #include <ICLUtils/CLImage2D.h>
@@ -54,7 +60,8 @@ struct BilateralFilterOp::Impl {
 
 	Impl(BilateralFilterOp::Method method) : _method(method) {}
 	virtual ~Impl() {}
-	virtual void applyGauss(const core::ImgBase *in, core::ImgBase **out, int radius, float sigma_s, float sigma_r, bool _use_lab) = 0;
+	virtual void applyGauss(const core::ImgBase *in, core::ImgBase **out, int radius, float sigma_s, float sigma_r, bool _use_lab,
+							bool approximate, int num_threads) = 0;
 	virtual void applyKuwahara(const core::ImgBase *in, core::ImgBase **out, int radius) = 0;
 
 	BilateralFilterOp::Method _method;
@@ -223,7 +230,8 @@ public:
 		}
 	}
 
-	void applyGauss(const core::ImgBase *in, core::ImgBase **out, int radius, float sigma_s, float sigma_r, bool _use_lab) {
+	void applyGauss(const core::ImgBase *in, core::ImgBase **out, int radius, float sigma_s, float sigma_r, bool _use_lab,
+					bool /*approximate*/, int /*num_threads*/) {
 
 		int w = in->getWidth();//in->getROIWidth();//in->getWidth();
 		int h = in->getHeight();//in->getROIHeight();//in->getHeight();
@@ -479,56 +487,325 @@ protected:
 
 // /////////////////////////////////////////////////////////////////////////////////////////////////
 
-struct BilateralFilterOp::CPUImpl : public BilateralFilterOp::Impl {
-public:
-	CPUImpl(BilateralFilterOp::Method method)
-		: BilateralFilterOp::Impl(method) {}
-	~CPUImpl() {}
-
-	template<typename TYPE, int n_ch>
-	void filter(core::Img<TYPE> const &in, core::Img<TYPE> &out, int radius, float sigma_s, float sigma_r) {
+namespace {
+
+	/// minimum number of pixels per stripe of rows (see utils::parallel_for_rows)
+	static const int MIN_PIXELS_PER_STRIPE = 4096;
+
+#ifdef ICL_HAVE_SSE2
+	/// exp for 4 floats (Cephes polynomial, relative error < 2e-7 for x in [-87,0])
+	inline __m128 exp_ps(__m128 x) {
+		x = _mm_max_ps(x,_mm_set1_ps(-87.f));
+		__m128 fx = _mm_add_ps(_mm_mul_ps(x,_mm_set1_ps(1.44269504088896341f)),_mm_set1_ps(0.5f));
+		__m128i n = _mm_cvttps_epi32(fx);
+		__m128 t = _mm_cvtepi32_ps(n);
+		// floor for negative values
+		n = _mm_sub_epi32(n,_mm_castps_si128(_mm_and_ps(_mm_cmpgt_ps(t,fx),_mm_castsi128_ps(_mm_set1_epi32(1)))));
+		fx = _mm_cvtepi32_ps(n);
+		x = _mm_sub_ps(x,_mm_mul_ps(fx,_mm_set1_ps(0.693359375f)));
+		x = _mm_sub_ps(x,_mm_mul_ps(fx,_mm_set1_ps(-2.12194440e-4f)));
+		__m128 y = _mm_set1_ps(1.9875691500e-4f);
+		y = _mm_add_ps(_mm_mul_ps(y,x),_mm_set1_ps(1.3981999507e-3f));
+		y = _mm_add_ps(_mm_mul_ps(y,x),_mm_set1_ps(8.3334519073e-3f));
+		y = _mm_add_ps(_mm_mul_ps(y,x),_mm_set1_ps(4.1665795894e-2f));
+		y = _mm_add_ps(_mm_mul_ps(y,x),_mm_set1_ps(1.6666665459e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y,x),_mm_set1_ps(5.0000001201e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y,_mm_mul_ps(x,x)),_mm_add_ps(x,_mm_set1_ps(1.f)));
+		const __m128i e = _mm_slli_epi32(_mm_add_epi32(n,_mm_set1_epi32(127)),23);
+		return _mm_mul_ps(y,_mm_castsi128_ps(e));
+	}
+#endif
 
-		/*int w = in.getWidth();
-		int h = in.getHeight();
+	/// neighbour of the filter mask with its spatial term (dx*dx+dy*dy)/sigma_s^2
+	struct BilateralTap {
+		int dx, dy;
+		float s;
+		BilateralTap(int dx, int dy, float s) : dx(dx), dy(dy), s(s) {}
+	};
 
-		int channel = in.getChannels();
-		core::Channel<TYPE> _channel[n_ch];
-		for(int i = 0; i < channel; ++i) {
-			_channel[i] = in[i];
+	/// filters the rows of NC float planes with the given taps
+	/** weight = exp(-(spatial term + |center-neighbour|^2/sigma_r^2)), neighbours outside
+		the image are skipped. rx is the maximum horizontal tap offset. */
+	template<int NC>
+	struct BilateralRows {
+		const float *src[NC];
+		float *dst[NC];
+		int w, h, rx;
+		float inv_r2;
+		const std::vector<BilateralTap> *taps;
+
+		void operator()(int yStart, int yEnd) const {
+			for (int y = yStart; y < yEnd; ++y) {
+				int x = 0;
+				for (; x < std::min(rx,w); ++x) pixel(x,y);
+#ifdef ICL_HAVE_SSE2
+				for (; x+4+rx <= w; x += 4) pixels4(x,y);
+#endif
+				for (; x < w; ++x) pixel(x,y);
+			}
 		}
 
-		for(int y = 0; y < h; ++y) {
-			for(int x = 0; x < w; ++x) {
-
-				int tlx = max(x-radius, 0);
-				int tly = max(y-radius, 0);
-				int brx = min(x+radius, w);
-				int bry = min(y+radius, h);
+		void pixel(int x, int y) const {
+			const int o = x+y*w;
+			float c[NC], sum[NC], wp = 0;
+			for (int k = 0; k < NC; ++k) {
+				c[k] = src[k][o];
+				sum[k] = 0;
+			}
+			for (unsigned int i = 0; i < taps->size(); ++i) {
+				const BilateralTap &t = (*taps)[i];
+				const int xx = x+t.dx, yy = y+t.dy;
+				if (xx < 0 || xx >= w || yy < 0 || yy >= h) continue;
+				const int p = xx+yy*w;
+				float n[NC], d = 0;
+				for (int k = 0; k < NC; ++k) {
+					n[k] = src[k][p];
+					d += (c[k]-n[k])*(c[k]-n[k]);
+				}
+				const float weight = std::exp(-(t.s + d*inv_r2));
+				for (int k = 0; k < NC; ++k) sum[k] += weight*n[k];
+				wp += weight;
+			}
+			for (int k = 0; k < NC; ++k) dst[k][o] = sum[k]/wp;
+		}
 
-				float sum = 0.f;
-				float wp = 0.f;
+#ifdef ICL_HAVE_SSE2
+		/// 4 pixels, whose horizontal neighbours are inside the image
+		void pixels4(int x, int y) const {
+			const int o = x+y*w;
+			__m128 c[NC], sum[NC], wp = _mm_setzero_ps();
+			for (int k = 0; k < NC; ++k) {
+				c[k] = _mm_loadu_ps(src[k]+o);
+				sum[k] = _mm_setzero_ps();
+			}
+			const __m128 inv = _mm_set1_ps(-inv_r2);
+			for (unsigned int i = 0; i < taps->size(); ++i) {
+				const BilateralTap &t = (*taps)[i];
+				const int yy = y+t.dy;
+				if (yy < 0 || yy >= h) continue;
+				const int p = o+t.dx+t.dy*w;
+				__m128 n[NC], d = _mm_setzero_ps();
+				for (int k = 0; k < NC; ++k) {
+					n[k] = _mm_loadu_ps(src[k]+p);
+					const __m128 diff = _mm_sub_ps(c[k],n[k]);
+					d = _mm_add_ps(d,_mm_mul_ps(diff,diff));
+				}
+				const __m128 weight = exp_ps(_mm_sub_ps(_mm_mul_ps(d,inv),_mm_set1_ps(t.s)));
+				for (int k = 0; k < NC; ++k) sum[k] = _mm_add_ps(sum[k],_mm_mul_ps(weight,n[k]));
+				wp = _mm_add_ps(wp,weight);
+			}
+			for (int k = 0; k < NC; ++k) _mm_storeu_ps(dst[k]+o,_mm_div_ps(sum[k],wp));
+		}
+#endif
+	};
 
-				icl::math::FixedColVector<n_ch> cur();
+	/// cube root for t > 0 (initial guess from the exponent bits, refined by two Halley iterations)
+	inline float cbrt_halley(float t) {
+		union { float f; unsigned int i; } u;
+		u.f = t;
+		u.i = u.i/3 + 709921077u;
+		float y = u.f;
+		for (int i = 0; i < 2; ++i) {
+			const float y3 = y*y*y;
+			y *= (y3 + 2.f*t)/(2.f*y3 + t);
+		}
+		return y;
+	}
 
-				for(int i=tlx; i< brx; i++) {
-					for(int j=tly; j<bry; j++) {
+	/// rgb (0-255) to the scaled CIE L*a*b* values that are used by the OpenCL kernel
+	/** rgb points to the source ROI (with a line length of rgbStep pixels), the
+		lab planes have a width of w pixels */
+	struct RGBToLabRows {
+		const icl8u *rgb[3];
+		float *lab[3];
+		int w;
+		int rgbStep;
+
+		void operator()(int yStart, int yEnd) const {
+			static const float m[3][3] = { { 0.412453f/255.f, 0.35758f/255.f, 0.180423f/255.f },
+										   { 0.212671f/255.f, 0.71516f/255.f, 0.072169f/255.f },
+										   { 0.019334f/255.f, 0.119193f/255.f, 0.950227f/255.f } };
+			static const float wXYZ[3] = { 0.950455f, 1.0f, 1.088753f };
+			for (int y = yStart; y < yEnd; ++y) {
+				for (int x = 0; x < w; ++x) {
+					const int i = x+y*w, j = x+y*rgbStep;
+					const float r = rgb[0][j], g = rgb[1][j], b = rgb[2][j];
+					float f[3];
+					for (int k = 0; k < 3; ++k) {
+						const float t = (m[k][0]*r + m[k][1]*g + m[k][2]*b)/wXYZ[k];
+						f[k] = t > 0.008856f ? cbrt_halley(t) : 7.787f*t + 16.f/116.f;
+					}
+					// the kernel stores the values in 8u images
+					lab[0][i] = utils::clipped_cast<int,icl8u>(int(116.f*2.55f*f[1] - 16.f*2.55f));
+					lab[1][i] = utils::clipped_cast<int,icl8u>(int(500.f*(f[0]-f[1]) + 128.f));
+					lab[2][i] = utils::clipped_cast<int,icl8u>(int(200.f*(f[1]-f[2]) + 128.f));
+				}
+			}
+		}
+	};
 
-						//float4 d4 = read_imagef(in,sampler,coords2);
-						float d = ;//d4.x;
-						float delta_depth = (src_depth - d) * (src_depth - d);
-						float weight = native_exp( -(delta_dist / s2 + delta_depth / r2) ); //cost
-						sum += weight * d;
-						wp += weight;
+	/// inverse of RGBToLabRows
+	struct LabToRGBRows {
+		const float *lab[3];
+		icl8u *rgb[3];
+		int w;
+		int rgbStep;
+
+		void operator()(int yStart, int yEnd) const {
+			static const float m[3][3] = { {  3.2405f*255.f, -1.5372f*255.f, -0.4985f*255.f },
+										   { -0.9693f*255.f,  1.8760f*255.f,  0.0416f*255.f },
+										   {  0.0556f*255.f, -0.2040f*255.f,  1.0573f*255.f } };
+			static const float wXYZ[3] = { 0.950455f, 1.0f, 1.088753f };
+			for (int y = yStart; y < yEnd; ++y) {
+				for (int x = 0; x < w; ++x) {
+					const int i = x+y*w, j = x+y*rgbStep;
+					const float fy = (lab[0][i] + 16.f*2.55f)/(116.f*2.55f);
+					const float f[3] = { fy + (lab[1][i]-128.f)/500.f, fy, fy - (lab[2][i]-128.f)/200.f };
+					float xyz[3];
+					for (int k = 0; k < 3; ++k) {
+						xyz[k] = wXYZ[k] * (f[k] > 0.206893f ? f[k]*f[k]*f[k] : (f[k]-16.f/116.f)/7.787f);
+					}
+					for (int k = 0; k < 3; ++k) {
+						rgb[k][j] = utils::clipped_cast<float,icl8u>(std::floor(m[k][0]*xyz[0] + m[k][1]*xyz[1] + m[k][2]*xyz[2]));
 					}
 				}
+			}
+		}
+	};
+
+} // anonymous namespace
 
+struct BilateralFilterOp::CPUImpl : public BilateralFilterOp::Impl {
+public:
+	CPUImpl(BilateralFilterOp *op, BilateralFilterOp::Method method)
+		: BilateralFilterOp::Impl(method), op(op) {}
+	~CPUImpl() {}
+
+	/// filters the NC float planes of src into dst
+	/** The exact version uses all (2*radius+1)^2 neighbours. The approximation
+		filters the rows first and then the columns of the intermediate result,
+		which reduces the costs per pixel from O(radius^2) to O(radius). */
+	template<int NC>
+	void filter(core::Img32f &src, core::Img32f &dst, int radius, float sigma_s, float sigma_r,
+				bool approximate, int num_threads) {
+		const utils::Size size = src.getSize();
+		const float inv_s2 = 1.f/(sigma_s*sigma_s);
+
+		BilateralRows<NC> rows;
+		rows.w = size.width;
+		rows.h = size.height;
+		rows.inv_r2 = 1.f/(sigma_r*sigma_r);
+		rows.taps = &taps;
+		taps.clear();
+
+		if (approximate) {
+			buffer.setSize(size);
+			buffer.setChannels(NC);
+
+			for (int d = -radius; d <= radius; ++d) taps.push_back(BilateralTap(d,0,d*d*inv_s2));
+			rows.rx = radius;
+			for (int k = 0; k < NC; ++k) {
+				rows.src[k] = src.begin(k);
+				rows.dst[k] = buffer.begin(k);
 			}
-		}*/
+			utils::parallel_for_rows(size,rows,MIN_PIXELS_PER_STRIPE,num_threads);
 
+			for (int d = -radius; d <= radius; ++d) taps[d+radius] = BilateralTap(0,d,d*d*inv_s2);
+			rows.rx = 0;
+			for (int k = 0; k < NC; ++k) {
+				rows.src[k] = buffer.begin(k);
+				rows.dst[k] = dst.begin(k);
+			}
+			utils::parallel_for_rows(size,rows,MIN_PIXELS_PER_STRIPE,num_threads);
+		} else {
+			for (int dy = -radius; dy <= radius; ++dy) {
+				for (int dx = -radius; dx <= radius; ++dx) {
+					taps.push_back(BilateralTap(dx,dy,(dx*dx+dy*dy)*inv_s2));
+				}
+			}
+			rows.rx = radius;
+			for (int k = 0; k < NC; ++k) {
+				rows.src[k] = src.begin(k);
+				rows.dst[k] = dst.begin(k);
+			}
+			utils::parallel_for_rows(size,rows,MIN_PIXELS_PER_STRIPE,num_threads);
+		}
 	}
 
-	void applyGauss(const core::ImgBase *in, core::ImgBase **out, int radius, float sigma_s, float sigma_r, bool _use_lab) {
-		ERROR_LOG("NOT IMPLEMENTED! PLEASE USE GPU VERSION!")
+	/// filters the ROI of in into the ROI of *out (see UnaryOp::setClipToROI)
+	/** Pixels outside of the source ROI are not used. */
+	void applyGauss(const core::ImgBase *in, core::ImgBase **out, int radius, float sigma_s, float sigma_r, bool _use_lab,
+					bool approximate, int num_threads) {
+		const utils::Size size = in->getROISize();
+		const int channels = in->getChannels();
+		if (!(in->getDepth() == core::depth8u && (channels == 1 || channels == 3))
+			&& !(in->getDepth() == core::depth32f && channels == 1)) {
+			ERROR_LOG("Unsupported image type. Expected 8u images with 1 or 3 channels or 32f images with 1 channel.");
+			return;
+		}
+		if (!op->prepare(out,in)) return;
+
+		src_f.setSize(size);
+		src_f.setChannels(channels);
+		dst_f.setSize(size);
+		dst_f.setChannels(channels);
+
+		if (in->getDepth() == core::depth32f) {
+			// the float image is filtered directly, if it has no ROI
+			const core::Img32f &_in = *in->as32f();
+			core::Img32f &_out = *(*out)->as32f();
+			if (_in.hasFullROI() && _out.hasFullROI()) {
+				core::Img32f src_wrap(size,1,std::vector<float*>(1,const_cast<float*>(_in.begin(0))));
+				core::Img32f dst_wrap(size,1,std::vector<float*>(1,_out.begin(0)));
+				filter<1>(src_wrap,dst_wrap,radius,sigma_s,sigma_r,approximate,num_threads);
+			} else {
+				_in.convertROI(&src_f);
+				filter<1>(src_f,dst_f,radius,sigma_s,sigma_r,approximate,num_threads);
+				dst_f.convertROI(&_out);
+			}
+			return;
+		}
+
+		const core::Img8u &_in = *in->as8u();
+		core::Img8u &_out = *(*out)->as8u();
+		if (channels == 3 && _use_lab) {
+			RGBToLabRows to_lab;
+			to_lab.w = size.width;
+			to_lab.rgbStep = _in.getWidth();
+			for (int k = 0; k < 3; ++k) {
+				to_lab.rgb[k] = _in.getROIData(k);
+				to_lab.lab[k] = src_f.begin(k);
+			}
+			utils::parallel_for_rows(size,to_lab,MIN_PIXELS_PER_STRIPE,num_threads);
+		} else {
+			_in.convertROI(&src_f);
+		}
+
+		if (channels == 3) {
+			filter<3>(src_f,dst_f,radius,sigma_s,sigma_r,approximate,num_threads);
+		} else {
+			filter<1>(src_f,dst_f,radius,sigma_s,sigma_r,approximate,num_threads);
+		}
+
+		if (channels == 3 && _use_lab) {
+			LabToRGBRows to_rgb;
+			to_rgb.w = size.width;
+			to_rgb.rgbStep = _out.getWidth();
+			for (int k = 0; k < 3; ++k) {
+				to_rgb.lab[k] = dst_f.begin(k);
+				to_rgb.rgb[k] = _out.getROIData(k);
+			}
+			utils::parallel_for_rows(size,to_rgb,MIN_PIXELS_PER_STRIPE,num_threads);
+		} else {
+			// truncation, like the OpenCL kernels
+			for (int k = 0; k < channels; ++k) {
+				const float *s = dst_f.begin(k);
+				for (int y = 0; y < size.height; ++y, s += size.width) {
+					icl8u *d = _out.getROIData(k) + y*_out.getWidth();
+					for (int x = 0; x < size.width; ++x) d[x] = utils::clipped_cast<float,icl8u>(s[x]);
+				}
+			}
+		}
 	}
 
 	void applyKuwahara(const core::ImgBase *in, core::ImgBase **out, int radius) {
@@ -536,6 +813,16 @@ public:
 	}
 
 protected:
+	/// the operator (used to prepare the destination image)
+	BilateralFilterOp *op;
+	//@{
+	/// float buffers for 8u images and the separable approximation
+	core::Img32f src_f;
+	core::Img32f dst_f;
+	core::Img32f buffer;
+	//@}
+	/// neighbours of the current filter mask
+	std::vector<BilateralTap> taps;
 };
 
 // /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -543,12 +830,13 @@ protected:
 BilateralFilterOp::BilateralFilterOp(int radius,
 										 float sigma_s, float sigma_r, bool _use_lab, Mode mode, Method method)
 	: filter::UnaryOp(), utils::Uncopyable(), use_lab(_use_lab), radius(radius),
-		sigma_s(sigma_s), sigma_r(sigma_r), _method(method), impl(0) {
+		sigma_s(sigma_s), sigma_r(sigma_r), _method(method), approximate(false), num_threads(1), impl(0) {
 	init(mode, method);
 }
 
 BilateralFilterOp::BilateralFilterOp(Mode mode, Method method)
-	: filter::UnaryOp(), utils::Uncopyable(), use_lab(true), radius(2), sigma_s(1), sigma_r(1), _method(method), impl(0) {
+	: filter::UnaryOp(), utils::Uncopyable(), use_lab(true), radius(2), sigma_s(1), sigma_r(1), _method(method),
+		approximate(false), num_threads(1), impl(0) {
 	init(mode, method);
 }
 
@@ -562,22 +850,31 @@ void BilateralFilterOp::init(Mode mode, Method method) {
 			WARNING_LOG("OpenCL is not available");
 		#endif
 	} else if (mode == CPU) {
-		impl = new CPUImpl(method);
+		impl = new CPUImpl(this, method);
 	} else if (mode == BEST) {
 		#ifdef ICL_HAVE_OPENCL
 			impl = new GPUImpl(method);
 		#else
-			impl = new CPUImpl(method);
+			impl = new CPUImpl(this, method);
 		#endif
 	}
 }
 
 BilateralFilterOp::~BilateralFilterOp() {
+	delete impl;
+}
+
+void BilateralFilterOp::setNumThreads(int numThreads) {
+	num_threads = numThreads < 0 ? 1 : numThreads;
 }
 
 void BilateralFilterOp::apply(const core::ImgBase *in, core::ImgBase **out) noexcept {
+	if (!impl) {
+		ERROR_LOG("No implementation available for the selected mode");
+		return;
+	}
 	if (_method == GAUSS)
-		impl->applyGauss(in,out,radius,sigma_s,sigma_r,use_lab);
+		impl->applyGauss(in,out,radius,sigma_s,sigma_r,use_lab,approximate,num_threads);
 	else if (_method == KUWAHARA)
 		impl->applyKuwahara(in,out,radius);
 	else
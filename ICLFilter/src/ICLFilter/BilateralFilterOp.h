@@ -43,7 +43,18 @@ namespace filter {
  * Implements the gaussian bilateral filtering like described in
  * "A Fast Approximation of the Bilateral Filter using a Signal Processing Approach"
  * (http://people.csail.mit.edu/sparis/publi/2006/tr/Paris_06_Fast_Bilateral_Filter_MIT_TR_low-res.pdf)
- * on the GPU using OpenCL (no CPU-backend at the moment).
+ * on the GPU using OpenCL.
+ *
+ * The CPU backend supports the same image types (8u with 1 or 3 channels,
+ * 32f with 1 channel) and uses the same weights as the OpenCL kernels. It is
+ * vectorized using SSE2 and can process the image rows in several threads
+ * (see setNumThreads). By default, all (2*radius+1)^2 neighbours are used.
+ * If the approximation is enabled (see setApproximate), the rows and columns are
+ * filtered one after another, which costs O(radius) instead of O(radius^2) per
+ * pixel. The result is very close to the exact filter for small sigma_r, but the
+ * separable filter cannot reproduce diagonal structures as well. The CPU backend
+ * filters the source ROI only (pixels outside of it are not used) and writes the
+ * result to the destination ROI (see UnaryOp::setClipToROI).
  */
 class ICLFilter_API BilateralFilterOp : public filter::UnaryOp, public utils::Uncopyable {
 
@@ -72,7 +83,7 @@ public:
 	 * Applies the bilateral filter operation. Supported are grayvalue-images, mono float images and color images like rgb.
 	 * Internally, the color images are converted to Lab-color-space for filtering if the flag use_lab is set to true. It will use
 	 * the given image format instead. The output image will
-	 * have the same size and format like the input image. There is no ROI-support at the moment.
+	 * have the same size and format like the input image. Only the CPU backend supports ROIs.
 	 * @brief apply Applies the bilateral filter operation.
 	 * @param in Image to filter.
 	 * @param out Filter result (must be of the same size and format)
@@ -87,10 +98,16 @@ public:
 	void setSigmaR(float sigmaR) { this->sigma_r = sigmaR; }
 	/// Sets whether to use lab-color space or rgb
 	void setUseLAB(bool _use_lab) { this->use_lab = _use_lab; }
+	/// Sets whether the CPU backend uses the separable approximation instead of the exact filter
+	void setApproximate(bool approximate) { this->approximate = approximate; }
+	/// Sets the number of threads used by the CPU backend (1: calling thread only (default), 0: all threads)
+	void setNumThreads(int numThreads);
 
 	int getRadius() { return this->radius; }
 	float getSigmaS() { return this->sigma_s; }
 	float getSigmaR() { return this->sigma_r; }
+	bool getApproximate() const { return this->approximate; }
+	int getNumThreads() const { return this->num_threads; }
 
 	core::Img32f const &getSumImg();
 
@@ -105,6 +122,10 @@ protected:
 	float sigma_r;
 	/// Bilateral filter method used
 	Method _method;
+	/// Use the separable approximation (CPU only)
+	bool approximate;
+	/// Number of threads (CPU only)
+	int num_threads;
 
 private:
 
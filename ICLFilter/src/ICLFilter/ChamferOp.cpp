@@ -31,6 +31,7 @@
 #include <ICLFilter/ChamferOp.h>
 #include <ICLCore/Img.h>
 #include <ICLUtils/Point.h>
+#include <ICLUtils/ThreadPool.h>
 
 #include <limits>
 #include <cmath>
@@ -242,6 +243,148 @@ namespace icl{
 
       // }}}
 
+      /// first pass of the exact EDT: distance to the nearest feature within each column
+      /** The columns [begin,end) are processed row by row in order to work on
+          contiguous memory. g is a ROI-sized buffer, gy optionally receives the
+          row of the nearest feature (-1 if there is none) */
+      struct EDTColumns{
+        // {{{ open
+        const icl32s *work; //!< ROI origin of the prepared image (0 for feature pixels)
+        int lineStep;
+        int w, h;
+        icl32s inf;
+        icl32s *g;
+        icl32s *gy;
+
+        void operator()(int begin, int end) const{
+          for(int x=begin;x<end;++x){
+            g[x] = work[x] ? inf : 0;
+            if(gy) gy[x] = work[x] ? -1 : 0;
+          }
+          for(int y=1;y<h;++y){
+            const icl32s *src = work + y*lineStep;
+            icl32s *gl = g + y*w, *glPrev = gl - w;
+            for(int x=begin;x<end;++x){
+              gl[x] = src[x] ? iclMin(glPrev[x]+1,inf) : 0;
+            }
+            if(gy){
+              icl32s *gyl = gy + y*w;
+              for(int x=begin;x<end;++x){
+                gyl[x] = src[x] ? gyl[x-w] : y;
+              }
+            }
+          }
+          for(int y=h-2;y>=0;--y){
+            icl32s *gl = g + y*w, *glNext = gl + w;
+            if(gy){
+              icl32s *gyl = gy + y*w;
+              for(int x=begin;x<end;++x){
+                if(glNext[x]+1 < gl[x]){
+                  gl[x] = glNext[x]+1;
+                  gyl[x] = gyl[x+w];
+                }
+              }
+            }else{
+              for(int x=begin;x<end;++x){
+                gl[x] = iclMin(gl[x],glNext[x]+1);
+              }
+            }
+          }
+        }
+      };
+
+      // }}}
+
+      /// second pass of the exact EDT (lower envelope of parabolas, Meijster et al.)
+      /** The rows [begin,end) are processed independently. The squared distances are
+          written to the prepared image, the nearest feature indices (y*imageWidth+x)
+          to labels (if given) */
+      struct EDTRows{
+        // {{{ open
+        icl32s *work; //!< ROI origin of the prepared image
+        int lineStep;
+        int w;
+        const icl32s *g;
+        const icl32s *gy;
+        icl32s *labels; //!< ROI origin of the nearest feature image (or 0)
+        Point offs; //!< ROI offset
+
+        static inline icl64s f(icl64s x, icl64s i, icl64s gi){
+          return (x-i)*(x-i) + gi*gi;
+        }
+
+        void operator()(int begin, int end) const{
+          std::vector<int> s(w), t(w);
+          for(int y=begin;y<end;++y){
+            const icl32s *gl = g + y*w;
+            int q = 0;
+            s[0] = t[0] = 0;
+            for(int u=1;u<w;++u){
+              while(q >= 0 && f(t[q],s[q],gl[s[q]]) > f(t[q],u,gl[u])) --q;
+              if(q < 0){
+                q = 0;
+                s[0] = u;
+              }else{
+                const icl64s i = s[q];
+                const icl64s sep = (icl64s(u)*u - i*i + icl64s(gl[u])*gl[u] - icl64s(gl[i])*gl[i]) / (2*(u-i));
+                if(sep+1 < w){
+                  ++q;
+                  s[q] = u;
+                  t[q] = (int)sep+1;
+                }
+              }
+            }
+            icl32s *dst = work + y*lineStep;
+            icl32s *lab = labels ? labels + y*lineStep : 0;
+            const icl32s *gyl = gy ? gy + y*w : 0;
+            for(int u=w-1;u>=0;--u){
+              dst[u] = (icl32s)iclMin(f(u,s[q],gl[s[q]]),icl64s(std::numeric_limits<icl32s>::max()));
+              if(lab){
+                lab[u] = gyl[s[q]] < 0 ? -1 : (offs.y+gyl[s[q]])*lineStep + offs.x+s[q];
+              }
+              if(u == t[q]) --q;
+            }
+          }
+        }
+      };
+
+      // }}}
+
+      void apply_edt(Img32s *poDst, int channel, Img32s *labels, int numThreads){
+        // {{{ open
+        const Rect r = poDst->getROI();
+        if(r.width < 1 || r.height < 1) return;
+        const int lineStep = poDst->getWidth();
+        icl32s *work = poDst->getData(channel) + r.x + r.y*lineStep;
+
+        std::vector<icl32s> g(r.getDim()), gy(labels ? r.getDim() : 0);
+        EDTColumns cols = { work, lineStep, r.width, r.height, r.width+r.height, g.data(), labels ? gy.data() : 0 };
+        parallel_for(0,r.width,cols,1,numThreads);
+
+        EDTRows rows = { work, lineStep, r.width, g.data(), labels ? gy.data() : 0,
+                         labels ? labels->getData(channel) + r.x + r.y*lineStep : 0, r.ul() };
+        parallel_for(0,r.height,rows,1,numThreads);
+      }
+
+      // }}}
+
+      void sqrt_roi(const Img32s &src, Img32f &dst, int channel){
+        // {{{ open
+        const Rect r = src.getROI();
+        const Point o = dst.getROIOffset();
+        const Channel32s s = src[channel];
+        Channel32f d = dst[channel];
+        for(int y=0;y<r.height;++y){
+          const icl32s *ps = &s(r.x,r.y+y);
+          icl32f *pd = &d(o.x,o.y+y);
+          for(int x=0;x<r.width;++x){
+            pd[x] = ::sqrt((float)ps[x]);
+          }
+        }
+      }
+
+      // }}}
+
     }
 
     ChamferOp::ChamferOp( icl32s horizontalAndVerticalNeighbourDistance, icl32s diagonalNeighborDistance, int scaleFactor, bool scaleUpResult)
@@ -250,13 +393,26 @@ namespace icl{
       :m_iHorizontalAndVerticalNeighbourDistance(horizontalAndVerticalNeighbourDistance),
        m_iDiagonalNeighborDistance(diagonalNeighborDistance),
        m_iScaleFactor(scaleFactor),
-       m_bScaleUpResult(scaleUpResult){
+       m_bScaleUpResult(scaleUpResult),
+       m_eMetric(chamfer),
+       m_bNearestFeature(false),
+       m_numThreads(1){
       setClipToROI(false);
     }
 
     // }}}
 
+    void ChamferOp::setMetric(ChamferOp::metric m){
+      m_eMetric = m;
+    }
+
+    void ChamferOp::setComputeNearestFeature(bool on){
+      m_bNearestFeature = on;
+    }
 
+    void ChamferOp::setNumThreads(int numThreads){
+      m_numThreads = numThreads < 0 ? 1 : numThreads;
+    }
 
     void ChamferOp::apply(const ImgBase *poSrc, ImgBase **ppoDst){
       // {{{ open
@@ -264,8 +420,8 @@ namespace icl{
       ICLASSERT_RETURN(ppoDst);
       ICLASSERT_RETURN(poSrc != *ppoDst);
 
-      bool needSetCheckOnlyToFalseCall = (!getCheckOnly()) && (*ppoDst == poSrc);
-      if(needSetCheckOnlyToFalseCall) setCheckOnly(true);
+      const bool exact = m_eMetric != chamfer;
+      const depth dstDepth = m_eMetric == euclidean ? depth32f : depth32s;
       //    if(!prepare (ppoDst, poSrc, depth32s)){
       Size dstSize;
       Rect dstROI;
@@ -276,14 +432,21 @@ namespace icl{
         dstSize = co::scale(poSrc->getSize(),m_iScaleFactor);
         dstROI = co::scale(poSrc->getROI(),m_iScaleFactor);
       }
-      if(!prepare(ppoDst, depth32s, dstSize,  poSrc->getFormat(), poSrc->getChannels(), dstROI)){
+      if(!prepare(ppoDst, dstDepth, dstSize,  poSrc->getFormat(), poSrc->getChannels(), dstROI)){
         ERROR_LOG("unable to prepare image \n");
-        if(needSetCheckOnlyToFalseCall) setCheckOnly(false);
         return;
       }
       int C = (*ppoDst)->getChannels();
 
-      Img32s *dst = (*ppoDst)->asImg<icl32s>();
+      // the rooted euclidean distances are computed in a squared-distance buffer first
+      Img32s *dst = 0;
+      if(dstDepth == depth32s){
+        dst = (*ppoDst)->asImg<icl32s>();
+      }else{
+        ImgBase *buf = &m_oSqrBufferImage;
+        ensureCompatible(&buf,depth32s,dstSize,C,poSrc->getFormat(),dstROI);
+        dst = &m_oSqrBufferImage;
+      }
 
       icl32s d1 = m_iHorizontalAndVerticalNeighbourDistance;
       icl32s d2 = m_iDiagonalNeighborDistance;
@@ -300,17 +463,39 @@ namespace icl{
 #undef ICL_INSTANTIATE_DEPTH
         default: ICL_INVALID_DEPTH;
       }
-      if(m_iScaleFactor == 1 || !m_bScaleUpResult){
-        for(int c=0;c<C;++c){
-          apply_chamfer_op_generic(dst,c,d1,d2);
+
+      const bool scaleUp = m_iScaleFactor > 1 && m_bScaleUpResult;
+      Img32s *work = scaleUp ? &m_oBufferImage : dst;
+      Img32s *labels = 0;
+      if(exact && m_bNearestFeature){
+        ImgBase *l = scaleUp ? &m_oLabelBufferImage : &m_oLabelImage;
+        ensureCompatible(&l,depth32s,work->getSize(),C,formatMatrix,work->getROI());
+        labels = l->asImg<icl32s>();
+        labels->clear(-1,-1,false);
+      }
+
+      for(int c=0;c<C;++c){
+        if(exact){
+          apply_edt(work,c,labels,m_numThreads);
+        }else{
+          apply_chamfer_op_generic(work,c,d1,d2);
         }
-      }else{
+      }
+      if(scaleUp){
+        m_oBufferImage.scaledCopyROI(dst);
+        if(labels){
+          ImgBase *l = &m_oLabelImage;
+          ensureCompatible(&l,depth32s,dst->getSize(),C,formatMatrix,dst->getROI());
+          m_oLabelImage.clear(-1,-1,false);
+          m_oLabelBufferImage.scaledCopyROI(&m_oLabelImage);
+        }
+      }
+
+      if(dstDepth == depth32f){
         for(int c=0;c<C;++c){
-          apply_chamfer_op_generic(&m_oBufferImage,c,d1,d2);
+          sqrt_roi(*dst,*(*ppoDst)->asImg<icl32f>(),c);
         }
-        m_oBufferImage.scaledCopyROI(dst);
       }
-      if(needSetCheckOnlyToFalseCall) setCheckOnly(false);
     }
     // }}}
 
@@ -166,6 +166,23 @@ namespace icl{
         which can increase calculation performance when comparing one <em>Base</em>-
         image (chamfered once) with many models.
 
+        \section EDT Exact Euclidean distance transform
+        Instead of the chamfer approximation, the exact Euclidean distance transform
+        can be used (see setMetric). It is computed in linear time by the separable
+        algorithm of Meijster et al. (which is also used by Felzenszwalb and Huttenlocher):
+        First, the distance to the nearest white pixel within each image column is computed.
+        Then, for each row, the lower envelope of the parabolas \f$(x-i)^2 + g(i)^2\f$ is
+        evaluated. Both passes are distributed over several threads (see setNumThreads).
+        - euclideanSquared results in exact squared distances (depth32s)
+        - euclidean results in the (rooted) distances (depth32f)
+
+        Pixels in a channel that contains no white pixel at all get a very large value.
+        Optionally, the index \f$y\cdot width+x\f$ of the nearest white pixel can be
+        computed as well (see setComputeNearestFeature and getNearestFeatureImage), which
+        results in a labeling of the voronoi cells of the white pixels. If a scale factor
+        greater than 1 is used, the indices refer to the down-scaled image grid.\n
+        The chamfer weights and step 4 of the algorithm above are not used in this case.
+
         \section HP Hausdorff-Distance ROI penalties
         When comparing images using the Hausdorff-Distance, sometimes a model, represented by
         a point set \f$A=\{a_1,...,a_n\}\f$ must be compared with an image that is represented
@@ -200,6 +217,13 @@ namespace icl{
         distancePenalty /**< outer ROI model pixels are punished proportionally to the distance to the ROI */
       };
 
+      /// decides how the distances are computed
+      enum metric{
+        chamfer,          /**< two pass chamfer approximation using the given neighbour distances (depth32s) */
+        euclideanSquared, /**< exact squared euclidean distances (depth32s) */
+        euclidean         /**< exact euclidean distances (depth32f) */
+      };
+
       /// Creates a new ChampferOp object with given distances for adjacent image pixels
       /** @param horizontalAndVerticalNeighbourDistance distance between horizontal adjacent pixels
           @param diagonalNeighborDistance distance between diagonal adjacent pixels
@@ -236,6 +260,32 @@ namespace icl{
       /// Import unaryOps apply function without destination image
       using UnaryOp::apply;
 
+      /// sets the distance metric (chamfer by default)
+      /** For the metric euclidean, the result image has depth32f, so in this
+          case in-place application is not supported */
+      void setMetric(metric m);
+
+      /// returns the current distance metric
+      metric getMetric() const { return m_eMetric; }
+
+      /// sets whether the nearest white pixel index is computed (exact metrics only)
+      void setComputeNearestFeature(bool on);
+
+      /// returns whether the nearest white pixel index is computed
+      bool getComputeNearestFeature() const { return m_bNearestFeature; }
+
+      /// returns the nearest white pixel indices of the last apply call
+      /** Each pixel contains the index y*width+x of the nearest white pixel
+          or -1 if there is none. Only available for the exact metrics if
+          setComputeNearestFeature(true) was called */
+      const core::Img32s &getNearestFeatureImage() const { return m_oLabelImage; }
+
+      /// sets the number of threads used by the exact metrics (1: calling thread only, 0: all threads)
+      void setNumThreads(int numThreads);
+
+      /// returns the number of threads
+      int getNumThreads() const { return m_numThreads; }
+
       /// static utility function to convert a model represented by a point set into a binary image
       /** @param model model to convert into the binary image representation
           @param image destination image (adapted to depth 32s, so it can be chamfered in-place)
@@ -369,6 +419,24 @@ namespace icl{
 
       /// temporarily use buffer
       core::Img32s m_oBufferImage;
+
+      /// distance metric
+      metric m_eMetric;
+
+      /// whether the nearest feature image is computed
+      bool m_bNearestFeature;
+
+      /// number of threads used by the exact metrics
+      int m_numThreads;
+
+      /// squared distances buffer for the euclidean metric
+      core::Img32s m_oSqrBufferImage;
+
+      /// nearest feature indices
+      core::Img32s m_oLabelImage;
+
+      /// down-scaled nearest feature indices (if scaleUpResult is used)
+      core::Img32s m_oLabelBufferImage;
     };
   } // namespace filter
 }
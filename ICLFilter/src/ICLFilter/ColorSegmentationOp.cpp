@@ -34,6 +34,8 @@
 #include <ICLUtils/Uncopyable.h>
 #include <ICLFilter/ColorSegmentationOp.h>
 #include <ICLCore/Color.h>
+#include <ICLUtils/ThreadPool.h>
+#include <ICLUtils/ClippedCast.h>
 
 using namespace icl::utils;
 using namespace icl::core;
@@ -41,6 +43,58 @@ using namespace icl::core;
 namespace icl{
   namespace filter{
 
+    /// compressed two-level representation of a LUT3D
+    /** The LUT is split into blocks of 8x8x8 entries. Blocks that contain
+        a single label only (which is the common case) are stored in the block
+        table directly, all other blocks are stored in a pool. By this means,
+        even a full 256x256x256 LUT usually fits into the cache */
+    struct TwoLevelLUT{
+      int bw, bh;                 //!< number of blocks in x- and y-direction
+      std::vector<icl32s> blocks; //!< pool offset or -(label+1) for uniform blocks
+      std::vector<icl8u> pool;    //!< data of non-uniform blocks
+
+      /// creates the compressed table (all LUT dimensions must be multiples of 8)
+      void build(const icl8u *data, int w, int h, int t){
+        bw = w/8;
+        bh = h/8;
+        blocks.resize(bw*bh*(t/8));
+        pool.clear();
+        icl8u block[512];
+        for(int bz=0,i=0;bz<t/8;++bz){
+          for(int by=0;by<bh;++by){
+            for(int bx=0;bx<bw;++bx,++i){
+              bool uniform = true;
+              for(int z=0;z<8;++z){
+                for(int y=0;y<8;++y){
+                  const icl8u *src = data + 8*bx + w*(8*by+y) + w*h*(8*bz+z);
+                  std::copy(src,src+8,block+8*y+64*z);
+                }
+              }
+              for(int j=1;j<512 && uniform;++j){
+                uniform = block[j] == block[0];
+              }
+              if(uniform){
+                blocks[i] = -(int(block[0])+1);
+              }else{
+                blocks[i] = (int)pool.size();
+                pool.insert(pool.end(),block,block+512);
+              }
+            }
+          }
+        }
+      }
+
+      /// returns the size of the compressed data in bytes
+      int getMemorySize() const{
+        return (int)(blocks.size()*sizeof(icl32s) + pool.size());
+      }
+
+      inline icl8u operator()(int x, int y, int z) const{
+        const icl32s b = blocks[(x>>3) + bw*((y>>3) + bh*(z>>3))];
+        return b < 0 ? icl8u(-b-1) : pool[b + (x&7) + ((y&7)<<3) + ((z&7)<<6)];
+      }
+    };
+
     class ColorSegmentationOp::LUT3D : public Uncopyable{
       public:
       int dim, w, h,t, wh;
@@ -48,8 +102,18 @@ namespace icl{
       mutable Img8u image;
       mutable Img8u colorImage;
       mutable std::vector<Color> classmeans;
+
+      /// compressed version of the data (only used for large LUTs)
+      TwoLevelLUT compressed;
+
+      /// whether compressed has to be re-created
+      bool dirty;
+
+      /// LUTs with at least this number of entries are compressed
+      static const int COMPRESSION_MIN_DIM = 1<<21;
+
       LUT3D(int w, int h, int t):
-        dim(w*h*t),w(w),h(h),t(t),wh(w*h),data(dim ? new icl8u[dim] : 0){
+        dim(w*h*t),w(w),h(h),t(t),wh(w*h),data(dim ? new icl8u[dim] : 0),dirty(true){
         clear(0);
         classmeans.resize(256);
       }
@@ -79,6 +143,19 @@ namespace icl{
 
       void clear(icl8u value) {
         std::fill(data,data+dim,value);
+        dirty = true;
+      }
+
+      /// returns the compressed LUT, or 0 if the dense LUT is used
+      /** The dense LUT is used for small LUTs and if the compression does
+          not reduce the memory usage significantly */
+      const TwoLevelLUT *getCompressed(){
+        if(dim < COMPRESSION_MIN_DIM) return 0;
+        if(dirty){
+          compressed.build(data,w,h,t);
+          dirty = false;
+        }
+        return compressed.getMemorySize() < dim/8 ? &compressed : 0;
       }
 
       void save(const std::string &filename, format fmt){
@@ -132,6 +209,7 @@ namespace icl{
         resize(w,h,t);
 
         std::copy(f.getCurrentDataPointer(),f.getCurrentDataPointer()+dim,data);
+        dirty = true;
 
         return fmt;
       }
@@ -327,16 +405,109 @@ namespace icl{
 
     };
 
-   template<class SrcIterator, class DstIterator, icl8u xShift, icl8u yShift, icl8u zShift>
-    static void apply_lookup(SrcIterator a, SrcIterator b, SrcIterator c, DstIterator d, DstIterator dEnd, const ShiftedLUT3D_T<xShift,yShift,zShift> &lut){
-      while(d!=dEnd){
-        *d = lut(*a,*b,*c);
-        ++a; ++b; ++c; ++d;
+    /// lookup in the dense LUT with shifts given at run-time
+    struct DenseLookup{
+      const icl8u *data;
+      int w, wh;
+      int xShift, yShift, zShift;
+
+      inline icl8u operator()(int x, int y, int z) const{
+        return data[(x>>xShift) + w*(y>>yShift) + wh*(z>>zShift)];
+      }
+    };
+
+    /// lookup in the compressed LUT with shifts given at run-time
+    struct CompressedLookup{
+      const TwoLevelLUT *lut;
+      int xShift, yShift, zShift;
+
+      inline icl8u operator()(int x, int y, int z) const{
+        return (*lut)(x>>xShift,y>>yShift,z>>zShift);
+      }
+    };
+
+    /// source image is already given in the segmentation format
+    struct NoConversion{
+      static const bool BUFFERED = false;
+      static inline void row(const icl8u*, const icl8u*, const icl8u*, icl8u*, icl8u*, icl8u*, int){}
+    };
+
+    /// fused rgb to yuv conversion (equal to cc_util_rgb_to_yuv, but inlined)
+    struct RGBToYUV{
+      static const bool BUFFERED = true;
+      static inline void row(const icl8u *r, const icl8u *g, const icl8u *b, icl8u *y, icl8u *u, icl8u *v, int n){
+        for(int i=0;i<n;++i){
+          const int Y = ( 1254097*r[i] + 2462056*g[i] + 478151*b[i] ) >> 22;
+          y[i] = Y;
+          u[i] = clip((2063598*(b[i]-Y) >> 22) + 128,0,255);
+          v[i] = clip((3678405*(r[i]-Y) >> 22) + 128,0,255);
+        }
+      }
+    };
+
+    /// fused rgb to hls conversion
+    struct RGBToHLS{
+      static const bool BUFFERED = true;
+      static inline void row(const icl8u *r, const icl8u *g, const icl8u *b, icl8u *h, icl8u *l, icl8u *s, int n){
+        icl32f fh,fl,fs;
+        for(int i=0;i<n;++i){
+          cc_util_rgb_to_hls(r[i],g[i],b[i],fh,fl,fs);
+          h[i] = clipped_cast<icl32f,icl8u>(fh);
+          l[i] = clipped_cast<icl32f,icl8u>(fl);
+          s[i] = clipped_cast<icl32f,icl8u>(fs);
+        }
+      }
+    };
+
+    /// classifies the rows [begin,end) of the image
+    /** If a conversion is needed, each row is converted into a small
+        buffer first, which remains in the cache for the lookup */
+    template<class Conversion, class Lookup>
+    struct ClassifyRows{
+      const icl8u *c0, *c1, *c2;
+      icl8u *dst;
+      int w;
+      Lookup lut;
+
+      void operator()(int begin, int end) const{
+        std::vector<icl8u> buf(Conversion::BUFFERED ? 3*w : 0);
+        for(int y=begin;y<end;++y){
+          const icl8u *a = c0+y*w, *b = c1+y*w, *c = c2+y*w;
+          if(Conversion::BUFFERED){
+            Conversion::row(a,b,c,buf.data(),buf.data()+w,buf.data()+2*w,w);
+            a = buf.data();
+            b = a+w;
+            c = b+w;
+          }
+          icl8u *d = dst+y*w;
+          for(int x=0;x<w;++x){
+            d[x] = lut(a[x],b[x],c[x]);
+          }
+        }
+      }
+    };
+
+    template<class Conversion, class Lookup>
+    static void classify(const Img8u &src, Img8u &dst, const Lookup &lut, int numThreads){
+      ClassifyRows<Conversion,Lookup> rows = { src.begin(0), src.begin(1), src.begin(2), dst.begin(0), src.getWidth(), lut };
+      parallel_for(0,src.getHeight(),rows,0,numThreads);
+    }
+
+    template<class Conversion>
+    static void classify(const Img8u &src, Img8u &dst, ColorSegmentationOp::LUT3D &lut,
+                         const icl8u *shifts, int numThreads){
+      const TwoLevelLUT *compressed = lut.getCompressed();
+      if(compressed){
+        CompressedLookup l = { compressed, shifts[0], shifts[1], shifts[2] };
+        classify<Conversion>(src,dst,l,numThreads);
+      }else{
+        DenseLookup l = { lut.data, lut.w, lut.wh, shifts[0], shifts[1], shifts[2] };
+        classify<Conversion>(src,dst,l,numThreads);
       }
     }
 
     ColorSegmentationOp::ColorSegmentationOp(icl8u c0shift, icl8u c1shift, icl8u c2shift, format fmt):
-      m_segFormat(fmt),m_lut(new LUT3D(0,0,0)){
+      m_segFormat(fmt),m_lut(new LUT3D(0,0,0)),m_numThreads(1){
       ICLASSERT_THROW(getChannelsOfFormat(fmt) == 3,ICLException("Construktor ColorSegmentationOp: format must be a 3-channel format"));
       setSegmentationShifts(c0shift,c1shift,c2shift);
     }
@@ -361,6 +532,17 @@ namespace icl{
       }
       Img8u &dstRef = *(*dst)->asImg<icl8u>();
 
+      // rgb images are converted and classified in a single pass
+      if(src->getFormat() == formatRGB && src->getDepth() == depth8u){
+        if(m_segFormat == formatYUV){
+          classify<RGBToYUV>(*src->asImg<icl8u>(),dstRef,*m_lut,m_bitShifts,m_numThreads);
+          return;
+        }else if(m_segFormat == formatHLS){
+          classify<RGBToHLS>(*src->asImg<icl8u>(),dstRef,*m_lut,m_bitShifts,m_numThreads);
+          return;
+        }
+      }
+
       // preparing source image
       if(src->getFormat() != m_segFormat || src->getDepth() != depth8u){
         m_inputBuffer.setFormat(m_segFormat);
@@ -369,10 +551,14 @@ namespace icl{
       }
       const Img8u &srcRef = *src->asImg<icl8u>();
 
+      if(m_lut->getCompressed()){
+        classify<NoConversion>(srcRef,dstRef,*m_lut,m_bitShifts,m_numThreads);
+        return;
+      }
+
       // we use cross-instantiated templates for better performance
   #define SHIFT_2_CASE(SH0,SH1,SH2)                                       \
-      case SH2: apply_lookup(srcRef.begin(0),srcRef.begin(1),srcRef.begin(2), \
-                             dstRef.begin(0),dstRef.end(0),ShiftedLUT3D_T<SH0,SH1,SH2>(*m_lut)); break
+      case SH2: classify<NoConversion>(srcRef,dstRef,ShiftedLUT3D_T<SH0,SH1,SH2>(*m_lut),m_numThreads); break
 
 
 
@@ -382,12 +568,9 @@ namespace icl{
         SHIFT_2_CASE(SH0,SH1,2); SHIFT_2_CASE(SH0,SH1,3);                 \
         SHIFT_2_CASE(SH0,SH1,4); SHIFT_2_CASE(SH0,SH1,5);                 \
         SHIFT_2_CASE(SH0,SH1,6); SHIFT_2_CASE(SH0,SH1,7);                 \
-        default: apply_lookup(srcRef.begin(0),                            \
-                              srcRef.begin(1),                            \
-                              srcRef.begin(2),                            \
-                              dstRef.begin(0),                            \
-                              dstRef.end(0),                              \
-                              ShiftedLUT3D_T<SH0,SH1,8>(*m_lut));  break; \
+        default: classify<NoConversion>(srcRef,dstRef,                    \
+                                        ShiftedLUT3D_T<SH0,SH1,8>(*m_lut), \
+                                        m_numThreads);  break;            \
       }
 
   #define SHIFT_1_CASE(SH0,SH1)                   \
@@ -423,6 +606,10 @@ namespace icl{
       m_segFormat = fmt;
     }
 
+    void ColorSegmentationOp::setNumThreads(int numThreads){
+      m_numThreads = numThreads < 0 ? 1 : numThreads;
+    }
+
     void ColorSegmentationOp::setSegmentationShifts(icl8u c0shift, icl8u c1shift, icl8u c2shift){
       m_bitShifts[0] = c0shift;
       m_bitShifts[1] = c1shift;
@@ -454,6 +641,7 @@ namespace icl{
           }
         }
       }
+      m_lut->dirty = true;
     }
 
     void ColorSegmentationOp::lutEntry(format fmt, int a, int b, int c, int rA, int rB, int rC, icl8u value){
@@ -543,6 +731,7 @@ namespace icl{
     }
 
     icl8u *ColorSegmentationOp::getLUT(){
+      m_lut->dirty = true;
       return m_lut->data;
     }
 
@@ -106,6 +106,20 @@ namespace icl{
         into 255 valid classes. But actually, this should not become a problem at all as the
         classification quality usually restricts the number of classes to a maximum of about 10.
 
+        \section FUSED Fused Conversion and Classification
+        If the source image is an RGB image of depth8u and the segmentation format is
+        formatYUV or formatHLS, the color conversion is not performed as an extra pass.
+        Instead, each pixel is converted and classified at once. The rows of the image
+        can be processed by several threads (see setNumThreads).
+
+        \section COMP Compressed LUTs
+        Large LUTs (at least 2^21 entries) are internally compressed into a two-level
+        table of 8x8x8 blocks, where blocks that contain a single class label only are
+        not stored explicitly. As segmentation LUTs usually consist of a few compact
+        class volumes, the compressed table fits into the cache, which avoids the cache
+        misses of random accesses into a 16MB table. The compressed table is only
+        used if it is significantly smaller than the LUT itself.
+
         \section BENCH Benchmark Results
 
     */
@@ -122,6 +136,7 @@ namespace icl{
       core::Img8u m_lastDst;          //!< last used destination image
       icl8u m_bitShifts[3];     //!< bit shifts for all 8-Bit channels
       LUT3D *m_lut;             //!< color classification lookup table
+      int m_numThreads;         //!< number of threads used for the classification
 
       public:
 
@@ -142,6 +157,12 @@ namespace icl{
       /// Imported apply from parent UnaryOp class
       using UnaryOp::apply;
 
+      /// sets the number of threads used (1: calling thread only (default), 0: all threads)
+      void setNumThreads(int numThreads);
+
+      /// returns the number of threads used
+      int getNumThreads() const { return m_numThreads; }
+
       /// classifies a pixel in given rgb format
       icl8u classifyPixel(icl8u r, icl8u g, icl8u b);
 
@@ -198,7 +219,10 @@ namespace icl{
       const icl8u *getLUT() const;
 
       /// returns the internal lut data
-      /** Please be careful with this method :-)*/
+      /** Please be careful with this method :-)
+          The compressed LUT (see \ref COMP) is marked for an update
+          by each call of this method, so the returned pointer
+          must not be stored for later modifications of the LUT */
       icl8u *getLUT();
 
       /// returns the lut-sizes
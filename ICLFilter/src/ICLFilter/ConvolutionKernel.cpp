@@ -110,11 +110,71 @@ namespace icl{
                               -3,  0,  6,  0, -3,
                               -1, -3, -4, -3, -1 };
 
+      int gcd(int a, int b){
+        while(b){
+          int t = a % b;
+          a = b;
+          b = t;
+        }
+        return a < 0 ? -a : a;
+      }
+
+      /// rank-1 test for integer kernels (all factors are integers)
+      bool separate_int(const int *k, const Size &s, std::vector<float> &kx, std::vector<float> &ky){
+        const int w = s.width, h = s.height;
+        int r0=0, c0=0;
+        while(r0 < h && !k[r0*w+c0]){
+          if(++c0 == w){ c0 = 0; ++r0; }
+        }
+        if(r0 == h) return false;
+
+        // kx is the first non-null row divided by the gcd of its elements
+        const int *row0 = k+r0*w;
+        int g = 0;
+        for(int x=0;x<w;++x) g = gcd(g,row0[x]);
+        if(row0[c0] < 0) g = -g;
+        std::vector<int> ix(w), iy(h);
+        for(int x=0;x<w;++x) ix[x] = row0[x]/g;
+
+        for(int y=0;y<h;++y){
+          const int *row = k+y*w;
+          if(row[c0] % ix[c0]) return false;
+          iy[y] = row[c0] / ix[c0];
+          for(int x=0;x<w;++x){
+            if(iy[y]*ix[x] != row[x]) return false;
+          }
+        }
+        kx.assign(ix.begin(),ix.end());
+        ky.assign(iy.begin(),iy.end());
+        return true;
+      }
+
+      /// rank-1 test for float kernels (the products must reproduce the kernel exactly)
+      bool separate_float(const float *k, const Size &s, std::vector<float> &kx, std::vector<float> &ky){
+        const int w = s.width, h = s.height;
+        int r0=0, c0=0;
+        while(r0 < h && !k[r0*w+c0]){
+          if(++c0 == w){ c0 = 0; ++r0; }
+        }
+        if(r0 == h) return false;
+
+        kx.assign(k+r0*w,k+(r0+1)*w);
+        ky.resize(h);
+        for(int y=0;y<h;++y){
+          const float *row = k+y*w;
+          ky[y] = row[c0] / kx[c0];
+          for(int x=0;x<w;++x){
+            if(ky[y]*kx[x] != row[x]) return false;
+          }
+        }
+        return true;
+      }
     }
     ConvolutionKernel::ConvolutionKernel():fdata(0),idata(0),factor(0),isnull(true),owned(false),ft(custom){}
 
     ConvolutionKernel::ConvolutionKernel(const ConvolutionKernel &other):
-      size(other.size),fdata(0),idata(0),factor(other.factor),isnull(other.isnull),owned(other.owned),ft(other.ft){
+      size(other.size),fdata(0),idata(0),factor(other.factor),isnull(other.isnull),owned(other.owned),ft(other.ft),
+      sepx(other.sepx),sepy(other.sepy){
       if(owned){
         if(other.fdata)fdata = deepcopy(other.fdata,getDim());
         if(other.idata)idata = deepcopy(other.idata,getDim());
@@ -166,6 +226,30 @@ namespace icl{
       }
     }
 
+    ConvolutionKernel::ConvolutionKernel(const std::vector<int> &kx, const std::vector<int> &ky, int factor):
+      size(kx.size(),ky.size()),fdata(0),idata(0),factor(factor),isnull(false),owned(true),ft(custom),
+      sepx(kx.begin(),kx.end()),sepy(ky.begin(),ky.end()){
+      ICLASSERT_THROW(getDim() > 0,InvalidSizeException(__FUNCTION__));
+      idata = new int[getDim()];
+      for(int y=0;y<size.height;++y){
+        for(int x=0;x<size.width;++x){
+          idata[x+size.width*y] = ky[y]*kx[x];
+        }
+      }
+    }
+
+    ConvolutionKernel::ConvolutionKernel(const std::vector<float> &kx, const std::vector<float> &ky):
+      size(kx.size(),ky.size()),fdata(0),idata(0),factor(1),isnull(false),owned(true),ft(custom),
+      sepx(kx),sepy(ky){
+      ICLASSERT_THROW(getDim() > 0,InvalidSizeException(__FUNCTION__));
+      fdata = new float[getDim()];
+      for(int y=0;y<size.height;++y){
+        for(int x=0;x<size.width;++x){
+          fdata[x+size.width*y] = ky[y]*kx[x];
+        }
+      }
+    }
+
     ConvolutionKernel &ConvolutionKernel::operator=(const ConvolutionKernel &other){
       if(owned){
         ICL_DELETE(idata);
@@ -178,6 +262,8 @@ namespace icl{
       isnull = other.isnull;
       owned = other.owned;
       ft = other.ft;
+      sepx = other.sepx;
+      sepy = other.sepy;
 
       if(owned){
         if(other.fdata)fdata = deepcopy(other.fdata,getDim());
@@ -208,6 +294,8 @@ namespace icl{
         }
         owned = true;
         factor = 1.0;
+        sepx.clear();
+        sepy.clear();
       }
     }
 
@@ -222,11 +310,28 @@ namespace icl{
             fdata = 0;
           }
           owned = true;
+          sepx.clear();
+          sepy.clear();
         }
       }
     }
 
 
+    bool ConvolutionKernel::isSeparable() const{
+      std::vector<float> kx, ky;
+      return getSeparableFactors(kx,ky);
+    }
+
+    bool ConvolutionKernel::getSeparableFactors(std::vector<float> &kx, std::vector<float> &ky) const{
+      if(isnull) return false;
+      if(sepx.size()){
+        kx = sepx;
+        ky = sepy;
+        return true;
+      }
+      return idata ? separate_int(idata,size,kx,ky) : separate_float(fdata,size,kx,ky);
+    }
+
     void ConvolutionKernel::detach(){
       if(!owned){
         if(idata) idata = deepcopy(idata,getDim());
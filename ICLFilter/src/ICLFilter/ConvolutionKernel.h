@@ -33,6 +33,7 @@
 #include <ICLUtils/CompatMacros.h>
 #include <ICLUtils/Size.h>
 #include <ICLUtils/Exception.h>
+#include <vector>
 
 
 namespace icl{
@@ -43,7 +44,15 @@ namespace icl{
         can be float- or integer valued.
 
 
-  copies of shallow copied instances are shallow! */
+  copies of shallow copied instances are shallow!
+
+        \section SEP Separable Kernels
+        A kernel is separable, if it is the outer product of a column vector ky and
+        a row vector kx (i.e. kernel(x,y) = ky[y] * kx[x]). Separable kernels can be
+        applied as a row pass followed by a column pass, which reduces the cost
+        per pixel from O(w*h) to O(w+h). Separable kernels can be created explicitly
+        from their factors. Otherwise, getSeparableFactors() checks the kernel
+        data for separability (rank 1). */
     struct ICLFilter_API ConvolutionKernel{
 
       /// this enum contains several predefined convolution kernel types
@@ -149,6 +158,14 @@ namespace icl{
       /// create a fixed kernel (optionally as float kernel)
       ConvolutionKernel(fixedType t, bool useFloats=false);
 
+      /// create a separable integer kernel (kernel(x,y) = ky[y] * kx[x])
+      /** The kernel data is created from the given factors. The result of
+          the convolution is divided by factor. */
+      ConvolutionKernel(const std::vector<int> &kx, const std::vector<int> &ky, int factor=1);
+
+      /// create a separable float kernel (kernel(x,y) = ky[y] * kx[x])
+      ConvolutionKernel(const std::vector<float> &kx, const std::vector<float> &ky);
+
       /// Destructor
       ~ConvolutionKernel();
 
@@ -202,6 +219,18 @@ namespace icl{
       /// ensures shallow copied data is copied deeply
       void detach();
 
+      /// returns whether the kernel is separable (see getSeparableFactors)
+      bool isSeparable() const;
+
+      /// computes row and column factors of a separable kernel
+      /** If the kernel is separable, kx (of size width) and ky (of size height)
+          are filled such that kernel(x,y) == ky[y] * kx[x] holds exactly for the
+          current kernel data (int or float) and true is returned. For integer
+          kernels, all factors are integer values. Factors, that were given
+          explicitly at construction time, are returned directly as long as the
+          kernel's data type was not changed (see toFloat and toInt). */
+      bool getSeparableFactors(std::vector<float> &kx, std::vector<float> &ky) const;
+
     private:
       utils::Size size;    //!< associated size
       float *fdata; //!< float data pointer
@@ -210,6 +239,8 @@ namespace icl{
       bool isnull;  //!< is already initialized
       bool owned;   //!< is data owned
       fixedType ft; //!< fixed type set
+      std::vector<float> sepx; //!< explicitly given row factors (empty if not given)
+      std::vector<float> sepy; //!< explicitly given column factors (empty if not given)
     };
   } // namespace filter
 }
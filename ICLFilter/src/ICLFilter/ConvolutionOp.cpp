@@ -29,8 +29,12 @@
 ********************************************************************/
 
 #include <ICLFilter/ConvolutionOp.h>
+#include <ICLFilter/ConvolutionOpHelpers.h>
 #include <ICLCore/Img.h>
+#include <ICLUtils/CPUInfo.h>
 #include <limits>
+#include <vector>
+#include <cmath>
 
 using namespace icl::utils;
 using namespace icl::core;
@@ -38,29 +42,43 @@ using namespace icl::core;
 namespace icl{
   namespace filter{
     namespace{
+      /// parameters of a single convolution (the ConvolutionOp itself is not changed while applying it)
+      class ConvolutionParams{
+        const ConvolutionOp &op;
+        const ConvolutionKernel &kernel;
+        Point roiOffset;
+        public:
+        ConvolutionParams(const ConvolutionOp &op, const ConvolutionKernel &kernel, const Point &roiOffset):
+          op(op),kernel(kernel),roiOffset(roiOffset){}
+        const ConvolutionKernel &getKernel() const { return kernel; }
+        const Point &getROIOffset() const { return roiOffset; }
+        const Point &getAnchor() const { return op.getAnchor(); }
+        const Size &getMaskSize() const { return op.getMaskSize(); }
+      };
+
   #ifdef ICL_HAVE_IPP
       template<class SrcType, class DstType, typename ippfunc>
-      inline void ipp_call_fixed(const Img<SrcType> &src, Img<DstType> &dst, int channel, ippfunc func, ConvolutionOp &op){
+      inline void ipp_call_fixed(const Img<SrcType> &src, Img<DstType> &dst, int channel, ippfunc func, const ConvolutionParams &op){
         func(src.getROIData(channel,op.getROIOffset()),src.getLineStep(),dst.getROIData(channel),dst.getLineStep(),dst.getROISize());
       }
       template<class SrcType, class DstType, typename ippfunc>
-      inline void ipp_call_fixed_mask(const Img<SrcType> &src, Img<DstType> &dst, int channel, IppiMaskSize m, ippfunc func, ConvolutionOp &op){
+      inline void ipp_call_fixed_mask(const Img<SrcType> &src, Img<DstType> &dst, int channel, IppiMaskSize m, ippfunc func, const ConvolutionParams &op){
         func(src.getROIData(channel,op.getROIOffset()),src.getLineStep(),dst.getROIData(channel),dst.getLineStep(),dst.getROISize(),m);
       }
       template<class ImageType,typename ippfunc>
-      inline void ipp_call_filter_int(const Img<ImageType> &src, Img<ImageType> &dst, const int *kernel, int channel, ConvolutionOp &op, ippfunc func){
+      inline void ipp_call_filter_int(const Img<ImageType> &src, Img<ImageType> &dst, const int *kernel, int channel, const ConvolutionParams &op, ippfunc func){
         func(src.getROIData(channel,op.getROIOffset()),src.getLineStep(),dst.getROIData(channel),dst.getLineStep(),dst.getROISize(),
                 kernel, op.getKernel().getSize(), op.getAnchor(), op.getKernel().getFactor() );
       }
       template<class ImageType,typename ippfunc>
-      inline void ipp_call_filter_float(const Img<ImageType> &src, Img<ImageType> &dst, const float *kernel, int channel, ConvolutionOp &op, ippfunc func){
+      inline void ipp_call_filter_float(const Img<ImageType> &src, Img<ImageType> &dst, const float *kernel, int channel, const ConvolutionParams &op, ippfunc func){
         func(src.getROIData(channel,op.getROIOffset()),src.getLineStep(),dst.getROIData(channel),dst.getLineStep(),
                 dst.getROISize(), kernel, op.getKernel().getSize(), op.getAnchor() );
       }
   #endif
 
       template<class KernelType, class SrcType, class DstType>
-      void generic_cpp_convolution(const Img<SrcType> &src, Img<DstType> &dst,const KernelType *k, ConvolutionOp &op, int c){
+      void generic_cpp_convolution(const Img<SrcType> &src, Img<DstType> &dst,const KernelType *k, const ConvolutionParams &op, int c){
         const ImgIterator<SrcType> s(const_cast<SrcType*>(src.getData(c)), src.getWidth(),Rect(op.getROIOffset(), dst.getROISize()));
         const ImgIterator<SrcType> sEnd = ImgIterator<SrcType>::create_end_roi_iterator(src.getData(c),src.getWidth(), Rect(op.getROIOffset(), dst.getROISize()));
         ImgIterator<DstType>      d = dst.beginROI(c);
@@ -78,7 +96,7 @@ namespace icl{
       }
 
       template<class KernelType, class SrcType, class DstType>
-      void generic_cpp_convolution_3x3(const Img<SrcType> &src, Img<DstType> &dst,const KernelType *k, ConvolutionOp &op, int c){
+      void generic_cpp_convolution_3x3(const Img<SrcType> &src, Img<DstType> &dst,const KernelType *k, const ConvolutionParams &op, int c){
 
         register const SrcType *s = src.getROIData(c,op.getROIOffset());
         register DstType *d = dst.getROIData(c);
@@ -113,13 +131,124 @@ namespace icl{
       }
 
 
+      /// returns the best available vectorized implementation (or 0)
+      const ConvolutionOpKernels *get_simd_kernels(){
+        const ConvolutionOpKernels *k = 0;
+        if(CPUInfo::isAvailable(CPUInfo::AVX2) && (k = get_convolution_op_kernels_avx2())) return k;
+        if(CPUInfo::isAvailable(CPUInfo::SSE2) && (k = get_convolution_op_kernels_sse2())) return k;
+        if(CPUInfo::isAvailable(CPUInfo::NEON) && (k = get_convolution_op_kernels_neon())) return k;
+        return 0;
+      }
+
+      /// calls the vectorized 2D or separable filter function for a single channel
+      /** Integer kernels are only processed, if all intermediate results are exactly
+          representable as float (i.e. max|src| * sum|k| < 2^24). As sum|k| equals
+          sum|kx| * sum|ky| for separable kernels, the row- and column pass results
+          are exact as well. */
+      template<class S, class D, class KernelType, class Filter2D, class FilterSep>
+      bool simd_convolve(Filter2D filter, FilterSep separable, const Img<S> &src, Img<D> &dst,
+                         const KernelType *k, const ConvolutionParams &op, int c, float maxAbsSrc){
+        static thread_local std::vector<float> kernel, kx, ky, buffer;
+        const Size &ks = op.getMaskSize();
+        const bool isInt = !op.getKernel().isFloat();
+
+        kernel.resize(ks.getDim());
+        double absSum = 0;
+        for(int i=0;i<ks.getDim();++i){
+          kernel[i] = (float)k[i];
+          absSum += std::abs((double)k[i]);
+        }
+        if(isInt && absSum * maxAbsSrc >= (1<<24)) return false;
+
+        const bool sep = op.getKernel().getSeparableFactors(kx,ky);
+
+        const Size &roi = dst.getROISize();
+        buffer.resize(get_convolution_buffer_size(roi.width,ks.width,ks.height));
+        const S *s = src.getROIData(c,op.getROIOffset()-op.getAnchor());
+        const float factor = (float)op.getKernel().getFactor();
+        if(sep){
+          separable(s,src.getWidth(),dst.getROIData(c),dst.getWidth(),roi.width,roi.height,
+                    kx.data(),ks.width,ky.data(),ks.height,factor,buffer.data());
+        }else{
+          filter(s,src.getWidth(),dst.getROIData(c),dst.getWidth(),roi.width,roi.height,
+                 kernel.data(),ks.width,ks.height,factor,buffer.data());
+        }
+        return true;
+      }
+
+      /// vectorized convolution (default: not available for the depth combination)
+      template<class KernelType, class SrcType, class DstType>
+      inline bool convolute_simd(const Img<SrcType>&, Img<DstType>&, const KernelType*, const ConvolutionParams&, int){
+        return false;
+      }
+
+  #define SIMD_SPEC(KT,SD,DD,MAX)                                                                   \
+      template<> inline bool                                                                        \
+      convolute_simd<KT,icl##SD,icl##DD>(const Img##SD &src, Img##DD &dst, const KT *k,             \
+                                         const ConvolutionParams &op, int c){                        \
+        const ConvolutionOpKernels *impl = get_simd_kernels();                                      \
+        return impl && simd_convolve(impl->filter_##SD##DD,impl->separable_##SD##DD,                \
+                                     src,dst,k,op,c,MAX);                                           \
+      }
+
+      SIMD_SPEC(int,8u,8u,255);
+      SIMD_SPEC(int,8u,16s,255);
+      SIMD_SPEC(int,16s,16s,32768);
+      SIMD_SPEC(float,32f,32f,0);
+
+  #undef SIMD_SPEC
+
+      /// separable convolution using a row pass and a column pass
+      /** The row pass results of the last kernel-height source rows are kept in a
+          ring buffer. Both passes accumulate in KernelType, and the result is divided
+          by the kernel factor and clipped to the destination range just like in
+          generic_cpp_convolution. Returns false, if the kernel is not separable */
+      template<class KernelType, class SrcType, class DstType>
+      bool generic_cpp_separable(const Img<SrcType> &src, Img<DstType> &dst, const ConvolutionParams &op, int c){
+        static thread_local std::vector<float> fx, fy;
+        if(!op.getKernel().getSeparableFactors(fx,fy)) return false;
+
+        static thread_local std::vector<KernelType> kx, ky, rows;
+        kx.assign(fx.begin(),fx.end());
+        ky.assign(fy.begin(),fy.end());
+
+        const int kw = (int)kx.size(), kh = (int)ky.size();
+        const int w = dst.getROISize().width, h = dst.getROISize().height;
+        const int srcStep = src.getWidth(), dstStep = dst.getWidth();
+        const int factor = op.getKernel().getFactor();
+        const SrcType *s = src.getROIData(c,op.getROIOffset()-op.getAnchor());
+        DstType *d = dst.getROIData(c);
+        rows.resize(w*kh);
+
+        for(int y=0;y<h+kh-1;++y){
+          const SrcType *srow = s + y*srcStep;
+          KernelType *r = rows.data() + (y%kh)*w;
+          for(int x=0;x<w;++x){
+            KernelType sum = 0;
+            for(int i=0;i<kw;++i) sum += kx[i] * (KernelType)srow[x+i];
+            r[x] = sum;
+          }
+          const int yDst = y-kh+1;
+          if(yDst < 0) continue;
+          DstType *drow = d + yDst*dstStep;
+          for(int x=0;x<w;++x){
+            KernelType sum = 0;
+            for(int j=0;j<kh;++j) sum += ky[j] * rows[((yDst+j)%kh)*w+x];
+            drow[x] = clipped_cast<KernelType, DstType>(sum / factor);
+          }
+        }
+        return true;
+      }
+
       template<class KernelType, class SrcType, class DstType, ConvolutionKernel::fixedType t>
-      inline void convolute(const Img<SrcType> &src, Img<DstType> &dst,const KernelType *k, ConvolutionOp &op, int c){
+      inline void convolute(const Img<SrcType> &src, Img<DstType> &dst,const KernelType *k, const ConvolutionParams &op, int c){
         /// here we call the generic conv method and do not implement the convolution directly to
         /// get rid of the 4th template parameter 't' which is not regarded in this general case
-        if(op.getAnchor() == Point(1,1) && op.getMaskSize() == Size(3,3)){
+        if(convolute_simd(src,dst,k,op,c)){
+          return;
+        }else if(op.getAnchor() == Point(1,1) && op.getMaskSize() == Size(3,3)){
           generic_cpp_convolution_3x3(src,dst,k,op,c);
-        }else{
+        }else if(!generic_cpp_separable<KernelType>(src,dst,op,c)){
           generic_cpp_convolution(src,dst,k,op,c);
         }
       }
@@ -132,25 +261,25 @@ namespace icl{
       // note: each specialization is doubled because the kernel-type template parameters is handled in the IPP
   #define FIXED_SPEC(SD,DD,KT,IPPF)                                                                                                   \
       template<> inline void                                                                                                          \
-      convolute<int,icl##SD,icl##DD,ConvolutionKernel::KT>(const Img##SD &src,Img##DD &dst,const int*,ConvolutionOp &op, int c){      \
+      convolute<int,icl##SD,icl##DD,ConvolutionKernel::KT>(const Img##SD &src,Img##DD &dst,const int*,const ConvolutionParams &op, int c){ \
         ipp_call_fixed(src,dst,c,IPPF,op);                                                                                            \
       }                                                                                                                               \
       template<> inline void                                                                                                          \
-      convolute<float,icl##SD,icl##DD,ConvolutionKernel::KT>(const Img##SD &src,Img##DD &dst,const float*,ConvolutionOp &op, int c){  \
+      convolute<float,icl##SD,icl##DD,ConvolutionKernel::KT>(const Img##SD &src,Img##DD &dst,const float*,const ConvolutionParams &op, int c){ \
         ipp_call_fixed(src,dst,c,IPPF,op);                                                                                            \
       }
   #define FIXED_SPEC_M(SD,DD,KT,IPPF,MASK)                                                                                            \
       template<> inline void                                                                                                          \
-      convolute<int,icl##SD,icl##DD,ConvolutionKernel::KT>(const Img##SD &src,Img##DD &dst,const int*,ConvolutionOp &op, int c){      \
+      convolute<int,icl##SD,icl##DD,ConvolutionKernel::KT>(const Img##SD &src,Img##DD &dst,const int*,const ConvolutionParams &op, int c){ \
         ipp_call_fixed_mask(src,dst,c,MASK,IPPF,op);                                                                                  \
       }                                                                                                                               \
       template<> inline void                                                                                                          \
-      convolute<float,icl##SD,icl##DD,ConvolutionKernel::KT>(const Img##SD &src,Img##DD &dst,const float*,ConvolutionOp &op, int c){  \
+      convolute<float,icl##SD,icl##DD,ConvolutionKernel::KT>(const Img##SD &src,Img##DD &dst,const float*,const ConvolutionParams &op, int c){ \
         ipp_call_fixed_mask(src,dst,c,MASK,IPPF,op);                                                                                  \
       }
   #define CONV_SPEC(KD,ID,IPPF)                                                                                                           \
       template<> inline void                                                                                                              \
-      convolute<KD,icl##ID,icl##ID,ConvolutionKernel::custom>(const Img##ID &src,Img##ID &dst,const KD* kernel,ConvolutionOp& op, int c){ \
+      convolute<KD,icl##ID,icl##ID,ConvolutionKernel::custom>(const Img##ID &src,Img##ID &dst,const KD* kernel,const ConvolutionParams &op, int c){ \
         ipp_call_filter_##KD(src,dst,kernel,c,op,IPPF);                                                                                   \
       }
 
@@ -210,14 +339,14 @@ namespace icl{
 
 
       template<class KernelType, class SrcType, class DstType, ConvolutionKernel::fixedType t>
-      inline void apply_convolution_sdt(const Img<SrcType> &src, Img<DstType> &dst,const KernelType *k, ConvolutionOp &op){
+      inline void apply_convolution_sdt(const Img<SrcType> &src, Img<DstType> &dst,const KernelType *k, const ConvolutionParams &op){
         for(int c=src.getChannels()-1;c>=0;--c){
           convolute<KernelType,SrcType,DstType,t>(src,dst,k,op,c);
         }
       }
 
       template<class KernelType, class SrcType, class DstType>
-      inline void apply_convolution_sd(const Img<SrcType> &src, Img<DstType> &dst,const KernelType *k, ConvolutionOp &op){
+      inline void apply_convolution_sd(const Img<SrcType> &src, Img<DstType> &dst,const KernelType *k, const ConvolutionParams &op){
         switch(op.getKernel().getFixedType()){
   #define CASE(X) case ConvolutionKernel::X: apply_convolution_sdt<KernelType,SrcType,DstType,ConvolutionKernel::X>(src,dst,k,op); break
           CASE(gauss3x3);CASE(gauss5x5);CASE(sobelX3x3);CASE(sobelX5x5);
@@ -231,7 +360,7 @@ namespace icl{
 
 
       template<class KernelType, class SrcType>
-      inline void apply_convolution_s(const Img<SrcType> &src, ImgBase &dst,const KernelType *k, ConvolutionOp &op){
+      inline void apply_convolution_s(const Img<SrcType> &src, ImgBase &dst,const KernelType *k, const ConvolutionParams &op){
         switch(dst.getDepth()){
   #define ICL_INSTANTIATE_DEPTH(D) case depth##D: apply_convolution_sd(src,*dst.asImg<icl##D>(),k,op); break;
           ICL_INSTANTIATE_ALL_DEPTHS;
@@ -241,7 +370,7 @@ namespace icl{
       }
 
       template<class KernelType>
-      inline void apply_convolution(const ImgBase &src, ImgBase &dst,const KernelType *k, ConvolutionOp &op){
+      inline void apply_convolution(const ImgBase &src, ImgBase &dst,const KernelType *k, const ConvolutionParams &op){
         switch(src.getDepth()){
   #define ICL_INSTANTIATE_DEPTH(D) case depth##D: apply_convolution_s(*src.asImg<icl##D>(),dst,k,op); break;
           ICL_INSTANTIATE_ALL_DEPTHS;
@@ -263,24 +392,32 @@ namespace icl{
     void ConvolutionOp::apply(const ImgBase *src, ImgBase **dst){
       ICLASSERT_RETURN(src);
       ICLASSERT_RETURN(!m_kernel.isNull());
+      Point roiOffset;
       if(m_forceUnsignedOutput){
-        if(!prepare(dst,src)) return;
+        if(!prepare(dst,src,roiOffset)) return;
       }else{
-        if(!prepare(dst,src,src->getDepth()==depth8u ? depth16s : src->getDepth())) return;
+        if(!prepare(dst,src,src->getDepth()==depth8u ? depth16s : src->getDepth(),roiOffset)) return;
       }
 
-      if(src->getDepth() >= depth32f){
-        m_kernel.toFloat();
-      }else if(m_kernel.isFloat()){
+      // the kernel is converted into a local copy, so that apply can be called concurrently
+      ConvolutionKernel converted;
+      const ConvolutionKernel *k = &m_kernel;
+      if(src->getDepth() >= depth32f && !m_kernel.isFloat()){
+        converted = m_kernel;
+        converted.toFloat();
+        k = &converted;
+      }else if(src->getDepth() < depth32f && m_kernel.isFloat()){
         WARNING_LOG("convolution of non-float images with float kernels is not supported\n"
                     "use an int-kernel instead. For now, the kernel is casted to int-type");
-        m_kernel.toInt(true);
+        converted = m_kernel;
+        converted.toInt(true);
+        k = &converted;
       }
 
-      if(m_kernel.isFloat()){
-        apply_convolution<float>(*src,**dst,m_kernel.getFloatData(),*this);
+      if(k->isFloat()){
+        apply_convolution<float>(*src,**dst,k->getFloatData(),ConvolutionParams(*this,*k,roiOffset));
       }else{
-        apply_convolution<int>(*src,**dst,m_kernel.getIntData(),*this);
+        apply_convolution<int>(*src,**dst,k->getIntData(),ConvolutionParams(*this,*k,roiOffset));
       }
     }
   } // namespace filter
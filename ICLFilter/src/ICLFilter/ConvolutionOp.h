@@ -83,6 +83,19 @@ namespace icl {
        - icl8u images & icl32f kernel <b>~135ms</b> (further implem. ~230ms)
        - icl32f-image & icl32f kernel <b>~60ms</b> (further implem. ~60ms)
 
+    <h2>Performance (without IPP)</h2>
+    If the IPP is not available, the depth combinations 8u&rarr;8u, 8u&rarr;16s,
+    16s&rarr;16s and 32f&rarr;32f are processed by vectorized implementations
+    (SSE2, AVX2 or NEON), that are chosen at runtime (see utils::CPUInfo).
+    Separable kernels (see ConvolutionKernel::getSeparableFactors) are applied as
+    a row pass followed by a column pass, which reduces the cost per pixel from
+    O(w*h) to O(w+h). This is also done by the C++ fallback for all other depths.
+    For integer kernels, the results are identical to the ones of the generic
+    C++ implementation, float results may differ in the last bits due to the
+    changed summation order. Integer results are saturated to the destination
+    range. The vectorized Gaussian and Sobel filters are about 3 to 10 times
+    faster than the generic implementation.
+
     <h2>Buffering Kernels</h2>
     In some applications the ConvolutionOp object has to be created
     during runtime. If the filter-kernel is created elsewhere, and it
@@ -113,6 +126,8 @@ namespace icl {
       /// Import unaryOps apply function without destination image
       using NeighborhoodOp::apply;
 
+      virtual bool isTileable() const { return true; }
+
       /// change kernel
       void setKernel (const ConvolutionKernel &kernel){ m_kernel = kernel; }
 
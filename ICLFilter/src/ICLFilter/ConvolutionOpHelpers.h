@@ -0,0 +1,343 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLFilter/src/ICLFilter/ConvolutionOpHelpers.h         **
+** Module : ICLFilter                                              **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace icl{
+  namespace filter{
+
+    /// Internally used table of vectorized convolution functions
+    /** The ConvolutionOp uses these functions for the depth combinations,
+        that are not handled by the IPP. Each table entry processes a single
+        channel: src points to the upper left pixel of the filter mask for the
+        first result pixel, dst to the first result pixel. Line steps are given
+        in elements. The kernel is given as float array, integer kernels are
+        passed as float values. The result is divided by the given factor and
+        then, for integer destinations, truncated and saturated. The buffer
+        must provide get_convolution_buffer_size() floats.
+
+        For integer kernels, all intermediate results are exact (i.e. the results
+        are identical to the integer computation), if the kernels absolute sum
+        multiplied with the largest absolute source value is less than 2^24. For
+        float kernels, the 2D filters sum up the products in the same order as
+        the generic C++ implementation. The separable filters first apply kx
+        to each row and then ky to each column.
+
+        There is one table per instruction set. The respective implementations
+        are located in the ConvolutionOpHelpers_<isa>.cpp files, which are
+        compiled with the according compiler flags. */
+    struct ConvolutionOpKernels{
+      const char *name; //!< name of the instruction set
+
+      /// 2D filter functions
+      void (*filter_8u8u)(const uint8_t *src, int srcStep, uint8_t *dst, int dstStep, int width, int height,
+                          const float *k, int kw, int kh, float factor, float *buffer);
+      void (*filter_8u16s)(const uint8_t *src, int srcStep, int16_t *dst, int dstStep, int width, int height,
+                           const float *k, int kw, int kh, float factor, float *buffer);
+      void (*filter_16s16s)(const int16_t *src, int srcStep, int16_t *dst, int dstStep, int width, int height,
+                            const float *k, int kw, int kh, float factor, float *buffer);
+      void (*filter_32f32f)(const float *src, int srcStep, float *dst, int dstStep, int width, int height,
+                            const float *k, int kw, int kh, float factor, float *buffer);
+
+      /// separable filter functions (row pass with kx followed by a column pass with ky)
+      void (*separable_8u8u)(const uint8_t *src, int srcStep, uint8_t *dst, int dstStep, int width, int height,
+                             const float *kx, int kw, const float *ky, int kh, float factor, float *buffer);
+      void (*separable_8u16s)(const uint8_t *src, int srcStep, int16_t *dst, int dstStep, int width, int height,
+                              const float *kx, int kw, const float *ky, int kh, float factor, float *buffer);
+      void (*separable_16s16s)(const int16_t *src, int srcStep, int16_t *dst, int dstStep, int width, int height,
+                               const float *kx, int kw, const float *ky, int kh, float factor, float *buffer);
+      void (*separable_32f32f)(const float *src, int srcStep, float *dst, int dstStep, int width, int height,
+                               const float *kx, int kw, const float *ky, int kh, float factor, float *buffer);
+    };
+
+    /// returns the SSE2 implementation (or 0 if not available in this build)
+    const ConvolutionOpKernels *get_convolution_op_kernels_sse2();
+
+    /// returns the AVX2 implementation (or 0 if not available in this build)
+    const ConvolutionOpKernels *get_convolution_op_kernels_avx2();
+
+    /// returns the NEON implementation (or 0 if not available in this build)
+    const ConvolutionOpKernels *get_convolution_op_kernels_neon();
+
+    /// returns the number of floats, the buffer of a ConvolutionOpKernels function needs
+    inline int get_convolution_buffer_size(int width, int kw, int kh){
+      return (2*kh+1)*(width+kw-1);
+    }
+
+    namespace {
+      /* The implementation is parameterized with a vector type V, that provides
+         the following static functions:
+         - F zero(), F set1(float), F load(const float*), void store(float*, F)
+         - F add(F,F), F mul(F,F), F div(F,F)
+         - F convert(const uint8_t*), F convert(const int16_t*), F convert(const float*)
+           (loads N source values and converts them to float)
+         - void store_result(D*, F) for D in {uint8_t, int16_t, float} (truncates
+           and saturates for integer types)
+         It is instantiated once in each ConvolutionOpHelpers_<isa>.cpp file. The
+         anonymous namespace ensures, that the instances, which are compiled with
+         different instruction set flags, are not merged by the linker. */
+
+      template<class D> inline D conv_saturate(float f);
+      template<> inline uint8_t conv_saturate<uint8_t>(float f){
+        int i = (int)f;
+        return i < 0 ? 0 : i > 255 ? 255 : (uint8_t)i;
+      }
+      template<> inline int16_t conv_saturate<int16_t>(float f){
+        int i = (int)f;
+        return i < -32768 ? -32768 : i > 32767 ? 32767 : (int16_t)i;
+      }
+      template<> inline float conv_saturate<float>(float f){
+        return f;
+      }
+
+      /// converts n source values to float
+      template<class V, class S>
+      inline void conv_convert_row(const S *s, float *d, int n){
+        int x=0;
+        for(;x<=n-V::N;x+=V::N){
+          V::store(d+x,V::convert(s+x));
+        }
+        for(;x<n;++x){
+          d[x] = (float)s[x];
+        }
+      }
+
+      /// converts the given source row into the ring buffer of kh rows
+      /** Each row is stored twice (at row%kh and row%kh+kh), so that the kh
+          latest rows can always be accessed with a constant stride */
+      template<class V, class S>
+      inline void conv_prepare_row(const S *src, int srcStep, int row, float *buffer, int rowLen, int kh){
+        float *r = buffer+(row%kh)*rowLen;
+        conv_convert_row<V>(src+row*srcStep,r,rowLen);
+        memcpy(r+kh*rowLen,r,rowLen*sizeof(float));
+      }
+
+      /// float rows are used directly
+      template<class V>
+      inline void conv_prepare_row(const float*, int, int, float*, int, int){}
+
+      /// returns the first of the kh source rows starting at row (stride is set to the row stride)
+      template<class S>
+      inline const float *conv_get_rows(const S*, int, int row, const float *buffer, int rowLen, int kh, int &stride){
+        stride = rowLen;
+        return buffer+(row%kh)*rowLen;
+      }
+
+      /// returns the source rows themselves
+      inline const float *conv_get_rows(const float *src, int srcStep, int row, const float*, int, int, int &stride){
+        stride = srcStep;
+        return src+row*srcStep;
+      }
+
+      /// 2D filter (each result row is computed from the kh latest converted source rows)
+      template<class V, class S, class D>
+      void conv_filter_2d(const S *src, int srcStep, D *dst, int dstStep, int width, int height,
+                          const float *k, int kw, int kh, float factor, float *buffer){
+        typedef typename V::F F;
+        const int N = V::N;
+        const int rowLen = width+kw-1;
+        const bool scale = factor != 1;
+        const F f = V::set1(factor);
+
+        for(int r=0;r<kh-1;++r){
+          conv_prepare_row<V>(src,srcStep,r,buffer,rowLen,kh);
+        }
+
+        for(int y=0;y<height;++y,dst+=dstStep){
+          conv_prepare_row<V>(src,srcStep,y+kh-1,buffer,rowLen,kh);
+          int stride = 0;
+          const float *rows = conv_get_rows(src,srcStep,y,buffer,rowLen,kh,stride);
+
+          int x=0;
+          for(;x<=width-2*N;x+=2*N){
+            F a = V::zero(), b = V::zero();
+            const float *m = k;
+            for(int r=0;r<kh;++r){
+              const float *row = rows+r*stride+x;
+              for(int c=0;c<kw;++c,++m){
+                const F v = V::set1(*m);
+                a = V::add(a,V::mul(v,V::load(row+c)));
+                b = V::add(b,V::mul(v,V::load(row+c+N)));
+              }
+            }
+            if(scale){
+              a = V::div(a,f);
+              b = V::div(b,f);
+            }
+            V::store_result(dst+x,a);
+            V::store_result(dst+x+N,b);
+          }
+          for(;x<=width-N;x+=N){
+            F a = V::zero();
+            const float *m = k;
+            for(int r=0;r<kh;++r){
+              const float *row = rows+r*stride+x;
+              for(int c=0;c<kw;++c,++m){
+                a = V::add(a,V::mul(V::set1(*m),V::load(row+c)));
+              }
+            }
+            if(scale) a = V::div(a,f);
+            V::store_result(dst+x,a);
+          }
+          for(;x<width;++x){
+            float a = 0;
+            const float *m = k;
+            for(int r=0;r<kh;++r){
+              const float *row = rows+r*stride+x;
+              for(int c=0;c<kw;++c,++m){
+                a += *m * row[c];
+              }
+            }
+            if(scale) a /= factor;
+            dst[x] = conv_saturate<D>(a);
+          }
+        }
+      }
+
+      /// returns the given source row converted into buf
+      template<class V, class S>
+      inline const float *conv_source_row(const S *src, int srcStep, int row, float *buf, int rowLen){
+        conv_convert_row<V>(src+row*srcStep,buf,rowLen);
+        return buf;
+      }
+
+      /// float rows are used directly
+      template<class V>
+      inline const float *conv_source_row(const float *src, int srcStep, int row, float*, int){
+        return src+row*srcStep;
+      }
+
+      /// applies the row filter kx on a converted source row
+      template<class V>
+      inline void conv_row_pass(const float *in, float *out, int width, const float *kx, int kw){
+        typedef typename V::F F;
+        const int N = V::N;
+        int x=0;
+        for(;x<=width-N;x+=N){
+          F a = V::zero();
+          for(int c=0;c<kw;++c){
+            a = V::add(a,V::mul(V::set1(kx[c]),V::load(in+x+c)));
+          }
+          V::store(out+x,a);
+        }
+        for(;x<width;++x){
+          float a = 0;
+          for(int c=0;c<kw;++c){
+            a += kx[c] * in[x+c];
+          }
+          out[x] = a;
+        }
+      }
+
+      /// separable filter (row pass into a ring buffer of kh rows followed by a column pass)
+      template<class V, class S, class D>
+      void conv_filter_separable(const S *src, int srcStep, D *dst, int dstStep, int width, int height,
+                                 const float *kx, int kw, const float *ky, int kh, float factor,
+                                 float *buffer){
+        typedef typename V::F F;
+        const int N = V::N;
+        const int rowLen = width+kw-1;
+        const bool scale = factor != 1;
+        const F f = V::set1(factor);
+        float *rows = buffer+rowLen;
+
+        for(int r=0;r<kh-1;++r){
+          conv_row_pass<V>(conv_source_row<V>(src,srcStep,r,buffer,rowLen),rows+r*width,width,kx,kw);
+        }
+        for(int y=0;y<height;++y,dst+=dstStep){
+          const int newest = y+kh-1;
+          conv_row_pass<V>(conv_source_row<V>(src,srcStep,newest,buffer,rowLen),
+                           rows+(newest%kh)*width,width,kx,kw);
+
+          // the ring buffer rows y..y+kh-1 start at row y%kh
+          const float *first = rows+(y%kh)*width, *end = rows+kh*width;
+          int x=0;
+          for(;x<=width-2*N;x+=2*N){
+            F a = V::zero(), b = V::zero();
+            const float *p = first;
+            for(int r=0;r<kh;++r){
+              const F k = V::set1(ky[r]);
+              a = V::add(a,V::mul(k,V::load(p+x)));
+              b = V::add(b,V::mul(k,V::load(p+x+N)));
+              if((p+=width) == end) p = rows;
+            }
+            if(scale){
+              a = V::div(a,f);
+              b = V::div(b,f);
+            }
+            V::store_result(dst+x,a);
+            V::store_result(dst+x+N,b);
+          }
+          for(;x<=width-N;x+=N){
+            F a = V::zero();
+            const float *p = first;
+            for(int r=0;r<kh;++r){
+              a = V::add(a,V::mul(V::set1(ky[r]),V::load(p+x)));
+              if((p+=width) == end) p = rows;
+            }
+            if(scale) a = V::div(a,f);
+            V::store_result(dst+x,a);
+          }
+          for(;x<width;++x){
+            float a = 0;
+            const float *p = first;
+            for(int r=0;r<kh;++r){
+              a += ky[r] * p[x];
+              if((p+=width) == end) p = rows;
+            }
+            if(scale) a /= factor;
+            dst[x] = conv_saturate<D>(a);
+          }
+        }
+      }
+
+      /// creates the function table for the given vector type
+      template<class V>
+      inline ConvolutionOpKernels create_convolution_op_kernels(const char *name){
+        ConvolutionOpKernels k = {
+          name,
+          conv_filter_2d<V,uint8_t,uint8_t>,
+          conv_filter_2d<V,uint8_t,int16_t>,
+          conv_filter_2d<V,int16_t,int16_t>,
+          conv_filter_2d<V,float,float>,
+          conv_filter_separable<V,uint8_t,uint8_t>,
+          conv_filter_separable<V,uint8_t,int16_t>,
+          conv_filter_separable<V,int16_t,int16_t>,
+          conv_filter_separable<V,float,float>
+        };
+        return k;
+      }
+    } // anonymous namespace
+
+  } // namespace filter
+}
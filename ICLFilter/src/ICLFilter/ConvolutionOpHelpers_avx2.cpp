@@ -0,0 +1,98 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLFilter/src/ICLFilter/ConvolutionOpHelpers_avx2.cpp  **
+** Module : ICLFilter                                              **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+// This file is compiled with AVX2 support (see ICL_AVX2_FLAGS). It must not
+// include any headers, that define non-template inline functions, which could
+// then be emitted with AVX2 instructions and picked by the linker elsewhere.
+#include <ICLFilter/ConvolutionOpHelpers.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#include <string.h>
+#endif
+
+namespace icl{
+  namespace filter{
+
+  #ifdef __AVX2__
+    namespace{
+      struct AVX2Vec{
+        typedef __m256 F;
+        enum { N = 8 };
+
+        static inline F zero() { return _mm256_setzero_ps(); }
+        static inline F set1(float f) { return _mm256_set1_ps(f); }
+        static inline F load(const float *p) { return _mm256_loadu_ps(p); }
+        static inline void store(float *p, F v) { _mm256_storeu_ps(p,v); }
+        static inline F add(F a, F b) { return _mm256_add_ps(a,b); }
+        static inline F mul(F a, F b) { return _mm256_mul_ps(a,b); }
+        static inline F div(F a, F b) { return _mm256_div_ps(a,b); }
+
+        static inline F convert(const uint8_t *p){
+          __m128i v = _mm_loadl_epi64((const __m128i*)p);
+          return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+        }
+        static inline F convert(const int16_t *p){
+          __m128i v = _mm_loadu_si128((const __m128i*)p);
+          return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v));
+        }
+        static inline F convert(const float *p){
+          return _mm256_loadu_ps(p);
+        }
+
+        static inline __m128i pack_16s(F v){
+          __m256i i = _mm256_cvttps_epi32(v);
+          return _mm_packs_epi32(_mm256_castsi256_si128(i),_mm256_extracti128_si256(i,1));
+        }
+        static inline void store_result(uint8_t *p, F v){
+          __m128i i = pack_16s(v);
+          _mm_storel_epi64((__m128i*)p,_mm_packus_epi16(i,i));
+        }
+        static inline void store_result(int16_t *p, F v){
+          _mm_storeu_si128((__m128i*)p,pack_16s(v));
+        }
+        static inline void store_result(float *p, F v){
+          _mm256_storeu_ps(p,v);
+        }
+      };
+    }
+
+    const ConvolutionOpKernels *get_convolution_op_kernels_avx2(){
+      static const ConvolutionOpKernels k = create_convolution_op_kernels<AVX2Vec>("avx2");
+      return &k;
+    }
+  #else
+    const ConvolutionOpKernels *get_convolution_op_kernels_avx2(){
+      return 0;
+    }
+  #endif
+
+  } // namespace filter
+}
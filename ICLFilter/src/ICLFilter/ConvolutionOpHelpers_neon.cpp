@@ -0,0 +1,102 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLFilter/src/ICLFilter/ConvolutionOpHelpers_neon.cpp  **
+** Module : ICLFilter                                              **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#include <ICLFilter/ConvolutionOpHelpers.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#include <string.h>
+#define ICL_CONVOLUTION_NEON
+#endif
+
+namespace icl{
+  namespace filter{
+
+  #ifdef ICL_CONVOLUTION_NEON
+    namespace{
+      struct NEONVec{
+        typedef float32x4_t F;
+        enum { N = 4 };
+
+        static inline F zero() { return vdupq_n_f32(0); }
+        static inline F set1(float f) { return vdupq_n_f32(f); }
+        static inline F load(const float *p) { return vld1q_f32(p); }
+        static inline void store(float *p, F v) { vst1q_f32(p,v); }
+        static inline F add(F a, F b) { return vaddq_f32(a,b); }
+        // vmlaq_f32 is not used, as it might be fused on some targets
+        static inline F mul(F a, F b) { return vmulq_f32(a,b); }
+        static inline F div(F a, F b) {
+          float fa[4], fb[4];
+          vst1q_f32(fa,a);
+          vst1q_f32(fb,b);
+          for(int i=0;i<4;++i) fa[i] /= fb[i];
+          return vld1q_f32(fa);
+        }
+
+        static inline F convert(const uint8_t *p){
+          uint32_t i;
+          memcpy(&i,p,4);
+          uint8x8_t v = vreinterpret_u8_u32(vdup_n_u32(i));
+          return vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(v))));
+        }
+        static inline F convert(const int16_t *p){
+          return vcvtq_f32_s32(vmovl_s16(vld1_s16(p)));
+        }
+        static inline F convert(const float *p){
+          return vld1q_f32(p);
+        }
+
+        static inline void store_result(uint8_t *p, F v){
+          int16x4_t s = vqmovn_s32(vcvtq_s32_f32(v));
+          uint8x8_t u = vqmovun_s16(vcombine_s16(s,s));
+          uint32_t r = vget_lane_u32(vreinterpret_u32_u8(u),0);
+          memcpy(p,&r,4);
+        }
+        static inline void store_result(int16_t *p, F v){
+          vst1_s16(p,vqmovn_s32(vcvtq_s32_f32(v)));
+        }
+        static inline void store_result(float *p, F v){
+          vst1q_f32(p,v);
+        }
+      };
+    }
+
+    const ConvolutionOpKernels *get_convolution_op_kernels_neon(){
+      static const ConvolutionOpKernels k = create_convolution_op_kernels<NEONVec>("neon");
+      return &k;
+    }
+  #else
+    const ConvolutionOpKernels *get_convolution_op_kernels_neon(){
+      return 0;
+    }
+  #endif
+
+  } // namespace filter
+}
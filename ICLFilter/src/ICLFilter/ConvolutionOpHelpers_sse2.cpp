@@ -0,0 +1,95 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLFilter/src/ICLFilter/ConvolutionOpHelpers_sse2.cpp  **
+** Module : ICLFilter                                              **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#include <ICLFilter/ConvolutionOpHelpers.h>
+#include <ICLUtils/SSETypes.h>
+#include <string.h>
+
+namespace icl{
+  namespace filter{
+
+  #ifdef ICL_HAVE_SSE2
+    namespace{
+      struct SSE2Vec{
+        typedef __m128 F;
+        enum { N = 4 };
+
+        static inline F zero() { return _mm_setzero_ps(); }
+        static inline F set1(float f) { return _mm_set1_ps(f); }
+        static inline F load(const float *p) { return _mm_loadu_ps(p); }
+        static inline void store(float *p, F v) { _mm_storeu_ps(p,v); }
+        static inline F add(F a, F b) { return _mm_add_ps(a,b); }
+        static inline F mul(F a, F b) { return _mm_mul_ps(a,b); }
+        static inline F div(F a, F b) { return _mm_div_ps(a,b); }
+
+        static inline F convert(const uint8_t *p){
+          int32_t i;
+          memcpy(&i,p,4);
+          const __m128i z = _mm_setzero_si128();
+          __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(i),z);
+          return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v,z));
+        }
+        static inline F convert(const int16_t *p){
+          __m128i v = _mm_loadl_epi64((const __m128i*)p);
+          return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v,v),16));
+        }
+        static inline F convert(const float *p){
+          return _mm_loadu_ps(p);
+        }
+
+        static inline void store_result(uint8_t *p, F v){
+          __m128i i = _mm_cvttps_epi32(v);
+          i = _mm_packs_epi32(i,i);
+          i = _mm_packus_epi16(i,i);
+          int32_t r = _mm_cvtsi128_si32(i);
+          memcpy(p,&r,4);
+        }
+        static inline void store_result(int16_t *p, F v){
+          __m128i i = _mm_cvttps_epi32(v);
+          _mm_storel_epi64((__m128i*)p,_mm_packs_epi32(i,i));
+        }
+        static inline void store_result(float *p, F v){
+          _mm_storeu_ps(p,v);
+        }
+      };
+    }
+
+    const ConvolutionOpKernels *get_convolution_op_kernels_sse2(){
+      static const ConvolutionOpKernels k = create_convolution_op_kernels<SSE2Vec>("sse2");
+      return &k;
+    }
+  #else
+    const ConvolutionOpKernels *get_convolution_op_kernels_sse2(){
+      return 0;
+    }
+  #endif
+
+  } // namespace filter
+}
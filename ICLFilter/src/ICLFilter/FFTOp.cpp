@@ -48,6 +48,7 @@ namespace icl{
       SizeAdaptionMode m_sam;
       bool m_fftshift;
       bool m_forceDFT;
+      int m_numThreads;
       ImgBase *m_adaptedSource;
       DynMatrix<std::complex<float> > m_buf32f;
       DynMatrix<std::complex<double> > m_buf64f;
@@ -55,7 +56,7 @@ namespace icl{
       DynMatrix<std::complex<double> > m_dstBuf64f;
 
       Data(ResultMode rm=LOG_POWER_SPECTRUM, SizeAdaptionMode sam=NO_SCALE,bool fftshift=true,bool forceDFT=false):
-        m_rm(rm),m_sam(sam), m_fftshift(fftshift),m_forceDFT(forceDFT),m_adaptedSource(0){}
+        m_rm(rm),m_sam(sam), m_fftshift(fftshift),m_forceDFT(forceDFT),m_numThreads(1),m_adaptedSource(0){}
       ~Data(){
         ICL_DELETE(m_adaptedSource);
       }
@@ -93,6 +94,14 @@ namespace icl{
       return m_data->m_fftshift;
     }
 
+    void FFTOp::setNumThreads(int numThreads){
+      m_data->m_numThreads = numThreads < 0 ? 1 : numThreads;
+    }
+
+    int FFTOp::getNumThreads() const{
+      return m_data->m_numThreads;
+    }
+
     FFTOp::FFTOp(ResultMode rm, SizeAdaptionMode zam, bool fftshift, bool forceDFT):
       m_data(new FFTOp::Data(rm, zam, fftshift, forceDFT)){}
 
@@ -221,7 +230,7 @@ namespace icl{
           dft2D(srcMat,dstBuf,buf);
         } else {
           FFTOp_DEBUG("compute fft on "<<lChannel);
-          fft2D(srcMat,dstBuf,buf);
+          fft2D(srcMat,dstBuf,buf,m_data->m_numThreads);
         }
         switch(m_data->m_rm){
           case TWO_CHANNEL_COMPLEX:{
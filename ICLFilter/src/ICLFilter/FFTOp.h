@@ -42,10 +42,12 @@ namespace icl{
 
   /**
    This class implements the unary operator for the fast and discrete 2D fourier transformation.
-    As known the fft can only be applied if the datasize is a power of 2.
-    This implementation uses the fft as far as it can be applied and switches to the dft,
-    so you can use it if datasize is not a power of 2 too. If MKL or IPP is available, FFTOp tries
-    to use it if possible.
+    The fallback implementation supports all datasizes: sizes whose prime factors are
+    2, 3, 5 and 7 are computed by a mixed-radix fft, all other sizes by Bluestein's
+    algorithm. The twiddle factors of each size are cached, so that repeated calls
+    do not allocate memory apart from the result buffers. Rows and columns can be
+    distributed to several threads (see setNumThreads). If MKL or IPP is available,
+    FFTOp tries to use it if possible.
 
     \section EXAMPLE Simple FFT-computation demo
 
@@ -113,6 +115,9 @@ namespace icl{
   	<TR><TD>MKL</TD><TD> 1 </TD><TD> 2 </TD><TD> 7 </TD><TD> 12 </TD><TD> 36 </TD><TD>26</TD><TD> 6 </TD><TD> 58 </TD></TR>
   	<TR><TD>FB</TD><TD> 214 </TD><TD> 440 </TD><TD> 896 </TD><TD> 5509 </TD><TD> 1395 </TD><TD> 11064 </TD><TD> 438 </TD><TD> 1915 </TD></TR>
   	</TABLE>
+  	The FB row was measured with the former recursive fallback. The plan based
+  	fallback needs about 20ms for VGA and 16ms for 512x512 on a single core of a
+  	current CPU.
     */
   class ICLFilter_API FFTOp : public UnaryOp{
 
@@ -215,6 +220,14 @@ namespace icl{
   	/**@return true if destinationimage  is to be fftshifted, else false*/
   	bool getFFTShift();
 
+  	///Sets the number of threads used by the fallback fft
+  	/**@param numThreads 1 (default): calling thread only, 0: all threads of the
+                     global ThreadPool (see icl::math::fft::fft2D_cpp)*/
+  	void setNumThreads(int numThreads);
+
+  	///Returns the number of threads used by the fallback fft
+  	int getNumThreads() const;
+
   	///Call this method to start fftcomputation.
   	/**Applies FFTOp on src and dst.
   	  @param *src pointer to sourceimage
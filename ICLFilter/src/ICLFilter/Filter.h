@@ -55,6 +55,7 @@
     - Wiener filer (see icl::filter::WienerOp)
     - Local threshold operations (see icl::filter::LocalThresholdOp)
     - Image proximity measurement (see icl::filter::ProximityOp)
+    - Fused per-pixel expressions (see icl::filter::PixelExpression)
     </td></tr></table>
 
     When talking about <em>image filters</em> some misapprehensions can arise. To prevent this, the following section
@@ -48,13 +48,14 @@ namespace icl{
       bool m_join;
       bool m_ifftshift;
       bool m_forceIDFT;
+      int m_numThreads;
       ImgBase *m_adaptedSource;
       DynMatrix<std::complex<float> > m_buf32f;
       DynMatrix<std::complex<double> > m_buf64f;
       DynMatrix<std::complex<float> > m_dstBuf32f;
       DynMatrix<std::complex<double> > m_dstBuf64f;
       Data(ResultMode rm, SizeAdaptionMode sam, Rect roi,bool join, bool ifftshift, bool forceIDFT):
-        m_rm(rm),m_sam(sam),m_roi(roi),m_join(join),m_ifftshift(ifftshift),m_forceIDFT(forceIDFT),m_adaptedSource(0){}
+        m_rm(rm),m_sam(sam),m_roi(roi),m_join(join),m_ifftshift(ifftshift),m_forceIDFT(forceIDFT),m_numThreads(1),m_adaptedSource(0){}
       ~Data(){
         ICL_DELETE(m_adaptedSource);
       }
@@ -88,6 +89,14 @@ namespace icl{
       return m_data->m_forceIDFT;
     }
 
+    void IFFTOp::setNumThreads(int numThreads){
+      m_data->m_numThreads = numThreads < 0 ? 1 : numThreads;
+    }
+
+    int IFFTOp::getNumThreads() const{
+      return m_data->m_numThreads;
+    }
+
     void IFFTOp::setJoinMatrix(bool pJoin){
       m_data->m_join = pJoin;
     }
@@ -239,9 +248,9 @@ namespace icl{
           }
         } else {
           if(m_data->m_join){
-            ifft2D(joinMat,dstBuf,buf);
+            ifft2D(joinMat,dstBuf,buf,m_data->m_numThreads);
           }else {
-            ifft2D(srcMat,dstBuf,buf);
+            ifft2D(srcMat,dstBuf,buf,m_data->m_numThreads);
           }
         }
         switch(m_data->m_rm){
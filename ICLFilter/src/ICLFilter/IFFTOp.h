@@ -42,10 +42,9 @@
 namespace icl{
   namespace filter{
     /// This class implements the unary operator for the inverse fast and discrete 2D fourier transformation.
-    /** As known the ifft can only be applied if the datasize is a power of 2.
-        This implementation uses the ifft as far as it can be applied and switches to the idft,
-        so you can use it if datasize is not a power of 2 too. If MKL or IPP is available, IFFTOp tries
-        to use it if possible.*/
+    /** The fallback implementation supports all datasizes (see FFTOp). Rows and
+        columns can be distributed to several threads (see setNumThreads). If MKL
+        or IPP is available, IFFTOp tries to use it if possible.*/
     class ICLFilter_API IFFTOp : public UnaryOp{
 
       private:
@@ -153,6 +152,14 @@ namespace icl{
       /**@param pForceDFT*/
       void setForceIDFT(bool pForceDFT);
 
+      ///Sets the number of threads used by the fallback ifft
+      /**@param numThreads 1 (default): calling thread only, 0: all threads of the
+                        global ThreadPool (see icl::math::fft::ifft2D_cpp)*/
+      void setNumThreads(int numThreads);
+
+      ///Returns the number of threads used by the fallback ifft
+      int getNumThreads() const;
+
       ///Call this method to start ifftcomputation.
       /**Applies IFFTOp on src and dst.
   	  @param *src pointer to sourceimage
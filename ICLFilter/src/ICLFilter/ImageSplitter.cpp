@@ -41,8 +41,7 @@ namespace icl{
     //n=4   10     20     30    40    50
     //
 
-    void ImageSplitter::splitImage(ImgBase *src, std::vector<ImgBase*> &parts){
-      Rect r = src->getROI();
+    void ImageSplitter::splitImage(ImgBase *src, const Rect &r, std::vector<ImgBase*> &parts){
       int n = (int)parts.size();
       ICLASSERT_RETURN(n);
       ICLASSERT_RETURN(r.getDim());
@@ -53,7 +52,7 @@ namespace icl{
         int yStart = r.y+(int)round(dh*i);
         int yEnd = r.y+(int)round(dh*(i+1));
         int dy = yEnd - yStart;
-        parts[i] = src->shallowCopy(Rect(r.x,yStart,r.width,dy));
+        parts[i] = src->shallowCopy(Rect(r.x,yStart,r.width,dy),&parts[i]);
       }
     }
 
@@ -61,10 +60,14 @@ namespace icl{
 
     std::vector<ImgBase*> ImageSplitter::split(ImgBase *src, int nParts){
       std::vector<ImgBase*> v(nParts,(ImgBase*)0);
-      splitImage(src,v);
+      splitImage(src,src->getROI(),v);
       return v;
     }
 
+    void ImageSplitter::split(const ImgBase *src, const Rect &roi, std::vector<ImgBase*> &parts){
+      splitImage(const_cast<ImgBase*>(src),roi,parts);
+    }
+
     const std::vector<ImgBase*> ImageSplitter::split(const ImgBase *src, int nParts){
       ImgBase *srcX = const_cast<ImgBase*>(src);
       std::vector<ImgBase*> v= split(srcX,nParts);
@@ -65,6 +65,14 @@ namespace icl{
       /// splits a const source image into a given number of const parts
       static const std::vector<core::ImgBase*> split(const core::ImgBase *src, int nParts);
 
+      /// splits the given ROI of src into parts.size() parts
+      /** In contrast to the other split functions, the given parts are reused.
+          Only null-entries are newly allocated, so calling this function
+          repeatedly with the same parts vector does not allocate memory.
+          The resulting images must be released using release(). */
+      static void split(const core::ImgBase *src, const utils::Rect &roi,
+                        std::vector<core::ImgBase*> &parts);
+
       /// releases all images within the given vector
       static void release(const std::vector<core::ImgBase*> &v);
 
@@ -72,10 +80,11 @@ namespace icl{
       /// private constructor
       ImageSplitter(){}
       /// internally used static splitting function
-      /** Note: the resulting images must be deleted manually <b>and</b>
-          the given parts vector must be given, initalized with NULL pointers.
+      /** Note: the resulting images must be deleted manually. Non-null
+          entries of the given parts vector are reused.
       **/
-      static void splitImage(core::ImgBase *src, std::vector<core::ImgBase*> &parts);
+      static void splitImage(core::ImgBase *src, const utils::Rect &r,
+                             std::vector<core::ImgBase*> &parts);
     };
   } // namespace filter
 }
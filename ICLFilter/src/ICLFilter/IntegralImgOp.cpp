@@ -29,6 +29,9 @@
 ********************************************************************/
 
 #include <ICLFilter/IntegralImgOp.h>
+#include <ICLUtils/ThreadPool.h>
+#include <ICLUtils/SSETypes.h>
+#include <algorithm>
 
 using namespace icl::utils;
 using namespace icl::core;
@@ -39,14 +42,14 @@ namespace icl{
 
     IntegralImgOp::IntegralImgOp(depth d):
       // {{{ open
-      m_integralImageDepth(d),m_buf(0){
+      m_integralImageDepth(d),m_sqrBuf(0),m_squaredSums(false),m_numThreads(1){
     }
 
     // }}}
 
     IntegralImgOp::~IntegralImgOp(){
       // {{{ open
-      ICL_DELETE(m_buf);
+      ICL_DELETE(m_sqrBuf);
     }
     // }}}
 
@@ -65,122 +68,189 @@ namespace icl{
 
     // }}}
 
-
-    template<class S,class  D>
-    static void create_integral_channel_cpp(const S *image,int w, int h, D *intImage){
+    void IntegralImgOp::setSquaredSums(bool on){
       // {{{ open
-      /* algorithm:
-          +++++..
-          +++CA..
-          +++BX..
-          .......
-          X = src(x) + A + B - C
-      */
-
-      const S *src = image;
-      D *dst = intImage;
+      m_squaredSums = on;
+      if(!on) ICL_DELETE(m_sqrBuf);
+    }
 
-      // first pixel
-      *dst++ = D(*src++);
+    // }}}
 
-      // first row
-      for(const S *srcEnd=src+w-1;src<srcEnd;++src,++dst){
-        *dst = D(*src) + *(dst-1);
-      }
+    const ImgBase *IntegralImgOp::getSquaredSumImage() const{
+      // {{{ open
+      return m_squaredSums ? m_sqrBuf : 0;
+    }
 
+    // }}}
 
-      // rest of the image up to last row
-      for(int y=1;y<h;++y){
-        const S *s = image+y*w;
-        const S * const sEnd = s+w;
-        D *d = intImage+y*w;
-        D *dl = d-w;
+    void IntegralImgOp::setNumThreads(int numThreads){
+      // {{{ open
+      m_numThreads = numThreads < 0 ? 1 : numThreads;
+    }
 
-        // first pix in row
-        *d = *dl + *s;
-        ++s;
-        ++d;
-        ++dl;
+    // }}}
 
-  #define STEP *d =  -*(dl-1) + *dl + *(d-1) + D(*s);  ++s; ++d; ++dl;
 
-        // we use 16x loop-unrolling here. This is about 5% faster then 8x
-        for(int n = ((int)(sEnd - s)) >> 4; n>0; --n){
-          STEP STEP STEP STEP STEP STEP STEP STEP
-          STEP STEP STEP STEP STEP STEP STEP STEP
-        }
-        while(s < sEnd){ STEP; }
-  #undef STEP
+    /// adds the row a to the row b (used for the column accumulation)
+    template<class D>
+    static inline void add_rows(const D *a, D *b, int n){
+      for(int i=0;i<n;++i) b[i] += a[i];
+    }
 
+  #ifdef ICL_HAVE_SSE2
+    template<> inline void add_rows(const icl32s *a, icl32s *b, int n){
+      int i=0;
+      for(;i<=n-4;i+=4){
+        _mm_storeu_si128((__m128i*)(b+i),_mm_add_epi32(_mm_loadu_si128((const __m128i*)(a+i)),
+                                                        _mm_loadu_si128((const __m128i*)(b+i))));
       }
+      for(;i<n;++i) b[i] += a[i];
+    }
+    template<> inline void add_rows(const icl32f *a, icl32f *b, int n){
+      int i=0;
+      for(;i<=n-4;i+=4) _mm_storeu_ps(b+i,_mm_add_ps(_mm_loadu_ps(a+i),_mm_loadu_ps(b+i)));
+      for(;i<n;++i) b[i] += a[i];
     }
+    template<> inline void add_rows(const icl64f *a, icl64f *b, int n){
+      int i=0;
+      for(;i<=n-2;i+=2) _mm_storeu_pd(b+i,_mm_add_pd(_mm_loadu_pd(a+i),_mm_loadu_pd(b+i)));
+      for(;i<n;++i) b[i] += a[i];
+    }
+  #endif
 
-    // }}}
+    /// replaces the n values of the row d by their prefix sums
+    template<class D>
+    static inline void prefix_sum(D *d, int n){
+      for(int i=1;i<n;++i) d[i] += d[i-1];
+    }
 
-    template<class S, class D>
-    static void create_integral_image_sd(const Img<S> &src, Img<D> &dst, ImgBase**){
-      // {{{ open
-      for(int c=src.getChannels()-1;c>=0;--c){
-        create_integral_channel_cpp(src.begin(c), src.getWidth(), src.getHeight(), dst.begin(c));
+  #ifdef ICL_HAVE_SSE2
+    /* the vectorized prefix sums add the vector shifted by one and by two
+       elements (which yields the prefix sums within the vector) and the
+       last sum of the previous vector, which is broadcasted to all elements */
+    template<> inline void prefix_sum(icl32s *d, int n){
+      __m128i carry = _mm_setzero_si128();
+      int i=0;
+      for(;i<=n-4;i+=4){
+        __m128i x = _mm_loadu_si128((const __m128i*)(d+i));
+        x = _mm_add_epi32(x,_mm_slli_si128(x,4));
+        x = _mm_add_epi32(x,_mm_slli_si128(x,8));
+        x = _mm_add_epi32(x,carry);
+        _mm_storeu_si128((__m128i*)(d+i),x);
+        carry = _mm_shuffle_epi32(x,0xFF);
       }
+      for(i=std::max(i,1);i<n;++i) d[i] += d[i-1];
     }
-    // }}}
-
-  #ifdef ICL_HAVE_IPP_DEACTIVATED_BECAUSE_IT_IS_MUCH_SLOWER
-
-    template<class S, class D, class B, class IPP_FUNC>
-    void create_integral_image_ipp(const Img<S> &src, Img<D> &dst, ImgBase **buf,  IPP_FUNC ippfunc){
-      // {{{ open
-
-      ensureCompatible(buf,getDepth<B>(), src.getSize()+Size(1,1), 1, formatMatrix, Rect::null);
-      Img<B> &dbuf = *(*buf)->asImg<B>();
+    template<> inline void prefix_sum(icl32f *d, int n){
+      __m128 carry = _mm_setzero_ps();
+      int i=0;
+      for(;i<=n-4;i+=4){
+        __m128 x = _mm_loadu_ps(d+i);
+        x = _mm_add_ps(x,_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x),4)));
+        x = _mm_add_ps(x,_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x),8)));
+        x = _mm_add_ps(x,carry);
+        _mm_storeu_ps(d+i,x);
+        carry = _mm_shuffle_ps(x,x,0xFF);
+      }
+      for(i=std::max(i,1);i<n;++i) d[i] += d[i-1];
+    }
+    template<> inline void prefix_sum(icl64f *d, int n){
+      __m128d carry = _mm_setzero_pd();
+      int i=0;
+      for(;i<=n-2;i+=2){
+        __m128d x = _mm_loadu_pd(d+i);
+        x = _mm_add_pd(x,_mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(x),8)));
+        x = _mm_add_pd(x,carry);
+        _mm_storeu_pd(d+i,x);
+        carry = _mm_unpackhi_pd(x,x);
+      }
+      for(i=std::max(i,1);i<n;++i) d[i] += d[i-1];
+    }
+  #endif
 
-      for(int c=src.getChannels()-1;c>=0;--c){
-        IppStatus s = ippfunc(src.begin(c),src.getLineStep(),dbuf.begin(0),dbuf.getLineStep(), src.getSize(), 0);
-        if(s != ippStsNoErr) throw ICLException("error in ippiIntegral_8u32s_C1R in " +std::string(__FUNCTION__) + ":" +std::string(ippGetStatusString(s)));
-        dbuf.setROI(Rect(Point(1,1),src.getSize()));
-        TODO_LOG("this does not work in case of N>1 channel-images!!");
-        if(dst.getDepth() == dbuf.getDepth()){ // i really wonder why this lasts 2 msec??
-          dbuf.deepCopyROI(bpp(dst));
-        }else{
-          dbuf.convertROI(&dst);
+    /// first pass: prefix sums of the rows [begin,end) (and of their squares)
+    template<class S, class D>
+    struct IntegralRows{
+      const S *src;
+      D *dst;
+      icl64f *sqrDst;
+      int w;
+
+      void operator()(int begin, int end) const{
+        for(int y=begin;y<end;++y){
+          const S *s = src+(size_t)y*w;
+          D *d = dst+(size_t)y*w;
+          for(int x=0;x<w;++x) d[x] = D(s[x]);
+          prefix_sum(d,w);
+          if(sqrDst){
+            icl64f *q = sqrDst+(size_t)y*w;
+            for(int x=0;x<w;++x) q[x] = icl64f(s[x])*icl64f(s[x]);
+            prefix_sum(q,w);
+          }
         }
-        dbuf.setFullROI();
       }
-    }
+    };
 
-    // }}}
+    /// second pass: accumulates the rows within the column strips [begin,end)
+    template<class D>
+    struct IntegralColumns{
+      D *dst;
+      icl64f *sqrDst;
+      int w, h, stripWidth;
+
+      void operator()(int begin, int end) const{
+        const int x0 = begin*stripWidth, n = std::min(end*stripWidth,w) - x0;
+        for(int y=1;y<h;++y){
+          add_rows(dst+(size_t)(y-1)*w+x0,dst+(size_t)y*w+x0,n);
+          if(sqrDst) add_rows(sqrDst+(size_t)(y-1)*w+x0,sqrDst+(size_t)y*w+x0,n);
+        }
+      }
+    };
 
-    template<> void create_integral_image_sd<icl8u,icl32s>(const Img<icl8u> &src, Img<icl32s> &dst, ImgBase **buf){
+    template<class S, class D>
+    void IntegralImgOp::create_channel(const S *src, int w, int h, D *dst, icl64f *sqrDst, int numThreads){
       // {{{ open
+      /* algorithm:
+          the rows are integrated independently (using vectorized prefix sums),
+          then each row is added to the one below, which processes whole rows
+          at once and is therefore vectorized as well. The rows are distributed
+          to the threads in the first pass, vertical strips of columns in the
+          second one.
+      */
+      if(w <= 0 || h <= 0) return;
+      IntegralRows<S,D> rows = { src, dst, sqrDst, w };
+      parallel_for(0,h,rows,0,numThreads);
 
-      create_integral_image_ipp<icl8u,icl32s,icl32s>(src,dst, buf, ippiIntegral_8u32s_C1R);
+      static const int STRIP_WIDTH = 256;
+      IntegralColumns<D> cols = { dst, sqrDst, w, h, STRIP_WIDTH };
+      parallel_for(0,(w+STRIP_WIDTH-1)/STRIP_WIDTH,cols,0,numThreads);
     }
 
     // }}}
-    template<> void create_integral_image_sd<icl8u,icl32f>(const Img<icl8u> &src, Img<icl32f> &dst, ImgBase **buf){
-      // {{{ open
 
-      create_integral_image_ipp<icl8u,icl32f,icl32f>(src,dst, buf, ippiIntegral_8u32f_C1R);
-    }
+  #define ICL_INSTANTIATE_DEPTH(S)                                         \
+    template ICLFilter_API void IntegralImgOp::create_channel<icl##S,icl32s>(const icl##S*,int,int,icl32s*,icl64f*,int); \
+    template ICLFilter_API void IntegralImgOp::create_channel<icl##S,icl32f>(const icl##S*,int,int,icl32f*,icl64f*,int); \
+    template ICLFilter_API void IntegralImgOp::create_channel<icl##S,icl64f>(const icl##S*,int,int,icl64f*,icl64f*,int);
+    ICL_INSTANTIATE_ALL_DEPTHS
+  #undef ICL_INSTANTIATE_DEPTH
 
-    // }}}
-    template<> void create_integral_image_sd<icl8u,icl64f>(const Img<icl8u> &src, Img<icl64f> &dst, ImgBase **buf){
+    template<class S, class D>
+    static void create_integral_image_sd(const Img<S> &src, Img<D> &dst, Img64f *sqrDst, int numThreads){
       // {{{ open
-
-      create_integral_image_ipp<icl8u,icl64f,icl32f>(src,dst, buf, ippiIntegral_8u32f_C1R);
+      for(int c=src.getChannels()-1;c>=0;--c){
+        IntegralImgOp::create_channel(src.begin(c), src.getWidth(), src.getHeight(), dst.begin(c),
+                                      sqrDst ? sqrDst->begin(c) : (icl64f*)0, numThreads);
+      }
     }
-
     // }}}
 
-  #endif
-
     template<class D>
-    static void create_integral_image_xd(const ImgBase *src, Img<D> &dst, ImgBase **buf){
+    static void create_integral_image_xd(const ImgBase *src, Img<D> &dst, ImgBase *sqrDst, int numThreads){
       // {{{ open
-
+      Img64f *sqr = sqrDst ? sqrDst->asImg<icl64f>() : 0;
       switch(src->getDepth()){
-  #define ICL_INSTANTIATE_DEPTH(D) case depth##D: create_integral_image_sd(*src->asImg<icl##D>(), dst, buf) ; break;
+  #define ICL_INSTANTIATE_DEPTH(D) case depth##D: create_integral_image_sd(*src->asImg<icl##D>(), dst, sqr, numThreads) ; break;
         ICL_INSTANTIATE_ALL_DEPTHS
   #undef ICL_INSTANTIATE_DEPTH
       }
@@ -193,7 +263,7 @@ namespace icl{
       // {{{ open
 
       ICLASSERT_RETURN( poSrc );
-      ICLASSERT_RETURN( poSrc );
+      ICLASSERT_RETURN( ppoDst );
       ICLASSERT_RETURN( poSrc != *ppoDst );
 
       if(!prepare(ppoDst,  m_integralImageDepth, poSrc->getSize(),
@@ -202,15 +272,22 @@ namespace icl{
         return;
       }
 
+      ImgBase *sqr = 0;
+      if(m_squaredSums){
+        // squared sums exceed the range of 32s (and the precision of 32f) already for small images
+        ensureCompatible(&m_sqrBuf, depth64f, poSrc->getSize(), poSrc->getChannels(), formatMatrix);
+        sqr = m_sqrBuf;
+      }
+
       switch(m_integralImageDepth){
         case depth32s:
-          create_integral_image_xd(poSrc, *(*ppoDst)->asImg<icl32s>(), &m_buf);
+          create_integral_image_xd(poSrc, *(*ppoDst)->asImg<icl32s>(), sqr, m_numThreads);
           break;
         case depth32f:
-          create_integral_image_xd(poSrc, *(*ppoDst)->asImg<icl32f>(), &m_buf);
+          create_integral_image_xd(poSrc, *(*ppoDst)->asImg<icl32f>(), sqr, m_numThreads);
           break;
         case depth64f:
-          create_integral_image_xd(poSrc, *(*ppoDst)->asImg<icl64f>(), &m_buf);
+          create_integral_image_xd(poSrc, *(*ppoDst)->asImg<icl64f>(), sqr, m_numThreads);
           break;
         default:
           ERROR_LOG("integral image destination depth must be 32s, 32f, or 64f");
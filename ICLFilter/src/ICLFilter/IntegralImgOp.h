@@ -83,6 +83,21 @@ namespace icl{
     We support all source image depth, the integral image always needs a large value domain,
     so here, only icl32s, icl32f and icl64f are supported.
 
+    <h1>Squared Sums</h1>
+    If setSquaredSums(true) was called, apply also creates an integral image of the
+    squared source values (see getSquaredSumImage), which allows to compute the
+    variance of arbitrary rectangular image regions in constant time. This image
+    has always depth64f, because squared sums exceed the range of icl32s
+    already for small images.
+
+    <h1>Multi-Threading</h1>
+    The integral image is computed in two passes: each row is integrated
+    independently, then each row is added to the row below. Both passes are
+    SSE2 vectorized (prefix sums within vectors in the first one, whole rows
+    in the second one). The rows (first pass) and
+    vertical strips of columns (second pass) can be distributed to several threads
+    (see setNumThreads).
+
     <h1>Performance</h1>
     The calculation is very fast and we come close to the IPP performace.
     - Benchmark plattworm: Intel Core2Duo with 2GHz, 2GB Ram (single core-performance)
@@ -116,6 +131,34 @@ namespace icl{
       */
       core::depth getIntegralImageDepth() const;
 
+      /// enables the additional integral image of squared source values
+      void setSquaredSums(bool on);
+
+      /// returns whether squared sums are computed as well
+      bool getSquaredSums() const { return m_squaredSums; }
+
+      /// returns the integral image of squared values of the last apply call
+      /** The image has depth64f. Returns 0 if squared sums are not enabled */
+      const core::ImgBase *getSquaredSumImage() const;
+
+      /// sets the number of threads used (1: calling thread only (default), 0: all threads)
+      void setNumThreads(int numThreads);
+
+      /// returns the number of threads used
+      int getNumThreads() const { return m_numThreads; }
+
+      /// computes the integral image of a single channel
+      /** This is the engine used by apply. It can be used directly by other
+          operators that need box sums of an image.
+          @param src source channel data of size w x h
+          @param dst destination integral image (w x h)
+          @param sqrDst optional destination for the integral image of squared values (w x h)
+          @param numThreads number of threads used (see setNumThreads)
+          Instantiated for all source depths and icl32s, icl32f and icl64f
+          destinations */
+      template<class S, class D>
+      static void create_channel(const S *src, int w, int h, D *dst, icl64f *sqrDst=0, int numThreads=1);
+
       /// applies the integralimage Operaor
       /** @param src The source image
         @param dst Pointer to the destination image
@@ -127,7 +170,9 @@ namespace icl{
 
       private:
       core::depth m_integralImageDepth; //!< destination depth
-      core::ImgBase *m_buf; //!< used only if IPP is available
+      core::ImgBase *m_sqrBuf; //!< integral image of squared values
+      bool m_squaredSums; //!< whether m_sqrBuf is computed
+      int m_numThreads; //!< number of threads used
     };
   } // namespace filter
 }
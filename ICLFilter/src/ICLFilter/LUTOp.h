@@ -65,6 +65,11 @@ namespace icl {
         \section SEC5 IPP
         Yet, only the reduceBits function and therewith the according LUT-objects
         mode with given count of quantization levels is IPP optimized.
+
+        \section SEC6 Fused Lookups
+        Lookups of computed values, or lookups followed by further per-pixel
+        operations, can be processed in a single pass by lut() within a
+        PixelExpression.
     */
     class ICLFilter_API LUTOp : public UnaryOp, public utils::Uncopyable{
      public:
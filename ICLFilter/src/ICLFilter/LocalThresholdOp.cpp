@@ -29,13 +29,13 @@
 ********************************************************************/
 
 #include <ICLFilter/LocalThresholdOp.h>
-#include <ICLFilter/BinaryCompareOp.h>
 #include <ICLUtils/Size.h>
 #include <ICLUtils/Macros.h>
 #include <ICLUtils/StackTimer.h>
 #include <ICLFilter/IntegralImgOp.h>
 #include <ICLUtils/StringUtils.h>
 #include <ICLUtils/Time.h>
+#include <ICLUtils/ThreadPool.h>
 #include <ICLFilter/LocalThresholdOpHelpers.h>
 #include <ICLFilter/UnaryCompareOp.h>
 
@@ -77,8 +77,7 @@ namespace icl{
       // {{{ open
       m_roiBufSrc(0), m_roiBufDst(0),
       m_iiOp(new IntegralImgOp),
-      m_cmp(new BinaryCompareOp(BinaryCompareOp::gt)),
-      m_tiledBuf1(0),m_tiledBuf2(0){
+      m_tiledBuf1(0),m_numThreads(1){
 
       /*
           - mask size (range:spinbox)
@@ -100,14 +99,14 @@ namespace icl{
       // {{{ open
       m_roiBufSrc(0), m_roiBufDst(0),
       m_iiOp(new IntegralImgOp),
-      m_cmp(new BinaryCompareOp(BinaryCompareOp::gt)),
-      m_tiledBuf1(0),m_tiledBuf2(0){
+      m_tiledBuf1(0),m_numThreads(1){
 
       addProperty("mask size","range:slider","[1,100]",str(maskSize));
       addProperty("global threshold","range:slider","[-255,255]",str(globalThreshold));
       addProperty("gamma slope","range:slider","[-10,10]",str(gammaSlope));
       addProperty("algorithm","menu","region mean,tiled linear,tiled NN,gobal",a==regionMean?"region mean":a==tiledNN?"tiled NN":"tiled linear");
       addProperty("actually used mask size","info","","0");
+      addProperty("invert output","flag","",false);
     }
     // }}}
 
@@ -117,9 +116,7 @@ namespace icl{
 
       ICL_DELETE(m_roiBufDst);
       ICL_DELETE(m_iiOp);
-      ICL_DELETE(m_cmp);
       ICL_DELETE(m_tiledBuf1);
-      ICL_DELETE(m_tiledBuf2);
     }
 
     // }}}
@@ -203,94 +200,78 @@ namespace icl{
 
 
 
+    /// applies fast_lt to the rows [begin,end) of one channel
+    template<class S, class I, class D, bool WITH_GAMMA>
+    struct LocalThresholdRows{
+      const S *src;
+      const I *ii;
+      D *dst;
+      int w, h, m;
+      typename ThreshType<S>::T t;
+      float gs;
+
+      void operator()(int begin, int end) const{
+        fast_lt<S,I,D,typename ThreshType<S>::T,WITH_GAMMA>(src,ii,dst,w,h,m,t,gs,begin,end);
+      }
+    };
+
+    template<class S, class I, class D, bool WITH_GAMMA>
+    static void apply_local_threshold_rows(const Img<S> &src, const Img<I> &ii, Img<D> &dst,
+                                           typename ThreshType<S>::T t, int m, float gs, int numThreads){
+      // {{{ open
+      const int w = src.getWidth(), h = src.getHeight();
+      for(int c=0;c<src.getChannels();++c){
+        LocalThresholdRows<S,I,D,WITH_GAMMA> rows = { src.begin(c), ii.begin(c), dst.begin(c), w, h, m, t, gs };
+        parallel_for(0,h,rows,0,numThreads);
+      }
+    }
+
+    // }}}
+
     /// this template resolves the destination images depths and if a gamma slope is set or not
     template<class S, class I>
-    void apply_local_threshold_six(const Img<S> &src,const Img<I> &ii, ImgBase *dst, float tf, int m, float gs){
+    void apply_local_threshold_six(const Img<S> &src,const Img<I> &ii, ImgBase *dst, float tf, int m, float gs,
+                                   int numThreads){
       // {{{ open
       typename ThreshType<S>::T t = (typename ThreshType<S>::T)(tf);
-      int w = src.getWidth(), h = src.getHeight();
-      const S *psrc = src.begin(0);
-      const I *pii = ii.begin(0);
       switch(dst->getDepth()){
-        case depth8u:
-          if(gs!=0.0f){
-            for(int c=0;c<src.getChannels();++c){
-              fast_lt<S,I,icl8u,typename ThreshType<S>::T,true>(psrc,pii,dst->asImg<icl8u>()->begin(0),w,h,m,t,gs,c);
-            }
-          }else{
-            for(int c=0;c<src.getChannels();++c){
-              fast_lt<S,I,icl8u,typename ThreshType<S>::T,false>(psrc,pii,dst->asImg<icl8u>()->begin(0),w,h,m,t,gs,c);
-            }
-          }
-          break;
-        case depth16s:
-          if(gs!=0.0f){
-            for(int c=0;c<src.getChannels();++c){
-              fast_lt<S,I,icl16s,typename ThreshType<S>::T,true>(psrc,pii,dst->asImg<icl16s>()->begin(0),w,h,m,t,gs,c);
-            }
-          }else{
-            for(int c=0;c<src.getChannels();++c){
-              fast_lt<S,I,icl16s,typename ThreshType<S>::T,false>(psrc,pii,dst->asImg<icl16s>()->begin(0),w,h,m,t,gs,c);
-            }
-          }
-          break;
-        case depth32s:
-          if(gs!=0.0f){
-            for(int c=0;c<src.getChannels();++c){
-              fast_lt<S,I,icl32s,typename ThreshType<S>::T,true>(psrc,pii,dst->asImg<icl32s>()->begin(0),w,h,m,t,gs,c);
-            }
-          }else{
-            for(int c=0;c<src.getChannels();++c){
-              fast_lt<S,I,icl32s,typename ThreshType<S>::T,false>(psrc,pii,dst->asImg<icl32s>()->begin(0),w,h,m,t,gs,c);
-            }
-          }
-          break;
-        case depth32f:
-          if(gs!=0.0f){
-            for(int c=0;c<src.getChannels();++c){
-              fast_lt<S,I,icl32f,typename ThreshType<S>::T,true>(psrc,pii,dst->asImg<icl32f>()->begin(0),w,h,m,t,gs,c);
-            }
-          }else{
-            for(int c=0;c<src.getChannels();++c){
-              fast_lt<S,I,icl32f,typename ThreshType<S>::T,false>(psrc,pii,dst->asImg<icl32f>()->begin(0),w,h,m,t,gs,c);
-            }
-          }
-          break;
-        case depth64f:
-          if(gs!=0.0f){
-            for(int c=0;c<src.getChannels();++c){
-              fast_lt<S,I,icl64f,typename ThreshType<S>::T,true>(psrc,pii,dst->asImg<icl64f>()->begin(0),w,h,m,t,gs,c);
-            }
-          }else{
-            for(int c=0;c<src.getChannels();++c){
-              fast_lt<S,I,icl64f,typename ThreshType<S>::T,false>(psrc,pii,dst->asImg<icl64f>()->begin(0),w,h,m,t,gs,c);
-            }
-          }
+#define ICL_INSTANTIATE_DEPTH(D)                                        \
+        case depth##D:                                                  \
+          if(gs!=0.0f){                                                 \
+            apply_local_threshold_rows<S,I,icl##D,true>(src,ii,*dst->asImg<icl##D>(),t,m,gs,numThreads); \
+          }else{                                                        \
+            apply_local_threshold_rows<S,I,icl##D,false>(src,ii,*dst->asImg<icl##D>(),t,m,gs,numThreads); \
+          }                                                             \
           break;
+        ICL_INSTANTIATE_DEPTH(8u)
+        ICL_INSTANTIATE_DEPTH(16s)
+        ICL_INSTANTIATE_DEPTH(32s)
+        ICL_INSTANTIATE_DEPTH(32f)
+        ICL_INSTANTIATE_DEPTH(64f)
+#undef ICL_INSTANTIATE_DEPTH
         default:
           // this may not happen
           ICL_INVALID_DEPTH;
       }
-
-
     }
 
     // }}}
 
     /// this template resolves the integral image depths
     template<class S>
-    void apply_local_threshold_sxx(const Img<S> &src,const ImgBase *ii, ImgBase *dst, float t,unsigned int m, float gs){
+    void apply_local_threshold_sxx(const Img<S> &src,const ImgBase *ii, ImgBase *dst, float t,unsigned int m, float gs,
+                                   int numThreads){
       // {{{ open
 
       switch(ii->getDepth()){
         case depth32s:
-          apply_local_threshold_six(src,*ii->asImg<icl32s>(),dst,t,m,gs);
+          apply_local_threshold_six(src,*ii->asImg<icl32s>(),dst,t,m,gs,numThreads);
           break;
         case depth32f:
-          apply_local_threshold_six(src,*ii->asImg<icl32f>(),dst,t,m,gs);
+          apply_local_threshold_six(src,*ii->asImg<icl32f>(),dst,t,m,gs,numThreads);
           break;
         case depth64f:
-          apply_local_threshold_six(src,*ii->asImg<icl64f>(),dst,t,m,gs);
+          apply_local_threshold_six(src,*ii->asImg<icl64f>(),dst,t,m,gs,numThreads);
           break;
         default:
           // this may not happen
@@ -360,14 +341,13 @@ namespace icl{
 
 
     template<class S>
-    static void linear_interpolate_cmp(S a, S b, int n, const S *src, icl8u *dst, int threshold, icl32f *cmp){
+    static void linear_interpolate_cmp(S a, S b, int n, const S *src, icl8u *dst, int threshold){
       // fixed-point approx x 100
       float dy = ((float)b - float(a));
       float slope = dy / float(n-1);
       float base = a + threshold;
       for(int i=0;i<n;++i){
         dst[i] = 255 * (src[i] > (base + i * slope));
-        //  cmp[i] = base + i * slope;
       }
     }
 
@@ -375,105 +355,108 @@ namespace icl{
     template<class S>
     static void compare_lin(S *cL,S *cR, int tsx, int tsy,
                             S ul, S ur, S ll, S lr, const Channel<S> &src,
-                            Channel8u dst, const Rect &roi, int threshold,
-                            Channel32f cmp){
+                            Channel8u dst, const Rect &roi, int threshold){
       linear_interpolate(ul,ll,cL,tsy);
       linear_interpolate(ur,lr,cR,tsy);
       for(int y=0;y<tsy;++y){
         linear_interpolate_cmp<S>(cL[y], cR[y], tsx,
                                   &src(roi.x,roi.y+y),
                                   &dst(roi.x,roi.y+y),
-                                  threshold,
-                                  &cmp(roi.x,roi.y+y));
+                                  threshold);
 
       }
     }
 
+    /// computes the means of the tile rows [begin,end)
+    template<class S>
+    struct TileMeans{
+      const Channel<S> *src;
+      Channel<S> *means;
+      int ts, NX;
+
+      void operator()(int begin, int end) const{
+        for(int y=begin;y<end;++y){
+          for(int x=0;x<NX;++x){
+            (*means)(x,y) = roi_mean(*src,ts*ts,Rect(ts*x,ts*y,ts,ts));
+          }
+        }
+      }
+    };
+
+    /// compares the tile rows [begin,end) with their means (nearest neighbour)
     template<class S>
-    static void apply_tiled_thresh(const Img<S> &s, Img8u &dst,
-                                   Img<S> &buf1, Img<S> &buf2, int ts, int threshold,
-                                   BinaryCompareOp *cmp, bool lin){
+    struct TileRowsNN{
+      const Channel<S> *src;
+      Channel8u *dst;
+      int ts, NX, threshold;
+
+      void operator()(int begin, int end) const{
+        for(int y=begin;y<end;++y){
+          for(int x=0;x<NX;++x){
+            const Rect r(ts*x,ts*y,ts,ts);
+            roi_cmp(*src,r,roi_mean(*src,ts*ts,r),*dst,threshold);
+          }
+        }
+      }
+    };
+
+    /// compares the rows [begin,end) of tiles between the tile centers with the interpolated means
+    template<class S>
+    struct TileRowsLIN{
+      const Channel<S> *src;
+      Channel8u *dst;
+      const Channel<S> *means;
+      int ts, NX, threshold;
+
+      void operator()(int begin, int end) const{
+        std::vector<S> c1(ts), c2(ts);
+        const int o = ts/2;
+        for(int y=begin;y<end;++y){
+          for(int x=1;x<NX;++x){
+            compare_lin(c1.data(),c2.data(),ts,ts,
+                        (*means)(x-1,y-1),
+                        (*means)(x,y-1),
+                        (*means)(x-1,y),
+                        (*means)(x,y),
+                        *src, *dst,
+                        Rect(ts*x-o,ts*y-o,ts,ts), threshold);
+          }
+        }
+      }
+    };
+
+    template<class S>
+    static void apply_tiled_thresh(const Img<S> &s, Img8u &dst, Img<S> &buf1, int ts, int threshold, bool lin,
+                                   int numThreads){
 
       int w = s.getWidth();
       int h = s.getHeight();
-      Size t(ts,ts);
-      int dim = ts*ts;
 
       int NX = w/ts;
       int NY = h/ts;
-      Rect r(0,0,ts,ts);
 
-      //      Time tt2 = Time::now();
       /*
-          the old version is outdated now
+          The tile means and the comparison are computed directly on the
+          source image, no intermediate images are used. The tile rows are
+          distributed to the threads.
           Benchmarks: 1280x960 single channel (scaled lena image)
           OLD with IPP: 13.5ms
-
           NEW (no IPP involved) 2.7ms
           */
-
-#ifdef ICL_HAVE_IPP
-      int bw = w/ts;
-      // Time tt = tt2;
-
+      std::vector<S> c1(ts), c2(ts);
       for(int c=s.getChannels()-1;c>=0;--c){
-        S *pbuf1 = buf1.begin(c);
-        const Channel<S> chan = s[c];
-        for(int y=0;y<NY;++y){
-          r.y = ts*y;
-          for(int x=0;x<NX;++x){
-            r.x = ts*x;
-            pbuf1[x+bw*y] = roi_mean(chan,dim,r)+threshold;
-          }
-        }
-      }
-
-      //tt.printAge("roi-mean-downscaling");
-      //tt = Time::now();
-      buf1.scaledCopy(&buf2,lin?interpolateLIN:interpolateNN);
-      //tt.printAge("scaled copy");
-      //tt = Time::now();
-      cmp->apply(&s,&buf2,bpp(dst));
-      //tt.printAge("compare");
-
-#else
-      for(int c=s.getChannels()-1;c>=0;--c){
-        //S *pbuf1 = buf1.begin(c);
         const Channel<S> srcChan = s[c];
         Channel8u dstChan = dst[c];
 
         if(lin){
           Channel<S> bufChan = buf1[0];
-          const Channel<S> chan = s[c];
-          for(int y=0;y<NY;++y){
-            r.y = ts*y;
-            for(int x=0;x<NX;++x){
-              r.x = ts*x;
-              bufChan(x,y) = roi_mean(chan,dim,r);
-            }
-          }
-          const Point o(ts/2,ts/2);
-          //S c1[ts],c2[ts];
-          S *c1 = new S[ts];
-          S *c2 = new S[ts];
-
-          Img32f cmp(s.getSize(),1);
-          Channel32f chanCmp = cmp[0];
+          TileMeans<S> means = { &srcChan, &bufChan, ts, NX };
+          parallel_for(0,NY,means,0,numThreads);
 
           /// major part of the image
-          for(int y=1;y<NY;++y){
-            r.y = ts*y - o.y;
-            for(int x=1;x<NX;++x){
-              r.x = ts*x - o.y;
-              compare_lin(c1,c2,ts,ts,
-                          bufChan(x-1,y-1),
-                          bufChan(x,y-1),
-                          bufChan(x-1,y),
-                          bufChan(x,y),
-                          srcChan, dstChan,
-                          r, threshold, chanCmp);
-            }
-          }
+          TileRowsLIN<S> rows = { &srcChan, &dstChan, &bufChan, ts, NX, threshold };
+          parallel_for(1,NY,rows,0,numThreads);
+
           /// image borders, here, the closest global value is used
           /*
                                                   xm
@@ -504,48 +487,39 @@ namespace icl{
           roi_cmp(srcChan, Rect(xm,ym,th,th), bufChan(NX-1,NY-1), dstChan, threshold);
           for(int x=1; x<NX;++x){
             // top
-            compare_lin(c1,c2,ts,th,
+            compare_lin(c1.data(),c2.data(),ts,th,
                         bufChan(x-1,0),bufChan(x,0),
                         bufChan(x-1,0),bufChan(x,0),
                         srcChan, dstChan,
-                        Rect(th+(x-1)*ts,0,ts,th), threshold, chanCmp);
+                        Rect(th+(x-1)*ts,0,ts,th), threshold);
             // bottom
-            compare_lin(c1,c2,ts,th,
+            compare_lin(c1.data(),c2.data(),ts,th,
                         bufChan(x-1,NY-1),bufChan(x,NY-1),
                         bufChan(x-1,NY-1),bufChan(x,NY-1),
                         srcChan, dstChan,
-                        Rect(th+(x-1)*ts,ym,ts,th), threshold, chanCmp);
+                        Rect(th+(x-1)*ts,ym,ts,th), threshold);
           }
           for(int y=1;y<NY;++y){
             // left
-            compare_lin(c1,c2,th,ts,
+            compare_lin(c1.data(),c2.data(),th,ts,
                         bufChan(0,y-1),bufChan(0,y-1),
                         bufChan(0,y),bufChan(0,y),
                         srcChan, dstChan,
-                        Rect(0,th+(y-1)*ts,th,ts), threshold, chanCmp);
+                        Rect(0,th+(y-1)*ts,th,ts), threshold);
             // right
-            compare_lin(c1,c2,th,ts,
+            compare_lin(c1.data(),c2.data(),th,ts,
                         bufChan(NX-1,y-1),bufChan(NX-1,y-1),
                         bufChan(NX-1,y),bufChan(NX-1,y),
                         srcChan, dstChan,
-                        Rect(xm,th+(y-1)*ts,th,ts), threshold, chanCmp);
+                        Rect(xm,th+(y-1)*ts,th,ts), threshold);
           }
 
-          delete[] c1;
-          delete[] c2;
         }else{
           /// todo: handle right colum and bottom row!
-          for(int y=0;y<NY;++y){
-            r.y = ts*y;
-            for(int x=0;x<NX;++x){
-              r.x = ts*x;
-              S mean = roi_mean(srcChan,dim,r);
-              roi_cmp(srcChan,r,mean,dstChan,threshold);
-            }
-          }
+          TileRowsNN<S> rows = { &srcChan, &dstChan, ts, NX, threshold };
+          parallel_for(0,NY,rows,0,numThreads);
         }
       }
-#endif
     }
 
     inline bool is_int(float x){
@@ -580,7 +554,6 @@ namespace icl{
       ICLASSERT_RETURN(ts>1);
       Size size = src->getSize();
       ensureCompatible(&m_tiledBuf1,src->getDepth(),size/ts, 1, formatMatrix);
-      ensureCompatible(&m_tiledBuf2,src->getDepth(),size,1,formatMatrix);
 
       switch(src->getDepth()){
 #define ICL_INSTANTIATE_DEPTH(D)                                \
@@ -588,9 +561,9 @@ namespace icl{
         apply_tiled_thresh(*src->asImg<icl##D>(),               \
                            *(*dst)->asImg<icl8u>(),             \
                            *m_tiledBuf1->asImg<icl##D>(),       \
-                           *m_tiledBuf2->asImg<icl##D>(),       \
-                           ts, getGlobalThreshold(), m_cmp,     \
-                           getAlgorithm() == tiledLIN);         \
+                           ts, getGlobalThreshold(),            \
+                           getAlgorithm() == tiledLIN,          \
+                           m_numThreads);                       \
         break;
         ICL_INSTANTIATE_ALL_DEPTHS
 #undef ICL_INSTANTIATE_DEPTH
@@ -609,6 +582,7 @@ namespace icl{
       // {{{ open
 
       m_iiOp->setIntegralImageDepth((src->getDepth() == depth8u || src->getDepth() == depth16s) ? depth32s : src->getDepth());
+      m_iiOp->setNumThreads(m_numThreads);
       const ImgBase *ii = m_iiOp->apply(src);
 
       float t = getGlobalThreshold();
@@ -618,7 +592,7 @@ namespace icl{
       float gs = getGammaSlope();
 
       switch(src->getDepth()){
-#define ICL_INSTANTIATE_DEPTH(D) case depth##D: apply_local_threshold_sxx<icl##D>(*src->asImg<icl##D>(), ii, *dst, t, s, gs); break;
+#define ICL_INSTANTIATE_DEPTH(D) case depth##D: apply_local_threshold_sxx<icl##D>(*src->asImg<icl##D>(), ii, *dst, t, s, gs, m_numThreads); break;
         ICL_INSTANTIATE_ALL_DEPTHS;
 #undef ICL_INSTANTIATE_DEPTH
       }
@@ -42,7 +42,6 @@ namespace icl{
     /** \cond */
     class IntegralImgOp;
     class UnaryCompareOp;
-    class BinaryCompareOp;
     /** \endcond*/
 
     /// LocalThreshold Filter class \ingroup UNARY
@@ -117,6 +116,14 @@ namespace icl{
         This time, no special operation for multi channels images are implemneted, so each channel
         is process independently in this case.
 
+        \section MT__ Multi-Threading
+        The region mean algorithm (including the integral image computation) can be distributed
+        over several threads by setNumThreads. The image rows are split into bands, each thread
+        thresholds its bands directly from the integral image. The tiled algorithms compare each
+        pixel directly with its (interpolated) tile mean, no intermediate images are created.
+        Here, the rows of tiles are distributed to the threads (only the image borders of the
+        tiled linear algorithm are processed by the calling thread).
+
 
         \section GAMMA Experimental feature gamma slope
         By applying a small adaption, the procedure presented avoid can be used to
@@ -226,6 +233,16 @@ namespace icl{
       /// sets internally used algorithm
       void setAlgorithm(algorithm a);
 
+      /// sets the number of threads used (1: calling thread only, 0: all threads of the pool)
+      void setNumThreads(int numThreads){
+        m_numThreads = numThreads < 0 ? 1 : numThreads;
+      }
+
+      /// returns the number of threads used
+      int getNumThreads() const{
+        return m_numThreads;
+      }
+
       private:
 
       /// internal algorithm function
@@ -253,14 +270,11 @@ namespace icl{
       /// currently used algorithm
       /// property algorithm m_algorithm;
 
-      /// BinaryCompareOp for tiledXXX algorithms
-      BinaryCompareOp *m_cmp;
-
       /// first buffer for tiledXXX algorithsm
       core::ImgBase *m_tiledBuf1;
 
-      /// second buffer for tiledXXX algorithsm
-      core::ImgBase *m_tiledBuf2;
+      /// number of threads used
+      int m_numThreads;
 
     };
 
@@ -31,6 +31,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <algorithm>
 
 namespace icl{
   namespace filter{
@@ -55,15 +56,18 @@ namespace icl{
     /// Internally used helper function
     /** This function was outsourced to optimize the compilation times by better
         exploiting multi-threaded compilation. The actual template instantiation of
-        this function is spread over 10 source-files. */
+        this function is spread over 10 source-files. Only the rows
+        [rowBegin,rowEnd) of the destination are computed. */
     template<class TS,  class TI, class TD, class TT, bool WITH_GAMMA>
-    void fast_lt(const TS *psrc, const TI *ii, TD *pdst, int w, int h, int r, TT t, float gs, int channel);
+    void fast_lt(const TS *psrc, const TI *ii, TD *pdst, int w, int h, int r, TT t, float gs,
+                 int rowBegin, int rowEnd);
 
     /// Internally used helper function
     /** This function was outsourced to optimize the compilation times by better
         exploiting multi-threaded compilation */
     template<class TS,  class TI, class TD, class TT, bool WITH_GAMMA>
-    void fast_lt_impl(const TS *psrc, const TI *ii, TD *pdst, int w, int h, int r, TT t, float gs, int channel){
+    void fast_lt_impl(const TS *psrc, const TI *ii, TD *pdst, int w, int h, int r, TT t, float gs,
+                      int rowBegin, int rowEnd){
       const int r2 = 2*r;
       const int yEnd = h-r;
       const int dim = r2*r2;
@@ -101,7 +105,7 @@ namespace icl{
 
 
       // [1][2][3]
-      for(int y=0;y<r;++y){
+      for(int y=rowBegin;y<std::min(r,rowEnd);++y){
         for(int x=0;x<r;++x){    //[1]
           COMPLEX_STEP(0,0,r+x,r+y);
         }
@@ -114,7 +118,7 @@ namespace icl{
       }
 
       // [4][CENTER][5]
-      for(int y=r; y<yEnd; ++y){
+      for(int y=std::max(r,rowBegin); y<std::min(yEnd,rowEnd); ++y){
         //[4]
         for(int x=0;x<r;++x){
           COMPLEX_STEP(0,y-r,x+r,r2);
@@ -151,7 +155,7 @@ namespace icl{
       }
 
       // [6][7][8]
-      for(int y=h-r;y<h;++y){
+      for(int y=std::max(h-r,rowBegin);y<rowEnd;++y){
         for(int x=0;x<r;++x){    //[6]
           COMPLEX_STEP(0,y-r,r+x,h+r-y-1);
         }
@@ -176,15 +180,15 @@ namespace icl{
 #define FAST_LT_DEFINITION                                              \
     template<class TS,  class TI, class TD, class TT, bool WITH_GAMMA>  \
     void fast_lt(const TS *psrc, const TI *iim, TD *pdst, int w, int h, \
-                 int r, TT t, float gs, int channel){                   \
-      fast_lt_impl<TS,TI,TD,TT,WITH_GAMMA>(psrc,iim,pdst,w,h,r,t,gs,channel); \
+                 int r, TT t, float gs, int rowBegin, int rowEnd){      \
+      fast_lt_impl<TS,TI,TD,TT,WITH_GAMMA>(psrc,iim,pdst,w,h,r,t,gs,rowBegin,rowEnd); \
     }
 
 #define INST_FAST_LT(TS,TI,TD,WITH_GAMMA)                               \
   template void fast_lt<lt_icl##TS,lt_icl##TI,lt_icl##TD,               \
     ThreshType<lt_icl##TS>::T,WITH_GAMMA>                      \
   (const lt_icl##TS*, const lt_icl##TI*, lt_icl##TD*, int, int,         \
-   int, ThreshType<lt_icl##TS>::T,float,int)
+   int, ThreshType<lt_icl##TS>::T,float,int,int)
 
 #define INST_FAST_LT_FOR_SRC_TYPE(SRC,WITH_GAMMA) \
   INST_FAST_LT(SRC,32s,8u,WITH_GAMMA);            \
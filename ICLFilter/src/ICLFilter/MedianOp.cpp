@@ -31,6 +31,7 @@
 
 #include <ICLFilter/MedianOp.h>
 #include <ICLCore/Img.h>
+#include <ICLUtils/ThreadPool.h>
 #include <vector>
 #include <algorithm>
 
@@ -42,31 +43,6 @@ namespace icl {
 
     namespace{
 
-      template<typename T>
-      void apply_median (const Img<T> *src, Img<T> *dst, const Size &oMaskSize,const Point &roiOffset, const Point &oAnchor) {
-        // {{{ open
-        std::vector<T> oList(oMaskSize.getDim());
-        typename std::vector<T>::iterator itList = oList.begin();
-        typename std::vector<T>::iterator itMedian = oList.begin()+((oMaskSize.width * oMaskSize.height)/2);
-
-
-        for (int c=0;c<src->getChannels();c++){
-          const ImgIterator<T> s(const_cast<T*>(src->getData(c)),src->getWidth(), Rect(roiOffset, dst->getROISize()));
-          const ImgIterator<T> sEnd = ImgIterator<T>::create_end_roi_iterator(src->getData(c),src->getWidth(),Rect(roiOffset, dst->getROISize()));
-          ImgIterator<T> d= dst->beginROI(c);
-          for(;s != sEnd;++s,++d){
-            for(const ImgIterator<T> sR(s,oMaskSize,oAnchor); sR.inRegionSubROI(); ++sR, ++itList){
-              *itList = *sR;
-            }
-            std::sort(oList.begin(),oList.end());
-            *d = *itMedian;
-            itList = oList.begin();
-          }
-        }
-      }
-
-      // }}}
-
       template<class T>
       inline void subMedian3x3(const T *l0, const T *l1, const T *l2, T *med) {
         T a0 = *l0++;
@@ -101,7 +77,7 @@ namespace icl {
         c2 = std::max(c1, c2);
 
         a0 = std::max(a0, std::max(b0, c0));
-        a2 = std::min(a2, std::max(b2, c2));
+        a2 = std::min(a2, std::min(b2, c2));
         b1 = std::min(B1, C1);
         b2 = std::max(B1, C1);
         b1 = std::max(A1, b1);
@@ -185,6 +161,10 @@ namespace icl {
         MINMAX(tmp, r08, r14);
         MINMAX(tmp, r08, r11);
 
+        MINMAX(tmp, r12, r15);
+        MINMAX(tmp, r09, r15);
+        MINMAX(tmp, r09, r12);
+
         MINMAX(tmp, r13, r16);
         MINMAX(tmp, r10, r16);
         MINMAX(tmp, r10, r13);
@@ -310,15 +290,9 @@ namespace icl {
             b2 = max(b1, b2);
 
             for (; dstIt<dstEnd; dstIt += dstWidth, srcIt += srcWidth) {
-              T1 c0 = a0;
-              T1 c1 = A1;
-              T1 c2 = a2;
-              a0 = b0;
-              A1 = B1;
-              a2 = b2;
-              b0 = srcIt;
-              B1 = srcIt + 1;
-              b2 = srcIt + 2;
+              T1 c0 = srcIt;
+              T1 c1 = srcIt + 1;
+              T1 c2 = srcIt + 2;
 
               T1 C1 = min(c1, c2);
               c2 = max(c1, c2);
@@ -327,17 +301,20 @@ namespace icl {
               C1 = min(c1, c2);
               c2 = max(c1, c2);
 
-              a0 = max(a0, max(b0, c0));
-              a2 = min(a2, max(b2, c2));
-              b1 = min(B1, C1);
-              b2 = max(B1, C1);
-              b1 = max(A1, b1);
-              a1 = min(b1, b2);
-
-              b1 = min(a1, a2);
-              b2 = max(a1, a2);
-              b1 = max(a0, b1);
-              min(b1, b2).storeu(dstIt);
+              // the sorted rows a and b are reused for the next row
+              T1 lo = max(a0, max(b0, c0));
+              T1 hi = min(a2, min(b2, c2));
+              T1 mid = max(A1, min(B1, C1));
+              mid = min(mid, max(B1, C1));
+              T1 m = max(lo, min(mid, hi));
+              min(m, max(mid, hi)).storeu(dstIt);
+
+              a0 = b0;
+              A1 = B1;
+              a2 = b2;
+              b0 = c0;
+              B1 = C1;
+              b2 = c2;
             }
 
             // increment pointers to the next values
@@ -372,15 +349,9 @@ namespace icl {
               b2 = std::max(b1, b2);
 
               for (; dstIt<dstEnd; dstIt += dstWidth, srcIt += srcWidth) {
-                T c0 = a0;
-                T c1 = A1;
-                T c2 = a2;
-                a0 = b0;
-                A1 = B1;
-                a2 = b2;
-                b0 = *srcIt;
-                B1 = srcIt[1];
-                b2 = srcIt[2];
+                T c0 = *srcIt;
+                T c1 = srcIt[1];
+                T c2 = srcIt[2];
 
                 T C1 = std::min(c1, c2);
                 c2 = std::max(c1, c2);
@@ -389,17 +360,17 @@ namespace icl {
                 C1 = std::min(c1, c2);
                 c2 = std::max(c1, c2);
 
-                a0 = std::max(a0, std::max(b0, c0));
-                a2 = std::min(a2, std::max(b2, c2));
-                b1 = std::min(B1, C1);
-                b2 = std::max(B1, C1);
-                b1 = std::max(A1, b1);
-                a1 = std::min(b1, b2);
-
-                b1 = std::min(a1, a2);
-                b2 = std::max(a1, a2);
-                b1 = std::max(a0, b1);
-                *dstIt = std::min(b1, b2);
+                const T lo = std::max(a0, std::max(b0, c0));
+                const T hi = std::min(a2, std::min(b2, c2));
+                const T mid = std::min(std::max(A1, std::min(B1, C1)), std::max(B1, C1));
+                *dstIt = std::min(std::max(lo, std::min(mid, hi)), std::max(mid, hi));
+
+                a0 = b0;
+                A1 = B1;
+                a2 = b2;
+                b0 = c0;
+                B1 = C1;
+                b2 = c2;
               }
             }
           }
@@ -440,7 +411,7 @@ namespace icl {
         c2 = max(c1, c2);
 
         a0 = max(a0, max(b0, c0));
-        a2 = min(a2, max(b2, c2));
+        a2 = min(a2, min(b2, c2));
         b1 = min(B1, C1);
         b2 = max(B1, C1);
         b1 = max(A1, b1);
@@ -524,6 +495,10 @@ namespace icl {
         MINMAX(tmp, r08, r14);
         MINMAX(tmp, r08, r11);
 
+        MINMAX(tmp, r12, r15);
+        MINMAX(tmp, r09, r15);
+        MINMAX(tmp, r09, r12);
+
         MINMAX(tmp, r13, r16);
         MINMAX(tmp, r10, r16);
         MINMAX(tmp, r10, r13);
@@ -611,164 +586,604 @@ namespace icl {
     #undef MINMAX
   #endif
 
-#ifdef ICL_HAVE_SSE2
+      /// number of tasks the rows of a channel are split into
+      inline int median_num_strips(const Size &roiSize, const Size &maskSize, int numThreads){
+        static const int MIN_PIXELS_PER_STRIPE = 16384;
+        if(numThreads == 1) return 1;
+        const int threads = numThreads > 0 ? numThreads : ThreadPool::instance().getConcurrency();
+        // each strip has to initialize maskSize.height-1 additional rows
+        const int maxStrips = std::min(roiSize.getDim()/MIN_PIXELS_PER_STRIPE, roiSize.height/(2*maskSize.height));
+        return iclMax(1,iclMin(4*threads,maxStrips));
+      }
+
+      /// median filter, that selects the median of each mask from a copy of its values
+      /** std::nth_element runs in O(N) per pixel. This is used for very large
+          masks, for which the sorting networks become too large and the
+          histograms of ConstantTimeMedian would overflow. */
       template<class T>
-      void apply_median_all(const Img<T> *src, Img<T> *dst, const Size &oMaskSize,const Point &roiOffset, const Point &oAnchor) {
-        // {{{ open
-        std::vector<T> oList(oMaskSize.getDim());
-        typename std::vector<T>::iterator itList = oList.begin();
-        typename std::vector<T>::iterator itMedian = oList.begin()+((oMaskSize.width * oMaskSize.height)/2);
-
-
-        for (int c=0;c<src->getChannels();c++){
-          const ImgIterator<T> s(const_cast<T*>(src->getData(c)),src->getWidth(), Rect(roiOffset, dst->getROISize()));
-          const ImgIterator<T> sEnd = ImgIterator<T>::create_end_roi_iterator(src->getData(c),src->getWidth(),Rect(roiOffset, dst->getROISize()));
-          ImgIterator<T> d= dst->beginROI(c);
-          for(;s != sEnd;++s,++d){
-            for(const ImgIterator<T> sR(s,oMaskSize,oAnchor); sR.inRegionSubROI(); ++sR, ++itList){
-              *itList = *sR;
+      struct SelectionMedian{
+        const T *src;
+        T *dst;
+        int srcW, dstW;
+        Size roiSize, maskSize;
+        int stripH;
+
+        void operator()(int begin, int end) const{
+          std::vector<T> values(maskSize.getDim());
+          const typename std::vector<T>::iterator median = values.begin() + values.size()/2;
+          for(int strip=begin;strip<end;++strip){
+            const int y0 = strip*stripH, y1 = iclMin(y0+stripH,roiSize.height);
+            for(int y=y0;y<y1;++y){
+              for(int x=0;x<roiSize.width;++x){
+                T *v = values.data();
+                for(int j=0;j<maskSize.height;++j){
+                  const T *s = src + (y+j)*srcW + x;
+                  v = std::copy(s,s+maskSize.width,v);
+                }
+                std::nth_element(values.begin(),median,values.end());
+                dst[y*dstW+x] = *median;
+              }
             }
-            std::sort(oList.begin(),oList.end());
-            *d = *itMedian;
-            itList = oList.begin();
           }
         }
-      }
+      };
 
-      template<>
-      void apply_median_all(const Img<icl8u> *src, Img<icl8u> *dst, const Size &oMaskSize,const Point &roiOffset, const Point &oAnchor) {
-        // {{{ open
-        const int half      = oMaskSize.getDim() / 2;
-        const int halfexact = (oMaskSize.getDim() + 1) / 2;
-
-        for (int c = 0; c < src->getChannels(); c++) {
-          ImgIterator<icl8u> d    = dst->beginROI(c);
-          const ImgIterator<icl8u> s(const_cast<icl8u*>(src->getData(c)),src->getWidth(), Rect(roiOffset, dst->getROISize()));
-          const ImgIterator<icl8u> sR(s,oMaskSize,oAnchor);
-          const icl8u *s_tl = &(*sR);
-
-          for (int k = 0; k < dst->getROIWidth(); ++k, ++d, ++s_tl, ++s) {
-            icl8u median = 0;
-            icl16s hist[256] = {0};
-            icl16s left = 0;
-
-            for (const ImgIterator<icl8u> sR(s,oMaskSize,oAnchor); sR.inRegionSubROI(); ++sR){
-              hist[*sR]++;
-            }
+      template<class T>
+      void apply_median_select(const Img<T> *src, Img<T> *dst, const Size &oMaskSize,const Point &roiOffset,
+                               const Point &oAnchor, int numThreads) {
+        const Point offs = roiOffset - oAnchor;
+        const Size roiSize = dst->getROISize();
+        const int nStrips = median_num_strips(roiSize,oMaskSize,numThreads);
+
+        SelectionMedian<T> m;
+        m.srcW = src->getWidth();
+        m.dstW = dst->getWidth();
+        m.roiSize = roiSize;
+        m.maskSize = oMaskSize;
+        m.stripH = (roiSize.height+nStrips-1)/nStrips;
+        for(int c=0;c<src->getChannels();c++){
+          m.src = src->getData(c) + offs.x + offs.y*m.srcW;
+          m.dst = dst->getROIData(c);
+          parallel_for(0,nStrips,m,1,numThreads);
+        }
+      }
 
+      /// adds n (a multiple of 8) 16 bit histogram bins
+      inline void hist_add(icl16s *dst, const icl16s *src, int n){
+  #ifdef ICL_HAVE_SSE2
+        for(int i=0;i<n;i+=8){
+          _mm_storeu_si128((__m128i*)(dst+i),_mm_add_epi16(_mm_loadu_si128((const __m128i*)(dst+i)),
+                                                           _mm_loadu_si128((const __m128i*)(src+i))));
+        }
+  #else
+        for(int i=0;i<n;++i) dst[i] += src[i];
+  #endif
+      }
 
-            icl16s sum = 0;
+      /// adds a-b to n (a multiple of 8) 16 bit histogram bins
+      inline void hist_add_diff(icl16s *dst, const icl16s *a, const icl16s *b, int n){
+  #ifdef ICL_HAVE_SSE2
+        for(int i=0;i<n;i+=8){
+          const __m128i d = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(a+i)),_mm_loadu_si128((const __m128i*)(b+i)));
+          _mm_storeu_si128((__m128i*)(dst+i),_mm_add_epi16(_mm_loadu_si128((const __m128i*)(dst+i)),d));
+        }
+  #else
+        for(int i=0;i<n;++i) dst[i] += a[i]-b[i];
+  #endif
+      }
 
-            for (int i = 0; i < 256; ++i) {
-              sum += hist[i];
-              if (sum >= halfexact) {
-                *d = median = i;
-                left = sum - hist[i];
+      /// finds the first bin k of a histogram, whose prefix sum exceeds t
+      /** below is set to the sum of the bins before k, n is a multiple of 8
+          and at most 256 */
+      inline int hist_find(const icl16s *h, int n, int t, int &below){
+        icl16s prefix[256];
+  #ifdef ICL_HAVE_SSE2
+        const __m128i tt = _mm_set1_epi16(t);
+        __m128i carry = _mm_setzero_si128(), gt = _mm_setzero_si128(); // gt: -1 for each prefix sum > t
+        for(int i=0;i<n;i+=8){
+          __m128i x = _mm_loadu_si128((const __m128i*)(h+i));
+          x = _mm_add_epi16(x,_mm_slli_si128(x,2));
+          x = _mm_add_epi16(x,_mm_slli_si128(x,4));
+          x = _mm_add_epi16(x,_mm_slli_si128(x,8));
+          x = _mm_add_epi16(x,carry);
+          _mm_storeu_si128((__m128i*)(prefix+i),x);
+          gt = _mm_add_epi16(gt,_mm_cmpgt_epi16(x,tt));
+          carry = _mm_shufflehi_epi16(x,_MM_SHUFFLE(3,3,3,3));
+          carry = _mm_unpackhi_epi64(carry,carry);
+        }
+        gt = _mm_madd_epi16(gt,_mm_set1_epi16(1));
+        gt = _mm_add_epi32(gt,_mm_shuffle_epi32(gt,_MM_SHUFFLE(1,0,3,2)));
+        gt = _mm_add_epi32(gt,_mm_shuffle_epi32(gt,_MM_SHUFFLE(2,3,0,1)));
+        const int k = n + _mm_cvtsi128_si32(gt);
+  #else
+        int k = n, sum = 0;
+        for(int i=0;i<n;++i){
+          sum += h[i];
+          prefix[i] = sum;
+          if(sum > t && k == n) k = i;
+        }
+  #endif
+        below = k ? prefix[k-1] : 0;
+        return k;
+      }
 
-                break;
+      /// constant time median filter for integer types (Perreault and Hebert 2007)
+      /** Each column of the source region has a histogram of the mask-height
+          pixels above the current row, that is moved down by adding the new and
+          removing the old pixel. The histogram of the mask is moved to the right
+          by adding the entering and subtracting the leaving column histogram.
+          To keep this cheap for large value ranges, the histograms have two
+          levels: C coarse bins, that are always kept up to date and F fine bins
+          per coarse bin, of which only the ones of the coarse bin that contains
+          the median are brought up to date (lazily). Therefore, the costs per
+          pixel do not depend on the mask size. The bins that contain the median
+          are found using SIMD prefix sums instead of a sequential search.
+
+          The region is processed in tiles of at most tileW columns, so that the
+          column histograms stay in the cache. The rows are split into strips,
+          that are processed in parallel. */
+      template<class T>
+      struct ConstantTimeMedian{
+        const T *src;
+        T *dst;
+        int srcW, dstW;
+        Size roiSize, maskSize;
+        int minVal;   //!< value of bin 0
+        int fineBits; //!< each coarse bin has F=1<<fineBits fine bins (F is a multiple of 8)
+        int C;        //!< number of coarse bins (a multiple of 8)
+        int tileW, stripH;
+
+        void operator()(int begin, int end) const{
+          const int mw = maskSize.width, mh = maskSize.height, F = 1<<fineBits, CF = C*F;
+          const int half = (mw*mh)/2;
+          const int cols = iclMin(tileW,roiSize.width)+mw-1;
+          std::vector<icl16s> colC(cols*C), colF(cols*CF), hc(C), hf(CF);
+          std::vector<int> luc(C);
+
+          for(int strip=begin;strip<end;++strip){
+            const int y0 = strip*stripH, y1 = iclMin(y0+stripH,roiSize.height);
+            for(int x0=0;x0<roiSize.width;x0+=tileW){
+              const int tw = iclMin(tileW,roiSize.width-x0), tc = tw+mw-1;
+              std::fill(colC.begin(),colC.begin()+tc*C,0);
+              std::fill(colF.begin(),colF.end(),0);
+              for(int y=y0;y<y0+mh-1;++y){
+                add_row(colC.data(),colF.data(),src+y*srcW+x0,tc,cols,1);
               }
-            }
-
 
-            const icl8u *sRtl = s_tl;
-            const icl8u *sRbl = &(s_tl[src->getWidth()*oMaskSize.height]);
+              for(int y=y0;y<y1;++y){
+                add_row(colC.data(),colF.data(),src+(y+mh-1)*srcW+x0,tc,cols,1);
+
+                std::fill(hc.begin(),hc.end(),0);
+                std::fill(luc.begin(),luc.end(),0);
+                for(int x=0;x<mw-1;++x) hist_add(hc.data(),&colC[x*C],C);
+
+                T *d = dst + y*dstW + x0;
+                for(int x=0;x<tw;++x){
+                  if(x){
+                    hist_add_diff(hc.data(),&colC[(x+mw-1)*C],&colC[(x-1)*C],C);
+                  }else{
+                    hist_add(hc.data(),&colC[(mw-1)*C],C);
+                  }
+
+                  int below = 0, fineBelow = 0;
+                  const int k = hist_find(hc.data(),C,half,below);
+
+                  // bring the fine bins of coarse bin k up to date
+                  icl16s *f = &hf[k*F];
+                  const icl16s *cf = &colF[k*cols*F];
+                  const int xEnd = x+mw;
+                  int &l = luc[k];
+                  if(l <= x){
+                    std::fill(f,f+F,0);
+                    for(l=x;l<xEnd;++l) hist_add(f,cf+l*F,F);
+                  }else{
+                    for(;l<xEnd;++l) hist_add_diff(f,cf+l*F,cf+(l-mw)*F,F);
+                  }
+
+                  d[x] = T(minVal + (k<<fineBits) + hist_find(f,F,half-below,fineBelow));
+                }
 
-            for (ImgIterator<icl8u> dCol(d,Size(1,dst->getROIHeight()-1),Point(0,-1)); dCol.inRegionSubROI();
-                  ++dCol, sRtl = &(sRtl[src->getWidth()]), sRbl = &(sRbl[src->getWidth()])) {
-              for (int i = 0; i < oMaskSize.width; ++i) {
-                hist[sRtl[i]]--;
-                if (sRtl[i] < median) --left;
-                hist[sRbl[i]]++;
-                if (sRbl[i] < median) ++left;
+                add_row(colC.data(),colF.data(),src+y*srcW+x0,tc,cols,-1);
               }
+            }
+          }
+        }
 
-              if (left > half) {
-                do {
-                  --median;
-                  left -= hist[median];
-                } while(left > half);
-              } else {
-                while (left + hist[median] < halfexact) {
-                  left += hist[median];
-                  ++median;
-                }
-              }
+        /// adds v to the column histograms of the values s[0..n), the fine bins of a coarse bin are stored contiguously
+        inline void add_row(icl16s *colC, icl16s *colF, const T *s, int n, int cols, int v) const{
+          const int F = 1<<fineBits;
+          for(int x=0;x<n;++x){
+            const int i = int(s[x])-minVal, k = i>>fineBits;
+            colC[x*C+k] += v;
+            colF[(k*cols+x)*F+(i&(F-1))] += v;
+          }
+        }
+      };
 
-              *dCol = median;
-            }
+      /// value range of an image region
+      template<class T>
+      inline void get_median_range(const T *s, int srcW, const Size &size, int &minVal, int &maxVal){
+        T lo = *s, hi = *s;
+        for(int y=0;y<size.height;++y,s+=srcW){
+          for(int x=0;x<size.width;++x){
+            lo = iclMin(lo,s[x]);
+            hi = iclMax(hi,s[x]);
           }
         }
+        minVal = lo;
+        maxVal = hi;
       }
       template<>
-      void apply_median_all(const Img<icl16s> *src, Img<icl16s> *dst, const Size &oMaskSize,const Point &roiOffset, const Point &oAnchor) {
-        // {{{ open
-        const int half      = oMaskSize.getDim() / 2;
-        const int halfexact = (oMaskSize.getDim() + 1) / 2;
-
-        for (int c = 0; c < src->getChannels(); c++) {
-          ImgIterator<icl16s> d    = dst->beginROI(c);
-          const ImgIterator<icl16s> s(const_cast<icl16s*>(src->getData(c)),src->getWidth(), Rect(roiOffset, dst->getROISize()));
-          const ImgIterator<icl16s> sR(s,oMaskSize,oAnchor);
-          const icl16s *s_tl = &(*sR);
-
-          for (int k = 0; k < dst->getROIWidth(); ++k, ++d, ++s_tl, ++s) {
-            icl16s median = 0;
-            icl16s hist[65536] = {0};
-            icl16s left = 0;
-
-            for (const ImgIterator<icl16s> sR(s,oMaskSize,oAnchor); sR.inRegionSubROI(); ++sR){
-              hist[*sR]++;
-            }
+      inline void get_median_range(const icl8u*, int, const Size&, int &minVal, int &maxVal){
+        minVal = 0;
+        maxVal = 255;
+      }
 
+      template<class T>
+      void apply_median_ctmf(const Img<T> *src, Img<T> *dst, const Size &oMaskSize,const Point &roiOffset,
+                             const Point &oAnchor, int numThreads) {
+        if(oMaskSize.getDim() > 32767){
+          // the histogram bins are signed 16 bit values
+          apply_median_select(src,dst,oMaskSize,roiOffset,oAnchor,numThreads);
+          return;
+        }
+        const Point offs = roiOffset - oAnchor;
+        const Size roiSize = dst->getROISize(), regionSize = roiSize + oMaskSize - Size(1,1);
+        const int nStrips = median_num_strips(roiSize,oMaskSize,numThreads);
+
+        ConstantTimeMedian<T> m;
+        m.srcW = src->getWidth();
+        m.dstW = dst->getWidth();
+        m.roiSize = roiSize;
+        m.maskSize = oMaskSize;
+        m.stripH = (roiSize.height+nStrips-1)/nStrips;
+
+        for(int c=0;c<src->getChannels();c++){
+          m.src = src->getData(c) + offs.x + offs.y*m.srcW;
+          m.dst = dst->getROIData(c);
+
+          // F*C >= range, with F ~ C ~ sqrt(range) fine and coarse bins
+          int maxVal = 0, bits = 0;
+          get_median_range(m.src,m.srcW,regionSize,m.minVal,maxVal);
+          while((1 << (2*bits)) < maxVal-m.minVal+1) ++bits;
+          m.fineBits = iclMax(3,bits);
+          m.C = ((((maxVal-m.minVal) >> m.fineBits) + 1 + 7) / 8) * 8;
+
+          // about 1MB of column histograms per tile
+          const int colBytes = 2*m.C*(1+(1<<m.fineBits));
+          m.tileW = iclMax(2*oMaskSize.width,(1<<20)/colBytes - oMaskSize.width + 1);
+
+          parallel_for(0,nStrips,m,1,numThreads);
+        }
+      }
 
-            icl16s sum = 0;
+      /// comparator network, that selects the median of the values of a mask
+      /** The values of the mask are split into blocks (the columns or the rows of
+          the mask), which are sorted first. Sorted blocks are shared by
+          neighbouring masks: sorted columns are reused by the next mw-1 pixels of
+          a row and sorted rows by the next mh-1 rows. The sorted blocks are then
+          combined by the merge stages of Batcher's odd-even merge sort. Both
+          networks are pruned to the comparators that influence the median.
+          Each comparator works on "registers", which are the values of the
+          block (block sorting) or of the mask (merging). */
+      struct MedianNetwork{
+        bool rowBlocks;               //!< blocks are the rows (otherwise the columns) of the mask
+        int blockLen, numBlocks;
+        std::vector<int> sortA, sortB;    //!< comparators of the block sorting network
+        std::vector<int> sortIn;          //!< needed block elements
+        std::vector<int> ranks, rankRegs; //!< needed ranks of the sorted blocks and their registers
+        std::vector<int> mergeA, mergeB;  //!< comparators of the merge network
+        std::vector<int> mergeIn;         //!< needed mask elements (block*blockLen+rank)
+        int median;                       //!< register of the median after merging
+
+        /// number of comparators per pixel
+        int cost() const { return (int)(sortA.size() + mergeA.size()); }
+
+        MedianNetwork(const Size &maskSize, bool rowBlocks):rowBlocks(rowBlocks){
+          blockLen = rowBlocks ? maskSize.width : maskSize.height;
+          numBlocks = rowBlocks ? maskSize.height : maskSize.width;
+          const int pl = next_pow2(blockLen), pb = next_pow2(numBlocks);
+
+          std::vector<int> sortRegs(pl,-1), regs(pl*pb,-1);
+          for(int j=0;j<blockLen;++j) sortRegs[j] = j;
+          batcher(pl,1,sortRegs,sortA,sortB);
+
+          for(int b=0;b<numBlocks;++b){
+            for(int j=0;j<blockLen;++j) regs[b*pl+j] = b*blockLen+j;
+          }
+          batcher(pl*pb,pl,regs,mergeA,mergeB);
+          median = regs[(blockLen*numBlocks)/2];
+
+          std::vector<bool> needed(blockLen*numBlocks,false);
+          needed[median] = true;
+          prune(mergeA,mergeB,needed);
+          for(int b=0;b<numBlocks;++b){
+            for(int j=0;j<blockLen;++j){
+              if(needed[b*blockLen+j]) mergeIn.push_back(b*blockLen+j);
+            }
+          }
+
+          std::vector<bool> neededRanks(blockLen,false);
+          for(unsigned int i=0;i<mergeIn.size();++i) neededRanks[mergeIn[i]%blockLen] = true;
+          std::vector<bool> neededSort(blockLen,false);
+          for(int j=0;j<blockLen;++j){
+            if(!neededRanks[j]) continue;
+            ranks.push_back(j);
+            rankRegs.push_back(sortRegs[j]);
+            neededSort[sortRegs[j]] = true;
+          }
+          prune(sortA,sortB,neededSort);
+          for(int j=0;j<blockLen;++j){
+            if(neededSort[j]) sortIn.push_back(j);
+          }
+        }
 
-            for (int i = 0; i < 65536; ++i) {
-              sum += hist[i];
-              if (sum >= halfexact) {
-                *d = median = i;
-                left = sum - hist[i];
+        static int next_pow2(int n){
+          int p = 1;
+          while(p < n) p *= 2;
+          return p;
+        }
 
-                break;
+        /// Batcher's odd-even merge sort for n positions, starting with sorted blocks of size minBlock
+        /** regs[i] is the register at position i or -1 for padding positions, which are
+            treated as +inf: comparators with padding positions are not needed, but they
+            can move the register to another position. After sorting, regs[i] is the
+            register with the i-th smallest value. */
+        static void batcher(int n, int minBlock, std::vector<int> &regs, std::vector<int> &a, std::vector<int> &b){
+          for(int p=minBlock;p<n;p*=2){
+            for(int k=p;k>=1;k/=2){
+              for(int j=k%p;j+k<n;j+=2*k){
+                for(int i=0;i<k && i+j+k<n;++i){
+                  if((i+j)/(2*p) != (i+j+k)/(2*p)) continue;
+                  int &ra = regs[i+j], &rb = regs[i+j+k];
+                  if(rb < 0) continue;
+                  if(ra < 0){
+                    std::swap(ra,rb);
+                  }else{
+                    a.push_back(ra);
+                    b.push_back(rb);
+                  }
+                }
               }
             }
+          }
+        }
+
+        /// removes all comparators, that do not influence the needed registers
+        /** On return, needed marks the registers whose input values are needed */
+        static void prune(std::vector<int> &a, std::vector<int> &b, std::vector<bool> &needed){
+          std::vector<int> ka, kb;
+          for(int i=(int)a.size()-1;i>=0;--i){
+            if(needed[a[i]] || needed[b[i]]){
+              needed[a[i]] = needed[b[i]] = true;
+              ka.push_back(a[i]);
+              kb.push_back(b[i]);
+            }
+          }
+          a.assign(ka.rbegin(),ka.rend());
+          b.assign(kb.rbegin(),kb.rend());
+        }
+      };
+
+      /// scalar registers for the median network
+      template<class T>
+      struct ScalarLanes{
+        typedef T V;
+        static const int N = 1;
+        static inline V load(const T *p){ return *p; }
+        static inline void store(T *p, const V &v){ *p = v; }
+        static inline void minmax(V &a, V &b){
+          const V t = iclMin(a,b);
+          b = iclMax(a,b);
+          a = t;
+        }
+      };
+
+  #ifdef ICL_HAVE_SSE2
+      /// K SSE registers (4*K floats) for the median network
+      template<int K>
+      struct SSELanes{
+        struct V{ __m128 v[K]; };
+        static const int N = 4*K;
+        static inline V load(const float *p){
+          V r;
+          for(int k=0;k<K;++k) r.v[k] = _mm_loadu_ps(p+4*k);
+          return r;
+        }
+        static inline void store(float *p, const V &v){
+          for(int k=0;k<K;++k) _mm_storeu_ps(p+4*k,v.v[k]);
+        }
+        static inline void minmax(V &a, V &b){
+          for(int k=0;k<K;++k){
+            const __m128 t = _mm_min_ps(a.v[k],b.v[k]);
+            b.v[k] = _mm_max_ps(a.v[k],b.v[k]);
+            a.v[k] = t;
+          }
+        }
+      };
+  #endif
+
+      /// applies a comparator network to the pixels [x,x+L::N)
+      /** in[i] + x is the address of the value of register inRegs[i], results
+          are written to out[i] + x from register outRegs[i] */
+      template<class L, class T>
+      inline void run_median_network(typename L::V *r, int x,
+                                     const T *const *in, const int *inRegs, int nIn,
+                                     const int *a, const int *b, int n,
+                                     T *const *out, const int *outRegs, int nOut){
+        for(int i=0;i<nIn;++i) r[inRegs[i]] = L::load(in[i]+x);
+        for(int i=0;i<n;++i) L::minmax(r[a[i]],r[b[i]]);
+        for(int i=0;i<nOut;++i) L::store(out[i]+x,r[outRegs[i]]);
+      }
 
+      /// applies a comparator network to the pixels [0,width)
+      template<class T>
+      struct MedianNetworkRow{
+        std::vector<T> scalarRegs;
+        MedianNetworkRow(int nRegs):scalarRegs(nRegs){}
+
+        void operator()(int width, const std::vector<const T*> &in, const std::vector<int> &inRegs,
+                        const std::vector<int> &a, const std::vector<int> &b,
+                        const std::vector<T*> &out, const std::vector<int> &outRegs){
+          for(int x=0;x<width;++x){
+            run_median_network<ScalarLanes<T> >(scalarRegs.data(),x,in.data(),inRegs.data(),(int)in.size(),
+                                                a.data(),b.data(),(int)a.size(),out.data(),outRegs.data(),(int)out.size());
+          }
+        }
+      };
 
-            const icl16s *sRtl = s_tl;
-            const icl16s *sRbl = &(s_tl[src->getWidth()*oMaskSize.height]);
+  #ifdef ICL_HAVE_SSE2
+      template<>
+      struct MedianNetworkRow<icl32f>{
+        typedef SSELanes<4> Wide;
+        typedef SSELanes<1> Narrow;
+        std::vector<icl32f> regs;
+        MedianNetworkRow(int nRegs):regs(nRegs*Wide::N+4){}
+
+        void operator()(int width, const std::vector<const icl32f*> &in, const std::vector<int> &inRegs,
+                        const std::vector<int> &a, const std::vector<int> &b,
+                        const std::vector<icl32f*> &out, const std::vector<int> &outRegs){
+          // registers have to be 16 byte aligned
+          icl32f *r = regs.data() + ((16 - (reinterpret_cast<size_t>(regs.data()) & 15)) & 15) / sizeof(icl32f);
+          int x = 0;
+          for(;x<=width-Wide::N;x+=Wide::N){
+            run_median_network<Wide>(reinterpret_cast<Wide::V*>(r),x,in.data(),inRegs.data(),(int)in.size(),
+                                     a.data(),b.data(),(int)a.size(),out.data(),outRegs.data(),(int)out.size());
+          }
+          for(;x<=width-Narrow::N;x+=Narrow::N){
+            run_median_network<Narrow>(reinterpret_cast<Narrow::V*>(r),x,in.data(),inRegs.data(),(int)in.size(),
+                                       a.data(),b.data(),(int)a.size(),out.data(),outRegs.data(),(int)out.size());
+          }
+          for(;x<width;++x){
+            run_median_network<ScalarLanes<icl32f> >(r,x,in.data(),inRegs.data(),(int)in.size(),
+                                                     a.data(),b.data(),(int)a.size(),out.data(),outRegs.data(),(int)out.size());
+          }
+        }
+      };
+  #endif
 
-            for (ImgIterator<icl16s> dCol(d,Size(1,dst->getROIHeight()-1),Point(0,-1)); dCol.inRegionSubROI();
-                  ++dCol, sRtl = &(sRtl[src->getWidth()]), sRbl = &(sRbl[src->getWidth()])) {
-              for (int i = 0; i < oMaskSize.width; ++i) {
-                hist[sRtl[i]]--;
-                if (sRtl[i] < median) --left;
-                hist[sRbl[i]]++;
-                if (sRbl[i] < median) ++left;
+      /// median filter using a MedianNetwork for strips of rows
+      template<class T>
+      struct NetworkMedian{
+        const T *src;
+        T *dst;
+        int srcW, dstW;
+        Size roiSize;
+        int stripH;
+        const MedianNetwork *net;
+
+        void operator()(int begin, int end) const{
+          const MedianNetwork &n = *net;
+          const int L = n.blockLen, nRanks = (int)n.ranks.size();
+          MedianNetworkRow<T> sortRow(L), mergeRow(L*n.numBlocks);
+
+          // sorted blocks: one row of width w per needed rank (for each
+          // of the numBlocks last rows of the mask, if the blocks are rows)
+          const int w = n.rowBlocks ? roiSize.width : roiSize.width + n.numBlocks - 1;
+          const int slots = n.rowBlocks ? n.numBlocks : 1;
+          std::vector<T> sorted(slots*nRanks*w);
+          std::vector<int> rankIndex(L,-1);
+          for(int i=0;i<nRanks;++i) rankIndex[n.ranks[i]] = i;
+
+          std::vector<const T*> sortIn(n.sortIn.size()), mergeIn(n.mergeIn.size());
+          std::vector<T*> sortOut(nRanks), mergeOut(1);
+          const std::vector<int> medianReg(1,n.median);
+
+          for(int strip=begin;strip<end;++strip){
+            const int y0 = strip*stripH, y1 = iclMin(y0+stripH,roiSize.height);
+            if(n.rowBlocks){
+              for(int y=y0;y<y0+n.numBlocks-1;++y) sort_rows(sortRow,y,sorted,w,nRanks,sortIn,sortOut);
+            }
+            for(int y=y0;y<y1;++y){
+              if(n.rowBlocks){
+                sort_rows(sortRow,y+n.numBlocks-1,sorted,w,nRanks,sortIn,sortOut);
+              }else{
+                // sort the columns x of rows [y,y+mh)
+                for(unsigned int i=0;i<sortIn.size();++i) sortIn[i] = src + (y+n.sortIn[i])*srcW;
+                for(int i=0;i<nRanks;++i) sortOut[i] = sorted.data() + i*w;
+                sortRow(w,sortIn,n.sortIn,n.sortA,n.sortB,sortOut,n.rankRegs);
               }
 
-              if (left > half) {
-                do {
-                  --median;
-                  left -= hist[median];
-                } while(left > half);
-              } else {
-                while (left + hist[median] < halfexact) {
-                  left += hist[median];
-                  ++median;
+              for(unsigned int i=0;i<mergeIn.size();++i){
+                const int block = n.mergeIn[i] / L, rank = rankIndex[n.mergeIn[i] % L];
+                if(n.rowBlocks){
+                  mergeIn[i] = sorted.data() + (((y+block)%slots)*nRanks + rank)*w;
+                }else{
+                  mergeIn[i] = sorted.data() + rank*w + block;
                 }
               }
-
-              *dCol = median;
+              mergeOut[0] = dst + y*dstW;
+              mergeRow(roiSize.width,mergeIn,n.mergeIn,n.mergeA,n.mergeB,mergeOut,medianReg);
             }
           }
         }
+
+        /// sorts the row segments [x,x+mw) of source row y
+        void sort_rows(MedianNetworkRow<T> &sortRow, int y, std::vector<T> &sorted, int w, int nRanks,
+                       std::vector<const T*> &sortIn, std::vector<T*> &sortOut) const{
+          const MedianNetwork &n = *net;
+          for(unsigned int i=0;i<sortIn.size();++i) sortIn[i] = src + y*srcW + n.sortIn[i];
+          for(int i=0;i<nRanks;++i) sortOut[i] = sorted.data() + ((y%n.numBlocks)*nRanks + i)*w;
+          sortRow(w,sortIn,n.sortIn,n.sortA,n.sortB,sortOut,n.rankRegs);
+        }
+      };
+
+      /// median filter using sorting networks (falls back to apply_median_select for large masks)
+      template<class T>
+      void apply_median_network(const Img<T> *src, Img<T> *dst, const Size &oMaskSize,const Point &roiOffset,
+                                const Point &oAnchor, int numThreads) {
+        const MedianNetwork cols(oMaskSize,false), rows(oMaskSize,true);
+        const MedianNetwork &net = cols.cost() <= rows.cost() ? cols : rows;
+        if(net.cost() > 16*oMaskSize.getDim()){
+          // the network grows with O(N log^2 N), selection is O(N)
+          apply_median_select(src,dst,oMaskSize,roiOffset,oAnchor,numThreads);
+          return;
+        }
+
+        const Point offs = roiOffset - oAnchor;
+        const Size roiSize = dst->getROISize();
+        const int nStrips = median_num_strips(roiSize,oMaskSize,numThreads);
+
+        NetworkMedian<T> m;
+        m.srcW = src->getWidth();
+        m.dstW = dst->getWidth();
+        m.roiSize = roiSize;
+        m.stripH = (roiSize.height+nStrips-1)/nStrips;
+        m.net = &net;
+        for(int c=0;c<src->getChannels();c++){
+          m.src = src->getData(c) + offs.x + offs.y*m.srcW;
+          m.dst = dst->getROIData(c);
+          parallel_for(0,nStrips,m,1,numThreads);
+        }
+      }
+
+      /// median for masks sizes, that have no special implementation
+      template<class T>
+      inline void apply_median_large(const Img<T> *src, Img<T> *dst, const Size &oMaskSize,const Point &roiOffset,
+                                     const Point &oAnchor, int numThreads) {
+        apply_median_network(src,dst,oMaskSize,roiOffset,oAnchor,numThreads);
+      }
+      inline void apply_median_large(const Img8u *src, Img8u *dst, const Size &oMaskSize,const Point &roiOffset,
+                                     const Point &oAnchor, int numThreads) {
+        apply_median_ctmf(src,dst,oMaskSize,roiOffset,oAnchor,numThreads);
+      }
+      inline void apply_median_large(const Img16s *src, Img16s *dst, const Size &oMaskSize,const Point &roiOffset,
+                                     const Point &oAnchor, int numThreads) {
+        apply_median_ctmf(src,dst,oMaskSize,roiOffset,oAnchor,numThreads);
+      }
+
+      template<typename T>
+      void apply_median(const Img<T> *src, Img<T> *dst, const Size &oMaskSize,const Point &roiOffset,
+                        const Point &oAnchor, int numThreads) {
+        apply_median_large(src,dst,oMaskSize,roiOffset,oAnchor,numThreads);
       }
-      //#endif
-      //#ifdef ICL_HAVE_SSE2
+
+#ifdef ICL_HAVE_SSE2
 
       #define APPLY_MEDIAN(T0, T1, STEP)                                                                                          \
         template<>                                                                                                                \
-        void apply_median(const Img<T0> *src, Img<T0> *dst, const Size &oMaskSize,const Point &roiOffset, const Point &oAnchor) { \
+        void apply_median(const Img<T0> *src, Img<T0> *dst, const Size &oMaskSize,const Point &roiOffset,                  \
+                          const Point &oAnchor, int numThreads) {                                                         \
           if (oMaskSize == Size(3,3)) {                                                                                           \
             for (int c = 0; c < src->getChannels(); c++) {                                                                        \
               const ImgIterator<T0> s_it(const_cast<T0*>(src->getData(c)),src->getWidth(), Rect(roiOffset, dst->getROISize()));   \
@@ -793,13 +1208,14 @@ namespace icl {
                       subMedian5x5<T0>, subSSEMedian5x5<T0,T1>, STEP);                                                            \
             }                                                                                                                     \
           } else {                                                                                                                \
-            apply_median_all(src, dst, oMaskSize, roiOffset, oAnchor);                                                            \
+            apply_median_large(src, dst, oMaskSize, roiOffset, oAnchor, numThreads);                                              \
           }                                                                                                                       \
         }
 
       #define APPLY_MEDIAN2(T0, T1, STEP)                                                                                         \
         template<>                                                                                                                \
-        void apply_median(const Img<T0> *src, Img<T0> *dst, const Size &oMaskSize,const Point &roiOffset, const Point &oAnchor) { \
+        void apply_median(const Img<T0> *src, Img<T0> *dst, const Size &oMaskSize,const Point &roiOffset,                  \
+                          const Point &oAnchor, int numThreads) {                                                         \
           if (oMaskSize == Size(3,3)) {                                                                                           \
             for (int c = 0; c < src->getChannels(); c++) {                                                                        \
               const ImgIterator<T0> s_it(const_cast<T0*>(src->getData(c)),src->getWidth(), Rect(roiOffset, dst->getROISize()));   \
@@ -824,7 +1240,7 @@ namespace icl {
                       subMedian5x5<T0>, subSSEMedian5x5<T0,T1>, STEP);                                                            \
             }                                                                                                                     \
           } else {                                                                                                                \
-            apply_median_all(src, dst, oMaskSize, roiOffset, oAnchor);                                                            \
+            apply_median_large(src, dst, oMaskSize, roiOffset, oAnchor, numThreads);                                              \
           }                                                                                                                       \
         }
 
@@ -832,7 +1248,8 @@ namespace icl {
 
       #define APPLY_MEDIAN(T0, STEP)                                                                                          \
         template<>                                                                                                                \
-        void apply_median(const Img<T0> *src, Img<T0> *dst, const Size &oMaskSize,const Point &roiOffset, const Point &oAnchor) { \
+        void apply_median(const Img<T0> *src, Img<T0> *dst, const Size &oMaskSize,const Point &roiOffset,                  \
+                          const Point &oAnchor, int numThreads) {                                                         \
           if (oMaskSize == Size(3,3)) {                                                                                           \
             for (int c = 0; c < src->getChannels(); c++) {                                                                        \
               const ImgIterator<T0> s(const_cast<T0*>(src->getData(c)),src->getWidth(), Rect(roiOffset, dst->getROISize()));      \
@@ -855,7 +1272,7 @@ namespace icl {
               }                                                                                                                   \
             }                                                                                                                     \
           } else {                                                                                                                \
-            apply_median_all(src, dst, oMaskSize, roiOffset, oAnchor);                                                            \
+            apply_median_large(src, dst, oMaskSize, roiOffset, oAnchor, numThreads);                                              \
           }                                                                                                                       \
         }
 
@@ -911,7 +1328,8 @@ namespace icl {
       // }}}
 
       template<>
-      void apply_median<icl8u>(const Img8u *src, Img8u *dst, const Size &maskSize,const Point &roiOffset, const Point &anchor){
+      void apply_median<icl8u>(const Img8u *src, Img8u *dst, const Size &maskSize,const Point &roiOffset, const Point &anchor,
+                                int){
         // {{{ open
 
         if(maskSize == Size(3,3)){
@@ -926,7 +1344,8 @@ namespace icl {
       // }}}
 
       template<>
-      void apply_median<icl16s>(const Img16s *src, Img16s *dst, const Size &maskSize,const Point &roiOffset, const Point &anchor){
+      void apply_median<icl16s>(const Img16s *src, Img16s *dst, const Size &maskSize,const Point &roiOffset, const Point &anchor,
+                                int){
         // {{{ open
 
         if(maskSize == Size(3,3)){
@@ -940,7 +1359,8 @@ namespace icl {
 
   /* our SSE version is always faster than IPP for icl32f
       template<>
-      void apply_median<icl32f>(const Img32f *src, Img32f *dst, const Size &maskSize,const Point &roiOffset, const Point &anchor){
+      void apply_median<icl32f>(const Img32f *src, Img32f *dst, const Size &maskSize,const Point &roiOffset, const Point &anchor,
+                                int){
         // {{{ open
 
         ippMedian<icl32f,ippiFilterMedian_32f_C1R>(src,dst,maskSize,roiOffset,anchor);
@@ -958,7 +1378,8 @@ namespace icl {
 
       FUNCTION_LOG("");
 
-      if (!prepare (ppoDst, poSrc)) return;
+      Point roiOffset;
+      if (!prepare (ppoDst, poSrc, roiOffset)) return;
 
       switch(poSrc->getDepth()){
   #define ICL_INSTANTIATE_DEPTH(D)                        \
@@ -966,8 +1387,9 @@ namespace icl {
           apply_median(poSrc->asImg<icl##D>(),            \
                        (*ppoDst)->asImg<icl##D>(),        \
                        getMaskSize(),                     \
-                       getROIOffset(),                    \
-                       getAnchor());                      \
+                       roiOffset,                         \
+                       getAnchor(),                       \
+                       m_numThreads);                     \
           break;
         ICL_INSTANTIATE_ALL_DEPTHS;
   #undef ICL_INSTANTIATE_DEPTH
@@ -977,5 +1399,9 @@ namespace icl {
 
     // }}}
 
+    void MedianOp::setNumThreads(int numThreads){
+      m_numThreads = numThreads < 0 ? 1 : numThreads;
+    }
+
   } // namespace filter
 }
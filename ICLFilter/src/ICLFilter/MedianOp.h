@@ -51,39 +51,21 @@ namespace icl {
         Here the algorithm just takes the median using min and max
         functions.
         Images of the type Img8u and Img16s with other mask sizes
-        are processed by the algorithm, that was introduced by
-        Thomas S. Huang. With the help of a histogram the algorithm
-        runs in O(n).
-        For all other types a trivial implementation was designed to
-        calculate the median values. It uses the naive algorithm
-        of sorting all N pixel values inside the median mask,
-        and setting the destination pixel value to the mid-element
-        of the sorted pixel list.
-        This algorithm runs in O(w*h*N*log(N)) where (w,h) is the
-        size of source images ROI, and N=n*n is the mask size used.
-        The following code extract explains the operation of the
-        fallback algorithm in Img-style notation for a single
-        channel image, and Img8u type (the real implementation
-        uses some special optimizations, that are not mentioned
-        further):
-
-        <pre>
-        void channel_median_8u(Img8u &src, Img8u &dst, int w, int h, int c)
-        {
-            std::vector<icl8u> list;
-
-            for(Img8u::iterator s=src.begin(c), d=dst.begin(c); s.inRegion() ; s++, d++ )
-            {
-                for(Img8u::iterator sR(s,w,h); sR.inRegion(); sR++)
-                {
-                   list.push_back(*sR);
-                }
-                std::sort(list.begin(),list.end());
-                *d = list[w*h/2];
-                list.clear();
-            }
-        }
-        </pre>
+        are processed by a constant time median filter (Perreault and
+        Hebert): one coarse/fine histogram pair is kept per column and
+        the histogram of the mask is updated by adding and subtracting
+        whole column histograms. The cost per pixel does not depend on
+        the mask size. Img16s images are shifted by their minimum value,
+        so negative values are handled correctly.
+        For all other types, the median of each mask is computed by
+        a pruned sorting network, that shares the sorted mask columns
+        (or rows) between neighbouring pixels and is evaluated with
+        SSE-instructions for icl32f. As the network grows with
+        O(N log^2 N), very large masks fall back to a selection
+        algorithm (std::nth_element), that runs in O(N) per pixel,
+        where N is the number of mask pixels.
+        Both algorithms can process horizontal image strips in
+        parallel (see setNumThreads).
 
         The IPP implementation uses a fast median algorithm that
         estimates the median not by sorting a list, but by working
@@ -104,6 +86,11 @@ namespace icl {
         the next higher odd value is used.
 
         <h2>Benchmarks</h2>
+        The following table was measured with the former Huang and
+        sorting implementations. Without IPP, the constant time median
+        now needs about 8-11ms for a 640x480 icl8u-image, independent
+        of the mask size, and an icl32f-image needs ~17ms for a 7x7
+        mask (single threaded, no IPP).
         <h3>table</h3>
         <table>
            <tr>
@@ -240,7 +227,7 @@ namespace icl {
       /** @param maskSize of odd width and height
           Even width or height is increased to next higher odd value.
       **/
-      MedianOp (const utils::Size &maskSize):NeighborhoodOp(adaptSize(maskSize)){}
+      MedianOp (const utils::Size &maskSize):NeighborhoodOp(adaptSize(maskSize)),m_numThreads(1){}
 
       /// applies the median operation on poSrc and stores the result in poDst
       /** The depth, channel count and size of poDst is adapted to poSrc' ROI:
@@ -252,6 +239,8 @@ namespace icl {
       /// Import unaryOps apply function without destination image
       using NeighborhoodOp::apply;
 
+      virtual bool isTileable() const { return true; }
+
       /// ensures that mask width and height are odd
       /** This is a workaround, necessary because of an ipp Bug that allows no
           even mask sizes here!
@@ -263,6 +252,16 @@ namespace icl {
         return utils::Size(1+ 2*(size.width/2),1+ 2*(size.height/2));
       }
 
+      /// sets the number of threads (1: calling thread only (default), 0: all threads)
+      /** Only used for mask sizes other than 3x3 and 5x5. Small images are
+          always processed by the calling thread. */
+      void setNumThreads(int numThreads);
+
+      /// returns the number of threads
+      int getNumThreads() const { return m_numThreads; }
+
+    private:
+      int m_numThreads;
 
     };
 
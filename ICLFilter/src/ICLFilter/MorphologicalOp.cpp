@@ -32,8 +32,10 @@
 #include <ICLCore/Img.h>
 #include <ICLUtils/Range.h>
 #include <ICLCore/ImgBorder.h>
-#include <functional>
 #include <ICLFilter/BinaryArithmeticalOp.h>
+#include <ICLUtils/SSETypes.h>
+#include <vector>
+#include <algorithm>
 
 using namespace icl::utils;
 using namespace icl::core;
@@ -41,23 +43,184 @@ using namespace icl::core;
 namespace icl {
   namespace filter{
   #ifndef ICL_HAVE_IPP
-    template<class T, typename cmp_func>
-    void morph_cpp(const Img<T> &src, Img<T> &dst, MorphologicalOp &op,
-                   T init, cmp_func cmp, const icl8u *mask){
+    namespace{
+      /// maximum of two values and of two arrays (used for dilatation)
+      template<class T> struct MorphMax{
+        static inline T apply(T a, T b){ return a < b ? b : a; }
+        static inline void apply(const T *a, const T *b, T *d, int n){
+          for(int i=0;i<n;++i) d[i] = apply(a[i],b[i]);
+        }
+      };
+
+      /// minimum of two values and of two arrays (used for erosion)
+      template<class T> struct MorphMin{
+        static inline T apply(T a, T b){ return b < a ? b : a; }
+        static inline void apply(const T *a, const T *b, T *d, int n){
+          for(int i=0;i<n;++i) d[i] = apply(a[i],b[i]);
+        }
+      };
+
+  #ifdef ICL_HAVE_SSE2
+  #define ICL_MORPH_SSE_OP(NAME,T,VT,LOAD,STORE,INTRIN,STEP)             \
+      template<> inline void NAME<T>::apply(const T *a, const T *b, T *d, int n){ \
+        int i = 0;                                                        \
+        for(;i<=n-STEP;i+=STEP){                                          \
+          STORE(d+i,INTRIN(LOAD(a+i),LOAD(b+i)));                         \
+        }                                                                 \
+        for(;i<n;++i) d[i] = apply(a[i],b[i]);                            \
+      }
+
+  #define ICL_MORPH_LOAD_8U(p) _mm_loadu_si128((const __m128i*)(p))
+  #define ICL_MORPH_STORE_8U(p,v) _mm_storeu_si128((__m128i*)(p),v)
+      ICL_MORPH_SSE_OP(MorphMax,icl8u,__m128i,ICL_MORPH_LOAD_8U,ICL_MORPH_STORE_8U,_mm_max_epu8,16)
+      ICL_MORPH_SSE_OP(MorphMin,icl8u,__m128i,ICL_MORPH_LOAD_8U,ICL_MORPH_STORE_8U,_mm_min_epu8,16)
+      ICL_MORPH_SSE_OP(MorphMax,icl32f,__m128,_mm_loadu_ps,_mm_storeu_ps,_mm_max_ps,4)
+      ICL_MORPH_SSE_OP(MorphMin,icl32f,__m128,_mm_loadu_ps,_mm_storeu_ps,_mm_min_ps,4)
+  #undef ICL_MORPH_LOAD_8U
+  #undef ICL_MORPH_STORE_8U
+  #undef ICL_MORPH_SSE_OP
+  #endif
+
+      /// masks up to this length are processed directly, longer ones using van Herk/Gil-Werman
+      static const int MAX_DIRECT_LENGTH = 4;
+
+      /// d[x] = extremum of s[x] .. s[x+len-1] for x in [0,n) (van Herk/Gil-Werman)
+      /** s must contain n+len-1 values, g and h are buffers for n+len-1 values.
+          Independent of len, 3 comparisons are needed per value */
+      template<class T, class Op>
+      void vhgw_row(const T *s, T *d, int n, int len, T *g, T *h){
+        const int m = n+len-1;
+        for(int b=0;b<m;b+=len){
+          const int e = std::min(b+len,m)-1;
+          g[b] = s[b];
+          for(int i=b+1;i<=e;++i) g[i] = Op::apply(g[i-1],s[i]);
+          h[e] = s[e];
+          for(int i=e-1;i>=b;--i) h[i] = Op::apply(h[i+1],s[i]);
+        }
+        for(int x=0;x<n;++x) d[x] = Op::apply(h[x],g[x+len-1]);
+      }
+
+      /// d[x] = extremum of s[x] .. s[x+len-1] for x in [0,n)
+      template<class T, class Op>
+      void running_extremum_row(const T *s, T *d, int n, int len, std::vector<T> &buf){
+        if(len <= MAX_DIRECT_LENGTH){
+          std::copy(s,s+n,d);
+          for(int k=1;k<len;++k) Op::apply(d,s+k,d,n);
+        }else{
+          buf.resize(2*(n+len-1));
+          vhgw_row<T,Op>(s,d,n,len,buf.data(),buf.data()+n+len-1);
+        }
+      }
+
+      /// row y of dst = extremum of the rows y .. y+len-1 of src (rows of width w)
+      /** This is the vertical version of vhgw_row: all operations are applied
+          to whole rows, so they are vectorized */
+      template<class T, class Op>
+      void running_extremum_cols(const std::vector<const T*> &src, const std::vector<T*> &dst,
+                                 int w, int len, std::vector<T> &buf){
+        const int n = (int)dst.size();
+        if(len <= MAX_DIRECT_LENGTH){
+          for(int y=0;y<n;++y){
+            std::copy(src[y],src[y]+w,dst[y]);
+            for(int k=1;k<len;++k) Op::apply(dst[y],src[y+k],dst[y],w);
+          }
+          return;
+        }
+        const int m = n+len-1;
+        buf.resize(2*(size_t)m*w);
+        T *g = buf.data(), *h = g + (size_t)m*w;
+        for(int b=0;b<m;b+=len){
+          const int e = std::min(b+len,m)-1;
+          std::copy(src[b],src[b]+w,g+(size_t)b*w);
+          for(int i=b+1;i<=e;++i) Op::apply(g+(size_t)(i-1)*w,src[i],g+(size_t)i*w,w);
+          std::copy(src[e],src[e]+w,h+(size_t)e*w);
+          for(int i=e-1;i>=b;--i) Op::apply(h+(size_t)(i+1)*w,src[i],h+(size_t)i*w,w);
+        }
+        for(int y=0;y<n;++y) Op::apply(h+(size_t)y*w,g+(size_t)(y+len-1)*w,dst[y],w);
+      }
+
+      /// horizontal run of non-zero mask entries
+      struct MaskRun{
+        int row;   //!< mask row
+        int x;     //!< first column of the run
+        int len;   //!< length of the run
+      };
+    }
+
+    /// dilatation or erosion of the source region Rect(roiOffset,dst.getROISize())
+    /** Rectangular masks are decomposed into a row and a column pass, each of
+        them using the van Herk/Gil-Werman algorithm. Other masks are decomposed
+        into horizontal runs of non-zero entries. The running extrema are computed
+        once for each run length, so that each run costs one comparison per pixel. */
+    template<class T, class Op>
+    void morph_cpp(const Img<T> &src, Img<T> &dst, const MorphologicalOp &op, const Point &roiOffset,
+                   T init, const icl8u *mask){
+      const Point an = op.getAnchor();
+      const Size si = op.getMaskSize();
+      const Size roi = dst.getROISize();
+      if(!roi.getDim()) return;
+
+      std::vector<MaskRun> runs;
+      for(int j=0;j<si.height;++j){
+        for(int i=0;i<si.width;){
+          if(!mask[i+j*si.width]){ ++i; continue; }
+          MaskRun r = { j, i, 0 };
+          while(i < si.width && mask[i+j*si.width]){ ++i; ++r.len; }
+          runs.push_back(r);
+        }
+      }
+      bool rectangular = (int)runs.size() == si.height;
+      for(unsigned int i=0;rectangular && i<runs.size();++i) rectangular = runs[i].len == si.width;
+
+      // source rows, that are touched by the mask
+      const int nRows = roi.height + si.height - 1;
+      const int x0 = roiOffset.x - an.x, y0 = roiOffset.y - an.y;
+      const int sw = src.getWidth();
+
+      std::vector<int> lengths;
+      for(unsigned int i=0;i<runs.size();++i){
+        if(std::find(lengths.begin(),lengths.end(),runs[i].len) == lengths.end()) lengths.push_back(runs[i].len);
+      }
+
+      // horizontal running extrema of all needed rows for each run length
+      std::vector<std::vector<T> > hor(lengths.size());
+      std::vector<T> buf;
+      std::vector<const T*> rows(nRows);
+      std::vector<T*> dstRows(roi.height);
 
-      Point an = op.getAnchor();
-      Size si = op.getMaskSize();
       for(int c=0;c<src.getChannels();++c){
-        const ImgIterator<T> s(const_cast<T*>(src.getData(c)), src.getWidth(),Rect(op.getROIOffset(), dst.getROISize()));
-        const ImgIterator<T> sEnd = ImgIterator<T>::create_end_roi_iterator(src.getData(c),src.getWidth(), Rect(op.getROIOffset(), dst.getROISize()));
-        ImgIterator<T> d = dst.beginROI(c);
-        for(; s != sEnd; ++s){
-          const icl8u *m = mask;
-          T best = init;
-          for(const ImgIterator<T> sR (s,si,an);sR.inRegionSubROI(); ++sR, ++m){
-            if(*m && cmp(*sR,best)) best = *sR;
+        for(int y=0;y<roi.height;++y) dstRows[y] = dst.getROIData(c) + y*dst.getWidth();
+        if(!runs.size()){
+          for(int y=0;y<roi.height;++y) std::fill(dstRows[y],dstRows[y]+roi.width,init);
+          continue;
+        }
+
+        const T *s0 = src.getData(c) + x0 + y0*sw;
+        for(unsigned int l=0;l<lengths.size();++l){
+          const int len = lengths[l];
+          const int w = roi.width + si.width - len;
+          hor[l].resize((size_t)w*nRows);
+          for(int y=0;y<nRows;++y){
+            running_extremum_row<T,Op>(s0+y*sw,hor[l].data()+(size_t)y*w,w,len,buf);
+          }
+        }
+
+        if(rectangular){
+          for(int y=0;y<nRows;++y) rows[y] = hor[0].data()+(size_t)y*roi.width;
+          running_extremum_cols<T,Op>(rows,dstRows,roi.width,si.height,buf);
+          continue;
+        }
+
+        for(int y=0;y<roi.height;++y){
+          T *d = dstRows[y];
+          for(unsigned int r=0;r<runs.size();++r){
+            const MaskRun &run = runs[r];
+            const int l = (int)(std::find(lengths.begin(),lengths.end(),run.len)-lengths.begin());
+            const int w = roi.width + si.width - run.len;
+            const T *h = hor[l].data() + (size_t)(y+run.row)*w + run.x;
+            if(r) Op::apply(d,h,d,roi.width);
+            else std::copy(h,h+roi.width,d);
           }
-          *d++ = best;
         }
       }
     }
@@ -81,7 +244,7 @@ namespace icl {
 
 
     template<class T>
-    void MorphologicalOp::apply_t(const ImgBase *poSrc, ImgBase **ppoDst){
+    void MorphologicalOp::apply_t(const ImgBase *poSrc, ImgBase **ppoDst, const Point &roiOffset){
       const Img<T> &src = *poSrc->asImg<T>();
       Img<T> &dst = *(*ppoDst)->asImg<T>();
       Range<T> limits = Range<T>::limits();
@@ -96,12 +259,12 @@ namespace icl {
         case dilate:
         case dilate3x3:
         case dilateBorderReplicate:
-          morph_cpp(src,dst,*this,limits.minVal,std::greater<T>(),getMask());
+          morph_cpp<T,MorphMax<T> >(src,dst,*this,roiOffset,limits.minVal,getMask());
           break;
         case erode:
         case erode3x3:
         case erodeBorderReplicate:
-          morph_cpp(src,dst,*this,limits.maxVal,std::less<T>(),getMask());
+          morph_cpp<T,MorphMin<T> >(src,dst,*this,roiOffset,limits.maxVal,getMask());
           break;
         case tophatBorder:
         case blackhatBorder:{
@@ -147,7 +310,7 @@ namespace icl {
           op.setClipToROI(getClipToROI());
           op.setCheckOnly(getCheckOnly());
           op.apply(poSrc,&m_openingAndClosingBuffer);
-          op.setOptype(m_eType==openBorder ? erode : dilate);
+          op.setOptype(m_eType==openBorder ? dilate : erode);
           op.apply(m_openingAndClosingBuffer,ppoDst);
           break;
         }
@@ -167,14 +330,15 @@ namespace icl {
 
     void MorphologicalOp::apply (const ImgBase *poSrc, ImgBase **ppoDst){
       FUNCTION_LOG("");
-      if (!prepare (ppoDst, poSrc)) return;
+      Point roiOffset;
+      if (!prepare (ppoDst, poSrc, roiOffset)) return;
 
       switch (poSrc->getDepth()){
         case depth8u:
-          apply_t<icl8u>(poSrc,ppoDst);
+          apply_t<icl8u>(poSrc,ppoDst,roiOffset);
           break;
         case depth32f:
-          apply_t<icl32f>(poSrc,ppoDst);
+          apply_t<icl32f>(poSrc,ppoDst,roiOffset);
           break;
         default:
           ICL_INVALID_DEPTH;
@@ -187,8 +351,8 @@ namespace icl {
     {
       ICLASSERT_RETURN(maskSize.getDim());
       m_pcMask = 0;
-      setMask (maskSize,pcMask);
       m_eType = eOptype;
+      setMask (maskSize,pcMask);
     }
 
     MorphologicalOp::MorphologicalOp (const std::string &o, const Size &maskSize,const icl8u *pcMask):
@@ -196,7 +360,6 @@ namespace icl {
     {
       ICLASSERT_RETURN(maskSize.getDim());
       m_pcMask = 0;
-      setMask (maskSize,pcMask);
 
 #define CHECK_OPTYPE(X) else if(o == #X) { m_eType = X; }
       if(o == "dilate") { m_eType = dilate; }
@@ -214,6 +377,7 @@ namespace icl {
       else{
         throw ICLException("MorphologicalOp::MorphologicalOp: invalid optype string!");
       }
+      setMask (maskSize,pcMask);
     }
 
 
@@ -250,7 +414,6 @@ namespace icl {
     MorphologicalOp::MorphologicalOp (const std::string &o, const Size &maskSize,const icl8u *pcMask){
       ICLASSERT_RETURN(maskSize.getDim());
       m_pcMask = 0;
-      setMask (maskSize,pcMask);
 
     m_bMorphState8u=false;
       m_bMorphState32f=false;
@@ -280,6 +443,7 @@ namespace icl {
       else{
         throw ICLException("MorphologicalOp::MorphologicalOp: invalid optype string!");
       }
+      setMask (maskSize,pcMask);
     }
 
 
@@ -349,7 +513,8 @@ namespace icl {
 
     void MorphologicalOp::apply (const ImgBase *poSrc, ImgBase **ppoDst){
       FUNCTION_LOG("");
-      if (!prepare (ppoDst, poSrc)) return;
+      Point roiOffset;
+      if (!prepare (ppoDst, poSrc, roiOffset)) return;
 
       IppStatus s = ippStsNoErr;
       switch (poSrc->getDepth()){
@@ -358,44 +523,44 @@ namespace icl {
           Img8u *dst = (*ppoDst)->asImg<icl8u>();
           switch (m_eType){
             case dilate:
-              s=ippiMorphologicalCall<icl8u,ippiDilate_8u_C1R> (src,dst);
+              s=ippiMorphologicalCall<icl8u,ippiDilate_8u_C1R> (src,dst,roiOffset);
               break;
             case erode:
-              s=ippiMorphologicalCall<icl8u,ippiErode_8u_C1R> (src,dst);
+              s=ippiMorphologicalCall<icl8u,ippiErode_8u_C1R> (src,dst,roiOffset);
               break;
             case dilate3x3:
-              s=ippiMorphologicalCall3x3<icl8u,ippiDilate3x3_8u_C1R> (src,dst);
+              s=ippiMorphologicalCall3x3<icl8u,ippiDilate3x3_8u_C1R> (src,dst,roiOffset);
               break;
             case erode3x3:
-              s=ippiMorphologicalCall3x3<icl8u,ippiErode3x3_8u_C1R> (src,dst);
+              s=ippiMorphologicalCall3x3<icl8u,ippiErode3x3_8u_C1R> (src,dst,roiOffset);
               break;
             case dilateBorderReplicate:
               checkMorphState8u(src->getROISize());
-              s=ippiMorphologicalBorderReplicateCall<icl8u,ippiDilateBorderReplicate_8u_C1R> (src,dst,m_pState8u);
+              s=ippiMorphologicalBorderReplicateCall<icl8u,ippiDilateBorderReplicate_8u_C1R> (src,dst,roiOffset,m_pState8u);
               break;
             case erodeBorderReplicate:
               checkMorphState8u(src->getROISize());
-              s=ippiMorphologicalBorderReplicateCall<icl8u,ippiErodeBorderReplicate_8u_C1R> (src,dst,m_pState8u);
+              s=ippiMorphologicalBorderReplicateCall<icl8u,ippiErodeBorderReplicate_8u_C1R> (src,dst,roiOffset,m_pState8u);
               break;
             case openBorder:
               checkMorphAdvState8u(src->getROISize());
-              s=ippiMorphologicalBorderCall<icl8u,ippiMorphOpenBorder_8u_C1R> (src,dst,m_pAdvState8u);
+              s=ippiMorphologicalBorderCall<icl8u,ippiMorphOpenBorder_8u_C1R> (src,dst,roiOffset,m_pAdvState8u);
               break;
             case closeBorder:
               checkMorphAdvState8u(src->getROISize());
-              s=ippiMorphologicalBorderCall<icl8u,ippiMorphCloseBorder_8u_C1R> (src,dst,m_pAdvState8u);
+              s=ippiMorphologicalBorderCall<icl8u,ippiMorphCloseBorder_8u_C1R> (src,dst,roiOffset,m_pAdvState8u);
               break;
             case tophatBorder:
               checkMorphAdvState8u(src->getROISize());
-              s=ippiMorphologicalBorderCall<icl8u,ippiMorphTophatBorder_8u_C1R> (src,dst,m_pAdvState8u);
+              s=ippiMorphologicalBorderCall<icl8u,ippiMorphTophatBorder_8u_C1R> (src,dst,roiOffset,m_pAdvState8u);
               break;
             case blackhatBorder:
               checkMorphAdvState8u(src->getROISize());
-              s=ippiMorphologicalBorderCall<icl8u,ippiMorphBlackhatBorder_8u_C1R> (src,dst,m_pAdvState8u);
+              s=ippiMorphologicalBorderCall<icl8u,ippiMorphBlackhatBorder_8u_C1R> (src,dst,roiOffset,m_pAdvState8u);
               break;
             case gradientBorder:
               checkMorphAdvState8u(src->getROISize());
-              s=ippiMorphologicalBorderCall<icl8u,ippiMorphGradientBorder_8u_C1R> (src,dst,m_pAdvState8u);
+              s=ippiMorphologicalBorderCall<icl8u,ippiMorphGradientBorder_8u_C1R> (src,dst,roiOffset,m_pAdvState8u);
               break;
           }
         break;
@@ -405,44 +570,44 @@ namespace icl {
           Img32f *dst = (*ppoDst)->asImg<icl32f>();
           switch (m_eType){
             case dilate:
-              s=ippiMorphologicalCall<icl32f,ippiDilate_32f_C1R> (src,dst);
+              s=ippiMorphologicalCall<icl32f,ippiDilate_32f_C1R> (src,dst,roiOffset);
               break;
             case erode:
-              s=ippiMorphologicalCall<icl32f,ippiErode_32f_C1R> (src,dst);
+              s=ippiMorphologicalCall<icl32f,ippiErode_32f_C1R> (src,dst,roiOffset);
               break;
             case dilate3x3:
-              s=ippiMorphologicalCall3x3<icl32f,ippiDilate3x3_32f_C1R> (src,dst);
+              s=ippiMorphologicalCall3x3<icl32f,ippiDilate3x3_32f_C1R> (src,dst,roiOffset);
               break;
             case erode3x3:
-              s=ippiMorphologicalCall3x3<icl32f,ippiErode3x3_32f_C1R> (src,dst);
+              s=ippiMorphologicalCall3x3<icl32f,ippiErode3x3_32f_C1R> (src,dst,roiOffset);
               break;
             case dilateBorderReplicate:
               checkMorphState32f(src->getROISize());
-              s=ippiMorphologicalBorderReplicateCall<icl32f,ippiDilateBorderReplicate_32f_C1R> (src,dst,m_pState32f);
+              s=ippiMorphologicalBorderReplicateCall<icl32f,ippiDilateBorderReplicate_32f_C1R> (src,dst,roiOffset,m_pState32f);
               break;
             case erodeBorderReplicate:
               checkMorphState32f(src->getROISize());
-              s=ippiMorphologicalBorderReplicateCall<icl32f,ippiErodeBorderReplicate_32f_C1R> (src,dst,m_pState32f);
+              s=ippiMorphologicalBorderReplicateCall<icl32f,ippiErodeBorderReplicate_32f_C1R> (src,dst,roiOffset,m_pState32f);
               break;
             case openBorder:
               checkMorphAdvState32f(src->getROISize());
-              s=ippiMorphologicalBorderCall<icl32f,ippiMorphOpenBorder_32f_C1R> (src,dst,m_pAdvState32f);
+              s=ippiMorphologicalBorderCall<icl32f,ippiMorphOpenBorder_32f_C1R> (src,dst,roiOffset,m_pAdvState32f);
               break;
             case closeBorder:
               checkMorphAdvState32f(src->getROISize());
-              s=ippiMorphologicalBorderCall<icl32f,ippiMorphCloseBorder_32f_C1R> (src,dst,m_pAdvState32f);
+              s=ippiMorphologicalBorderCall<icl32f,ippiMorphCloseBorder_32f_C1R> (src,dst,roiOffset,m_pAdvState32f);
               break;
             case tophatBorder:
               checkMorphAdvState32f(src->getROISize());
-              s=ippiMorphologicalBorderCall<icl32f,ippiMorphTophatBorder_32f_C1R> (src,dst,m_pAdvState32f);
+              s=ippiMorphologicalBorderCall<icl32f,ippiMorphTophatBorder_32f_C1R> (src,dst,roiOffset,m_pAdvState32f);
               break;
             case blackhatBorder:
               checkMorphAdvState32f(src->getROISize());
-              s=ippiMorphologicalBorderCall<icl32f,ippiMorphBlackhatBorder_32f_C1R> (src,dst,m_pAdvState32f);
+              s=ippiMorphologicalBorderCall<icl32f,ippiMorphBlackhatBorder_32f_C1R> (src,dst,roiOffset,m_pAdvState32f);
               break;
             case gradientBorder:
               checkMorphAdvState32f(src->getROISize());
-              s=ippiMorphologicalBorderCall<icl32f,ippiMorphGradientBorder_32f_C1R> (src,dst,m_pAdvState32f);
+              s=ippiMorphologicalBorderCall<icl32f,ippiMorphGradientBorder_32f_C1R> (src,dst,roiOffset,m_pAdvState32f);
               break;
           }
           break;
@@ -459,9 +624,9 @@ namespace icl {
 
 
     template<typename T, IppStatus (IPP_DECL *ippiFunc) (const T*, int, T*, int, IppiSize, const Ipp8u*, IppiSize, IppiPoint)>
-    IppStatus MorphologicalOp::ippiMorphologicalCall (const Img<T> *src, Img<T> *dst) {
+    IppStatus MorphologicalOp::ippiMorphologicalCall (const Img<T> *src, Img<T> *dst, const Point &roiOffset) {
       for(int c=0; c < src->getChannels(); c++) {
-        IppStatus s = ippiFunc(src->getROIData (c, this->m_oROIOffset),
+        IppStatus s = ippiFunc(src->getROIData (c, roiOffset),
                                src->getLineStep(),
                                dst->getROIData (c),
                                dst->getLineStep(),
@@ -473,9 +638,9 @@ namespace icl {
     }
 
     template<typename T, IppStatus (IPP_DECL *ippiFunc) (const T*, int, T*, int, IppiSize)>
-    IppStatus MorphologicalOp::ippiMorphologicalCall3x3 (const Img<T> *src, Img<T> *dst) {
+    IppStatus MorphologicalOp::ippiMorphologicalCall3x3 (const Img<T> *src, Img<T> *dst, const Point &roiOffset) {
       for(int c=0; c < src->getChannels(); c++) {
-        IppStatus s = ippiFunc(src->getROIData (c, this->m_oROIOffset),
+        IppStatus s = ippiFunc(src->getROIData (c, roiOffset),
                                src->getLineStep(),
                                dst->getROIData (c),
                                dst->getLineStep(),
@@ -487,9 +652,9 @@ namespace icl {
     }
 
     template<typename T, IppStatus (IPP_DECL *ippiFunc) (const T*, int, T*, int, IppiSize, _IppiBorderType, IppiMorphState*)>
-    IppStatus MorphologicalOp::ippiMorphologicalBorderReplicateCall (const Img<T> *src, Img<T> *dst,IppiMorphState* state) {
+    IppStatus MorphologicalOp::ippiMorphologicalBorderReplicateCall (const Img<T> *src, Img<T> *dst, const Point &roiOffset,IppiMorphState* state) {
       for(int c=0; c < src->getChannels(); c++) {
-        IppStatus s = ippiFunc(src->getROIData (c, this->m_oROIOffset),
+        IppStatus s = ippiFunc(src->getROIData (c, roiOffset),
                                src->getLineStep(),
                                dst->getROIData (c),
                                dst->getLineStep(),
@@ -503,9 +668,9 @@ namespace icl {
     }
 
     template<typename T, IppStatus (IPP_DECL *ippiFunc) (const T*, int, T*, int, IppiSize, IppiBorderType, IppiMorphAdvState*)>
-    IppStatus MorphologicalOp::ippiMorphologicalBorderCall (const Img<T> *src, Img<T> *dst, IppiMorphAdvState* advState) {
+    IppStatus MorphologicalOp::ippiMorphologicalBorderCall (const Img<T> *src, Img<T> *dst, const Point &roiOffset, IppiMorphAdvState* advState) {
       for(int c=0; c < src->getChannels(); c++) {
-        IppStatus s = ippiFunc(src->getROIData (c, this->m_oROIOffset),
+        IppStatus s = ippiFunc(src->getROIData (c, roiOffset),
                                src->getLineStep(),
                                dst->getROIData (c),
                                dst->getLineStep(),
@@ -531,13 +696,15 @@ namespace icl {
         NeighborhoodOp::setMask (maskSize);
       }
 
-      ICL_DELETE_ARRAY(m_pcMask);
-      m_pcMask = new icl8u[maskSize.getDim()];
+      // pcMask may be the current mask (see setOptype)
+      icl8u *newMask = new icl8u[maskSize.getDim()];
       if(pcMask){
-        std::copy(pcMask,pcMask+maskSize.getDim(),m_pcMask);
+        std::copy(pcMask,pcMask+maskSize.getDim(),newMask);
       }else{
-        std::fill(m_pcMask,m_pcMask+maskSize.getDim(),255);
+        std::fill(newMask,newMask+maskSize.getDim(),255);
       }
+      ICL_DELETE_ARRAY(m_pcMask);
+      m_pcMask = newMask;
 
       m_oMaskSizeMorphOp=maskSize;
       m_bHas_changed=true;
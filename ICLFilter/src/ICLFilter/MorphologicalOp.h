@@ -78,6 +78,15 @@ namespace icl {
         -# <b>blackhat</b> closing result - source image
         -# <b>gradient</b> closing result - opened result
 
+        \section FB Fallback Implementation
+        Without IPP, dilatation and erosion (and therefore all other operations)
+        use the van Herk/Gil-Werman algorithm: for masks whose entries are all
+        non-zero, a row pass and a column pass are applied, each of them needs
+        3 comparisons per pixel independent of the mask size. Arbitrary masks
+        are decomposed into horizontal runs of non-zero entries whose running
+        extrema are computed once per run length. For Img8u and Img32f, the
+        row-wise comparisons are SSE2 vectorized.
+
         \section EX Examples
         As a useful help, some example images are shown here:
 
@@ -149,19 +158,23 @@ namespace icl {
       /// Import unaryOps apply function without destination image
       using UnaryOp::apply;
 
+      /// only dilate and erode can be applied on image tiles (see UnaryOp::isTileable)
+      /** The other operation types use internal buffers or replicate the image borders */
+      virtual bool isTileable() const { return m_eType == dilate || m_eType == erode; }
+
   #ifdef ICL_HAVE_IPP
     private:
 
       template<typename T, IppStatus (IPP_DECL *ippiFunc) (const T*, int, T*, int, IppiSize, const Ipp8u*, IppiSize, IppiPoint)>
-      IppStatus ippiMorphologicalCall (const core::Img<T> *src, core::Img<T> *dst);
+      IppStatus ippiMorphologicalCall (const core::Img<T> *src, core::Img<T> *dst, const utils::Point &roiOffset);
       template<typename T, IppStatus (IPP_DECL *ippiFunc) (const T*, int, T*, int, IppiSize)>
-      IppStatus ippiMorphologicalCall3x3 (const core::Img<T> *src, core::Img<T> *dst);
+      IppStatus ippiMorphologicalCall3x3 (const core::Img<T> *src, core::Img<T> *dst, const utils::Point &roiOffset);
 
       template<typename T, IppStatus (IPP_DECL *ippiFunc) (const T*, int, T*, int, IppiSize, _IppiBorderType, IppiMorphState*)>
-      IppStatus ippiMorphologicalBorderReplicateCall (const core::Img<T> *src, core::Img<T> *dst,IppiMorphState *state);
+      IppStatus ippiMorphologicalBorderReplicateCall (const core::Img<T> *src, core::Img<T> *dst, const utils::Point &roiOffset,IppiMorphState *state);
 
       template<typename T, IppStatus (IPP_DECL *ippiFunc) (const T*, int, T*, int, IppiSize, IppiBorderType, IppiMorphAdvState*)>
-      IppStatus ippiMorphologicalBorderCall (const core::Img<T> *src, core::Img<T> *dst, IppiMorphAdvState *advState);
+      IppStatus ippiMorphologicalBorderCall (const core::Img<T> *src, core::Img<T> *dst, const utils::Point &roiOffset, IppiMorphAdvState *advState);
 
       typedef IppiMorphState ICLMorphState ;
       typedef IppiMorphAdvState ICLMorphAdvState;
@@ -174,7 +187,7 @@ namespace icl {
 
     private:
       template<class T>
-      void apply_t(const core::ImgBase *src, core::ImgBase **dst);
+      void apply_t(const core::ImgBase *src, core::ImgBase **dst, const utils::Point &roiOffset);
   #endif
     private:
       icl8u * m_pcMask;
@@ -32,6 +32,9 @@
 #include <ICLFilter/MotionSensitiveTemporalSmoothing.h>
 #include <ICLFilter/ConvolutionOp.h>
 #include <ICLCore/Img.h>
+#include <ICLUtils/ThreadPool.h>
+#include <ICLUtils/SSETypes.h>
+#include <algorithm>
 
 using namespace icl::utils;
 using namespace icl::core;
@@ -102,6 +105,242 @@ static char timeSmoothingKernel[] =
 ;
 #endif
 
+namespace {
+	/// updates the running sums and counts of n pixels for the new values src replacing old
+	/** Pixels whose value does not change are skipped, so the sums are exactly
+	    the same as if they were updated one value at a time */
+	template<class T, class S>
+	inline void update_running_sums(const T *src, const T *old, S *sum,
+			icl32s *count, int n, int nullValue) {
+		for (int i = 0; i < n; ++i) {
+			const T v = src[i], o = old[i];
+			if (v == o) continue;
+			if (o != nullValue) {
+				sum[i] -= o;
+				--count[i];
+			}
+			if (v != nullValue) {
+				sum[i] += v;
+				++count[i];
+			}
+		}
+	}
+
+#ifdef ICL_HAVE_SSE2
+	/// SSE2 version for 8u (16 pixels per step, 32s sums)
+	inline void update_running_sums(const icl8u *src, const icl8u *old,
+			icl32s *sum, icl32s *count, int n, int nullValue) {
+		const bool hasNull = nullValue >= 0 && nullValue <= 255;
+		const __m128i nv = _mm_set1_epi8((char) nullValue);
+		const __m128i zero = _mm_setzero_si128();
+		int i = 0;
+		for (; i <= n - 16; i += 16) {
+			const __m128i v = _mm_loadu_si128((const __m128i*) (src + i));
+			const __m128i o = _mm_loadu_si128((const __m128i*) (old + i));
+			// null masks (0xff for null values)
+			const __m128i vNull = hasNull ? _mm_cmpeq_epi8(v, nv) : zero;
+			const __m128i oNull = hasNull ? _mm_cmpeq_epi8(o, nv) : zero;
+			const __m128i vz = _mm_andnot_si128(vNull, v);
+			const __m128i oz = _mm_andnot_si128(oNull, o);
+			// count difference (v valid) - (o valid) = vNull - oNull (with null masks as -1/0)
+			const __m128i dc8 = _mm_sub_epi8(vNull, oNull);
+			const __m128i d16[2] = { _mm_sub_epi16(_mm_unpacklo_epi8(vz, zero), _mm_unpacklo_epi8(oz, zero)),
+			                         _mm_sub_epi16(_mm_unpackhi_epi8(vz, zero), _mm_unpackhi_epi8(oz, zero)) };
+			const __m128i c16[2] = { _mm_srai_epi16(_mm_unpacklo_epi8(dc8, dc8), 8),
+			                         _mm_srai_epi16(_mm_unpackhi_epi8(dc8, dc8), 8) };
+			for (int k = 0; k < 2; ++k) {
+				const __m128i d32[2] = { _mm_srai_epi32(_mm_unpacklo_epi16(d16[k], d16[k]), 16),
+				                         _mm_srai_epi32(_mm_unpackhi_epi16(d16[k], d16[k]), 16) };
+				const __m128i c32[2] = { _mm_srai_epi32(_mm_unpacklo_epi16(c16[k], c16[k]), 16),
+				                         _mm_srai_epi32(_mm_unpackhi_epi16(c16[k], c16[k]), 16) };
+				for (int j = 0; j < 2; ++j) {
+					__m128i *ps = (__m128i*) (sum + i + 8 * k + 4 * j);
+					__m128i *pc = (__m128i*) (count + i + 8 * k + 4 * j);
+					_mm_storeu_si128(ps, _mm_add_epi32(_mm_loadu_si128(ps), d32[j]));
+					_mm_storeu_si128(pc, _mm_add_epi32(_mm_loadu_si128(pc), c32[j]));
+				}
+			}
+		}
+		update_running_sums<icl8u, icl32s>(src + i, old + i, sum + i, count + i, n - i, nullValue);
+	}
+
+	/// SSE2 version for 32f (4 pixels per step, 64f sums)
+	inline void update_running_sums(const icl32f *src, const icl32f *old,
+			icl64f *sum, icl32s *count, int n, int nullValue) {
+		const __m128 nv = _mm_set1_ps((float) nullValue);
+		int i = 0;
+		for (; i <= n - 4; i += 4) {
+			const __m128 v = _mm_loadu_ps(src + i);
+			const __m128 o = _mm_loadu_ps(old + i);
+			const __m128 vNull = _mm_cmpeq_ps(v, nv);
+			const __m128 oNull = _mm_cmpeq_ps(o, nv);
+			// unchanged pixels are skipped like in the scalar version
+			const __m128 same = _mm_cmpeq_ps(v, o);
+			const __m128 vz = _mm_andnot_ps(_mm_or_ps(vNull, same), v);
+			const __m128 oz = _mm_andnot_ps(_mm_or_ps(oNull, same), o);
+			__m128d lo = _mm_loadu_pd(sum + i), hi = _mm_loadu_pd(sum + i + 2);
+			lo = _mm_add_pd(_mm_sub_pd(lo, _mm_cvtps_pd(oz)), _mm_cvtps_pd(vz));
+			hi = _mm_add_pd(_mm_sub_pd(hi, _mm_cvtps_pd(_mm_movehl_ps(oz, oz))),
+					_mm_cvtps_pd(_mm_movehl_ps(vz, vz)));
+			_mm_storeu_pd(sum + i, lo);
+			_mm_storeu_pd(sum + i + 2, hi);
+			__m128i *pc = (__m128i*) (count + i);
+			const __m128i dc = _mm_sub_epi32(_mm_castps_si128(vNull), _mm_castps_si128(oNull));
+			_mm_storeu_si128(pc, _mm_add_epi32(_mm_loadu_si128(pc), dc));
+		}
+		update_running_sums<icl32f, icl64f>(src + i, old + i, sum + i, count + i, n - i, nullValue);
+	}
+#endif
+
+	/// streaming CPU implementation of the temporal smoothing for the rows [begin,end)
+	/** Instead of walking through the whole history for every pixel, each pixel
+	    keeps the running sum, the number of non-null values and the minimum and
+	    maximum of its history together with the number of history values that
+	    are equal to them. A new frame replaces the oldest ring buffer slot, so
+	    only the outgoing and the incoming value have to be taken into account.
+	    The history is only rescanned if the last occurrence of the current minimum
+	    or maximum leaves the ring buffer (or if rebuild is set, e.g. after the
+	    filter size was changed), which makes the per-frame costs independent of
+	    the filter size in practice. The running sums and counts of each row are
+	    updated in a separate pass (see update_running_sums), which is vectorized
+	    for 8u and 32f if SSE2 is available.
+	    The results are identical to the OpenCL kernel (including its clipping of
+	    min and max to [0,100000]) */
+	template<class T, class S>
+	struct TemporalSmoothingRows {
+		const T *src;            //!< new input frame
+		T * const *slots;        //!< ring buffer slots (currentFilterSize entries)
+		int numSlots;            //!< current filter size
+		int slot;                //!< slot that receives the new frame
+		int w;                   //!< image width
+		S *sum;                  //!< running sums of the non-null values
+		icl32s *count;           //!< running number of non-null values
+		T *minVal;               //!< running minimum of the non-null values
+		T *maxVal;               //!< running maximum of the non-null values
+		icl32s *minCount;        //!< number of history values equal to the minimum
+		icl32s *maxCount;        //!< number of history values equal to the maximum
+		T *dst;                  //!< output image
+		float *motion;           //!< motion image (255 for motion pixels, 0 otherwise)
+		int nullValue;
+		float difference;
+		bool rebuild;
+
+		void rescan(int i) const {
+			S s = 0;
+			icl32s c = 0, cMin = 0, cMax = 0;
+			T mn = 0, mx = 0;
+			for (int k = 0; k < numSlots; ++k) {
+				const T v = slots[k][i];
+				if (v == nullValue) continue;
+				if (!c || v < mn) {
+					mn = v;
+					cMin = 0;
+				}
+				if (!c || v > mx) {
+					mx = v;
+					cMax = 0;
+				}
+				cMin += (v == mn);
+				cMax += (v == mx);
+				s += v;
+				++c;
+			}
+			sum[i] = s;
+			count[i] = c;
+			minVal[i] = mn;
+			maxVal[i] = mx;
+			minCount[i] = cMin;
+			maxCount[i] = cMax;
+		}
+
+		void operator()(int begin, int end) const {
+			T *target = slots[slot];
+			const int iBegin = begin * w, iEnd = end * w;
+			if (!rebuild) {
+				update_running_sums(src + iBegin, target + iBegin, sum + iBegin,
+						count + iBegin, iEnd - iBegin, nullValue);
+			}
+			for (int i = iBegin; i < iEnd; ++i) {
+				const T n = src[i];
+				const T o = target[i];
+				target[i] = n;
+				if (rebuild) {
+					rescan(i);
+				} else if (o != n) {
+					// sum and count are already updated, so count[i] == 1 means that
+					// n is the only non-null value of the history
+					bool needsRescan = false;
+					if (o != nullValue) {
+						if (o == minVal[i]) needsRescan |= !--minCount[i];
+						if (o == maxVal[i]) needsRescan |= !--maxCount[i];
+					}
+					if (n != nullValue) {
+						if (count[i] == 1) {
+							minVal[i] = maxVal[i] = n;
+							minCount[i] = maxCount[i] = 1;
+							needsRescan = false;
+						} else if (!needsRescan) {
+							if (n < minVal[i]) {
+								minVal[i] = n;
+								minCount[i] = 1;
+							} else if (n == minVal[i]) {
+								++minCount[i];
+							}
+							if (n > maxVal[i]) {
+								maxVal[i] = n;
+								maxCount[i] = 1;
+							} else if (n == maxVal[i]) {
+								++maxCount[i];
+							}
+						}
+					}
+					if (needsRescan && count[i]) rescan(i);
+				}
+
+				const icl32s c = count[i];
+				if (!c) {
+					dst[i] = (T) nullValue;
+					motion[i] = 0;
+				} else if (std::max<float>(maxVal[i], 0) - std::min<float>(minVal[i], 100000) > difference) {
+					dst[i] = n;
+					motion[i] = 255;
+				} else {
+					dst[i] = (T) ((float) sum[i] / (float) c);
+					motion[i] = 0;
+				}
+			}
+		}
+	};
+
+	template<class T, class S>
+	void apply_temporal_smoothing(const Img<T> &src, std::vector<Img<T> > &history,
+			int numSlots, int slot, std::vector<S> &sum, std::vector<icl32s> &count,
+			std::vector<T> &minVal, std::vector<T> &maxVal,
+			std::vector<icl32s> &minCount, std::vector<icl32s> &maxCount, Img<T> &dst,
+			Img32f &motion, int nullValue, int difference, bool rebuild,
+			int numThreads) {
+		const int w = src.getWidth(), h = src.getHeight(), dim = w * h;
+		if ((int) sum.size() != dim) {
+			sum.assign(dim, 0);
+			count.assign(dim, 0);
+			minVal.assign(dim, 0);
+			maxVal.assign(dim, 0);
+			minCount.assign(dim, 0);
+			maxCount.assign(dim, 0);
+			rebuild = true;
+		}
+		std::vector<T*> slots(numSlots);
+		for (int i = 0; i < numSlots; ++i) {
+			slots[i] = history[i].begin(0);
+		}
+		TemporalSmoothingRows<T, S> rows = { src.begin(0), slots.data(), numSlots,
+				slot, w, sum.data(), count.data(), minVal.data(), maxVal.data(),
+				minCount.data(), maxCount.data(), dst.begin(0), motion.begin(0), nullValue, (float) difference,
+				rebuild };
+		parallel_for(0, h, rows, 1, numThreads);
+	}
+}
+
 MotionSensitiveTemporalSmoothing::MotionSensitiveTemporalSmoothing(
 		int iNullValue, int iMaxFilterSize) {
 	//addProperty("use opencl","flag","",true);
@@ -116,11 +355,12 @@ MotionSensitiveTemporalSmoothing::MotionSensitiveTemporalSmoothing(
 	currentFilterSize = 6;
 	currentDifference = 10;
 	useCL = true;
+	numThreads = 1;
 }
 
 MotionSensitiveTemporalSmoothing::~MotionSensitiveTemporalSmoothing() {
 	for (int i = clPointer.size() - 1; i >= 0; i--) {
-		delete &clPointer.at(i);
+		delete clPointer.at(i);
 	}
 	clPointer.clear();
 }
@@ -135,7 +375,7 @@ void MotionSensitiveTemporalSmoothing::init(int iChannels, core::depth iDepth,
 	std::cout << "channels: " << numChannels << " , imageSize: " << size
 			<< " , imageDepth: " << depth << std::endl;
 	for (int i = clPointer.size() - 1; i >= 0; i--) {
-		delete &clPointer.at(i);
+		delete clPointer.at(i);
 	}
 	clPointer.clear();
 	for (int i = 0; i < numChannels; i++) {
@@ -144,6 +384,7 @@ void MotionSensitiveTemporalSmoothing::init(int iChannels, core::depth iDepth,
 		clElement->setFilterSize(currentFilterSize);
 		clElement->setDifference(currentDifference);
 		clElement->setUseCL(useCL);
+		clElement->setNumThreads(numThreads);
 		clPointer.push_back(clElement);
 	}
 }
@@ -217,6 +458,13 @@ void MotionSensitiveTemporalSmoothing::setDifference(int difference) {
 	}
 }
 
+void MotionSensitiveTemporalSmoothing::setNumThreads(int n) {
+	numThreads = n < 0 ? 1 : n;
+	for (unsigned int i = 0; i < clPointer.size(); i++) {
+		clPointer.at(i)->setNumThreads(numThreads);
+	}
+}
+
 Img32f MotionSensitiveTemporalSmoothing::getMotionImage() {
 	return clPointer.at(0)->getMotionImage();
 }
@@ -239,6 +487,8 @@ TemporalSmoothingCL::TemporalSmoothingCL(utils::Size size, core::depth depth,
 
 	imgCount = 0;
 	useCL = true;
+	streamValid = false;
+	numThreads = 1;
 
 	motionImage.setSize(Size(w,h));
 	motionImage.setChannels(1);
@@ -355,15 +605,17 @@ Img32f TemporalSmoothingCL::temporalSmoothingF(const Img32f &inputImage) {
 	if (currentFilterSize != filterSize) {
 		currentFilterSize = filterSize;
 		imgCount = 0;
+		streamValid = false;
 	}
 
 	if (imgCount % currentFilterSize == 0) {
 		imgCount = 0;
 	}
-        inputImage.deepCopy(&inputImagesF.at(imgCount % currentFilterSize));
-	imgCount++;
+	const int slot = imgCount++;
 
 	if (useCL == true && clReady == true) {
+		inputImage.deepCopy(&inputImagesF.at(slot));
+		streamValid = false;
 #ifdef ICL_HAVE_OPENCL
 		try {
 			inputImage1ArrayF=inputImagesF.at(imgCount-1).begin(0);
@@ -386,36 +638,14 @@ Img32f TemporalSmoothingCL::temporalSmoothingF(const Img32f &inputImage) {
 		}
 #endif
 	} else {
-		for (int x = 0; x < w; x++) {
-			for (int y = 0; y < h; y++) {
-				int count = 0;
-				float value = 0;
-				float min = 100000;
-				float max = 0;
-
-				for (int i = 0; i < currentFilterSize; i++) {
-					if (inputImagesF.at(i)(x, y, 0) != nullValue) {
-						count++;
-						value += inputImagesF.at(i)(x, y, 0);
-						if (inputImagesF.at(i)(x, y, 0) < min)
-							min = inputImagesF.at(i)(x, y, 0);
-						if (inputImagesF.at(i)(x, y, 0) > max)
-							max = inputImagesF.at(i)(x, y, 0);
-					}
-				}
-
-				if (count == 0) {
-					outputImageF(x, y, 0) = nullValue;
-				} else {
-					if ((max - min) > currentDifference) {
-						outputImageF(x, y, 0) = inputImagesF.at(imgCount - 1)(x,
-								y, 0);
-					} else {
-						outputImageF(x, y, 0) = value / count;
-					}
-				}
-			}
+		if (inputImage.getSize() != Size(w, h)) {
+			throw ICLException("TemporalSmoothingCL: unexpected input image size");
 		}
+		apply_temporal_smoothing(inputImage, inputImagesF, currentFilterSize,
+				slot, runningSumF, validCount, minF, maxF,
+				minCount, maxCount, outputImageF, motionImage,
+				nullValue, currentDifference, !streamValid, numThreads);
+		streamValid = true;
 	}
 	return outputImageF;
 }
@@ -429,15 +659,17 @@ Img8u TemporalSmoothingCL::temporalSmoothingC(const Img8u &inputImage) {
 	if (currentFilterSize != filterSize) {
 		currentFilterSize = filterSize;
 		imgCount = 0;
+		streamValid = false;
 	}
 
 	if (imgCount % currentFilterSize == 0) {
 		imgCount = 0;
 	}
-	inputImage.deepCopy(&inputImagesC.at(imgCount % currentFilterSize));
-	imgCount++;
+	const int slot = imgCount++;
 
 	if (useCL == true && clReady == true) {
+		inputImage.deepCopy(&inputImagesC.at(slot));
+		streamValid = false;
 #ifdef ICL_HAVE_OPENCL
 		try {
 			inputImage1ArrayC=inputImagesC.at(imgCount-1).begin(0);
@@ -466,37 +698,14 @@ Img8u TemporalSmoothingCL::temporalSmoothingC(const Img8u &inputImage) {
 		}
 #endif
 	} else {
-		for (int x = 0; x < w; x++) {
-			for (int y = 0; y < h; y++) {
-				int count = 0;
-				int value = 0;
-				int min = 100000;
-				int max = 0;
-
-				for (int i = 0; i < currentFilterSize; i++) {
-					if (inputImagesC.at(i)(x, y, 0) != nullValue) {
-						count++;
-						value += inputImagesC.at(i)(x, y, 0);
-						if (inputImagesC.at(i)(x, y, 0) < min)
-							min = inputImagesC.at(i)(x, y, 0);
-						if (inputImagesC.at(i)(x, y, 0) > max)
-							max = inputImagesC.at(i)(x, y, 0);
-					}
-				}
-
-				if (count == 0) {
-					outputImageC(x, y, 0) = nullValue;
-				} else {
-					if ((max - min) > currentDifference) {
-						outputImageC(x, y, 0) = inputImagesC.at(imgCount - 1)(x,
-								y, 0);
-					} else {
-						outputImageC(x, y, 0) = (unsigned char) ((float) value
-								/ (float) count);
-					}
-				}
-			}
+		if (inputImage.getSize() != Size(w, h)) {
+			throw ICLException("TemporalSmoothingCL: unexpected input image size");
 		}
+		apply_temporal_smoothing(inputImage, inputImagesC, currentFilterSize,
+				slot, runningSumC, validCount, minC, maxC,
+				minCount, maxCount, outputImageC, motionImage,
+				nullValue, currentDifference, !streamValid, numThreads);
+		streamValid = true;
 	}
 	return outputImageC;
 }
@@ -509,6 +718,10 @@ void TemporalSmoothingCL::setFilterSize(int iFilterSize) {
 	filterSize = iFilterSize;
 }
 
+void TemporalSmoothingCL::setNumThreads(int n) {
+	numThreads = n < 0 ? 1 : n;
+}
+
 void TemporalSmoothingCL::setDifference(int iDifference) {
 	currentDifference = iDifference;
 }
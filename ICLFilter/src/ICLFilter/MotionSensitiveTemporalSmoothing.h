@@ -79,6 +79,9 @@ namespace icl{
 	    /**       @param iDifference the difference */
 	    void setDifference(int iDifference);
 
+	    /// Sets the number of threads used by the CPU implementation (1: calling thread only, 0: all threads of the pool)
+	    void setNumThreads(int n);
+
 	    ///Returns the motionImage (visualize the movement in the image, usable as motion detector)
 	    /**   @return the motion image */
 	    core::Img32f getMotionImage();
@@ -113,6 +116,15 @@ namespace icl{
       core::Img8u outputImageC;
       core::Img32f motionImage;
 
+      /// streaming state of the CPU implementation (per pixel running sums, counts and extrema of the history)
+      bool streamValid;
+      int numThreads;
+      std::vector<icl64f> runningSumF;
+      std::vector<icl32s> runningSumC;
+      std::vector<icl32s> validCount, minCount, maxCount;
+      std::vector<icl32f> minF, maxF;
+      std::vector<icl8u> minC, maxC;
+
     #ifdef ICL_HAVE_OPENCL
       //OpenCL
       float* inputImage1ArrayF;
@@ -176,6 +188,9 @@ namespace icl{
 	    /**       @param difference the difference */
 	    void setDifference(int difference);
 
+	    /// Sets the number of threads used by the CPU implementation (1: calling thread only, 0: all threads of the pool)
+	    void setNumThreads(int n);
+
 	    ///Returns the motionImage (visualize the movement in the image, usable as motion detector)
 	    /**   @return the motion image */
 	    core::Img32f getMotionImage();
@@ -197,6 +212,7 @@ namespace icl{
       int maxFilterSize;
 
       int numChannels;
+      int numThreads;
       utils::Size size;
       core::depth depth;
 
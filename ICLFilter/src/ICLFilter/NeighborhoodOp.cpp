@@ -29,9 +29,7 @@
 ********************************************************************/
 
 #include <ICLFilter/NeighborhoodOp.h>
-#include <ICLFilter/UnaryOpWork.h>
 #include <ICLUtils/Macros.h>
-#include <ICLFilter/ImageSplitter.h>
 
 using namespace icl::utils;
 using namespace icl::core;
@@ -43,13 +41,21 @@ namespace icl {
       return prepare(ppoDst,poSrc,poSrc->getDepth());
     }
     bool NeighborhoodOp::prepare (ImgBase **ppoDst, const ImgBase *poSrc, depth eDepth) {
+      return prepare(ppoDst,poSrc,eDepth,m_oROIOffset);
+    }
+
+    bool NeighborhoodOp::prepare (ImgBase **ppoDst, const ImgBase *poSrc, Point &roiOffset) {
+      return prepare(ppoDst,poSrc,poSrc->getDepth(),roiOffset);
+    }
+
+    bool NeighborhoodOp::prepare (ImgBase **ppoDst, const ImgBase *poSrc, depth eDepth, Point &roiOffset) {
       Size oROIsize;   //< to-be-used ROI size
-      if (!computeROI (poSrc, m_oROIOffset, oROIsize)) return false;
+      if (!computeROI (poSrc, roiOffset, oROIsize)) return false;
 
       return UnaryOp::prepare (ppoDst, eDepth,
                       getClipToROI() ? oROIsize : poSrc->getSize(),
                       poSrc->getFormat(), poSrc->getChannels (),
-                      Rect (getClipToROI() ? Point::null : m_oROIOffset, oROIsize),
+                      Rect (getClipToROI() ? Point::null : roiOffset, oROIsize),
                       poSrc->getTime());
     }
 
@@ -105,53 +111,7 @@ namespace icl {
       }
       if(!prepare (ppoDst, poSrc)) return;
 
-      bool ctr = getClipToROI();
-      bool co = getCheckOnly();
-
-      setClipToROI(false);
-      setCheckOnly(true);
-
-      const ImgBase *srcROIAdapted = poSrc->shallowCopy(Rect(getROIOffset(),(*ppoDst)->getROISize()));
-      const std::vector<ImgBase*> srcs = ImageSplitter::split(srcROIAdapted,nThreads);
-      std::vector<ImgBase*> dsts = ImageSplitter::split(*ppoDst,nThreads);
-      delete srcROIAdapted;
-
-      /*
-          DEBUG_LOG("src image:" << *poSrc);
-          for(int i=0;i<srcs.size();++i){
-          DEBUG_LOG("part " << i << " roi:" << srcs[i]->getROI());
-          }
-      */
-
-
-
-      MultiThreader::WorkSet works(nThreads);
-
-      for(unsigned int i=0;i<nThreads;i++){
-        works[i] = new UnaryOpWork(this,srcs[i],const_cast<ImgBase*>(dsts[i]));
-      }
-
-      if(!m_poMT){
-        m_poMT = new MultiThreader(nThreads);
-      }else{
-        if(m_poMT->getNumThreads() != (int)nThreads){
-          delete m_poMT;
-          m_poMT = new MultiThreader(nThreads);
-        }
-      }
-
-      (*m_poMT)( works );
-
-      for(unsigned int i=0;i<nThreads;i++){
-        delete works[i];
-      }
-
-      setClipToROI(ctr);
-      setCheckOnly(co);
-
-      ImageSplitter::release(srcs);
-      ImageSplitter::release(dsts);
-
+      applyParts(poSrc,Rect(getROIOffset(),(*ppoDst)->getROISize()),*ppoDst,nThreads);
     }
   } // namespace filter
 }
@@ -98,6 +98,7 @@ namespace icl {
       void setROIOffset(const utils::Point &offs){
         m_oROIOffset = offs;
       }
+
       public:
       const utils::Size &getMaskSize() const{
         return m_oMaskSize;
@@ -105,6 +106,10 @@ namespace icl {
       const utils::Point &getAnchor() const {
         return m_oAnchor;
       }
+      /// returns the to-be-used ROI offset that was computed by the last call to prepare
+      /** Note: the prepare-versions with a roiOffset output parameter, that are
+          used by the apply functions of ConvolutionOp, MedianOp and MorphologicalOp,
+          do not update this value. */
       const utils::Point &getROIOffset() const{
         return m_oROIOffset;
       }
@@ -116,6 +121,15 @@ namespace icl {
       /// prepare filter operation: as above, but with depth parameter
       virtual bool prepare (core::ImgBase **ppoDst, const core::ImgBase *poSrc, core::depth eDepht);
 
+      /// prepare filter operation: returns the to-be-used ROI offset instead of storing it
+      /** As the instance is not changed, this can be used by apply implementations,
+          that are called concurrently for several image parts (see UnaryOp::applyMT) */
+      bool prepare (core::ImgBase **ppoDst, const core::ImgBase *poSrc, utils::Point &roiOffset);
+
+      /// prepare filter operation: as above, but with depth parameter
+      bool prepare (core::ImgBase **ppoDst, const core::ImgBase *poSrc, core::depth eDepht,
+                    utils::Point &roiOffset);
+
       /// this function can be reimplemented e.g to enshure an odd mask width and height
        /** E.g. some implementations of Neighborhood-operation could demand odd or even
            mask size parameters. In this case, this function can be implemented in another
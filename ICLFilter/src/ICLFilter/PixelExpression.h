@@ -0,0 +1,463 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLFilter/src/ICLFilter/PixelExpression.h              **
+** Module : ICLFilter                                              **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#pragma once
+
+#include <ICLUtils/CompatMacros.h>
+#include <ICLUtils/ClippedCast.h>
+#include <ICLUtils/Exception.h>
+#include <ICLUtils/ThreadPool.h>
+#include <ICLCore/Img.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <type_traits>
+
+namespace icl{
+  namespace filter{
+
+    /// Base class of all fused per-pixel expressions \ingroup UNARY
+    /** \section GEN General Information
+        Simple per-pixel chains such as <tt>(a*0.5+b) > t</tt> would usually be
+        computed by a sequence of UnaryArithmeticalOp, BinaryArithmeticalOp and
+        UnaryCompareOp instances. Each of these reads and writes the whole image
+        and needs an intermediate image. The expression templates defined here
+        build the whole chain at compile time instead, so that evaluate() can
+        compute it within a single pass over the destination image:
+
+        \code
+        Img8u a = ..., b = ...;
+        Img8u mask;
+        evaluate((pix(a)*0.5f + pix(b)) > 100, mask);
+
+        std::vector<icl8u> gamma(256);
+        Img32f c = ...;
+        evaluate(lut(pix(c)*255, gamma) & (pix(a) != 0), mask, 0);
+        \endcode
+
+        \section OPS Supported Operations
+        - pix(const Img<T>&) and pix(const Channel<T>&) create the image operands.
+          Only references to the given images are stored, so they must outlive
+          the expression
+        - arithmetical operations (+, -, *, /, unary -) follow the C++ type
+          promotion rules, i.e. adding two Img8u operands is computed with int
+          precision and does not overflow
+        - compare operations (<, <=, >, >=, ==, !=) and the logical operations
+          (&&, ||, !) result in 255 (true) and 0 (false) like UnaryCompareOp and
+          BinaryCompareOp
+        - the bitwise operations (&, |, ^) are available for integer values only
+        - abs, sqr, sqrt, exp and log as UnaryArithmeticalOp
+        - lut(e,table) uses the (integer casted) value of e as index into the
+          given table like LUTOp; the index is clipped to the table range.
+          Only a reference to the table is stored
+        - arithmetical scalars can be used as operands everywhere
+
+        The operators and functions are defined in the namespace
+        icl::filter::pixel_expression and found by argument dependent lookup,
+        so they do not hide the overloads of the standard library.
+
+        \section ROI ROI Handling
+        All image operands must have the same ROI size, which is also the size
+        of the destination ROI. Operands with a single channel are used for all
+        channels of the other operands; otherwise all image operands must have
+        the same channel count. The destination image is adapted to the size
+        and channel count of the expression if its ROI does not match already.
+        Only the ROI of the destination image is written, and the result of
+        each pixel is converted by clipped_cast to the destination depth.
+        Processing in-place (destination is one of the operands) is allowed
+        if the ROIs of both are identical.
+
+        \section PERF Performance
+        The expression is evaluated row by row using plain pointers, so that
+        the compiler can inline and (for suitable expressions) vectorize the
+        whole chain. Rows can additionally be processed in parallel by passing
+        numThreads != 1 to evaluate() (0: all threads of the pool).
+    */
+    template<class E>
+    struct PixelExpression{
+      /// returns the actual expression node
+      const E &self() const { return static_cast<const E&>(*this); }
+    };
+
+    /** \cond */
+    namespace pixel_expression{
+
+      /// combines the channel counts of two operands (0: scalar, 1: broadcast)
+      inline int combine_channels(int a, int b){
+        if(a <= 1) return b > a ? b : a;
+        if(b <= 1 || a == b) return a;
+        throw utils::ICLException("pixel expression: image operands have incompatible channel counts");
+      }
+
+      /// combines the ROI sizes of two operands (Size::null: scalar)
+      inline utils::Size combine_roi_sizes(const utils::Size &a, const utils::Size &b){
+        if(a == utils::Size::null) return b;
+        if(b == utils::Size::null || a == b) return a;
+        throw utils::ICLException("pixel expression: image operands have different ROI sizes");
+      }
+
+      /// row of an image operand
+      template<class T>
+      struct DataRow{
+        const T *data;
+        inline T operator[](int x) const { return data[x]; }
+      };
+
+      /// image operand
+      template<class T>
+      struct ImgTerm : public PixelExpression<ImgTerm<T> >{
+        typedef T value_type;
+        typedef DataRow<T> Row;
+        const core::Img<T> *image;
+
+        ImgTerm(const core::Img<T> *image):image(image){}
+        int getChannels() const { return image->getChannels(); }
+        utils::Size getROISize() const { return image->getROISize(); }
+        Row row(int c, int y) const {
+          Row r = { image->getROIData(image->getChannels() == 1 ? 0 : c) + y * image->getWidth() };
+          return r;
+        }
+      };
+
+      /// single channel operand
+      template<class T>
+      struct ChannelTerm : public PixelExpression<ChannelTerm<T> >{
+        typedef T value_type;
+        typedef DataRow<T> Row;
+        const T *data;
+        int width;
+        utils::Rect roi;
+
+        ChannelTerm(const core::Channel<T> &channel):
+          data(&channel[0]),width(channel.getWidth()),roi(channel.getROI()){}
+        int getChannels() const { return 1; }
+        utils::Size getROISize() const { return roi.getSize(); }
+        Row row(int, int y) const {
+          Row r = { data + roi.x + (roi.y + y) * width };
+          return r;
+        }
+      };
+
+      /// scalar operand (its own row)
+      template<class S>
+      struct ScalarTerm : public PixelExpression<ScalarTerm<S> >{
+        typedef S value_type;
+        typedef ScalarTerm<S> Row;
+        S value;
+
+        ScalarTerm(S value):value(value){}
+        int getChannels() const { return 0; }
+        utils::Size getROISize() const { return utils::Size::null; }
+        const Row &row(int, int) const { return *this; }
+        inline S operator[](int) const { return value; }
+      };
+
+      /// node of a binary operation
+      template<class A, class B, template<class,class> class Op>
+      struct BinaryNode : public PixelExpression<BinaryNode<A,B,Op> >{
+        typedef Op<typename A::value_type, typename B::value_type> op;
+        typedef typename op::type value_type;
+        A a;
+        B b;
+
+        struct Row{
+          typename A::Row a;
+          typename B::Row b;
+          inline value_type operator[](int x) const { return op::apply(a[x],b[x]); }
+        };
+
+        BinaryNode(const A &a, const B &b):a(a),b(b){}
+        int getChannels() const { return combine_channels(a.getChannels(),b.getChannels()); }
+        utils::Size getROISize() const { return combine_roi_sizes(a.getROISize(),b.getROISize()); }
+        Row row(int c, int y) const {
+          Row r = { a.row(c,y), b.row(c,y) };
+          return r;
+        }
+      };
+
+      /// node of a unary operation
+      template<class A, template<class> class Op>
+      struct UnaryNode : public PixelExpression<UnaryNode<A,Op> >{
+        typedef Op<typename A::value_type> op;
+        typedef typename op::type value_type;
+        A a;
+
+        struct Row{
+          typename A::Row a;
+          inline value_type operator[](int x) const { return op::apply(a[x]); }
+        };
+
+        UnaryNode(const A &a):a(a){}
+        int getChannels() const { return a.getChannels(); }
+        utils::Size getROISize() const { return a.getROISize(); }
+        Row row(int c, int y) const {
+          Row r = { a.row(c,y) };
+          return r;
+        }
+      };
+
+      /// table lookup node
+      template<class A, class V>
+      struct LUTNode : public PixelExpression<LUTNode<A,V> >{
+        typedef V value_type;
+        A a;
+        const V *table;
+        int maxIndex;
+
+        struct Row{
+          typename A::Row a;
+          const V *table;
+          int maxIndex;
+          inline V operator[](int x) const {
+            const int i = utils::clipped_cast<typename A::value_type,int>(a[x]);
+            return table[i < 0 ? 0 : i > maxIndex ? maxIndex : i];
+          }
+        };
+
+        LUTNode(const A &a, const std::vector<V> &table):
+          a(a),table(table.data()),maxIndex((int)table.size()-1){
+          if(table.empty()) throw utils::ICLException("pixel expression: empty lookup table");
+        }
+        int getChannels() const { return a.getChannels(); }
+        utils::Size getROISize() const { return a.getROISize(); }
+        Row row(int c, int y) const {
+          Row r = { a.row(c,y), table, maxIndex };
+          return r;
+        }
+      };
+
+      template<class A, class B> struct AddOp{
+        typedef decltype(A()+B()) type;
+        static inline type apply(A a, B b){ return a+b; }
+      };
+      template<class A, class B> struct SubOp{
+        typedef decltype(A()-B()) type;
+        static inline type apply(A a, B b){ return a-b; }
+      };
+      template<class A, class B> struct MulOp{
+        typedef decltype(A()*B()) type;
+        static inline type apply(A a, B b){ return a*b; }
+      };
+      template<class A, class B> struct DivOp{
+        typedef decltype(A()/B()) type;
+        static inline type apply(A a, B b){ return a/b; }
+      };
+      template<class A, class B> struct AndOp{
+        typedef decltype(A()&B()) type;
+        static inline type apply(A a, B b){ return a&b; }
+      };
+      template<class A, class B> struct OrOp{
+        typedef decltype(A()|B()) type;
+        static inline type apply(A a, B b){ return a|b; }
+      };
+      template<class A, class B> struct XorOp{
+        typedef decltype(A()^B()) type;
+        static inline type apply(A a, B b){ return a^b; }
+      };
+
+#define ICL_PIXEL_EXPRESSION_CMP_OP(NAME,OP)                            \
+      template<class A, class B> struct NAME{                           \
+        typedef icl8u type;                                             \
+        static inline icl8u apply(A a, B b){ return (a OP b) ? 255 : 0; } \
+      };
+      ICL_PIXEL_EXPRESSION_CMP_OP(LessOp,<)
+      ICL_PIXEL_EXPRESSION_CMP_OP(LessEqualOp,<=)
+      ICL_PIXEL_EXPRESSION_CMP_OP(GreaterOp,>)
+      ICL_PIXEL_EXPRESSION_CMP_OP(GreaterEqualOp,>=)
+      ICL_PIXEL_EXPRESSION_CMP_OP(EqualOp,==)
+      ICL_PIXEL_EXPRESSION_CMP_OP(NotEqualOp,!=)
+      ICL_PIXEL_EXPRESSION_CMP_OP(LogicalAndOp,&&)
+      ICL_PIXEL_EXPRESSION_CMP_OP(LogicalOrOp,||)
+#undef ICL_PIXEL_EXPRESSION_CMP_OP
+
+      template<class A> struct NegOp{
+        typedef decltype(-A()) type;
+        static inline type apply(A a){ return -a; }
+      };
+      template<class A> struct NotOp{
+        typedef icl8u type;
+        static inline icl8u apply(A a){ return a ? 0 : 255; }
+      };
+      template<class A> struct AbsOp{
+        typedef decltype(std::abs(A())) type;
+        static inline type apply(A a){ return std::abs(a); }
+      };
+      template<class A> struct SqrOp{
+        typedef decltype(A()*A()) type;
+        static inline type apply(A a){ return a*a; }
+      };
+      template<class A> struct SqrtOp{
+        typedef decltype(std::sqrt(A())) type;
+        static inline type apply(A a){ return std::sqrt(a); }
+      };
+      template<class A> struct ExpOp{
+        typedef decltype(std::exp(A())) type;
+        static inline type apply(A a){ return std::exp(a); }
+      };
+      template<class A> struct LogOp{
+        typedef decltype(std::log(A())) type;
+        static inline type apply(A a){ return std::log(a); }
+      };
+
+      /// result type of a binary operator whose right operand is a scalar (no type for non-scalars)
+      template<class A, class S, template<class,class> class Op, bool = std::is_arithmetic<S>::value>
+      struct ScalarRight{};
+
+      template<class A, class S, template<class,class> class Op>
+      struct ScalarRight<A,S,Op,true>{
+        typedef BinaryNode<A,ScalarTerm<S>,Op> type;
+      };
+
+      /// result type of a binary operator whose left operand is a scalar (no type for non-scalars)
+      template<class S, class B, template<class,class> class Op, bool = std::is_arithmetic<S>::value>
+      struct ScalarLeft{};
+
+      template<class S, class B, template<class,class> class Op>
+      struct ScalarLeft<S,B,Op,true>{
+        typedef BinaryNode<ScalarTerm<S>,B,Op> type;
+      };
+
+      /// evaluates the rows [begin,end) of all channels
+      template<class D, class E>
+      struct EvaluateRows{
+        const E *e;
+        core::Img<D> *dst;
+        int channels;
+
+        void operator()(int begin, int end) const {
+          const int w = dst->getROIWidth(), lineStep = dst->getWidth();
+          for(int c=0;c<channels;++c){
+            D *d = dst->getROIData(c) + begin * lineStep;
+            for(int y=begin;y<end;++y, d+=lineStep){
+              const typename E::Row r = e->row(c,y);
+              for(int x=0;x<w;++x){
+                d[x] = utils::clipped_cast<typename E::value_type,D>(r[x]);
+              }
+            }
+          }
+        }
+      };
+
+#define ICL_PIXEL_EXPRESSION_BINARY(OP,NAME)                                      \
+      template<class A, class B>                                                    \
+      inline BinaryNode<A,B,NAME>                                                   \
+      operator OP(const PixelExpression<A> &a, const PixelExpression<B> &b){        \
+        return BinaryNode<A,B,NAME>(a.self(),b.self());                             \
+      }                                                                             \
+      template<class A, class S>                                                    \
+      inline typename ScalarRight<A,S,NAME>::type                                   \
+      operator OP(const PixelExpression<A> &a, S s){                                \
+        return typename ScalarRight<A,S,NAME>::type(a.self(),ScalarTerm<S>(s));     \
+      }                                                                             \
+      template<class S, class B>                                                    \
+      inline typename ScalarLeft<S,B,NAME>::type                                    \
+      operator OP(S s, const PixelExpression<B> &b){                                \
+        return typename ScalarLeft<S,B,NAME>::type(ScalarTerm<S>(s),b.self());      \
+      }
+
+      ICL_PIXEL_EXPRESSION_BINARY(+,AddOp)
+      ICL_PIXEL_EXPRESSION_BINARY(-,SubOp)
+      ICL_PIXEL_EXPRESSION_BINARY(*,MulOp)
+      ICL_PIXEL_EXPRESSION_BINARY(/,DivOp)
+      ICL_PIXEL_EXPRESSION_BINARY(&,AndOp)
+      ICL_PIXEL_EXPRESSION_BINARY(|,OrOp)
+      ICL_PIXEL_EXPRESSION_BINARY(^,XorOp)
+      ICL_PIXEL_EXPRESSION_BINARY(<,LessOp)
+      ICL_PIXEL_EXPRESSION_BINARY(<=,LessEqualOp)
+      ICL_PIXEL_EXPRESSION_BINARY(>,GreaterOp)
+      ICL_PIXEL_EXPRESSION_BINARY(>=,GreaterEqualOp)
+      ICL_PIXEL_EXPRESSION_BINARY(==,EqualOp)
+      ICL_PIXEL_EXPRESSION_BINARY(!=,NotEqualOp)
+      ICL_PIXEL_EXPRESSION_BINARY(&&,LogicalAndOp)
+      ICL_PIXEL_EXPRESSION_BINARY(||,LogicalOrOp)
+#undef ICL_PIXEL_EXPRESSION_BINARY
+
+#define ICL_PIXEL_EXPRESSION_UNARY(FUNC,NAME)                                     \
+      template<class A>                                                             \
+      inline UnaryNode<A,NAME> FUNC(const PixelExpression<A> &a){                   \
+        return UnaryNode<A,NAME>(a.self());                                         \
+      }
+
+      ICL_PIXEL_EXPRESSION_UNARY(operator-,NegOp)
+      ICL_PIXEL_EXPRESSION_UNARY(operator!,NotOp)
+      ICL_PIXEL_EXPRESSION_UNARY(abs,AbsOp)
+      ICL_PIXEL_EXPRESSION_UNARY(sqr,SqrOp)
+      ICL_PIXEL_EXPRESSION_UNARY(sqrt,SqrtOp)
+      ICL_PIXEL_EXPRESSION_UNARY(exp,ExpOp)
+      ICL_PIXEL_EXPRESSION_UNARY(log,LogOp)
+#undef ICL_PIXEL_EXPRESSION_UNARY
+
+      /// table lookup (found by argument dependent lookup)
+      template<class A, class V>
+      inline LUTNode<A,V> lut(const PixelExpression<A> &a, const std::vector<V> &table){
+        return LUTNode<A,V>(a.self(),table);
+      }
+
+    } // namespace pixel_expression
+    /** \endcond */
+
+    /// creates an image operand for pixel expressions (see PixelExpression)
+    template<class T>
+    inline pixel_expression::ImgTerm<T> pix(const core::Img<T> &image){
+      return pixel_expression::ImgTerm<T>(&image);
+    }
+
+    /// creates a single channel operand for pixel expressions (see PixelExpression)
+    template<class T>
+    inline pixel_expression::ChannelTerm<T> pix(const core::Channel<T> &channel){
+      return pixel_expression::ChannelTerm<T>(channel);
+    }
+
+    /// evaluates the given pixel expression into the ROI of dst (see PixelExpression)
+    /** @param e expression to evaluate
+        @param dst destination image; its size and channel count are adapted
+                   if its ROI does not match the expression's ROI size
+        @param numThreads number of threads used (1: calling thread only,
+                          0: all threads of the pool) */
+    template<class E, class D>
+    void evaluate(const PixelExpression<E> &e, core::Img<D> &dst, int numThreads=1){
+      const E &expr = e.self();
+      const int channels = expr.getChannels();
+      const utils::Size size = expr.getROISize();
+      if(!channels) throw utils::ICLException("pixel expression: at least one image operand is needed");
+      if(dst.getChannels() != channels || dst.getROISize() != size){
+        dst.setChannels(channels);
+        if(dst.getROISize() != size){
+          dst.setSize(size);
+          dst.setFullROI();
+        }
+      }
+      pixel_expression::EvaluateRows<D,E> rows = { &expr, &dst, channels };
+      utils::parallel_for(0,size.height,rows,1,numThreads);
+    }
+
+  } // namespace filter
+}
@@ -29,8 +29,16 @@
 ********************************************************************/
 
 #include <ICLFilter/ProximityOp.h>
+#include <ICLFilter/IntegralImgOp.h>
 #include <ICLCore/Img.h>
+#include <ICLMath/FFTUtils.h>
 #include <ICLUtils/StringUtils.h>
+#include <ICLUtils/ThreadPool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 using namespace icl::utils;
 using namespace icl::core;
@@ -38,8 +46,6 @@ using namespace icl::core;
 namespace icl {
   namespace utils{
 
-#ifdef ICL_HAVE_IPP
-
     template<> inline std::string str(const filter::ProximityOp::optype &t){
       return (t == filter::ProximityOp::sqrDistance ? "sqrDistance" :
               t == filter::ProximityOp::crossCorr ? "crossCorr" :
@@ -65,25 +71,6 @@ namespace icl {
   }
 
   namespace filter{
-    ProximityOp::ProximityOp(optype ot, applymode am):
-      m_poImageBuffer(0),m_poTemplateBuffer(0){
-      addProperty("operation type","menu","sqrDistance,crossCorr,crossCorrCoeff",ot,0,
-                  "Proximity measurement type (square distance, cross correlation,\n"
-                  "and cross correlation coefficient)");
-      addProperty("apply mode","menu","full,valid,same",am,0,
-                  "Defines on what part of the input image the proximity\n"
-                  "measurement is applied:\n"
-                  "'full':  means, the images are compared in every configuration,\n"
-                  "         where the two images have at least one pixel overlap.\n"
-                  "         (the result image becomes larger)\n"
-                  "'same':  the pattern is centered at every pixel of the\n"
-                  "         source image. (The result image size is identical to\n"
-                  "'valid': the pattern is only matched agains the source\n"
-                  "         image where the full pattern fits into it.\n"
-                  "         (The result image becomes smaller than the\n"
-                  "         source image");
-    }
-
     void ProximityOp::setOpType(optype ot){
       setPropertyValue("operation type",ot);
     }
@@ -100,8 +87,13 @@ namespace icl {
       return const_cast<ProximityOp*>(this)->getPropertyValue("apply mode");
     }
 
+    void ProximityOp::setNumThreads(int numThreads){
+      m_numThreads = numThreads < 0 ? 1 : numThreads;
+    }
+
     namespace{
 
+#ifdef ICL_HAVE_IPP
       template <typename T, IppStatus (IPP_DECL *ippiFunc) (const T*, int, IppiSize, const T*, int, IppiSize, icl32f*, int)>
       inline void ippiCall(const Img<T> *src1, const Img<T> *src2, Img32f *dst){
         // {{{ open
@@ -176,12 +168,17 @@ namespace icl {
 
       // }}}
 
+      /// the IPP functions need no buffers
+      struct ProximityBuffers{};
+
       template<class T>
       void proximity_apply(const Img<T> *poSrc1,
                            const Img<T> *poSrc2,
                            Img32f *poDst,
                            ProximityOp::optype ot,
-                           ProximityOp::applymode am){
+                           ProximityOp::applymode am,
+                           ProximityBuffers &,
+                           int){
         // {{{ open
 
         switch(ot){
@@ -228,9 +225,269 @@ namespace icl {
       }
 
       // }}}
+#else
+      // {{{ native implementation
+
+      /** Description: all three measures are computed from the correlation
+          Sxt = sum(x*t) of the image window x with the template t, the
+          sums Sx and Sxx of the window and the constant sums St and Stt of
+          the template:
+          - sqrDistance:    (Sxx - 2Sxt + Stt) / sqrt(Sxx*Stt)
+          - crossCorr:      Sxt / sqrt(Sxx*Stt)
+          - crossCorrCoeff: (Sxt - Sx*St/n) / sqrt((Sxx-Sx²/n)*(Stt-St²/n))
+
+          The image ROI is copied into a zero padded float buffer, whose size
+          depends on the apply mode, so that the window of each result pixel
+          lies completely inside of it. Sx and Sxx are taken from the integral
+          images of this buffer. Sxt is computed directly for small templates
+          and by means of the FFT for large ones. Windows with zero energy
+          (or zero variance for crossCorrCoeff) lead to 0 (crossCorr and
+          crossCorrCoeff), or to 0 and FLT_MAX (sqrDistance, identical or not).
+      */
+
+      /// template and padded image of one channel with all needed sums
+      struct ProximityChannel{
+        std::vector<icl32f> padded;  //!< zero padded image ROI (with a leading zero row/column)
+        std::vector<icl64f> ii;      //!< integral image of padded
+        std::vector<icl64f> ii2;     //!< integral image of the squared values of padded
+        int pw, ph;                  //!< size of padded
+        std::vector<icl32f> templ;   //!< template ROI (tw x th)
+        int tw, th;
+        icl64f st, stt;              //!< template sums
+
+        template<class T>
+        void create(const Img<T> &image, const Img<T> &t, int c, const Size &pad0, const Size &pad1, int numThreads){
+          const Size is = image.getROISize();
+          tw = t.getROIWidth();
+          th = t.getROIHeight();
+          pw = 1 + pad0.width + is.width + pad1.width;
+          ph = 1 + pad0.height + is.height + pad1.height;
+          padded.assign((size_t)pw*ph,0);
+          for(int y=0;y<is.height;++y){
+            const T *s = image.getROIData(c) + y*image.getWidth();
+            icl32f *d = padded.data() + (size_t)(1+pad0.height+y)*pw + 1 + pad0.width;
+            for(int x=0;x<is.width;++x) d[x] = s[x];
+          }
+          ii.resize(padded.size());
+          ii2.resize(padded.size());
+          IntegralImgOp::create_channel(padded.data(),pw,ph,ii.data(),ii2.data(),numThreads);
+
+          templ.resize(tw*th);
+          st = stt = 0;
+          for(int y=0;y<th;++y){
+            const T *s = t.getROIData(c) + y*t.getWidth();
+            for(int x=0;x<tw;++x){
+              const icl32f v = s[x];
+              templ[x+tw*y] = v;
+              st += v;
+              stt += (icl64f)v*v;
+            }
+          }
+        }
+
+        /// sum of the window with upper left corner (x,y) in the given integral image (x,y >= 1)
+        inline icl64f windowSum(const icl64f *i, int x, int y) const {
+          const icl64f *a = i + (size_t)(y-1)*pw + x-1, *b = a + (size_t)th*pw;
+          return b[tw] - b[0] - a[tw] + a[0];
+        }
+      };
+
+      /// computes one result row from the correlation values of that row
+      inline void proximity_normalize_row(const ProximityChannel &pc, ProximityOp::optype ot,
+                                          const icl64f *sxt, int v, int w, icl32f *dst){
+        const icl64f n = pc.tw * pc.th;
+        const icl64f eps = 1e-12;
+        for(int u=0;u<w;++u){
+          const icl64f sxx = pc.windowSum(pc.ii2.data(),u+1,v+1);
+          switch(ot){
+            case ProximityOp::sqrDistance:{
+              const icl64f num = std::max(sxx - 2*sxt[u] + pc.stt, 0.0);
+              const icl64f den = std::sqrt(sxx*pc.stt);
+              dst[u] = den > eps ? (icl32f)(num/den) : (num > eps ? std::numeric_limits<icl32f>::max() : 0);
+              break;
+            }
+            case ProximityOp::crossCorr:{
+              const icl64f den = std::sqrt(sxx*pc.stt);
+              dst[u] = den > eps ? (icl32f)(sxt[u]/den) : 0;
+              break;
+            }
+            case ProximityOp::crossCorrCoeff:{
+              const icl64f sx = pc.windowSum(pc.ii.data(),u+1,v+1);
+              const icl64f vx = sxx - sx*sx/n, vt = pc.stt - pc.st*pc.st/n;
+              const icl64f den = std::sqrt(std::max(vx,0.0)*std::max(vt,0.0));
+              dst[u] = den > eps*std::max(sxx*pc.stt,1.0) ? (icl32f)((sxt[u] - sx*pc.st/n)/den) : 0;
+              break;
+            }
+          }
+        }
+      }
+
+      /// direct correlation of the result rows [begin,end)
+      /** Each template row is accumulated in float (contiguous multiply-add
+          loops over the result row, which are vectorized by the compiler)
+          and then added to the double precision result */
+      struct ProximityDirectRows{
+        const ProximityChannel *pc;
+        ProximityOp::optype ot;
+        Img32f *dst;
+        int c;
+
+        void operator()(int begin, int end) const {
+          const int w = dst->getWidth(), pw = pc->pw;
+          std::vector<icl32f> rowBuf(w);
+          std::vector<icl64f> sxt(w);
+          icl32f *r = rowBuf.data();
+          for(int v=begin;v<end;++v){
+            std::fill(sxt.begin(),sxt.end(),0.0);
+            for(int j=0;j<pc->th;++j){
+              std::fill(rowBuf.begin(),rowBuf.end(),0.0f);
+              const icl32f *src = pc->padded.data() + (size_t)(v+1+j)*pw + 1;
+              const icl32f *t = pc->templ.data() + j*pc->tw;
+              for(int i=0;i<pc->tw;++i){
+                const icl32f ti = t[i];
+                if(ti == 0) continue;
+                const icl32f *s = src + i;
+                for(int u=0;u<w;++u) r[u] += ti * s[u];
+              }
+              for(int u=0;u<w;++u) sxt[u] += r[u];
+            }
+            proximity_normalize_row(*pc,ot,sxt.data(),v,w,dst->getData(c)+v*w);
+          }
+        }
+      };
+
+      /// normalization of the result rows [begin,end) using the FFT based correlation
+      struct ProximityFFTRows{
+        const ProximityChannel *pc;
+        ProximityOp::optype ot;
+        const math::DynMatrix<std::complex<icl64f> > *corr;
+        Img32f *dst;
+        int c;
+
+        void operator()(int begin, int end) const {
+          const int w = dst->getWidth(), cols = corr->cols();
+          std::vector<icl64f> sxt(w);
+          for(int v=begin;v<end;++v){
+            const std::complex<icl64f> *s = corr->data() + (size_t)(v+1)*cols + 1;
+            for(int u=0;u<w;++u) sxt[u] = s[u].real();
+            proximity_normalize_row(*pc,ot,sxt.data(),v,w,dst->getData(c)+v*w);
+          }
+        }
+      };
+
+      /// returns the smallest n' >= n that has no prime factors larger than 5
+      inline int proximity_fft_size(int n){
+        for(;;++n){
+          int m = n;
+          while(m % 2 == 0) m /= 2;
+          while(m % 3 == 0) m /= 3;
+          while(m % 5 == 0) m /= 5;
+          if(m == 1) return n;
+        }
+      }
+
+      /// buffers of the native implementation (kept between the apply calls)
+      struct ProximityBuffers{
+        ProximityChannel pc;
+        math::DynMatrix<icl64f> a, b;                          //!< FFT inputs (image and template)
+        math::DynMatrix<std::complex<icl64f> > fa, fb, buf, corr; //!< spectra and correlation
+      };
+
+      template<class T>
+      void proximity_apply(const Img<T> *poSrc1,
+                           const Img<T> *poSrc2,
+                           Img32f *poDst,
+                           ProximityOp::optype ot,
+                           ProximityOp::applymode am,
+                           ProximityBuffers &bufs,
+                           int numThreads){
+        const Size ts = poSrc2->getROISize();
+        Size pad0, pad1;
+        switch(am){
+          case ProximityOp::full:
+            pad0 = pad1 = ts - Size(1,1);
+            break;
+          case ProximityOp::same:
+            pad0 = Size(ts.width/2,ts.height/2);
+            pad1 = ts - Size(1,1) - pad0;
+            break;
+          case ProximityOp::valid:
+            break;
+        }
+        const int w = poDst->getWidth(), h = poDst->getHeight();
+
+        // direct: w*h*tw*th multiply-adds (in float, vectorized); fft: three
+        // double precision transforms of the padded size. Measured break-even:
+        // one N*log2(N) unit of a transform costs about 24 multiply-adds
+        const int fw = proximity_fft_size(1 + pad0.width + poSrc1->getROIWidth() + pad1.width);
+        const int fh = proximity_fft_size(1 + pad0.height + poSrc1->getROIHeight() + pad1.height);
+        const double directCost = (double)w*h*ts.getDim();
+        const double fftCost = 3.0 * 24 * fw * fh * std::log((double)fw*fh) / std::log(2.0);
+        const bool useFFT = directCost > fftCost;
+
+        ProximityChannel &pc = bufs.pc;
+        for(int c=0;c<poSrc1->getChannels();++c){
+          pc.create(*poSrc1,*poSrc2,c,pad0,pad1,numThreads);
+          if(!useFFT){
+            ProximityDirectRows rows = { &pc, ot, poDst, c };
+            parallel_for(0,h,rows,1,numThreads);
+          }else{
+            math::DynMatrix<icl64f> &a = bufs.a, &b = bufs.b;
+            a.setBounds(fw,fh);
+            b.setBounds(fw,fh);
+            std::fill(a.begin(),a.end(),0.0);
+            std::fill(b.begin(),b.end(),0.0);
+            for(int y=0;y<pc.ph;++y){
+              std::copy(pc.padded.begin()+(size_t)y*pc.pw,pc.padded.begin()+(size_t)(y+1)*pc.pw,a.row_begin(y));
+            }
+            for(int y=0;y<pc.th;++y){
+              std::copy(pc.templ.begin()+y*pc.tw,pc.templ.begin()+(y+1)*pc.tw,b.row_begin(y));
+            }
+            math::DynMatrix<std::complex<icl64f> > &fa = bufs.fa, &fb = bufs.fb;
+            math::fft::fft2D_cpp(a,fa,bufs.buf,numThreads);
+            math::fft::fft2D_cpp(b,fb,bufs.buf,numThreads);
+            std::complex<icl64f> *pa = fa.data();
+            const std::complex<icl64f> *pb = fb.data();
+            for(unsigned int i=0;i<fa.dim();++i) pa[i] *= std::conj(pb[i]);
+            math::fft::ifft2D_cpp(fa,bufs.corr,bufs.buf,numThreads);
+            ProximityFFTRows rows = { &pc, ot, &bufs.corr, poDst, c };
+            parallel_for(0,h,rows,1,numThreads);
+          }
+        }
+      }
+
+      // }}}
+#endif
 
     }// anonymous namespace
 
+    class ProximityOp::Data : public ProximityBuffers{};
+
+    ProximityOp::ProximityOp(optype ot, applymode am):
+      m_poImageBuffer(0),m_poTemplateBuffer(0),m_data(new Data),m_numThreads(1){
+      addProperty("operation type","menu","sqrDistance,crossCorr,crossCorrCoeff",ot,0,
+                  "Proximity measurement type (square distance, cross correlation,\n"
+                  "and cross correlation coefficient)");
+      addProperty("apply mode","menu","full,valid,same",am,0,
+                  "Defines on what part of the input image the proximity\n"
+                  "measurement is applied:\n"
+                  "'full':  means, the images are compared in every configuration,\n"
+                  "         where the two images have at least one pixel overlap.\n"
+                  "         (the result image becomes larger)\n"
+                  "'same':  the pattern is centered at every pixel of the\n"
+                  "         source image. (The result image size is identical to\n"
+                  "'valid': the pattern is only matched agains the source\n"
+                  "         image where the full pattern fits into it.\n"
+                  "         (The result image becomes smaller than the\n"
+                  "         source image");
+    }
+
+    ProximityOp::~ProximityOp(){
+      ICL_DELETE(m_poImageBuffer);
+      ICL_DELETE(m_poTemplateBuffer);
+      delete m_data;
+    }
+
     void ProximityOp::apply(const ImgBase *poSrc1, const ImgBase *poSrc2, ImgBase **ppoDst){
       // {{{ open
 
@@ -245,24 +502,36 @@ namespace icl {
 
 
       /// set up dst image in depth, channel count and size
-      ensureDepth(ppoDst,depth32f);
-
-      (*ppoDst)->setChannels(poSrc1->getChannels());
-
       applymode am = getPropertyValue("apply mode");
       optype ot = getPropertyValue("operation type");
+#ifdef ICL_HAVE_IPP
+      // the IPP results are written to the destination ROI, whose size is derived from the image sizes
+      const Size s1 = poSrc1->getSize(), s2 = poSrc2->getSize();
+#else
+      // the native results are computed for the ROIs
+      const Size s1 = poSrc1->getROISize(), s2 = poSrc2->getROISize();
+#endif
+      Size dstSize;
       switch(am){
-        case full: (*ppoDst)->setSize(poSrc1->getSize()+poSrc2->getSize()-Size(1,1)); break;
-        case same: (*ppoDst)->setSize(poSrc1->getSize()); break;
-        case valid:(*ppoDst)->setSize(poSrc1->getSize()-poSrc2->getSize()+Size(1,1)); break;
+        case full: dstSize = s1+s2-Size(1,1); break;
+        case same: dstSize = s1; break;
+        case valid: dstSize = s1-s2+Size(1,1); break;
       }
+      ICLASSERT_RETURN( dstSize.width > 0 && dstSize.height > 0 );
+
+      ensureDepth(ppoDst,depth32f);
+      (*ppoDst)->setChannels(poSrc1->getChannels());
+      (*ppoDst)->setSize(dstSize);
+#ifndef ICL_HAVE_IPP
+      (*ppoDst)->setFullROI();
+#endif
 
       switch(poSrc1->getDepth()){
         case depth8u:
-          proximity_apply(poSrc1->asImg<icl8u>(),poSrc2->asImg<icl8u>(),(*ppoDst)->asImg<icl32f>(), ot, am);
+          proximity_apply(poSrc1->asImg<icl8u>(),poSrc2->asImg<icl8u>(),(*ppoDst)->asImg<icl32f>(), ot, am, *m_data, m_numThreads);
           break;
         case depth32f:
-          proximity_apply(poSrc1->asImg<icl32f>(),poSrc2->asImg<icl32f>(),(*ppoDst)->asImg<icl32f>(), ot, am);
+          proximity_apply(poSrc1->asImg<icl32f>(),poSrc2->asImg<icl32f>(),(*ppoDst)->asImg<icl32f>(), ot, am, *m_data, m_numThreads);
           break;
         default:
           ICL_INVALID_DEPTH;
@@ -270,7 +539,6 @@ namespace icl {
     }
 
     // }}}
-  #endif
 
     REGISTER_CONFIGURABLE(ProximityOp, return new ProximityOp(ProximityOp::crossCorr));
   } // namespace filter
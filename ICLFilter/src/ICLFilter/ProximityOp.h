@@ -40,7 +40,7 @@ namespace icl {
   namespace filter{
 
     /// Class for computing proximity measures  \ingroup BINARY
-    /** (Only available for Img8u and Img32f, IPP only!)
+    /** (Only available for Img8u and Img32f, other depths are converted internally)
         \section OV Overview (taken from the IPPI-Manual)
 
         "The functions described in this section compute the proximity (similarity) measure between an
@@ -100,7 +100,7 @@ namespace icl {
 
         \section OP Operation Type
         This time three different metrics for the similarity measurements
-        are implemented (IPP Only)
+        are implemented
 
         The formulas can be found in the ippi-manual!
 
@@ -109,6 +109,18 @@ namespace icl {
         - crossCorr
         - crossCorrCoeff
 
+        \section IMPL Implementation
+        If IPP is available, the IPP functions are used. Otherwise, the
+        measures are computed from the image/template correlation and the
+        window sums, which are taken from integral images of the zero padded
+        source ROI. The correlation is computed directly for small templates
+        and in the frequency domain for large ones. The result rows can be
+        processed in parallel (see setNumThreads). Results are computed for
+        the ROIs of the source image and the template, and the template
+        anchor for the "same" mode is (w/2,h/2). The buffers are kept between
+        the apply calls. With IPP, the destination size is still derived from
+        the full image sizes, as before.
+
 
     */
     class ProximityOp : public BinaryOp, public utils::Uncopyable, public utils::Configurable{
@@ -137,10 +149,7 @@ namespace icl {
       ICLFilter_API ProximityOp(optype ot, applymode am=valid);
 
       /// Destructor
-      virtual ~ProximityOp(){
-        if(m_poImageBuffer) delete m_poImageBuffer;
-        if(m_poTemplateBuffer) delete m_poTemplateBuffer;
-      }
+      ICLFilter_API virtual ~ProximityOp();
 
       /// applies the current op given source image, template and destination image
       /** allowed input image types are icl8u and icl32f other types are converted internally
@@ -171,6 +180,12 @@ namespace icl {
       /** @return current applymode **/
       ICLFilter_API applymode getApplyMode() const;
 
+      /// sets the number of threads used by the native implementation (1: calling thread only, 0: all threads)
+      ICLFilter_API void setNumThreads(int numThreads);
+
+      /// returns the number of threads used
+      int getNumThreads() const { return m_numThreads; }
+
       private:
 
       /// internal used buffer for handling unsupported formats
@@ -178,6 +193,13 @@ namespace icl {
 
       /// internal used buffer for handling unsupported formats
       core::Img32f *m_poTemplateBuffer;
+
+      /// buffers of the native implementation (padded image, integral images and FFT correlation)
+      class Data;
+      Data *m_data;
+
+      /// number of threads used by the native implementation
+      int m_numThreads;
     };
   } // namespace filter
 } // namespace icl
@@ -93,6 +93,8 @@ namespace icl {
         /// Import unaryOps apply function without destination image
         using UnaryOp::apply;
 
+        virtual bool isTileable() const { return true; }
+
         /// returns the lower threshold
         /**
          @return lower threshold
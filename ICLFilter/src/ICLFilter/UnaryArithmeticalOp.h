@@ -46,6 +46,8 @@ namespace icl {
         Img32s Fallback only
         Img64f Fallback only
         The user have to take care about overflows. For example 255+1=0 on icl8u
+        Chains of arithmetical, compare and lookup operations can be computed
+        in a single pass without intermediate images (see PixelExpression)
      */
     class ICLFilter_API UnaryArithmeticalOp : public UnaryOp {
       public:
@@ -78,6 +80,8 @@ namespace icl {
       /// Import unaryOps apply function without destination image
       using UnaryOp::apply;
 
+      virtual bool isTileable() const { return true; }
+
       /// sets the second operand, with the source is operated with.
       /**
         @param value the value for the operand
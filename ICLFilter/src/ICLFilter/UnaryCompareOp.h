@@ -41,6 +41,8 @@ namespace icl {
          using a specified compare operation. The result is written to a
          binarized image of type Img8u. If the result of the comparison is true,
          the corresponding output pixel is set to 255; otherwise, it is set to 0.
+         Comparisons of computed values can be fused with the computation
+         (see PixelExpression).
      */
     class ICLFilter_API UnaryCompareOp : public UnaryOp {
       public:
@@ -135,6 +137,8 @@ namespace icl {
 
       /// Import unaryOps apply function without destination image
       using UnaryOp::apply;
+
+      virtual bool isTileable() const { return true; }
       private:
 
       /// internal storage of the current optype
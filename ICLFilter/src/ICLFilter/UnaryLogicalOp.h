@@ -68,6 +68,8 @@ namespace icl {
       /// Import unaryOps apply function without destination image
       using UnaryOp::apply;
 
+      virtual bool isTileable() const { return true; }
+
       /// sets the second operand, with the source is operated with.
       /**
         @param value the value for the operand
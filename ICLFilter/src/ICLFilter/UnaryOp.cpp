@@ -30,8 +30,8 @@
 
 #include <ICLUtils/Macros.h>
 #include <ICLUtils/StringUtils.h>
+#include <ICLUtils/ThreadPool.h>
 #include <ICLFilter/UnaryOp.h>
-#include <ICLFilter/UnaryOpWork.h>
 #include <ICLFilter/ImageSplitter.h>
 #include <ICLFilter/ConvolutionOp.h>
 #include <ICLFilter/MorphologicalOp.h>
@@ -69,18 +69,17 @@ namespace icl{
                   "an exception is thrown.");
     }
 
-    UnaryOp::UnaryOp():m_poMT(0),m_buf(0){
+    UnaryOp::UnaryOp():m_buf(0){
       initConfigurable();
     }
 
     UnaryOp::UnaryOp(const UnaryOp &other):
-      m_poMT(0),m_oROIHandler(other.m_oROIHandler),m_buf(0){
+      m_oROIHandler(other.m_oROIHandler),m_buf(0){
       initConfigurable();
     }
 
     UnaryOp &UnaryOp::operator=(const UnaryOp &other){
       m_oROIHandler = other.m_oROIHandler;
-      ICL_DELETE( m_poMT );
 
       prop("UnaryOp.clip to ROI").value = other.prop("UnaryOp.clip to ROI").value;
       prop("UnaryOp.check only").value = other.prop("UnaryOp.check only").value;
@@ -88,7 +87,8 @@ namespace icl{
       return *this;
     }
     UnaryOp::~UnaryOp(){
-      ICL_DELETE( m_poMT );
+      ImageSplitter::release(m_parts[0]);
+      ImageSplitter::release(m_parts[1]);
       ICL_DELETE( m_buf );
     }
 
@@ -98,51 +98,78 @@ namespace icl{
     }
 
 
-    void UnaryOp::applyMT(const ImgBase *poSrc, ImgBase **ppoDst, unsigned int nThreads){
-      ICLASSERT_RETURN( nThreads > 0 );
-      ICLASSERT_RETURN( poSrc );
-      if(nThreads == 1){
-        apply(poSrc,ppoDst);
-        return;
+    namespace{
+      /// number of stripes per thread (finer stripes are balanced better between the threads)
+      const int STRIPES_PER_THREAD = 4;
+
+      struct ApplyPart{
+        UnaryOp *op;
+        const std::vector<ImgBase*> &srcs;
+        const std::vector<ImgBase*> &dsts;
+        ApplyPart(UnaryOp *op, const std::vector<ImgBase*> &srcs, const std::vector<ImgBase*> &dsts):
+          op(op),srcs(srcs),dsts(dsts){}
+        void operator()(int begin, int end) const{
+          for(int i=begin;i<end;++i){
+            ImgBase *dst = dsts[i];
+            op->apply(srcs[i],&dst);
+          }
+        }
+      };
+
+      /// drops the references to the shared channels, but keeps the stripe images
+      void unshare(const std::vector<ImgBase*> &parts){
+        for(unsigned int i=0;i<parts.size();++i){
+          if(parts[i]) parts[i]->setChannels(0);
+        }
       }
+    }
 
-      if(!prepare (ppoDst, poSrc)) return;
+    void UnaryOp::applyParts(const ImgBase *src, const Rect &roi, ImgBase *dst, unsigned int nThreads){
+      ICLASSERT_RETURN( roi.getSize() == dst->getROISize() );
+      int nParts = iclMin((int)nThreads*(isTileable() ? STRIPES_PER_THREAD : 1), roi.height);
+      if(nParts <= 0) return;
+      for(int i=0;i<2;++i){
+        for(unsigned int j=nParts;j<m_parts[i].size();++j){
+          ICL_DELETE(m_parts[i][j]);
+        }
+        m_parts[i].resize(nParts,(ImgBase*)0);
+      }
+      const std::vector<ImgBase*> &srcs = m_parts[0], &dsts = m_parts[1];
+      ImageSplitter::split(src,roi,m_parts[0]);
+      ImageSplitter::split(dst,dst->getROI(),m_parts[1]);
 
       bool ctr = getClipToROI();
       bool co = getCheckOnly();
-
-      setClipToROI(false);
-      setCheckOnly(true);
-
-      const std::vector<ImgBase*> srcs = ImageSplitter::split(poSrc,nThreads);
-      std::vector<ImgBase*> dsts = ImageSplitter::split(*ppoDst,nThreads);
-
-      MultiThreader::WorkSet works(nThreads);
-
-      for(unsigned int i=0;i<nThreads;i++){
-        works[i] = new UnaryOpWork(this,srcs[i],const_cast<ImgBase*>(dsts[i]));
-      }
-
-      if(!m_poMT){
-        m_poMT = new MultiThreader(nThreads);
-      }else{
-        if(m_poMT->getNumThreads() != (int)nThreads){
-          delete m_poMT;
-          m_poMT = new MultiThreader(nThreads);
-        }
+      m_oROIHandler.setClipToROI(false);
+      m_oROIHandler.setCheckOnly(true);
+
+      try{
+        ThreadPool::instance().parallelFor(0,nParts,ApplyPart(this,srcs,dsts),1,nThreads);
+      }catch(...){
+        m_oROIHandler.setClipToROI(ctr);
+        m_oROIHandler.setCheckOnly(co);
+        unshare(srcs);
+        unshare(dsts);
+        throw;
       }
 
-      (*m_poMT)( works );
+      m_oROIHandler.setClipToROI(ctr);
+      m_oROIHandler.setCheckOnly(co);
+      unshare(srcs);
+      unshare(dsts);
+    }
 
-      for(unsigned int i=0;i<nThreads;i++){
-        delete works[i];
+    void UnaryOp::applyMT(const ImgBase *poSrc, ImgBase **ppoDst, unsigned int nThreads){
+      ICLASSERT_RETURN( nThreads > 0 );
+      ICLASSERT_RETURN( poSrc );
+      if(nThreads == 1){
+        apply(poSrc,ppoDst);
+        return;
       }
 
-      setClipToROI(ctr);
-      setCheckOnly(co);
+      if(!prepare (ppoDst, poSrc)) return;
 
-      ImageSplitter::release(srcs);
-      ImageSplitter::release(dsts);
+      applyParts(poSrc,poSrc->getROI(),*ppoDst,nThreads);
     }
 
 
@@ -35,12 +35,6 @@
 #include <ICLFilter/OpROIHandler.h>
 
 namespace icl{
-  /** \cond */
-  namespace utils{
-    class MultiThreader;
-  }
-  /** \endcond */
-
   namespace filter{
 
 
@@ -69,9 +63,16 @@ namespace icl{
       /// pure virtual apply function, that must be implemented in all derived classes
       virtual void apply(const core::ImgBase *operand1, core::ImgBase **dst)=0;
 
-      /// apply function for multithreaded filtering (currently even slower than using one thread)
-      virtual ICL_DEPRECATED void applyMT(const core::ImgBase *operand1,
-                                          core::ImgBase **dst, unsigned int nThreads);
+      /// apply function for multithreaded filtering
+      /** The source image's ROI is split into horizontal stripes, which are
+          processed in parallel by the global utils::ThreadPool. nThreads
+          limits the number of threads that are used. Tileable operators
+          (see isTileable) are split into several stripes per thread, which
+          are balanced dynamically. All other operators are split into one
+          stripe per thread, as before. The stripe images are kept between
+          the calls, but they do not keep the image channels alive. */
+      virtual void applyMT(const core::ImgBase *operand1,
+                           core::ImgBase **dst, unsigned int nThreads);
 
       /// applys the filter usign an internal buffer as output image
       /** Normally, this function must not be reimplemented, because it's default implementation
@@ -128,6 +129,18 @@ namespace icl{
       bool getCheckOnly() const { return m_oROIHandler.getCheckOnly(); }
 
 
+      /// returns whether the operator can be applied independently on image tiles
+      /** This is true for operators, whose result pixels depend on a fixed
+          neighborhood of the corresponding source pixels only (for NeighborhoodOps,
+          this is given by mask size and anchor), but neither on the image size nor
+          on the pixel position. All pixel-wise operators (e.g. ThresholdOp or
+          UnaryArithmeticalOp) are tileable. In addition, the apply method must be
+          callable concurrently on different images, i.e. it must not change the
+          operator's state. Tileable operators can be fused by the UnaryOpPipe
+          and are split into finer stripes by applyMT. The default implementation
+          returns false. */
+      virtual bool isTileable() const { return false; }
+
       /// sets value of a property (always call call_callbacks(propertyName) or Configurable::setPropertyValue)
       virtual void setPropertyValue(const std::string &propertyName, const utils::Any &value);
 
@@ -176,13 +189,21 @@ namespace icl{
         return m_oROIHandler.prepare(ppoDst, poSrc, eDepth);
       }
 
-      utils::MultiThreader *m_poMT;
+      /// applies the operator on horizontal stripes of src's roi and dst's ROI in parallel
+      /** roi and dst's ROI must have the same size. The stripes are processed
+          with ClipToROI=false and CheckOnly=true. Tileable operators are split
+          into several stripes per thread. */
+      void applyParts(const core::ImgBase *src, const utils::Rect &roi,
+                      core::ImgBase *dst, unsigned int nThreads);
 
       private:
 
       OpROIHandler m_oROIHandler;
 
       core::ImgBase *m_buf;
+
+      /// reused shallow source and destination stripes of applyParts
+      std::vector<core::ImgBase*> m_parts[2];
     };
 
 
@@ -30,8 +30,12 @@
 
 #include <ICLFilter/UnaryOpPipe.h>
 #include <ICLFilter/UnaryOp.h>
+#include <ICLFilter/NeighborhoodOp.h>
 #include <ICLCore/ImgBase.h>
 #include <ICLCore/Img.h>
+#include <ICLUtils/ThreadPool.h>
+#include <ICLUtils/Mutex.h>
+#include <cmath>
 
 using namespace icl::utils;
 using namespace icl::core;
@@ -39,22 +43,158 @@ using namespace icl::core;
 namespace icl{
   namespace filter{
 
-    UnaryOpPipe::UnaryOpPipe(){}
+    namespace{
+      /// geometry of a single pipe stage
+      /** A result pixel p of the stage is computed from the input pixels
+          Rect(p + offset - anchor, mask) */
+      struct StageGeometry{
+        Point offset;
+        Point anchor;
+        Size mask;
+        Size outSize;
+      };
+
+      /// per-thread buffers for processing a single tile
+      struct TileSlot{
+        ImgBase *src;               //!< shallow copy of the source image
+        std::vector<ImgBase*> bufs; //!< result tile of each stage
+        std::vector<Rect> rects;    //!< region of each stage's result that is held by bufs
+        TileSlot(int n):src(0),bufs(n,(ImgBase*)0),rects(n){}
+        ~TileSlot(){
+          ICL_DELETE(src);
+          for(unsigned int i=0;i<bufs.size();++i) ICL_DELETE(bufs[i]);
+        }
+      };
+
+      template<class T>
+      void copy_tile(const ImgBase *src, const Point &srcOffs, ImgBase *dst, const Rect &dstRect){
+        for(int c=0;c<src->getChannels();++c){
+          deepCopyChannelROI(src->asImg<T>(),c,srcOffs,dstRect.getSize(),
+                             dst->asImg<T>(),c,dstRect.ul(),dstRect.getSize());
+        }
+      }
+    }
+
+    struct UnaryOpPipe::FusedData{
+      bool enabled;
+      int tileBufferSize;
+      int maxThreads;
+
+      std::vector<StageGeometry> stages;
+      Size tileSize;
+      int nx;
+      int ny;
+
+      Mutex mutex;
+      std::vector<TileSlot*> slots;
+      std::vector<TileSlot*> freeSlots;
+
+      FusedData():enabled(false),tileBufferSize(256*1024),maxThreads(0),nx(0),ny(0){}
+      ~FusedData(){
+        for(unsigned int i=0;i<slots.size();++i) delete slots[i];
+      }
+
+      TileSlot *acquire(int n){
+        Mutex::Locker lock(mutex);
+        if(freeSlots.size()){
+          TileSlot *s = freeSlots.back();
+          freeSlots.pop_back();
+          return s;
+        }
+        slots.push_back(new TileSlot(n));
+        return slots.back();
+      }
+
+      void release(TileSlot *s){
+        Mutex::Locker lock(mutex);
+        freeSlots.push_back(s);
+      }
+
+      void clearSlots(){
+        for(unsigned int i=0;i<slots.size();++i) delete slots[i];
+        slots.clear();
+        freeSlots.clear();
+      }
+
+      /// tile i of the result image (edge tiles are shifted inwards to keep the tile size)
+      Rect getTile(int i, Rect *owned) const{
+        const Size &s = stages.back().outSize;
+        int x = (i%nx)*tileSize.width, y = (i/nx)*tileSize.height;
+        *owned = Rect(x,y,iclMin(tileSize.width,s.width-x),iclMin(tileSize.height,s.height-y));
+        return Rect(iclMin(x,s.width-tileSize.width),iclMin(y,s.height-tileSize.height),
+                    tileSize.width,tileSize.height);
+      }
+
+      /// applies all ops on the given result tile (result is in s->bufs.back())
+      void processTile(std::vector<UnaryOp*> &ops, const ImgBase *src, TileSlot *s, const Rect &tile){
+        int n = (int)ops.size();
+        s->rects[n-1] = tile;
+        for(int k=n-1;k>0;--k){
+          const StageGeometry &g = stages[k];
+          s->rects[k-1] = Rect(s->rects[k].ul()+g.offset-g.anchor,
+                               s->rects[k].getSize()+g.mask-Size(1,1));
+        }
+        const_cast<ImgBase*>(src)->shallowCopy(Rect(s->rects[0].ul()+stages[0].offset,
+                                                     s->rects[0].getSize()),&s->src);
+        ops[0]->apply(s->src,&s->bufs[0]);
+        for(int k=1;k<n;++k){
+          s->bufs[k-1]->setROI(Rect(s->rects[k].ul()+stages[k].offset-s->rects[k-1].ul(),
+                                    s->rects[k].getSize()));
+          ops[k]->apply(s->bufs[k-1],&s->bufs[k]);
+        }
+      }
+
+      /// copies the owned part of a processed tile into the result image
+      void copyTile(TileSlot *s, const Rect &tile, const Rect &owned, ImgBase *dst){
+        const ImgBase *res = s->bufs.back();
+        Point offs = owned.ul()-tile.ul();
+        switch(dst->getDepth()){
+  #define ICL_INSTANTIATE_DEPTH(D) case depth##D: copy_tile<icl##D>(res,offs,dst,owned); break;
+          ICL_INSTANTIATE_ALL_DEPTHS;
+  #undef ICL_INSTANTIATE_DEPTH
+        }
+      }
+
+      /// processes a range of tiles (used with ThreadPool::parallelFor)
+      struct TileWork{
+        FusedData *d;
+        std::vector<UnaryOp*> &ops;
+        const ImgBase *src;
+        ImgBase *dst;
+        TileWork(FusedData *d, std::vector<UnaryOp*> &ops, const ImgBase *src, ImgBase *dst):
+          d(d),ops(ops),src(src),dst(dst){}
+
+        void operator()(int begin, int end) const{
+          TileSlot *s = d->acquire((int)ops.size());
+          for(int i=begin;i<end;++i){
+            Rect owned, tile = d->getTile(i,&owned);
+            d->processTile(ops,src,s,tile);
+            d->copyTile(s,tile,owned,dst);
+          }
+          d->release(s);
+        }
+      };
+    };
+
+    UnaryOpPipe::UnaryOpPipe():m_fusedData(new FusedData){}
 
     UnaryOpPipe::~UnaryOpPipe(){
       for(int i=0;i<getLength();i++){
         delete ops[i];
         delete ims[i];
       }
+      delete m_fusedData;
     }
 
     void UnaryOpPipe::add(UnaryOp *op, ImgBase*im){
       ops.push_back(op);
       ims.push_back(im);
+      m_fusedData->clearSlots();
     }
 
     void UnaryOpPipe::apply(const ImgBase *src, ImgBase **dst){
       int length = getLength();
+      if(length > 1 && m_fusedData->enabled && applyFused(src,dst)) return;
       switch(length){
         case 0: ERROR_LOG("length must be > 0"); break;
         case 1: getOp(0)->apply(src,dst); break;
@@ -68,6 +208,95 @@ namespace icl{
       }
     }
 
+    bool UnaryOpPipe::canApplyFused() const{
+      for(unsigned int i=0;i<ops.size();++i){
+        const UnaryOp *op = ops[i];
+        if(!op->isTileable() || !op->getClipToROI() || op->getCheckOnly()) return false;
+  #ifdef ICL_HAVE_IPP // the IPP workaround in NeighborhoodOp::computeROI shrinks even masks
+        const NeighborhoodOp *nop = dynamic_cast<const NeighborhoodOp*>(op);
+        if(nop && (nop->getMaskSize().width%2 == 0 || nop->getMaskSize().height%2 == 0)) return false;
+  #endif
+      }
+      return ops.size() > 0;
+    }
+
+    bool UnaryOpPipe::applyFused(const ImgBase *src, ImgBase **dst){
+      ICLASSERT_RETURN_VAL(src,false);
+      if(!canApplyFused() || !src->getChannels()) return false;
+
+      FusedData &d = *m_fusedData;
+      int n = getLength();
+
+      // compute the geometry of each stage (the ROI of intermediate results is always full)
+      d.stages.resize(n);
+      Img8u probe(src->getSize(),0);
+      probe.setROI(src->getROI());
+      for(int i=0;i<n;++i){
+        StageGeometry &g = d.stages[i];
+        NeighborhoodOp *nop = dynamic_cast<NeighborhoodOp*>(ops[i]);
+        if(nop){
+          if(!nop->computeROI(&probe,g.offset,g.outSize)) return false;
+          g.anchor = nop->getAnchor();
+          g.mask = nop->getMaskSize();
+        }else{
+          g.offset = probe.getROIOffset();
+          g.outSize = probe.getROISize();
+          g.anchor = Point::null;
+          g.mask = Size(1,1);
+        }
+        probe.setSize(g.outSize);
+        probe.setFullROI();
+      }
+
+      // choose the tile size, so that all stages' tiles fit into the budget
+      const Size &resultSize = d.stages.back().outSize;
+      int bytesPerPixel = src->getChannels() * getSizeOf(src->getDepth()) * (n+1);
+      int tilePixels = iclMax(256, d.tileBufferSize / bytesPerPixel);
+      int edge = iclMax(16, (int)::sqrt((float)tilePixels));
+      d.tileSize.width = iclMin(resultSize.width, edge);
+      d.tileSize.height = iclMin(resultSize.height, iclMax(16, tilePixels / d.tileSize.width));
+      d.nx = (resultSize.width + d.tileSize.width - 1) / d.tileSize.width;
+      d.ny = (resultSize.height + d.tileSize.height - 1) / d.tileSize.height;
+
+      // the first tile is processed by the calling thread to obtain the result's parameters
+      TileSlot *s = d.acquire(n);
+      Rect owned, tile = d.getTile(0,&owned);
+      d.processTile(ops,src,s,tile);
+      const ImgBase *res = s->bufs.back();
+      ensureCompatible(dst,res->getDepth(),resultSize,res->getChannels(),res->getFormat());
+      (*dst)->setTime(src->getTime());
+      d.copyTile(s,tile,owned,*dst);
+      d.release(s);
+
+      ThreadPool::instance().parallelFor(1,d.nx*d.ny,FusedData::TileWork(&d,ops,src,*dst),1,d.maxThreads);
+      return true;
+    }
+
+    void UnaryOpPipe::setFusedMode(bool on){
+      m_fusedData->enabled = on;
+    }
+
+    bool UnaryOpPipe::getFusedMode() const{
+      return m_fusedData->enabled;
+    }
+
+    void UnaryOpPipe::setTileBufferSize(int bytes){
+      ICLASSERT_RETURN(bytes > 0);
+      m_fusedData->tileBufferSize = bytes;
+    }
+
+    int UnaryOpPipe::getTileBufferSize() const{
+      return m_fusedData->tileBufferSize;
+    }
+
+    void UnaryOpPipe::setMaxThreads(int maxThreads){
+      m_fusedData->maxThreads = maxThreads;
+    }
+
+    int UnaryOpPipe::getMaxThreads() const{
+      return m_fusedData->maxThreads;
+    }
+
     const ImgBase *UnaryOpPipe::apply(const ImgBase *src){
       apply(src,&getLastImage());
       return getLastImage();
@@ -89,6 +89,25 @@ namespace icl{
            show(cvt(res));
         }
         \endcode
+
+        \section FUSED Fused Mode
+        By default, each operator is applied on the whole result image of its
+        predecessor. For long pipes and large images, the intermediate images
+        do no longer fit into the CPU caches, so that each stage has to stream
+        its whole input from main memory. In fused mode (see setFusedMode), the
+        pipe's result image is split into tiles, whose intermediate working set
+        fits into a given cache budget (see setTileBufferSize). For each tile,
+        the required input region of each stage is computed backwards from the
+        last stage (NeighborhoodOps extend it by their mask size and anchor),
+        and all stages are then applied on the tile one after another. The tiles
+        are processed in parallel using the global utils::ThreadPool. The result
+        is identical to the stage-by-stage application.
+
+        Fused mode is only possible, if all operators are tileable (see
+        UnaryOp::isTileable) and if all of them use ClipToROI=true and
+        CheckOnly=false. Otherwise, the pipe silently falls back to the
+        stage-by-stage application. Please note, that the intermediate result
+        images (getImage(i)) are not updated in fused mode.
     **/
     class ICLFilter_API UnaryOpPipe : public UnaryOp{
       public:
@@ -130,7 +149,40 @@ namespace icl{
       **/
       core::ImgBase *&getLastImage();
 
+      /// enables or disables the fused, tiled processing mode (disabled by default)
+      void setFusedMode(bool on);
+
+      /// returns whether the fused mode is enabled
+      bool getFusedMode() const;
+
+      /// sets the approximate number of bytes, that the working set of a single tile may use
+      /** The default value of 256KB is a typical L2 cache size */
+      void setTileBufferSize(int bytes);
+
+      /// returns the current tile buffer size
+      int getTileBufferSize() const;
+
+      /// sets the maximum number of threads used in fused mode (0 means all available)
+      void setMaxThreads(int maxThreads);
+
+      /// returns the maximum number of threads used in fused mode
+      int getMaxThreads() const;
+
+      /// returns whether the contained ops can be applied in fused mode
+      bool canApplyFused() const;
+
       private:
+
+      /** \cond */
+      struct FusedData;
+      /** \endcond */
+
+      /// applies all ops tile by tile (returns false if this is not possible for src)
+      bool applyFused(const core::ImgBase *src, core::ImgBase **dst);
+
+      /// internal data for the fused mode
+      FusedData *m_fusedData;
+
       /// Internal buffer of ops
       std::vector<UnaryOp*> ops;
 
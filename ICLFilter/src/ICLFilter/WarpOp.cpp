@@ -33,6 +33,7 @@
 #include <ICLUtils/CLProgram.h>
 #endif
 #include <ICLUtils/CLIncludes.h>
+#include <ICLUtils/ThreadPool.h>
 
 using namespace icl::utils;
 using namespace icl::core;
@@ -125,69 +126,119 @@ namespace icl{
     };
   #endif
 
-    template<class T>
-    T interpolate_pixel_nn(float x, float y, const Channel<T> &src){
-      if(x < 0) return T(0);
-      return src(round(x),round(y));
+    /// number of fractional bits of the fixed point warp map weights
+    static const int WARP_FRAC_BITS = 10;
+    static const int WARP_ONE = 1<<WARP_FRAC_BITS;
+
+    /// creates the fixed point map for given warp map and source image size
+    /** For each destination pixel, offsets contains the index of the (upper left)
+        source pixel, or -1 if the mapped position is outside of the source image.
+        For linear interpolation, weights contains the interleaved x- and y-weights
+        of the right/lower neighbours (in [0,WARP_ONE]) */
+    static void create_fixed_point_map(const Channel32f cwm[2], const Size &srcSize, scalemode mode,
+                                       std::vector<icl32s> &offsets, std::vector<icl16u> &weights){
+      const int w = srcSize.width, h = srcSize.height, dim = w*h;
+      const Rect r(Point::null,srcSize);
+      const bool lin = mode == interpolateLIN && w > 1 && h > 1;
+      offsets.resize(dim);
+      weights.resize(lin ? 2*dim : 0);
+
+      const icl32f *mx = cwm[0].begin(), *my = cwm[1].begin();
+      for(int i=0;i<dim;++i){
+        const float x = mx[i], y = my[i];
+        const int rx = (int)round(x), ry = (int)round(y);
+        if(!r.contains(rx,ry)){
+          offsets[i] = -1;
+          continue;
+        }
+        if(!lin){
+          offsets[i] = rx + w*ry;
+          continue;
+        }
+        int x0 = (int)floor(x), y0 = (int)floor(y);
+        int fx = (int)round((x-x0)*WARP_ONE), fy = (int)round((y-y0)*WARP_ONE);
+        if(x0 < 0){ x0 = 0; fx = 0; }
+        else if(x0 >= w-1){ x0 = w-2; fx = WARP_ONE; }
+        if(y0 < 0){ y0 = 0; fy = 0; }
+        else if(y0 >= h-1){ y0 = h-2; fy = WARP_ONE; }
+        offsets[i] = x0 + w*y0;
+        weights[2*i] = fx;
+        weights[2*i+1] = fy;
+      }
     }
 
+    /// bilinear interpolation with fixed point weights
     template<class T>
-    T interpolate_pixel_lin(float x, float y, const Channel<T> &src){
-      float fX0 = x - floor(x), fX1 = 1.0 - fX0;
-      float fY0 = y - floor(y), fY1 = 1.0 - fY0;
-      int xll = (int) x;
-      int yll = (int) y;
-
-      const T* pLL = &src(xll,yll);
-      float a = *pLL;        //  a b
-      float b = *(++pLL);    //  c d
-      pLL += src.getWidth();
-      float d = *pLL;
-      float c = *(--pLL);
-
-      return fX1 * (fY1*a + fY0*c) + fX0 * (fY1*b + fY0*d);
+    static inline T interpolate_fixed(const T *p, int lineStep, int fx, int fy){
+      static const float n = 1.0f/WARP_ONE;
+      const float wx = fx*n, wy = fy*n;
+      const float top = p[0] + wx*(p[1]-p[0]);
+      const float bottom = p[lineStep] + wx*(p[lineStep+1]-p[lineStep]);
+      return T(top + wy*(bottom-top));
     }
 
+    template<>
+    inline icl64f interpolate_fixed(const icl64f *p, int lineStep, int fx, int fy){
+      static const icl64f n = 1.0/WARP_ONE;
+      const icl64f wx = fx*n, wy = fy*n;
+      const icl64f top = p[0] + wx*(p[1]-p[0]);
+      const icl64f bottom = p[lineStep] + wx*(p[lineStep+1]-p[lineStep]);
+      return top + wy*(bottom-top);
+    }
 
-    template<class T>
-    static inline void apply_warp_2(const Channel32f warpMap[2],
-                                    const Channel<T> &src,
-                                    Channel<T> &dst,
-                                    const Size &size, T (*interpolator)(float x, float y, const Channel<T> &src)){
+    template<>
+    inline icl8u interpolate_fixed(const icl8u *p, int lineStep, int fx, int fy){
+      const int top = p[0]*(WARP_ONE-fx) + p[1]*fx;
+      const int bottom = p[lineStep]*(WARP_ONE-fx) + p[lineStep+1]*fx;
+      return (top*(WARP_ONE-fy) + bottom*fy + (1<<(2*WARP_FRAC_BITS-1))) >> (2*WARP_FRAC_BITS);
+    }
 
-      for(int x=0;x<size.width;++x){
-        for(int y=0;y<size.height;++y){
-          int idx = x+size.width*y;
-          dst[idx] = interpolator(warpMap[0][idx],warpMap[1][idx],src);
+    /// applies the fixed point map to the rows [begin,end) of a channel
+    template<class T, bool LIN>
+    struct WarpRows{
+      const T *src;
+      T *dst;
+      const icl32s *offsets;
+      const icl16u *weights;
+      int w;
+
+      void operator()(int begin, int end) const{
+        for(int i=begin*w, iEnd=end*w;i<iEnd;++i){
+          const int o = offsets[i];
+          if(o < 0){
+            dst[i] = T(0);
+          }else if(LIN){
+            dst[i] = interpolate_fixed(src+o,w,weights[2*i],weights[2*i+1]);
+          }else{
+            dst[i] = src[o];
+          }
         }
       }
-    }
+    };
 
     template<class T>
-    static void apply_warp(const Channel32f warpMap[2],
+    static void apply_warp(const std::vector<icl32s> &offsets,
+                           const std::vector<icl16u> &weights,
                            const Img<T>&src,
                            Img<T> &dst,
-                           scalemode mode){
+                           int numThreads){
+      const int w = src.getWidth(), h = src.getHeight();
       for(int c=0;c<src.getChannels();++c){
-        const Channel<T> s = src[c];
-        Channel<T> d = dst[c];
-        if(mode == interpolateNN){
-          apply_warp_2<T>(warpMap,s,d,s.getSize(),interpolate_pixel_nn<T>);
-        }else if(mode == interpolateLIN){
-          apply_warp_2<T>(warpMap,s,d,s.getSize(),interpolate_pixel_lin<T>);
+        if(weights.size()){
+          WarpRows<T,true> rows = { src.begin(c), dst.begin(c), offsets.data(), weights.data(), w };
+          parallel_for(0,h,rows,0,numThreads);
         }else{
-          ERROR_LOG("region average interpolation mode does not work here!");
-          return;
+          WarpRows<T,false> rows = { src.begin(c), dst.begin(c), offsets.data(), 0, w };
+          parallel_for(0,h,rows,0,numThreads);
         }
       }
     }
 
   #ifdef ICL_HAVE_IPP
-    template<>
-    void apply_warp<icl8u>(const Channel32f warpMap[2],
-                                  const Img<icl8u> &src,
-                                  Img<icl8u> &dst,
-                                  scalemode mode){
+    static void apply_warp_ipp(const Channel32f warpMap[2],
+                               const Img<icl8u> &src,
+                               Img<icl8u> &dst,
+                               scalemode mode){
       for(int c=0;c<src.getChannels();++c){
         IppStatus s = ippiRemap_8u_C1R(src.begin(c),src.getSize(),src.getLineStep(),
                                        src.getImageRect(),warpMap[0].begin(),sizeof(icl32f)*warpMap[0].getWidth(),
@@ -199,11 +250,11 @@ namespace icl{
         }
       }
     }
-    template<>
-    void apply_warp<icl32f>(const Channel32f warpMap[2],
-                                   const Img<icl32f> &src,
-                                   Img<icl32f> &dst,
-                                   scalemode mode){
+
+    static void apply_warp_ipp(const Channel32f warpMap[2],
+                               const Img<icl32f> &src,
+                               Img<icl32f> &dst,
+                               scalemode mode){
       for(int c=0;c<src.getChannels();++c){
         IppStatus s = ippiRemap_32f_C1R(src.begin(c),src.getSize(),src.getLineStep(),
                                        src.getImageRect(),warpMap[0].begin(),sizeof(icl32f)*warpMap[0].getWidth(),
@@ -215,9 +266,6 @@ namespace icl{
         }
       }
     }
-
-
-    // specialization for apply_warp<icl8u> and <icl32f>
   #endif
 
     void prepare_warp_table_inplace(Img32f &warpMap){
@@ -238,7 +286,8 @@ namespace icl{
 
 
     WarpOp::WarpOp(const Img32f &warpMap,scalemode mode, bool allowWarpMapScaling):
-      m_allowWarpMapScaling(allowWarpMapScaling),m_scaleMode(mode),m_tryUseOpenCL(false){
+      m_allowWarpMapScaling(allowWarpMapScaling),m_scaleMode(mode),m_tryUseOpenCL(false),
+      m_fixedPointMapMode(mode),m_numThreads(1){
       warpMap.deepCopy(&m_warpMap);
       prepare_warp_table_inplace(m_warpMap);
   #ifdef ICL_HAVE_OPENCL
@@ -259,6 +308,7 @@ namespace icl{
       warpMap.deepCopy(&m_warpMap);
       prepare_warp_table_inplace(m_warpMap);
       m_scaledWarpMap = Img32f();
+      m_fixedPointMapSize = Size::null;
   #ifdef ICL_HAVE_OPENCL
       m_clWarp->setWarpMap(m_warpMap);
   #endif
@@ -266,6 +316,9 @@ namespace icl{
     void WarpOp::setAllowWarpMapScaling(bool allow){
       m_allowWarpMapScaling = allow;
     }
+    void WarpOp::setNumThreads(int numThreads){
+      m_numThreads = numThreads < 0 ? 1 : numThreads;
+    }
 
 
     void WarpOp::apply(const ImgBase *src, ImgBase **dst){
@@ -315,11 +368,33 @@ namespace icl{
       }
   #endif
 
+  #ifdef ICL_HAVE_IPP
+      if(m_numThreads == 1 && src->getDepth() == depth8u){
+        apply_warp_ipp(cwm,*src->asImg<icl8u>(),*(*dst)->asImg<icl8u>(),m_scaleMode);
+        return;
+      }else if(m_numThreads == 1 && src->getDepth() == depth32f){
+        apply_warp_ipp(cwm,*src->asImg<icl32f>(),*(*dst)->asImg<icl32f>(),m_scaleMode);
+        return;
+      }
+  #endif
+
+      if(m_scaleMode != interpolateNN && m_scaleMode != interpolateLIN){
+        ERROR_LOG("region average interpolation mode does not work here!");
+        return;
+      }
+
+      if(m_fixedPointMapSize != src->getSize() || m_fixedPointMapMode != m_scaleMode){
+        create_fixed_point_map(cwm,src->getSize(),m_scaleMode,m_fixedPointOffsets,m_fixedPointWeights);
+        m_fixedPointMapSize = src->getSize();
+        m_fixedPointMapMode = m_scaleMode;
+      }
+
       switch(src->getDepth()){
-  #define ICL_INSTANTIATE_DEPTH(D)                                 \
-        case depth##D:                                             \
-        apply_warp<icl##D>(cwm,*src->asImg<icl##D>(),              \
-                           *(*dst)->asImg<icl##D>(),m_scaleMode);  \
+  #define ICL_INSTANTIATE_DEPTH(D)                                        \
+        case depth##D:                                                  \
+        apply_warp<icl##D>(m_fixedPointOffsets,m_fixedPointWeights,     \
+                           *src->asImg<icl##D>(),                       \
+                           *(*dst)->asImg<icl##D>(),m_numThreads);      \
         break;
         ICL_INSTANTIATE_ALL_DEPTHS;
         default:
@@ -33,6 +33,7 @@
 #include <ICLUtils/CompatMacros.h>
 #include <ICLCore/Img.h>
 #include <ICLFilter/UnaryOp.h>
+#include <vector>
 
 namespace icl{
   namespace filter{
@@ -61,7 +62,16 @@ namespace icl{
 
         \section IPP IPP-Support
         Support is purely optional and only defined in case of depth8u
-        or depth32f input images
+        or depth32f input images. IPP is only used if a single thread is used.
+
+        \section FIXED Fixed point map
+        Without IPP, the warp map is converted into a compact fixed point map once
+        (for each image size and interpolation mode). For each pixel, it contains the
+        offset of the source pixel and, for linear interpolation, the interpolation
+        weights with 10 fractional bits. depth8u images are interpolated using integer
+        arithmetics only. The image rows can be distributed to several threads (see
+        setNumThreads). Destination pixels, that are mapped outside of the source image
+        are set to 0.
 
         \section PERF Performance
         As already mentioned, the operation performance does not depend
@@ -125,6 +135,12 @@ namespace icl{
           function is disregarded quietly if not available */
       void setTryUseOpenCL(bool enabled);
 
+      /// sets the number of threads used (1: calling thread only (default), 0: all threads)
+      void setNumThreads(int numThreads);
+
+      /// returns the number of threads used
+      int getNumThreads() const { return m_numThreads; }
+
       /// returns the current scalemode
       core::scalemode getScaleMode() const { return m_scaleMode; }
 
@@ -146,6 +162,11 @@ namespace icl{
       core::Img32f m_scaledWarpMap;
       core::scalemode m_scaleMode;
       bool m_tryUseOpenCL;
+      std::vector<icl32s> m_fixedPointOffsets;
+      std::vector<icl16u> m_fixedPointWeights;
+      utils::Size m_fixedPointMapSize;
+      core::scalemode m_fixedPointMapMode;
+      int m_numThreads;
 
 #ifdef ICL_HAVE_OPENCL
       struct CLWarp; // forward declaration
@@ -87,6 +87,8 @@ namespace icl {
       /// Import unaryOps apply function without destination image
       using UnaryOp::apply;
 
+      virtual bool isTileable() const { return true; }
+
       /// returns the current weight vector
       /** @return reference to the current weight vector **/
       const std::vector<icl64f> &getWeights() const { return m_vecWeights; }
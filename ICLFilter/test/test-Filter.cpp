@@ -1 +1,890 @@
 #include "gtest/gtest.h"
+
+#include <ICLFilter/UnaryOpPipe.h>
+#include <ICLFilter/ConvolutionOp.h>
+#include <ICLFilter/MedianOp.h>
+#include <ICLFilter/MorphologicalOp.h>
+#include <ICLFilter/ThresholdOp.h>
+#include <ICLFilter/WarpOp.h>
+#include <ICLFilter/BilateralFilterOp.h>
+#include <ICLFilter/ChamferOp.h>
+#include <ICLFilter/ColorSegmentationOp.h>
+#include <ICLFilter/IntegralImgOp.h>
+#include <ICLFilter/LocalThresholdOp.h>
+#include <ICLFilter/MotionSensitiveTemporalSmoothing.h>
+#include <ICLFilter/PixelExpression.h>
+#include <ICLFilter/ProximityOp.h>
+#include <ICLCore/Img.h>
+#include <ICLCore/CCFunctions.h>
+#include <ICLUtils/CPUInfo.h>
+#include <ICLUtils/ThreadPool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace icl;
+using namespace icl::utils;
+using namespace icl::core;
+using namespace icl::filter;
+
+namespace {
+  void create_pipe(UnaryOpPipe &pipe) {
+    pipe << new ConvolutionOp(ConvolutionKernel(ConvolutionKernel::gauss5x5))
+         << new MedianOp(Size(4, 3))
+         << new ThresholdOp(ThresholdOp::ltgt, 40, 200)
+         << new MorphologicalOp(MorphologicalOp::erode, Size(3, 5));
+  }
+}
+
+TEST(UnaryOpPipeTest, FusedModeEqualsStageByStage) {
+  Img32f src(Size(301, 203), 3);
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) src.getData(c)[i] = (i * 7919 + c * 31) % 256;
+  }
+  src.setROI(Rect(13, 17, 250, 150));
+
+  UnaryOpPipe a, b;
+  create_pipe(a);
+  create_pipe(b);
+  b.setFusedMode(true);
+  b.setTileBufferSize(16 * 1024);
+  ASSERT_TRUE(b.canApplyFused());
+
+  ImgBase *ra = 0, *rb = 0;
+  a.apply(&src, &ra);
+  b.apply(&src, &rb);
+  ASSERT_EQ(ra->getSize(), rb->getSize());
+  ASSERT_EQ(ra->getChannels(), rb->getChannels());
+  for (int c = 0; c < ra->getChannels(); ++c) {
+    for (int i = 0; i < ra->getDim(); ++i) {
+      ASSERT_EQ(ra->asImg<icl32f>()->getData(c)[i], rb->asImg<icl32f>()->getData(c)[i]);
+    }
+  }
+  delete ra;
+  delete rb;
+}
+
+namespace {
+  void set_simd_enabled(bool enabled) {
+    CPUInfo::setEnabled(CPUInfo::SSE2, enabled);
+    CPUInfo::setEnabled(CPUInfo::AVX2, enabled);
+    CPUInfo::setEnabled(CPUInfo::NEON, enabled);
+  }
+
+  template<class S, class D>
+  void expect_equal_convolution(const ConvolutionKernel &k, const Size &size) {
+    Img<S> src(size, 1);
+    for (int i = 0; i < src.getDim(); ++i) src[0][i] = (S)((i * 7919) % 256);
+    src.setROI(Rect(3, 2, size.width - 5, size.height - 4));
+
+    ImgBase *generic = 0, *simd = 0;
+    ConvolutionOp a(k), b(k);
+    set_simd_enabled(false);
+    a.apply(&src, &generic);
+    set_simd_enabled(true);
+    b.apply(&src, &simd);
+
+    ASSERT_EQ(generic->getDepth(), simd->getDepth());
+    ASSERT_EQ(generic->getSize(), simd->getSize());
+    for (int i = 0; i < generic->getDim(); ++i) {
+      ASSERT_EQ(generic->asImg<D>()->getData(0)[i], simd->asImg<D>()->getData(0)[i]);
+    }
+    delete generic;
+    delete simd;
+  }
+}
+
+TEST(ConvolutionOpTest, SIMDEqualsGeneric) {
+  int ik[35];
+  float fk[12];
+  for (int i = 0; i < 35; ++i) ik[i] = (i * 7) % 11 - 5;
+  for (int i = 0; i < 12; ++i) fk[i] = (i % 5 - 2) * 0.37f;
+
+  expect_equal_convolution<icl8u, icl16s>(ConvolutionKernel(ConvolutionKernel::gauss5x5), Size(131, 47));
+  expect_equal_convolution<icl8u, icl16s>(ConvolutionKernel(ConvolutionKernel::sobelX3x3), Size(131, 47));
+  expect_equal_convolution<icl8u, icl16s>(ConvolutionKernel(ik, Size(7, 5), 13), Size(131, 47));
+  expect_equal_convolution<icl16s, icl16s>(ConvolutionKernel(ConvolutionKernel::sobelX5x5), Size(67, 33));
+  expect_equal_convolution<icl32f, icl32f>(ConvolutionKernel(fk, Size(4, 3)), Size(67, 33));
+  expect_equal_convolution<icl32f, icl32f>(ConvolutionKernel(ConvolutionKernel::laplace5x5), Size(67, 33));
+}
+
+namespace {
+  template<class S, class D>
+  void expect_direct_convolution(const ConvolutionKernel &k, const Size &size) {
+    Img<S> src(size, 1);
+    for (int i = 0; i < src.getDim(); ++i) src[0][i] = (S)((i * 7919) % 256);
+
+    ImgBase *dst = 0;
+    ConvolutionOp op(k);
+    op.apply(&src, &dst);
+    ASSERT_EQ(icl::core::getDepth<D>(), dst->getDepth());
+
+    const Size &ks = k.getSize();
+    const Img<D> &d = *dst->asImg<D>();
+    for (int y = 0; y < d.getROISize().height; ++y) {
+      for (int x = 0; x < d.getROISize().width; ++x) {
+        int sum = 0;
+        for (int j = 0; j < ks.height; ++j) {
+          for (int i = 0; i < ks.width; ++i) {
+            sum += k.getIntData()[i + j * ks.width] * (int)src(x + i, y + j, 0);
+          }
+        }
+        const D expected = clipped_cast<int, D>(sum / k.getFactor());
+        ASSERT_EQ(expected, d(x + d.getROIOffset().x, y + d.getROIOffset().y, 0));
+      }
+    }
+    delete dst;
+  }
+}
+
+TEST(ConvolutionOpTest, SeparableKernels) {
+  int box[35], gauss[35], laplace[9] = { 1, 1, 1, 1, -8, 1, 1, 1, 1 };
+  const int gx[7] = { 1, 6, 15, 20, 15, 6, 1 }, gy[5] = { -1, -4, 0, 4, 1 };
+  for (int i = 0; i < 35; ++i) {
+    box[i] = 3;
+    gauss[i] = gx[i % 7] * gy[i / 7];
+  }
+  std::vector<float> kx, ky;
+  ASSERT_TRUE(ConvolutionKernel(gauss, Size(7, 5)).getSeparableFactors(kx, ky));
+  for (int i = 0; i < 35; ++i) EXPECT_EQ(gauss[i], ky[i / 7] * kx[i % 7]);
+  EXPECT_TRUE(ConvolutionKernel(box, Size(7, 5)).isSeparable());
+  EXPECT_TRUE(ConvolutionKernel(ConvolutionKernel::sobelY3x3).isSeparable());
+  EXPECT_FALSE(ConvolutionKernel(laplace, Size(3, 3)).isSeparable());
+  EXPECT_FALSE(ConvolutionKernel(ConvolutionKernel::gauss5x5).isSeparable());
+
+  const std::vector<int> ex(gx, gx + 7), ey(gy, gy + 5);
+  const ConvolutionKernel explicitKernel(ex, ey, 64);
+  EXPECT_TRUE(explicitKernel.isSeparable());
+  for (int i = 0; i < 35; ++i) EXPECT_EQ(gauss[i], explicitKernel.getIntData()[i]);
+
+  for (int simd = 0; simd < 2; ++simd) {
+    set_simd_enabled(simd);
+    expect_direct_convolution<icl8u, icl16s>(ConvolutionKernel(gauss, Size(7, 5), 64), Size(97, 41));
+    expect_direct_convolution<icl8u, icl16s>(explicitKernel, Size(97, 41));
+    expect_direct_convolution<icl16s, icl16s>(ConvolutionKernel(box, Size(7, 5), 105), Size(97, 41));
+    expect_direct_convolution<icl32s, icl32s>(explicitKernel, Size(97, 41));
+  }
+}
+
+TEST(BilateralFilterOpTest, CPUBackendMatchesReference) {
+  Img32f src(Size(67, 41), 1);
+  for (int y = 0; y < src.getHeight(); ++y) {
+    for (int x = 0; x < src.getWidth(); ++x) src(x, y, 0) = (x > 30 ? 200 : 50) + (x * 7 + y * 13) % 17;
+  }
+  const int r = 3;
+  const float s = 2, sr = 20;
+  BilateralFilterOp op(r, s, sr, false, BilateralFilterOp::CPU);
+  ImgBase *exact = 0, *approx = 0;
+  op.apply(&src, &exact);
+  op.setApproximate(true);
+  op.setNumThreads(0);
+  op.apply(&src, &approx);
+  for (int y = 0; y < src.getHeight(); ++y) {
+    for (int x = 0; x < src.getWidth(); ++x) {
+      double sum = 0, wp = 0;
+      for (int j = std::max(0, y - r); j <= std::min(src.getHeight() - 1, y + r); ++j) {
+        for (int i = std::max(0, x - r); i <= std::min(src.getWidth() - 1, x + r); ++i) {
+          const double d = src(i, j, 0) - src(x, y, 0);
+          const double w = std::exp(-(((x - i) * (x - i) + (y - j) * (y - j)) / (s * s) + d * d / (sr * sr)));
+          sum += w * src(i, j, 0);
+          wp += w;
+        }
+      }
+      ASSERT_NEAR(sum / wp, (*exact->as32f())(x, y, 0), 1e-3);
+      ASSERT_NEAR(sum / wp, (*approx->as32f())(x, y, 0), 2);
+    }
+  }
+  delete exact;
+  delete approx;
+}
+
+TEST(BilateralFilterOpTest, CPUBackendHonoursROI) {
+  Img8u src(Size(67, 41), formatRGB);
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) src[c][i] = (icl8u)((i * (7 + 2 * c) + (i / 67) * 13) % 256);
+  }
+  const Rect roi(9, 5, 40, 27);
+  Img8u crop(roi.getSize(), formatRGB);
+  src.setROI(roi);
+  src.convertROI(&crop);
+
+  for (int lab = 0; lab < 2; ++lab) {
+    BilateralFilterOp op(2, 2, 30, lab, BilateralFilterOp::CPU);
+    ImgBase *full = 0, *clipped = 0, *notClipped = 0;
+    op.apply(&crop, &full);
+    op.apply(&src, &clipped);
+    op.setClipToROI(false);
+    op.apply(&src, &notClipped);
+    ASSERT_EQ(roi.getSize(), clipped->getSize());
+    ASSERT_EQ(src.getSize(), notClipped->getSize());
+    ASSERT_EQ(roi, notClipped->getROI());
+    for (int c = 0; c < 3; ++c) {
+      for (int y = 0; y < roi.height; ++y) {
+        for (int x = 0; x < roi.width; ++x) {
+          ASSERT_EQ((*full->as8u())(x, y, c), (*clipped->as8u())(x, y, c));
+          ASSERT_EQ((*full->as8u())(x, y, c), (*notClipped->as8u())(x + roi.x, y + roi.y, c));
+        }
+      }
+    }
+    delete full;
+    delete clipped;
+    delete notClipped;
+  }
+
+  Img32f src32(Size(67, 41), 1), crop32(roi.getSize(), 1);
+  for (int i = 0; i < src32.getDim(); ++i) src32[0][i] = (float)((i * 7919) % 256);
+  src32.setROI(roi);
+  src32.convertROI(&crop32);
+  BilateralFilterOp op(3, 2, 20, false, BilateralFilterOp::CPU);
+  ImgBase *full = 0, *clipped = 0;
+  op.apply(&crop32, &full);
+  op.apply(&src32, &clipped);
+  for (int i = 0; i < crop32.getDim(); ++i) ASSERT_EQ((*full->as32f())[0][i], (*clipped->as32f())[0][i]);
+  delete full;
+  delete clipped;
+}
+
+namespace {
+  template<class T>
+  Img<T> create_median_image(const Size &size, int lo, int hi) {
+    Img<T> im(size, 1);
+    for (int i = 0; i < im.getDim(); ++i) {
+      im[0][i] = (T)(lo + (i * 7919 + (i / 13) * 104729) % (hi - lo + 1));
+    }
+    return im;
+  }
+
+  template<class T>
+  void expect_brute_force_median(const Img<T> &src, const Size &maskSize, int numThreads) {
+    MedianOp op(maskSize);
+    op.setNumThreads(numThreads);
+    ImgBase *dstBase = 0;
+    op.apply(&src, &dstBase);
+    const Img<T> &dst = *dstBase->asImg<T>();
+    const Size m = op.getMaskSize();
+    Point offs;
+    Size roiSize;
+    ASSERT_TRUE(op.computeROI(&src, offs, roiSize));
+    const Point a = op.getAnchor(), dstOffs = dst.getROIOffset();
+
+    std::vector<T> v;
+    for (int y = 0; y < dst.getROIHeight(); ++y) {
+      for (int x = 0; x < dst.getROIWidth(); ++x) {
+        v.clear();
+        for (int j = 0; j < m.height; ++j) {
+          for (int i = 0; i < m.width; ++i) v.push_back(src(offs.x + x - a.x + i, offs.y + y - a.y + j, 0));
+        }
+        std::sort(v.begin(), v.end());
+        ASSERT_EQ(v[v.size() / 2], dst(dstOffs.x + x, dstOffs.y + y, 0))
+          << "depth " << getDepth<T>() << ", mask " << m << ", pixel " << x << "," << y;
+      }
+    }
+    delete dstBase;
+  }
+
+  template<class T>
+  void expect_brute_force_median(int lo, int hi) {
+    Img<T> src = create_median_image<T>(Size(83, 57), lo, hi);
+    const Size masks[] = { Size(3, 3), Size(5, 5), Size(7, 7), Size(9, 5), Size(3, 15), Size(15, 15), Size(41, 9) };
+    for (unsigned int i = 0; i < sizeof(masks) / sizeof(Size); ++i) {
+      src.setFullROI();
+      expect_brute_force_median(src, masks[i], 1);
+      src.setROI(Rect(Point(masks[i].width / 2 + 2, masks[i].height / 2 + 1), Size(60, 30)));
+      expect_brute_force_median(src, masks[i], 1);
+    }
+  }
+}
+
+TEST(MedianOpTest, MatchesBruteForceMedian) {
+  expect_brute_force_median<icl8u>(0, 255);
+  expect_brute_force_median<icl16s>(-3000, 3000);
+  expect_brute_force_median<icl32s>(-100000, 100000);
+  expect_brute_force_median<icl32f>(-100, 100);
+  expect_brute_force_median<icl64f>(-100, 100);
+}
+
+TEST(MedianOpTest, ParallelEqualsSequential) {
+  Img8u a = create_median_image<icl8u>(Size(320, 240), 0, 255);
+  Img16s b = create_median_image<icl16s>(Size(320, 240), -30000, 30000);
+  Img32f c = create_median_image<icl32f>(Size(320, 240), -50, 50);
+  expect_brute_force_median(a, Size(7, 7), 0);
+  expect_brute_force_median(b, Size(9, 5), 4);
+  expect_brute_force_median(c, Size(3, 15), 3);
+}
+
+namespace {
+  template<class T>
+  void expect_brute_force_morphology(const Img<T> &src, MorphologicalOp::optype t,
+                                     const Size &maskSize, const icl8u *mask) {
+    MorphologicalOp op(t, maskSize, mask);
+    ImgBase *dstBase = 0;
+    op.apply(&src, &dstBase);
+    const Img<T> &dst = *dstBase->asImg<T>();
+    const Size m = op.getMaskSize();
+    const icl8u *opMask = op.getMask();
+    Point offs;
+    Size roiSize;
+    ASSERT_TRUE(op.computeROI(&src, offs, roiSize));
+    const Point a = op.getAnchor(), dstOffs = dst.getROIOffset();
+    const bool isDilate = t == MorphologicalOp::dilate;
+
+    for (int c = 0; c < src.getChannels(); ++c) {
+      for (int y = 0; y < dst.getROIHeight(); ++y) {
+        for (int x = 0; x < dst.getROIWidth(); ++x) {
+          T e = T(0);
+          bool first = true;
+          for (int j = 0; j < m.height; ++j) {
+            for (int i = 0; i < m.width; ++i) {
+              if (!opMask[i + j * m.width]) continue;
+              const T v = src(offs.x + x - a.x + i, offs.y + y - a.y + j, c);
+              e = first ? v : isDilate ? std::max(e, v) : std::min(e, v);
+              first = false;
+            }
+          }
+          ASSERT_EQ(e, dst(dstOffs.x + x, dstOffs.y + y, c))
+            << "depth " << getDepth<T>() << ", mask " << m << ", pixel " << x << "," << y;
+        }
+      }
+    }
+    delete dstBase;
+  }
+
+  template<class T>
+  void expect_brute_force_morphology(int lo, int hi) {
+    Img<T> src(Size(83, 57), 2);
+    for (int i = 0; i < src.getDim(); ++i) {
+      src[0][i] = (T)(lo + (i * 7919 + (i / 13) * 104729) % (hi - lo + 1));
+      src[1][i] = (T)(lo + (i * 104729 + (i / 7) * 7919) % (hi - lo + 1));
+    }
+    const Size masks[] = { Size(3, 3), Size(7, 5), Size(15, 1), Size(1, 9), Size(21, 13) };
+    const icl8u cross[] = { 0, 0, 1, 0, 0,
+                            0, 1, 1, 1, 0,
+                            1, 1, 0, 1, 1,
+                            0, 1, 1, 1, 0,
+                            1, 0, 1, 0, 1 };
+    const MorphologicalOp::optype types[] = { MorphologicalOp::dilate, MorphologicalOp::erode };
+    for (int t = 0; t < 2; ++t) {
+      for (unsigned int i = 0; i < sizeof(masks) / sizeof(Size); ++i) {
+        src.setFullROI();
+        expect_brute_force_morphology(src, types[t], masks[i], 0);
+        src.setROI(Rect(Point(masks[i].width / 2 + 2, masks[i].height / 2 + 1), Size(60, 30)));
+        expect_brute_force_morphology(src, types[t], masks[i], 0);
+      }
+      src.setFullROI();
+      expect_brute_force_morphology(src, types[t], Size(5, 5), cross);
+      src.setROI(Rect(3, 4, 70, 41));
+      expect_brute_force_morphology(src, types[t], Size(5, 5), cross);
+    }
+  }
+}
+
+TEST(MorphologicalOpTest, MatchesBruteForceMorphology) {
+  expect_brute_force_morphology<icl8u>(0, 255);
+  expect_brute_force_morphology<icl32f>(-100, 100);
+}
+
+TEST(MorphologicalOpTest, OpeningIsErosionFollowedByDilatation) {
+  Img8u src(Size(64, 48), 1);
+  for (int i = 0; i < src.getDim(); ++i) src[0][i] = (icl8u)((i * 7919 + (i / 13) * 104729) % 256);
+  const MorphologicalOp::optype types[] = { MorphologicalOp::openBorder, MorphologicalOp::closeBorder };
+  for (int t = 0; t < 2; ++t) {
+    MorphologicalOp op(types[t], Size(5, 3));
+    MorphologicalOp first(t ? MorphologicalOp::dilate : MorphologicalOp::erode, Size(5, 3));
+    MorphologicalOp second(t ? MorphologicalOp::erode : MorphologicalOp::dilate, Size(5, 3));
+    ImgBase *a = 0, *b = 0, *c = 0;
+    op.apply(&src, &a);
+    first.apply(&src, &b);
+    second.apply(b, &c);
+    ASSERT_EQ(c->getROI(), a->getROI());
+    const Rect r = a->getROI();
+    for (int y = r.y; y < r.bottom(); ++y) {
+      for (int x = r.x; x < r.right(); ++x) {
+        ASSERT_EQ((*c->asImg<icl8u>())(x, y, 0), (*a->asImg<icl8u>())(x, y, 0));
+      }
+    }
+    delete a;
+    delete b;
+    delete c;
+  }
+}
+
+namespace {
+  void expect_apply_mt_equals_apply(UnaryOp &op, const ImgBase *src) {
+    ImgBase *a = 0, *b = 0;
+    op.apply(src, &a);
+    op.applyMT(src, &b, 4);
+    ASSERT_EQ(a->getSize(), b->getSize());
+    ASSERT_EQ(a->getROI(), b->getROI());
+    const Rect r = a->getROI();
+    for (int c = 0; c < a->getChannels(); ++c) {
+      for (int y = r.y; y < r.bottom(); ++y) {
+        for (int x = r.x; x < r.right(); ++x) {
+          ASSERT_EQ((*a->asImg<icl32f>())(x, y, c), (*b->asImg<icl32f>())(x, y, c));
+        }
+      }
+    }
+    delete a;
+    delete b;
+  }
+}
+
+TEST(UnaryOpTest, ApplyMTEqualsApply) {
+  Img32f src(Size(211, 157), 2);
+  for (int c = 0; c < 2; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) src.getData(c)[i] = (i * 7919 + c * 31) % 256;
+  }
+  src.setROI(Rect(9, 5, 180, 120));
+
+  ConvolutionOp conv(ConvolutionKernel(ConvolutionKernel::gauss5x5));
+  MedianOp median(Size(7, 5));
+  MorphologicalOp erode(MorphologicalOp::erode, Size(3, 5));
+  ThresholdOp threshold(ThresholdOp::ltgt, 40, 200);
+  UnaryOp *ops[] = { &conv, &median, &erode, &threshold };
+  for (int i = 0; i < 4; ++i) {
+    expect_apply_mt_equals_apply(*ops[i], &src);
+    ops[i]->setClipToROI(false);
+    expect_apply_mt_equals_apply(*ops[i], &src);
+  }
+}
+
+TEST(IntegralImgOpTest, MatchesNaiveSums) {
+  Img8u src(Size(301, 77), 2);
+  for (int c = 0; c < 2; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) src.getData(c)[i] = (i * 7919 + c * 131) % 256;
+  }
+  // all sums are exact in float precision as well
+  const depth depths[] = { depth32s, depth32f, depth64f };
+  for (int d = 0; d < 3; ++d) {
+    for (int threads = 0; threads < 2; ++threads) {
+      IntegralImgOp op(depths[d]);
+      op.setSquaredSums(true);
+      op.setNumThreads(threads);
+      ImgBase *dst = 0;
+      op.apply(&src, &dst);
+      ASSERT_EQ(src.getSize(), dst->getSize());
+      Img64f ii, sqr;
+      dst->convert(&ii);
+      op.getSquaredSumImage()->convert(&sqr);
+      for (int c = 0; c < 2; ++c) {
+        std::vector<double> col(src.getWidth(), 0), colSqr(src.getWidth(), 0);
+        for (int y = 0; y < src.getHeight(); ++y) {
+          double s = 0, ss = 0;
+          for (int x = 0; x < src.getWidth(); ++x) {
+            const double v = src(x, y, c);
+            col[x] += v;
+            colSqr[x] += v * v;
+            s += col[x];
+            ss += colSqr[x];
+            ASSERT_EQ(s, ii(x, y, c));
+            ASSERT_EQ(ss, sqr(x, y, c));
+          }
+        }
+      }
+      delete dst;
+    }
+  }
+}
+
+TEST(IntegralImgOpTest, SquaredSumsOfLargeImages) {
+  // the squared sums exceed the range of icl32s
+  Img8u src(Size(1600, 1200), 1);
+  src.clear(-1, 255);
+  IntegralImgOp op(depth32s);
+  op.setSquaredSums(true);
+  ImgBase *dst = 0;
+  op.apply(&src, &dst);
+  ASSERT_EQ(depth64f, op.getSquaredSumImage()->getDepth());
+  const Img64f &sqr = *op.getSquaredSumImage()->asImg<icl64f>();
+  EXPECT_EQ(255.0 * 255.0 * 1600 * 1200, sqr(1599, 1199, 0));
+  EXPECT_EQ(255.0 * 255.0 * 800 * 3, sqr(799, 2, 0));
+  EXPECT_EQ(255 * 1600 * 1200, (*dst->asImg<icl32s>())(1599, 1199, 0));
+  delete dst;
+}
+
+TEST(LocalThresholdOpTest, RegionMeanPerChannelAndParallel) {
+  Img8u src(Size(160, 120), 2);
+  for (int c = 0; c < 2; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) src.getData(c)[i] = (i * 7919 + c * 4001) % 256;
+  }
+  LocalThresholdOp op(LocalThresholdOp::regionMean, 7, 3, 0);
+  ImgBase *ref = 0;
+  op.apply(&src, &ref);
+  for (int c = 0; c < 2; ++c) {
+    Img8u single(src.getSize(), 1);
+    std::copy(src.begin(c), src.end(c), single.begin(0));
+    ImgBase *dst = 0;
+    op.apply(&single, &dst);
+    EXPECT_TRUE(std::equal(dst->asImg<icl8u>()->begin(0), dst->asImg<icl8u>()->end(0),
+                           ref->asImg<icl8u>()->begin(c)));
+    delete dst;
+  }
+  op.setNumThreads(0);
+  ImgBase *par = 0;
+  op.apply(&src, &par);
+  for (int c = 0; c < 2; ++c) {
+    EXPECT_TRUE(std::equal(par->asImg<icl8u>()->begin(c), par->asImg<icl8u>()->end(c),
+                           ref->asImg<icl8u>()->begin(c)));
+  }
+  delete ref;
+  delete par;
+}
+
+TEST(LocalThresholdOpTest, TiledParallelEqualsSequential) {
+  // ensure that there are workers, even on single core machines
+  if (ThreadPool::instance().getNumThreads() < 3) ThreadPool::instance().setNumThreads(3);
+  Img8u src(Size(320, 240), 2);
+  for (int c = 0; c < 2; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) src.getData(c)[i] = (i * 7919 + c * 4001) % 256;
+  }
+  const LocalThresholdOp::algorithm algs[] = { LocalThresholdOp::tiledNN, LocalThresholdOp::tiledLIN };
+  for (int a = 0; a < 2; ++a) {
+    LocalThresholdOp op(algs[a], 10, 3, 0);
+    ImgBase *ref = 0, *par = 0;
+    op.apply(&src, &ref);
+    op.setNumThreads(0);
+    op.apply(&src, &par);
+    for (int c = 0; c < 2; ++c) {
+      EXPECT_TRUE(std::equal(par->asImg<icl8u>()->begin(c), par->asImg<icl8u>()->end(c),
+                             ref->asImg<icl8u>()->begin(c)));
+    }
+    delete ref;
+    delete par;
+  }
+}
+
+TEST(ChamferOpTest, ExactEuclideanMatchesBruteForce) {
+  Img8u src(Size(83, 61), 2);
+  for (int c = 0; c < 2; ++c) {
+    for (int i = 0; i < src.getDim(); ++i) src.getData(c)[i] = ((i * 7919 + c * 37) % 97) == 0 ? 255 : 0;
+  }
+  src.setROI(Rect(5, 3, 70, 50));
+  const Rect r = src.getROI();
+  for (int threads = 0; threads < 2; ++threads) {
+    ChamferOp op;
+    op.setMetric(ChamferOp::euclideanSquared);
+    op.setComputeNearestFeature(true);
+    op.setNumThreads(threads);
+    ImgBase *dst = 0;
+    op.apply(&src, &dst);
+    ASSERT_EQ(depth32s, dst->getDepth());
+    const Img32s &d = *dst->asImg<icl32s>();
+    const Img32s &labels = op.getNearestFeatureImage();
+    for (int c = 0; c < 2; ++c) {
+      for (int y = r.y; y < r.bottom(); ++y) {
+        for (int x = r.x; x < r.right(); ++x) {
+          int best = -1;
+          for (int v = r.y; v < r.bottom(); ++v) {
+            for (int u = r.x; u < r.right(); ++u) {
+              const int dd = (x - u) * (x - u) + (y - v) * (y - v);
+              if (src(u, v, c) && (best < 0 || dd < best)) best = dd;
+            }
+          }
+          ASSERT_EQ(best, d(x, y, c));
+          const int l = labels(x, y, c);
+          ASSERT_TRUE(src.getData(c)[l] != 0);
+          const int lx = l % src.getWidth(), ly = l / src.getWidth();
+          ASSERT_EQ(best, (x - lx) * (x - lx) + (y - ly) * (y - ly));
+        }
+      }
+    }
+    delete dst;
+  }
+
+  ChamferOp op;
+  op.setMetric(ChamferOp::euclidean);
+  ImgBase *dst = 0;
+  op.apply(&src, &dst);
+  ASSERT_EQ(depth32f, dst->getDepth());
+  ChamferOp sqr;
+  sqr.setMetric(ChamferOp::euclideanSquared);
+  ImgBase *dstSqr = 0;
+  sqr.apply(&src, &dstSqr);
+  for (int y = r.y; y < r.bottom(); ++y) {
+    for (int x = r.x; x < r.right(); ++x) {
+      EXPECT_FLOAT_EQ(std::sqrt((float)(*dstSqr->asImg<icl32s>())(x, y, 1)), (*dst->asImg<icl32f>())(x, y, 1));
+    }
+  }
+  delete dst;
+  delete dstSqr;
+}
+
+TEST(WarpOpTest, FixedPointMapMatchesBilinearReference) {
+  const Size size(97, 63);
+  Img32f map(size, 2);
+  for (int y = 0; y < size.height; ++y) {
+    for (int x = 0; x < size.width; ++x) {
+      map(x, y, 0) = 0.9f * x + 0.05f * y + 1.37f * std::sin(0.1f * y);
+      map(x, y, 1) = 0.95f * y + 0.03f * x + 1.11f * std::cos(0.07f * x) - 1.5f;
+    }
+  }
+  Img8u src8(size, 2);
+  Img32f src32(size, 2);
+  for (int c = 0; c < 2; ++c) {
+    for (int i = 0; i < src8.getDim(); ++i) {
+      src8.getData(c)[i] = (i * 7919 + c * 131) % 256;
+      src32.getData(c)[i] = src8.getData(c)[i];
+    }
+  }
+  for (int threads = 0; threads < 2; ++threads) {
+    WarpOp op(map, interpolateLIN);
+    op.setNumThreads(threads);
+    ImgBase *d8 = 0, *d32 = 0;
+    op.apply(&src8, &d8);
+    op.apply(&src32, &d32);
+    for (int c = 0; c < 2; ++c) {
+      for (int y = 0; y < size.height; ++y) {
+        for (int x = 0; x < size.width; ++x) {
+          const float mx = map(x, y, 0), my = map(x, y, 1);
+          float e = 0;
+          if (Rect(Point::null, size).contains((int)std::floor(mx + 0.5f), (int)std::floor(my + 0.5f))) {
+            const int x0 = std::min(std::max((int)std::floor(mx), 0), size.width - 2);
+            const int y0 = std::min(std::max((int)std::floor(my), 0), size.height - 2);
+            const float fx = std::min(std::max(mx - x0, 0.f), 1.f), fy = std::min(std::max(my - y0, 0.f), 1.f);
+            const float top = src32(x0, y0, c) * (1 - fx) + src32(x0 + 1, y0, c) * fx;
+            const float bottom = src32(x0, y0 + 1, c) * (1 - fx) + src32(x0 + 1, y0 + 1, c) * fx;
+            e = top * (1 - fy) + bottom * fy;
+          }
+          ASSERT_NEAR(e, (*d32->asImg<icl32f>())(x, y, c), 0.2f);
+          ASSERT_NEAR(e, (*d8->asImg<icl8u>())(x, y, c), 1.0f);
+        }
+      }
+    }
+    delete d8;
+    delete d32;
+  }
+}
+
+namespace {
+  void expect_segmentation_equals_lookup(ColorSegmentationOp &op, const Img8u &rgb) {
+    Img8u conv(rgb.getSize(), op.getSegmentationFormat());
+    cc(&rgb, &conv);
+    int w = 0, h = 0, t = 0;
+    op.getLUTDims(w, h, t);
+    const icl8u *lut = op.getLUT();
+    const icl8u *sh = op.getSegmentationShifts();
+    ImgBase *dst = 0;
+    op.apply(&rgb, &dst);
+    const Img8u &d = *dst->asImg<icl8u>();
+    for (int i = 0; i < rgb.getDim(); ++i) {
+      const int idx = (conv.getData(0)[i] >> sh[0]) + w * (conv.getData(1)[i] >> sh[1]) +
+                      w * h * (conv.getData(2)[i] >> sh[2]);
+      ASSERT_EQ(lut[idx], d.getData(0)[i]);
+    }
+    delete dst;
+  }
+}
+
+TEST(ColorSegmentationOpTest, FusedAndCompressedLookupsMatchDenseLookup) {
+  Img8u rgb(Size(123, 77), formatRGB);
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < rgb.getDim(); ++i) rgb.getData(c)[i] = (i * 7919 + c * 104729 + (i * i) % 113) % 256;
+  }
+  const format fmts[] = { formatYUV, formatHLS, formatRGB };
+  for (int f = 0; f < 3; ++f) {
+    for (int threads = 0; threads < 2; ++threads) {
+      // small dense LUT and large (compressed) LUT
+      for (int shift = 0; shift < 3; shift += 2) {
+        ColorSegmentationOp op(shift, shift, shift, fmts[f]);
+        op.setNumThreads(threads);
+        op.lutEntry(100, 120, 130, 40, 30, 50, 1);
+        op.lutEntry(30, 200, 60, 20, 50, 20, 2);
+        expect_segmentation_equals_lookup(op, rgb);
+      }
+    }
+  }
+}
+
+namespace {
+  // brute force temporal smoothing over the whole history (as done by the OpenCL kernel)
+  template<class T>
+  void temporal_smoothing_reference(const std::vector<Img<T> > &history, int filterSize, int newest,
+                                    int difference, int nullValue, Img<T> &dst) {
+    for (int i = 0; i < dst.getDim(); ++i) {
+      int count = 0;
+      float value = 0, min = 100000, max = 0;
+      for (int k = 0; k < filterSize; ++k) {
+        const T v = history[k].getData(0)[i];
+        if (v == nullValue) continue;
+        ++count;
+        value += v;
+        min = std::min<float>(min, v);
+        max = std::max<float>(max, v);
+      }
+      T &d = dst.getData(0)[i];
+      if (!count) d = (T)nullValue;
+      else if (max - min > difference) d = history[newest].getData(0)[i];
+      else d = (T)(value / (float)count);
+    }
+  }
+
+  template<class T>
+  void expect_streaming_smoothing_matches_reference(depth dp, int lo, int hi, int nullValue, int threads) {
+    const Size size(37, 23);
+    const int maxFilterSize = 8;
+    TemporalSmoothingCL ts(size, dp, maxFilterSize, nullValue);
+    ts.setUseCL(false);
+    ts.setNumThreads(threads);
+    ts.setDifference(12);
+
+    std::vector<Img<T> > history;
+    for (int i = 0; i < maxFilterSize; ++i) history.push_back(Img<T>(size, 1));
+    int imgCount = 0, filterSize = maxFilterSize / 2;
+    const int sizes[] = { 3, 8, 1, 5 };
+    for (int frame = 0; frame < 60; ++frame) {
+      if (frame % 15 == 14) {
+        filterSize = sizes[(frame / 15) % 4];
+        ts.setFilterSize(filterSize);
+        imgCount = 0;
+      }
+      Img<T> in(size, 1);
+      for (int i = 0; i < in.getDim(); ++i) {
+        const int r = (i * 7919 + frame * 104729 + (i * frame) % 97) % (hi - lo + 1);
+        in.getData(0)[i] = (T)(r % 11 ? lo + (i % 7 == 0 ? r : r / 8) : nullValue);
+      }
+      if (imgCount % filterSize == 0) imgCount = 0;
+      in.deepCopy(&history[imgCount]);
+      const int newest = imgCount++;
+
+      Img<T> expected(size, 1);
+      temporal_smoothing_reference(history, filterSize, newest, 12, nullValue, expected);
+      const Img<T> result = dp == depth8u ? *ts.temporalSmoothingC(*in.as8u()).template asImg<T>()
+                                          : *ts.temporalSmoothingF(*in.as32f()).template asImg<T>();
+      for (int i = 0; i < expected.getDim(); ++i) {
+        ASSERT_EQ(expected.getData(0)[i], result.getData(0)[i]) << "frame " << frame << " pixel " << i;
+      }
+    }
+  }
+}
+
+TEST(MotionSensitiveTemporalSmoothingTest, StreamingEngineMatchesFullHistoryScan) {
+  for (int threads = 0; threads < 2; ++threads) {
+    expect_streaming_smoothing_matches_reference<icl8u>(depth8u, 0, 255, 0, threads);
+    expect_streaming_smoothing_matches_reference<icl8u>(depth8u, 0, 255, -1, threads);
+    expect_streaming_smoothing_matches_reference<icl32f>(depth32f, -40, 200, 0, threads);
+  }
+}
+
+TEST(PixelExpressionTest, FusedEvaluationMatchesPixelwiseComputation) {
+  Img8u a(Size(83, 57), 3), b(Size(83, 57), 3), mask(Size(83, 57), 1);
+  Img32f f(Size(83, 57), 3);
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < a.getDim(); ++i) {
+      a.getData(c)[i] = (i * 7919 + c * 31) % 256;
+      b.getData(c)[i] = (i * 104729 + c * 17) % 256;
+      f.getData(c)[i] = ((i * 31 + c) % 200) * 0.75f - 20;
+      if (!c) mask.getData(0)[i] = (i % 3) ? 255 : 0;
+    }
+  }
+  const Rect roi(5, 3, 61, 41);
+  a.setROI(roi);
+  b.setROI(roi);
+  f.setROI(roi);
+  mask.setROI(roi);
+  std::vector<icl8u> table(256);
+  for (int i = 0; i < 256; ++i) table[i] = (i * 37) % 256;
+
+  for (int threads = 0; threads < 2; ++threads) {
+    Img8u cmp, sum, fused;
+    Img32f root;
+    evaluate((pix(a) * 0.5f + pix(b)) > 100, cmp, threads);
+    evaluate(pix(a) + pix(b), sum, threads);
+    evaluate(lut(pix(f) * 2, table) & (pix(mask) != 0), fused, threads);
+    evaluate(sqrt(abs(pix(f))) - 1, root, threads);
+    ASSERT_EQ(roi.getSize(), cmp.getSize());
+    ASSERT_EQ(3, fused.getChannels());
+
+    for (int c = 0; c < 3; ++c) {
+      for (int y = 0; y < roi.height; ++y) {
+        for (int x = 0; x < roi.width; ++x) {
+          const int va = a(roi.x + x, roi.y + y, c), vb = b(roi.x + x, roi.y + y, c);
+          const float vf = f(roi.x + x, roi.y + y, c);
+          EXPECT_EQ((va * 0.5f + vb) > 100 ? 255 : 0, cmp(x, y, c));
+          EXPECT_EQ(std::min(va + vb, 255), sum(x, y, c));
+          const int idx = std::max(0, std::min(255, (int)(vf * 2)));
+          EXPECT_EQ(mask(roi.x + x, roi.y + y, 0) ? table[idx] : 0, fused(x, y, c));
+          EXPECT_FLOAT_EQ(std::sqrt(std::abs(vf)) - 1, root(x, y, c));
+        }
+      }
+    }
+  }
+
+  Img8u small(Size(10, 10), 3), dst;
+  EXPECT_THROW(evaluate(pix(a) + pix(small), dst), ICLException);
+}
+
+namespace {
+  // brute force proximity measure of result pixel (u,v) on the zero padded image ROI
+  template<class T>
+  double proximity_reference(const Img<T> &image, const Img<T> &templ, int c, ProximityOp::optype ot,
+                             ProximityOp::applymode am, int u, int v) {
+    const Rect r = image.getROI(), t = templ.getROI();
+    const int ox = am == ProximityOp::valid ? 0 : am == ProximityOp::full ? t.width - 1 : t.width / 2;
+    const int oy = am == ProximityOp::valid ? 0 : am == ProximityOp::full ? t.height - 1 : t.height / 2;
+    double sx = 0, sxx = 0, sxt = 0, st = 0, stt = 0;
+    for (int j = 0; j < t.height; ++j) {
+      for (int i = 0; i < t.width; ++i) {
+        const int x = u - ox + i, y = v - oy + j;
+        const double a = (x >= 0 && y >= 0 && x < r.width && y < r.height) ? image(r.x + x, r.y + y, c) : 0;
+        const double b = templ(t.x + i, t.y + j, c);
+        sx += a; sxx += a * a; sxt += a * b; st += b; stt += b * b;
+      }
+    }
+    const double n = t.getDim();
+    switch (ot) {
+      case ProximityOp::sqrDistance: return (sxx - 2 * sxt + stt) / std::sqrt(sxx * stt);
+      case ProximityOp::crossCorr: return sxt / std::sqrt(sxx * stt);
+      default: return (sxt - sx * st / n) / std::sqrt((sxx - sx * sx / n) * (stt - st * st / n));
+    }
+  }
+
+  template<class T>
+  void expect_proximity_matches_reference(const Img<T> &image, const Img<T> &templ, int threads, int sampling) {
+    const ProximityOp::optype ots[] = { ProximityOp::sqrDistance, ProximityOp::crossCorr, ProximityOp::crossCorrCoeff };
+    const ProximityOp::applymode ams[] = { ProximityOp::full, ProximityOp::same, ProximityOp::valid };
+    for (int o = 0; o < 3; ++o) {
+      for (int a = 0; a < 3; ++a) {
+        ProximityOp op(ots[o], ams[a]);
+        op.setNumThreads(threads);
+        ImgBase *dst = 0;
+        op.apply(&image, &templ, &dst);
+        const Img32f &d = *dst->as32f();
+        const Size s = image.getROISize(), t = templ.getROISize();
+        const Size e = ams[a] == ProximityOp::full ? s + t - Size(1, 1) :
+                       ams[a] == ProximityOp::same ? s : s - t + Size(1, 1);
+        ASSERT_EQ(e, d.getSize());
+        for (int c = 0; c < d.getChannels(); ++c) {
+          for (int i = 0; i < d.getDim(); i += sampling) {
+            const int u = i % e.width, v = i / e.width;
+            const double r = proximity_reference(image, templ, c, ots[o], ams[a], u, v);
+            ASSERT_NEAR(r, d(u, v, c), 1e-4 * std::max(1.0, std::fabs(r))) << "op " << o << " mode " << a << " at " << u << "," << v;
+          }
+        }
+        delete dst;
+      }
+    }
+  }
+}
+
+TEST(ProximityOpTest, NativeBackendMatchesBruteForce) {
+  Img8u image(Size(41, 33), 2), templ(Size(9, 8), 2);
+  Img32f image32(Size(41, 33), 1), templ32(Size(9, 8), 1);
+  for (int c = 0; c < 2; ++c) {
+    for (int i = 0; i < image.getDim(); ++i) image.getData(c)[i] = 1 + (i * 7919 + c * 31 + (i * i) % 37) % 250;
+    for (int i = 0; i < templ.getDim(); ++i) templ.getData(c)[i] = 1 + (i * 104729 + c * 17) % 250;
+  }
+  for (int i = 0; i < image32.getDim(); ++i) image32.getData(0)[i] = 1 + ((i * 31) % 97) * 0.37f;
+  for (int i = 0; i < templ32.getDim(); ++i) templ32.getData(0)[i] = 1 + ((i * 13) % 29) * 1.5f;
+  image.setROI(Rect(3, 2, 33, 27));
+  templ.setROI(Rect(1, 1, 5, 6));
+  for (int threads = 0; threads < 2; ++threads) {
+    expect_proximity_matches_reference(image, templ, threads, 1);
+    expect_proximity_matches_reference(image32, templ32, threads, 1);
+  }
+
+  // large templates are correlated in the frequency domain
+  Img8u large(Size(256, 256), 1), largeTempl(Size(48, 48), 1);
+  for (int i = 0; i < large.getDim(); ++i) large.getData(0)[i] = 1 + (i * 7919 + (i * i) % 101) % 250;
+  for (int i = 0; i < largeTempl.getDim(); ++i) largeTempl.getData(0)[i] = 1 + (i * 104729) % 250;
+  expect_proximity_matches_reference(large, largeTempl, 0, 997);
+}
@@ -274,6 +274,7 @@ namespace icl{
         m_poGrabber -> addProperty("desired format", "menu", "not used,formatGray,formatRGB,formatHLS,formatYUV,formatLAB,formatChroma,formatMatrix", "not used", 0, "");
         m_poGrabber -> addProperty("undistortion.enable","flag","",true,0,"forces to not use undistortion (eve if given)");
         m_poGrabber -> addProperty("undistortion.interpolation","menu","nearest,linear","nearest",0,"sets the interpolation mode for image undistortion");
+        m_poGrabber -> addProperty("undistortion.threads","range:spinbox","[0,64]:1","1",0,"number of threads used for image undistortion (0: all threads)");
 #ifdef ICL_HAVE_OPENCL
         m_poGrabber -> addProperty("undistortion.use OpenCL","flag","",false, 0,"trys to use OpenCL for the Warping operation (if possible, please note that OpenCL-based image warping is not neccessarily faster)");
 #endif
@@ -57,6 +57,7 @@ namespace icl{
       bool undistortionEnabled;
       scalemode undistortionInterpolationMode;
       bool undistortionUseOpenCL;
+      int undistortionNumThreads;
 
       Mutex callbackMutex;
       std::vector<Grabber::callback> callbacks;
@@ -75,6 +76,7 @@ namespace icl{
       data->undistortionEnabled = true;
       data->undistortionInterpolationMode = interpolateNN;
       data->undistortionUseOpenCL = false;
+      data->undistortionNumThreads = 1;
     }
 
     Grabber::~Grabber() {
@@ -177,6 +179,7 @@ namespace icl{
       const ImgBase *adapted = adaptGrabResult(acquired,useWarp ? 0 : ppoDst);
       if(useWarp){
         data->warp->setScaleMode(data->undistortionInterpolationMode);
+        data->warp->setNumThreads(data->undistortionNumThreads);
 #ifdef ICL_HAVE_OPENCL
         data->warp->setTryUseOpenCL(data->undistortionUseOpenCL);
 #endif
@@ -327,6 +330,8 @@ namespace icl{
         }
       }else if(prop.name == "undistortion.use OpenCL"){
         data->undistortionUseOpenCL = parse<bool>(prop.value);
+      }else if(prop.name == "undistortion.threads"){
+        data->undistortionNumThreads = parse<int>(prop.value);
       }
     }
 
@@ -29,7 +29,12 @@
 ********************************************************************/
 
 #include <ICLMath/FFTUtils.h>
+#include <ICLUtils/ThreadPool.h>
+#include <ICLUtils/SmartPtr.h>
 #include <limits>
+#include <vector>
+#include <map>
+#include <mutex>
 
 #ifdef ICL_SYSTEM_WINDOWS
 #ifdef min
@@ -781,56 +786,336 @@ namespace icl{
       DynMatrix<std::complex<icl64f> > &joinComplex(const DynMatrix<icl64f> &real,
                                                          const DynMatrix<icl64f> &im,DynMatrix<std::complex<icl64f> > &dst);
 
-      double f = 0.0;
-      template<typename T1,typename T2>
-      std::complex<T2>*  fft(unsigned int n, const T1* a){
-	if(n==1){
-          std::complex<T2> *cpya = new std::complex<T2>[1];
-          cpya[0] = (std::complex<T2>)a[0];
-          return cpya;
-	} else if(n%2==0){
-          unsigned int halfsize = n/2;
-          T1 *even = new T1[halfsize];
-          T1 *odd = new T1[halfsize];
-          //unsigned int i=0;
-          unsigned int j=0;
-          //split array
-          for(unsigned int i=0;i<halfsize;++i){
-            j=2*i;
-            even[i] = a[j];
-            odd[i] = a[j+1];
+      /// Cached FFT plan for one transformation size
+      /** Sizes whose prime factors are 2, 3, 5 and 7 are transformed by a
+          mixed-radix decimation-in-time algorithm, all other sizes by
+          Bluestein's algorithm, which maps the transformation to a cyclic
+          convolution of power-of-two size. A plan contains all twiddle
+          factors of its size. Plans are created on demand by FFTPlan::get
+          and kept until the program exits, so references to them stay
+          valid. Since
+          all temporary memory is passed to execute, a plan can be used by
+          several threads at once. */
+      template<class R>
+      class FFTPlan{
+        public:
+        typedef std::complex<R> C;
+
+        /// returns the cached plan for the given size
+        static const FFTPlan &get(int n);
+
+        /// size of the transformation
+        int size() const { return m_n; }
+
+        /// number of elements of the scratch buffer needed by execute
+        int scratchSize() const { return m_bluestein ? 2*m_m : 0; }
+
+        /// number of elements of the scratch buffer needed by executeReal
+        int realScratchSize() const {
+          return m_n + (m_half ? m_half->scratchSize() : scratchSize());
+        }
+
+        /// out = DFT(in), or the unnormalized inverse DFT; in and out must not overlap
+        void execute(const C *in, C *out, bool inverse, C *scratch) const;
+
+        /// execute for real valued input
+        /** For even sizes, the input is packed into a complex sequence of
+            half the length, whose transformation is then split into the
+            spectrum of the real input */
+        void executeReal(const R *in, C *out, bool inverse, C *scratch) const;
+
+        private:
+        explicit FFTPlan(int n);
+
+        /// recursive decimation-in-time step
+        void work(C *out, const C *in, int fstride, const int *factors, bool inverse) const;
+
+        void butterfly2(C *f, int fstride, int m, const C *tw) const;
+        void butterfly3(C *f, int fstride, int m, const C *tw) const;
+        void butterfly4(C *f, int fstride, int m, const C *tw, bool inverse) const;
+        void butterflyGeneric(C *f, int fstride, int m, int p, const C *tw) const;
+
+        int m_n;
+        std::vector<int> m_factors;    //!< pairs of radix and remaining size
+        std::vector<C> m_twiddles[2];  //!< exp(-2 pi i k/n) and exp(2 pi i k/n)
+        bool m_bluestein;
+        int m_m;                       //!< power-of-two size of the convolution
+        std::vector<C> m_chirp;        //!< exp(-pi i k^2/n)
+        std::vector<C> m_chirpFFT;     //!< DFT of the convolution kernel
+        const FFTPlan *m_sub;          //!< plan of size m_m (Bluestein)
+        const FFTPlan *m_half;         //!< plan of size n/2 (real input of even size)
+      };
+
+      template<class R>
+      const FFTPlan<R> &FFTPlan<R>::get(int n){
+        // recursive, since plans create their sub plans using get
+        static std::recursive_mutex mutex;
+        static std::map<int,SmartPtr<FFTPlan> > plans;
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        typename std::map<int,SmartPtr<FFTPlan> >::iterator it = plans.find(n);
+        if(it != plans.end()) return *it->second;
+        FFTPlan *p = new FFTPlan(n);
+        plans[n] = SmartPtr<FFTPlan>(p);
+        return *p;
+      }
+
+      template<class R>
+      FFTPlan<R>::FFTPlan(int n):m_n(n),m_bluestein(false),m_m(0),m_sub(0),m_half(0){
+        for(int d=0;d<2;++d){
+          m_twiddles[d].resize(n);
+          for(int k=0;k<n;++k){
+            const double a = (d ? FFT_2_PI : -FFT_2_PI) * k / n;
+            m_twiddles[d][k] = C((R)std::cos(a),(R)std::sin(a));
           }
-          std::complex<T2>* g = fft<T1,T2>(halfsize,even);
-          std::complex<T2>* u = fft<T1,T2>(halfsize,odd);
-          std::complex<T2>* c = new std::complex<T2>[n];
-          double cp = -(FFT_2_PI)/n;
-          std::complex<T2> fac(0.0,0.0);
-          for(unsigned int k=0;k<halfsize;++k){
-            f=cp*k;
-            fac = u[k]*std::complex<T2>(std::cos(f),std::sin(f));
-            c[k]=g[k]+fac;
-            c[k+halfsize]=g[k]-fac;
+        }
+        static const int radices[] = { 4, 2, 3, 5, 7 };
+        int rest = n;
+        for(int i=0;i<5 && rest > 1;){
+          if(rest % radices[i]){ ++i; continue; }
+          rest /= radices[i];
+          m_factors.push_back(radices[i]);
+          m_factors.push_back(rest);
+        }
+        if(rest > 1){
+          m_bluestein = true;
+          m_factors.clear();
+          m_m = 1;
+          while(m_m < 2*n-1) m_m <<= 1;
+          m_sub = &get(m_m);
+          m_chirp.resize(n);
+          for(int k=0;k<n;++k){
+            const double a = -FFT_PI * (double)(((long long)k*k) % (2*(long long)n)) / n;
+            m_chirp[k] = C((R)std::cos(a),(R)std::sin(a));
           }
-          delete[] even;
-          delete[] odd;
-          delete[] g;
-          delete[] u;
-          return c;
-	} else {
-          T2 omega = -FFT_2_PI/n;
-          std::complex<T2> *m3 = new std::complex<T2>[n];
-          std::complex<T2> x((T2)0.0,(T2)0.0);
-          T2 y = (T2) 0;
-          for(unsigned int p =0;p<n;++p){
-            x = std::complex<T2>(0.0,0.0);
-            y=p*omega;
-            for(unsigned int q = 0;q<n;++q){
-              x=x+(std::complex<T2>(std::cos(y*q),std::sin(y*q))*((std::complex<T2>)a[q]));
+          std::vector<C> b(m_m,C(0,0));
+          b[0] = std::conj(m_chirp[0]);
+          for(int k=1;k<n;++k){
+            b[k] = b[m_m-k] = std::conj(m_chirp[k]);
+          }
+          m_chirpFFT.resize(m_m);
+          m_sub->execute(b.data(),m_chirpFFT.data(),false,0);
+        }
+        if(n%2 == 0) m_half = &get(n/2);
+      }
+
+      template<class R>
+      void FFTPlan<R>::butterfly2(C *f, int fstride, int m, const C *tw) const{
+        C *g = f+m;
+        for(int k=0;k<m;++k){
+          const C t = g[k]*tw[k*fstride];
+          g[k] = f[k]-t;
+          f[k] += t;
+        }
+      }
+
+      template<class R>
+      void FFTPlan<R>::butterfly3(C *f, int fstride, int m, const C *tw) const{
+        const R s = tw[fstride*m].imag();
+        for(int k=0;k<m;++k){
+          const C s1 = f[k+m]*tw[k*fstride], s2 = f[k+2*m]*tw[2*k*fstride];
+          const C s3 = s1+s2, s0 = (s1-s2)*s;
+          f[k+m] = f[k] - s3*R(0.5);
+          f[k] += s3;
+          f[k+2*m] = C(f[k+m].real()+s0.imag(), f[k+m].imag()-s0.real());
+          f[k+m] += C(-s0.imag(), s0.real());
+        }
+      }
+
+      template<class R>
+      void FFTPlan<R>::butterfly4(C *f, int fstride, int m, const C *tw, bool inverse) const{
+        for(int k=0;k<m;++k){
+          const C s0 = f[k+m]*tw[k*fstride];
+          const C s1 = f[k+2*m]*tw[2*k*fstride];
+          const C s2 = f[k+3*m]*tw[3*k*fstride];
+          const C s5 = f[k]-s1, s3 = s0+s2, s4 = s0-s2;
+          f[k] += s1;
+          f[k+2*m] = f[k]-s3;
+          f[k] += s3;
+          if(inverse){
+            f[k+m] = C(s5.real()-s4.imag(), s5.imag()+s4.real());
+            f[k+3*m] = C(s5.real()+s4.imag(), s5.imag()-s4.real());
+          }else{
+            f[k+m] = C(s5.real()+s4.imag(), s5.imag()-s4.real());
+            f[k+3*m] = C(s5.real()-s4.imag(), s5.imag()+s4.real());
+          }
+        }
+      }
+
+      template<class R>
+      void FFTPlan<R>::butterflyGeneric(C *f, int fstride, int m, int p, const C *tw) const{
+        C t[7];
+        for(int u=0;u<m;++u){
+          for(int q=0;q<p;++q) t[q] = f[u+q*m];
+          for(int q1=0;q1<p;++q1){
+            const int k = u+q1*m;
+            C acc = t[0];
+            for(int q=1, i=0;q<p;++q){
+              i += fstride*k;
+              if(i >= m_n) i %= m_n;
+              acc += t[q]*tw[i];
             }
-            m3[p]=x;
+            f[k] = acc;
           }
-          return m3;
-	}
+        }
+      }
+
+      template<class R>
+      void FFTPlan<R>::work(C *out, const C *in, int fstride, const int *factors, bool inverse) const{
+        const int p = factors[0], m = factors[1];
+        if(m == 1){
+          for(int i=0;i<p;++i) out[i] = in[i*fstride];
+        }else{
+          for(int i=0;i<p;++i) work(out+i*m,in+i*fstride,fstride*p,factors+2,inverse);
+        }
+        const C *tw = m_twiddles[inverse].data();
+        switch(p){
+          case 2: butterfly2(out,fstride,m,tw); break;
+          case 3: butterfly3(out,fstride,m,tw); break;
+          case 4: butterfly4(out,fstride,m,tw,inverse); break;
+          default: butterflyGeneric(out,fstride,m,p,tw); break;
+        }
+      }
+
+      template<class R>
+      void FFTPlan<R>::execute(const C *in, C *out, bool inverse, C *scratch) const{
+        if(m_n == 1){
+          out[0] = in[0];
+        }else if(!m_bluestein){
+          work(out,in,1,m_factors.data(),inverse);
+        }else{
+          C *a = scratch, *A = scratch+m_m;
+          for(int j=0;j<m_n;++j) a[j] = (inverse ? std::conj(in[j]) : in[j]) * m_chirp[j];
+          std::fill(a+m_n,a+m_m,C(0,0));
+          m_sub->execute(a,A,false,0);
+          for(int i=0;i<m_m;++i) A[i] *= m_chirpFFT[i];
+          m_sub->execute(A,a,true,0);
+          const R s = R(1)/m_m;
+          for(int k=0;k<m_n;++k){
+            const C x = a[k]*m_chirp[k]*s;
+            out[k] = inverse ? std::conj(x) : x;
+          }
+        }
+      }
+
+      template<class R>
+      void FFTPlan<R>::executeReal(const R *in, C *out, bool inverse, C *scratch) const{
+        if(!m_half){
+          for(int j=0;j<m_n;++j) scratch[j] = C(in[j],0);
+          execute(scratch,out,inverse,scratch+m_n);
+          return;
+        }
+        // the DFT of real input is conjugate symmetric, so its inverse is conj(DFT)
+        const int h = m_n/2;
+        C *z = scratch, *Z = scratch+h;
+        for(int k=0;k<h;++k) z[k] = C(in[2*k],in[2*k+1]);
+        m_half->execute(z,Z,false,scratch+m_n);
+        const C *tw = m_twiddles[0].data();
+        for(int k=0;k<=h;++k){
+          const C zk = Z[k == h ? 0 : k], zc = std::conj(Z[k == 0 ? 0 : h-k]);
+          const C even = (zk+zc)*R(0.5), odd = (zk-zc)*C(0,R(-0.5));
+          const C x = even + tw[k]*odd;
+          out[k] = inverse ? std::conj(x) : x;
+        }
+        for(int k=1;k<h;++k) out[m_n-k] = std::conj(out[k]);
+      }
+
+      /// thread local scratch memory of the fallback transformations
+      template<class R>
+      static std::complex<R> *fft_scratch(int n){
+        static thread_local std::vector<std::complex<R> > buf;
+        if((int)buf.size() < n) buf.resize(n);
+        return buf.data();
+      }
+
+      /// transforms one row of real valued input
+      template<class T1, class R>
+      struct FFTRow{
+        static int scratchSize(const FFTPlan<R> &plan){
+          return plan.size() + plan.realScratchSize();
+        }
+        static void apply(const FFTPlan<R> &plan, const T1 *in, std::complex<R> *out,
+                          bool inverse, std::complex<R> *scratch){
+          R *r = reinterpret_cast<R*>(scratch);
+          for(int i=0;i<plan.size();++i) r[i] = (R)in[i];
+          plan.executeReal(r,out,inverse,scratch+plan.size());
+        }
+      };
+
+      /// transforms one row of complex input
+      template<class S, class R>
+      struct FFTRow<std::complex<S>,R>{
+        static int scratchSize(const FFTPlan<R> &plan){
+          return plan.size() + plan.scratchSize();
+        }
+        static void apply(const FFTPlan<R> &plan, const std::complex<S> *in, std::complex<R> *out,
+                          bool inverse, std::complex<R> *scratch){
+          for(int i=0;i<plan.size();++i) scratch[i] = CreateComplex<std::complex<S>,R>::create_complex(in[i]);
+          plan.execute(scratch,out,inverse,scratch+plan.size());
+        }
+      };
+
+      /// transforms rows [begin,end) of src and writes them transposed into dst
+      template<class T1, class R>
+      struct FFTRowsTransposed{
+        const FFTPlan<R> &plan;
+        const T1 *src;
+        std::complex<R> *dst;
+        int dstStep;
+        bool inverse;
+        R scale;
+
+        FFTRowsTransposed(const FFTPlan<R> &plan, const T1 *src, std::complex<R> *dst,
+                          int dstStep, bool inverse, R scale):
+          plan(plan),src(src),dst(dst),dstStep(dstStep),inverse(inverse),scale(scale){}
+
+        void operator()(int begin, int end) const{
+          const int n = plan.size();
+          std::complex<R> *row = fft_scratch<R>(n + FFTRow<T1,R>::scratchSize(plan));
+          for(int i=begin;i<end;++i){
+            FFTRow<T1,R>::apply(plan,src+(size_t)i*n,row,inverse,row+n);
+            std::complex<R> *d = dst+i;
+            if(scale != R(1)){
+              for(int j=0;j<n;++j) d[(size_t)j*dstStep] = row[j]*scale;
+            }else{
+              for(int j=0;j<n;++j) d[(size_t)j*dstStep] = row[j];
+            }
+          }
+        }
+      };
+
+      /// 2D transformation using cached plans: rows into buf (transposed), then rows of buf into dst
+      template<typename T1, typename T2>
+      static DynMatrix<std::complex<T2> > &fft2D_plan(const DynMatrix<T1> &src, DynMatrix<std::complex<T2> > &dst,
+                                                      DynMatrix<std::complex<T2> > &buf, bool inverse, int numThreads){
+        const int cols = src.cols(), rows = src.rows();
+        if(buf.isNull() || (int)buf.cols() != rows || (int)buf.rows() != cols){
+          buf.setBounds(rows,cols);
+        }
+        if((int)dst.cols() != cols || (int)dst.rows() != rows){
+          dst.setBounds(cols,rows);
+        }
+        FFTRowsTransposed<T1,T2> r(FFTPlan<T2>::get(cols),src.data(),buf.data(),rows,
+                                   inverse,inverse ? T2(1)/cols : T2(1));
+        parallel_for(0,rows,r,0,numThreads);
+        FFTRowsTransposed<std::complex<T2>,T2> c(FFTPlan<T2>::get(rows),buf.data(),dst.data(),cols,
+                                                 inverse,inverse ? T2(1)/rows : T2(1));
+        parallel_for(0,cols,c,0,numThreads);
+        return dst;
+      }
+
+      /// 1D transformation using cached plans
+      template<typename T1, typename T2>
+      static std::complex<T2> *fft1D_plan(unsigned int n, const T1 *a, bool inverse){
+        std::complex<T2> *c = new std::complex<T2>[n];
+        if(!n) return c;
+        const FFTPlan<T2> &plan = FFTPlan<T2>::get(n);
+        FFTRow<T1,T2>::apply(plan,a,c,inverse,fft_scratch<T2>(FFTRow<T1,T2>::scratchSize(plan)));
+        return c;
+      }
+
+      template<typename T1,typename T2>
+      std::complex<T2>*  fft(unsigned int n, const T1* a){
+        return fft1D_plan<T1,T2>(n,a,false);
       }
       template ICLMath_API icl32c*  fft(unsigned int n, const icl8u* a);
       template ICLMath_API icl32c*  fft(unsigned int n, const icl16u* a);
@@ -1221,94 +1506,69 @@ namespace icl{
 
       template<typename T1, typename T2>
       DynMatrix<std::complex<T2> >& fft2D_cpp(const DynMatrix<T1> &src,DynMatrix<std::complex<T2> > &dst,
-                                                   DynMatrix<std::complex<T2> > &buf){
+                                                   DynMatrix<std::complex<T2> > &buf, int numThreads){
 	FFT_DEBUG("fft2D_cpp");
-	//check buffer
-	if(buf.isNull() || buf.cols() != src.rows() || buf.rows() != src.cols()){
-          //always wrong, but in this case really right!!!
-          buf(src.rows(),src.cols());
-	}
-	unsigned int cols = src.cols();
-	unsigned int rows = src.rows();
-	std::complex<T2> *temp=0;
-	//already transposed
-	for(unsigned int i=0;i<rows;++i){
-          temp = fft<T1,T2>(cols,src.row_begin(i));
-          for(unsigned int j=0;j<cols;++j){
-            //buf.operator()(i,j)=temp[j];
-            buf(i,j)=temp[j];
-          }
-          delete[] temp;
-	}
-
-	for(unsigned int i=0;i<cols;++i){
-          temp = fft<std::complex<T2>,T2 >(rows,buf.row_begin(i));
-          for(unsigned int j=0;j<rows;++j){
-            //dst.operator()(i,j)=temp[j];
-            dst(i,j)=temp[j];
-          }
-          delete[] temp;
-	}
-	return dst;
+	return fft2D_plan(src,dst,buf,false,numThreads);
       }
       template ICLMath_API
       DynMatrix<icl32c >&  fft2D_cpp(const DynMatrix<icl8u> &src,
-                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  fft2D_cpp(const DynMatrix<icl16u> &src,
-                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  fft2D_cpp(const DynMatrix<icl16s> &src,
-                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  fft2D_cpp(const DynMatrix<icl32u> &src,
-                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  fft2D_cpp(const DynMatrix<icl32s> &src,
-                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D_cpp(const DynMatrix<icl8u> &src,
-                                                        DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                        DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D_cpp(const DynMatrix<icl16u> &src,
-                                                        DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                        DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D_cpp(const DynMatrix<icl16s> &src,
-                                                        DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                        DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D_cpp(const DynMatrix<icl32u> &src,
-                                                        DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                        DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D_cpp(const DynMatrix<icl32s> &src,
-                                                        DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                        DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  fft2D_cpp(const DynMatrix<icl32f> &src,
-                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                        DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >& fft2D_cpp(const DynMatrix<icl32f> &src,
-                                                       DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                       DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >& fft2D_cpp(const DynMatrix<icl64f> &src,
-                                                       DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                       DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& fft2D_cpp(const DynMatrix<icl64f> &src,
-                                                       DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                       DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >& fft2D_cpp(const DynMatrix<icl32c > &src,
-                                                       DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                       DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& fft2D_cpp(const DynMatrix<icl32c > &src,
-                                                       DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                       DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >& fft2D_cpp(const DynMatrix<std::complex<icl64f> > &src,
-                                                       DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                       DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& fft2D_cpp(const DynMatrix<std::complex<icl64f> > &src,
-                                                       DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                       DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
 
       template<typename T1, typename T2>
       DynMatrix<std::complex<T2> >& fft2D(const DynMatrix<T1> &src,
-                                               DynMatrix<std::complex<T2> > &dst, DynMatrix<std::complex<T2> > &buf){
+                                               DynMatrix<std::complex<T2> > &dst, DynMatrix<std::complex<T2> > &buf,
+                                               int numThreads){
 	if(isPowerOfTwo(src.cols()) && isPowerOfTwo(src.rows())){
 #ifdef ICL_HAVE_IPP
           buf.setBounds(src.cols(),src.rows());
@@ -1318,96 +1578,96 @@ namespace icl{
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template ICLMath_API
       DynMatrix<icl32c >& fft2D(const DynMatrix<icl8u> &src,
-                                                   DynMatrix<icl32c > &dst,	DynMatrix<icl32c > &buf);
+                                                   DynMatrix<icl32c > &dst,	DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& fft2D(const DynMatrix<icl16u> &src,
-                                                   DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                   DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& fft2D(const DynMatrix<icl32u> &src,
-                                                   DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                   DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& fft2D(const DynMatrix<icl16s> &src,
-                                                   DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                   DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& fft2D(const DynMatrix<icl32s> &src,
-                                                   DynMatrix<icl32c > &dst,	DynMatrix<icl32c > &buf);
+                                                   DynMatrix<icl32c > &dst,	DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& fft2D(const DynMatrix<icl32f> &src,
-                                                   DynMatrix<icl32c > &dst,	DynMatrix<icl32c > &buf);
+                                                   DynMatrix<icl32c > &dst,	DynMatrix<icl32c > &buf, int numThreads);
 
       //double
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D(const DynMatrix<icl8u> &src,
-                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D(const DynMatrix<icl16u> &src,
-                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D(const DynMatrix<icl32u> &src,
-                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D(const DynMatrix<icl16s> &src,
-                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D(const DynMatrix<icl32s> &src,
-                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D(const DynMatrix<icl32f> &src,
-                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  fft2D(const DynMatrix<icl64f> &src,
-                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                    DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<icl32c >&  fft2D(const DynMatrix<icl64f> &src,
-                                                    DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf){
+                                                    DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       //complex
       template<> ICLMath_API
       DynMatrix<icl32c >& fft2D(const DynMatrix<icl32c > &src,
-                                                   DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf){
+                                                   DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads){
 	if(isPowerOfTwo(src.cols()) && isPowerOfTwo(src.rows())){
 #ifdef ICL_HAVE_IPP
           buf.setBounds(src.cols(),src.rows());
@@ -1417,25 +1677,25 @@ namespace icl{
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft_icl32fc(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >& fft2D(const DynMatrix<std::complex<icl64f> > &src,
-                                                   DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                   DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_fft_icl64fc(src,dst,buf);
 #endif
-	return fft2D_cpp(src,dst,buf);
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >& fft2D(const DynMatrix<icl32c > &src,DynMatrix<std::complex<icl64f> > &dst,
-                                                   DynMatrix<std::complex<icl64f> > &buf){
-	return fft2D_cpp(src,dst,buf);
+                                                   DynMatrix<std::complex<icl64f> > &buf, int numThreads){
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<icl32c >& fft2D(const DynMatrix<std::complex<icl64f> > &src,DynMatrix<icl32c > &dst,
-                                                   DynMatrix<icl32c > &buf){
-	return fft2D_cpp(src,dst,buf);
+                                                   DynMatrix<icl32c > &buf, int numThreads){
+	return fft2D_cpp(src,dst,buf,numThreads);
       }
 
       template<typename T1, typename T2>
@@ -1554,81 +1814,10 @@ namespace icl{
       DynMatrix<icl32c >&  dft2D(DynMatrix<std::complex<icl64f> >& src,
                                                     DynMatrix<icl32c >& dst, DynMatrix<icl32c >& buf);
 
-      double e = 0.0;
-      template<typename T1,typename T2>
-      static std::complex<T2>*  ifft_(unsigned int n, const T1* a){
-	if(n==1){
-          std::complex<T2> *cpya = new std::complex<T2>[1];
-          cpya[0] = CreateComplex<T1,T2>::create_complex(*a);
-          return cpya;
-	} else if (n%2==0){
-          unsigned int halfsize = n/2;
-          T1* even = new T1[halfsize];
-          T1* odd = new T1[halfsize];
-          unsigned int i;
-          //split array
-          for(i=0;i<halfsize;++i){
-            even[i] = a[2*i];
-            odd[i] = a[2*i+1];
-          }
-          std::complex<T2>* g = ifft_<T1,T2>(halfsize,even);
-          std::complex<T2>* u = ifft_<T1,T2>(halfsize,odd);
-
-          std::complex<T2>* c = new std::complex<T2>[n];
-          T2 cp = FFT_2_PI/n;
-          std::complex<T2> fac(0.0,0.0);
-          for(unsigned int k=0;k<halfsize;++k){
-            e=cp*k;
-            fac = u[k]*std::complex<T2>(std::cos(e),std::sin(e));
-            c[k]=g[k]+fac;
-            c[k+halfsize]=g[k]-fac;
-          }
-          delete[] even;
-          delete[] odd;
-          delete[] g;
-          delete[] u;
-          return c;
-	} else {
-          T2 omega = FFT_2_PI/n;
-          std::complex<T2> *m3 = new std::complex<T2>[n];
-          std::complex<T2> x(0.0,0.0);
-          T2 y = (T2)0;
-          for(unsigned int p =0;p<n;++p){
-            x = std::complex<T2>(0.0,0.0);
-            y=p*omega;
-            for(unsigned int q = 0;q<n;++q){
-              //x=x+(exp(std::complex<T2>(0.0,y*q))*(CreateComplex<T1,T2>::create_complex(a[q])));
-              x=x+(std::complex<T2>(std::cos(y*q),std::sin(y*q))*(CreateComplex<T1,T2>::create_complex(a[q])));
-            }
-            m3[p]=x;
-          }
-          return m3;
-	}
-      }
-      template icl32c*  ifft_(unsigned int n, const icl8u* a);
-      template icl32c*  ifft_(unsigned int n, const icl16u* a);
-      template icl32c*  ifft_(unsigned int n, const icl32u* a);
-      template icl32c*  ifft_(unsigned int n, const icl16s* a);
-      template icl32c*  ifft_(unsigned int n, const icl32s* a);
-      template icl32c*  ifft_(unsigned int n, const icl32f* a);
-      template icl32c*  ifft_(unsigned int n, const icl64f* a);
-      template std::complex<icl64f>*  ifft_(unsigned int n, const icl8u* a);
-      template std::complex<icl64f>*  ifft_(unsigned int n, const icl16u* a);
-      template std::complex<icl64f>*  ifft_(unsigned int n, const icl32u* a);
-      template std::complex<icl64f>*  ifft_(unsigned int n, const icl16s* a);
-      template std::complex<icl64f>*  ifft_(unsigned int n, const icl32s* a);
-      template std::complex<icl64f>*  ifft_(unsigned int n, const icl32f* a);
-      template std::complex<icl64f>*  ifft_(unsigned int n, const icl64f* a);
-
-      template icl32c*  ifft_(unsigned int n, const icl32c* a);
-      template std::complex<icl64f>*  ifft_(unsigned int n, const icl32c* a);
-      template std::complex<icl64f>*  ifft_(unsigned int n, const std::complex<icl64f>* a);
-      template icl32c*  ifft_(unsigned int n, const std::complex<icl64f>* a);
-
       template<typename T1, typename T2>
       std::complex<T2>*  ifft_cpp(unsigned int n, const T1* a){
-	std::complex<T2>* tempMat = ifft_<T1,T2>(n,a);
-	double lambda = 1.0/n;
+	std::complex<T2>* tempMat = fft1D_plan<T1,T2>(n,a,true);
+	const T2 lambda = T2(1)/n;
 	for(unsigned int index = 0;index<n;++index){
           tempMat[index] *= lambda;
 	}
@@ -1908,88 +2097,69 @@ namespace icl{
 #endif
 
       template<typename T1, typename T2>
-      DynMatrix<std::complex<T2> >&   ifft2D_cpp(const DynMatrix<T1> &src,DynMatrix<std::complex<T2> > &dst,DynMatrix<std::complex<T2> > &buf){
-	if(buf.isNull() || buf.cols() != src.rows() || buf.rows() != src.cols()){
-          buf.setBounds(src.rows(),src.cols());
-	}
-	unsigned int cols = src.cols();
-	unsigned int rows = src.rows();
-	std::complex<T2> *temp=0;
-	//already transposed
-	for(unsigned int i=0;i<rows;++i){
-          temp = ifft_cpp<T1,T2>(cols,src.row_begin(i));
-          for(unsigned int j=0;j<cols;++j){
-            buf(i,j)=temp[j];
-          }
-          delete[] temp;
-	}
-	for(unsigned int i=0;i<buf.rows();++i){
-          temp = ifft_cpp<std::complex<T2>,T2>(buf.cols(),buf.row_begin(i));
-          for(unsigned int j=0;j<buf.cols();++j){
-            dst(i,j)=temp[j];
-          }
-          delete[] temp;
-	}
-	return dst;
+      DynMatrix<std::complex<T2> >&   ifft2D_cpp(const DynMatrix<T1> &src,DynMatrix<std::complex<T2> > &dst,
+                                                      DynMatrix<std::complex<T2> > &buf, int numThreads){
+	return fft2D_plan(src,dst,buf,true,numThreads);
       }
       template ICLMath_API
       DynMatrix<icl32c >&  ifft2D_cpp(const DynMatrix<icl8u> &src,
-                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  ifft2D_cpp(const DynMatrix<icl16u> &src,
-                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  ifft2D_cpp(const DynMatrix<icl32u> &src,
-                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  ifft2D_cpp(const DynMatrix<icl16s> &src,
-                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  ifft2D_cpp(const DynMatrix<icl32s> &src,
-                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D_cpp(const DynMatrix<icl8u> &src,
-                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D_cpp(const DynMatrix<icl16u> &src,
-                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D_cpp(const DynMatrix<icl32u> &src,
-                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D_cpp(const DynMatrix<icl16s> &src,
-                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D_cpp(const DynMatrix<icl32s> &src,
-                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  ifft2D_cpp(const DynMatrix<icl32f> &src,
-                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  ifft2D_cpp(const DynMatrix<icl64f> &src,
-                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D_cpp(const DynMatrix<icl32f> &src,
-                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D_cpp(const DynMatrix<icl64f> &src,
-                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D_cpp(const DynMatrix<icl32c > &src,
-                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  ifft2D_cpp(const DynMatrix<icl32c > &src,
-                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >&  ifft2D_cpp(const DynMatrix<std::complex<icl64f> > &src,
-                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf);
+                                                         DynMatrix<icl32c > &dst,DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D_cpp(const DynMatrix<std::complex<icl64f> > &src,
-                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf);
+                                                         DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads);
 
       template<typename T1, typename T2>
       DynMatrix<std::complex<T2> >& ifft2D(const DynMatrix<T1> &src,
-                                                DynMatrix<std::complex<T2> > &dst,	DynMatrix<std::complex<T2> > &buf){
+                                                DynMatrix<std::complex<T2> > &dst,	DynMatrix<std::complex<T2> > &buf,
+                                                int numThreads){
 	if(isPowerOfTwo(src.cols()) && isPowerOfTwo(src.rows())){
 #ifdef ICL_HAVE_IPP
           buf.setBounds(src.cols(),src.rows());
@@ -2000,109 +2170,109 @@ namespace icl{
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_ifft_icl32fc(src,dst,buf);
 #endif
-	return ifft2D_cpp(src,dst,buf);
+	return ifft2D_cpp(src,dst,buf,numThreads);
       }
       template ICLMath_API
       DynMatrix<icl32c >& ifft2D(const DynMatrix<icl8u> &src,
-                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& ifft2D(const DynMatrix<icl16u> &src,
-                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& ifft2D(const DynMatrix<icl32u> &src,
-                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& ifft2D(const DynMatrix<icl16s> &src,
-                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& ifft2D(const DynMatrix<icl32s> &src,
-                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& ifft2D(const DynMatrix<icl32f> &src,
-                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& ifft2D(const DynMatrix<icl64f> &src,
-                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& ifft2D(const DynMatrix<icl32c > &src,
-                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       template ICLMath_API
       DynMatrix<icl32c >& ifft2D(const DynMatrix<std::complex<icl64f> > &src,
-                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf);
+                                                    DynMatrix<icl32c > &dst, DynMatrix<icl32c > &buf, int numThreads);
       //double
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D(const DynMatrix<icl8u> &src,
-                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_ifft_icl64fc(src,dst,buf);
 #endif
-	return ifft2D_cpp(src,dst,buf);
+	return ifft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D(const DynMatrix<icl16u> &src,
-                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_ifft_icl64fc(src,dst,buf);
 #endif
-	return ifft2D_cpp(src,dst,buf);
+	return ifft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D(const DynMatrix<icl32u> &src,
-                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_ifft_icl64fc(src,dst,buf);
 #endif
-	return ifft2D_cpp(src,dst,buf);
+	return ifft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D(const DynMatrix<icl16s> &src,
-                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_ifft_icl64fc(src,dst,buf);
 #endif
-	return ifft2D_cpp(src,dst,buf);
+	return ifft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D(const DynMatrix<icl32s> &src,
-                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_ifft_icl64fc(src,dst,buf);
 #endif
-	return ifft2D_cpp(src,dst,buf);
+	return ifft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D(const DynMatrix<icl32f> &src,
-                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_ifft_icl64fc(src,dst,buf);
 #endif
-	return ifft2D_cpp(src,dst,buf);
+	return ifft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D(const DynMatrix<icl64f> &src,
-                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_ifft_icl64fc(src,dst,buf);
 #endif
-	return ifft2D_cpp(src,dst,buf);
+	return ifft2D_cpp(src,dst,buf,numThreads);
       }
 
       //complex
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D(const DynMatrix<icl32c > &src,
-                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_ifft_icl64fc(src,dst,buf);
 #endif
-	return ifft2D_cpp(src,dst,buf);
+	return ifft2D_cpp(src,dst,buf,numThreads);
       }
       template<> ICLMath_API
       DynMatrix<std::complex<icl64f> >&  ifft2D(const DynMatrix<std::complex<icl64f> > &src,
-                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf){
+                                                     DynMatrix<std::complex<icl64f> > &dst,DynMatrix<std::complex<icl64f> > &buf, int numThreads){
 #ifdef ICL_HAVE_MKL
 	return mkl_wrapper_function_result_ifft_icl64fc(src,dst,buf);
 #endif
-	return ifft2D_cpp(src,dst,buf);
+	return ifft2D_cpp(src,dst,buf,numThreads);
       }
 
       template<typename T1,typename T2>
@@ -2156,9 +2326,9 @@ namespace icl{
           }
           delete[] temp;
 	}
-	for(unsigned int i=0;i<buf.cols();++i){
-          temp =  idft<std::complex<T2>,T2>(buf.rows(),(buf.row(i)).data());
-          for(unsigned int j=0;j<buf.rows();++j){
+	for(unsigned int i=0;i<buf.rows();++i){
+          temp =  idft<std::complex<T2>,T2>(buf.cols(),(buf.row(i)).data());
+          for(unsigned int j=0;j<buf.cols();++j){
             dst(i,j)=temp[j];
           }
           delete[] temp;
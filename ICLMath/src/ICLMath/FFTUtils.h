@@ -55,8 +55,9 @@ namespace icl{
 
   ///1dfft computation (fallback)
   /**Computes the 1D Fast-Fourier-Transformation for given data.
-     If the size of the dataarray is a power of 2, the fft is performed,
-     else the dft is performed on the datapart, on which fft does not work.
+     Sizes, whose prime factors are 2, 3, 5 and 7, are transformed with a
+     mixed-radix fft, all other sizes with Bluestein's algorithm. The twiddle
+     factors of each size are computed once and cached for later calls.
      Possible inputdatatypes are: icl8u, icl16u, icl32u, icl16s, icl32s, icl32f,
      icl64f, std::complex<icl32f>, std::complex<icl64f>.
      Possible outputdatatype are std::complex<icl32f> and std::complex<icl64f>
@@ -69,18 +70,22 @@ namespace icl{
 
   ///2dfft computation (fallback)
   /**Computes the 2D Fast-Fourier-Transformation for given data.
-     Works even if datasize is not a power of 2.
+     Works for all data sizes (see fft). Real valued rows are packed into
+     complex sequences of half the length. Apart from buf, dst and the cached
+     plans, no memory is allocated.
      Possible inputdatatypes are: icl8u, icl16u, icl32u, icl16s, icl32s, icl32f,
      icl64f, std::complex<icl32f>, std::complex<icl64f>.
      Possible outputdatatype are std::complex<icl32f> and std::complex<icl64f>
      @param src datamatrix of size MxN
      @param dst destinationmatrix of size MxN
      @param buf buffermatrix of size NxM !!!
+     @param numThreads number of threads the rows and columns are distributed to
+            (1: calling thread only, 0: all threads of the global ThreadPool)
      @return matrix of fftvalues for datamatrix
    */
   template<typename T1, typename T2> ICLMath_IMP
   DynMatrix<std::complex<T2> >&  fft2D_cpp(const DynMatrix<T1> &src,
-  		DynMatrix<std::complex<T2> > &dst,DynMatrix<std::complex<T2> > &buf);
+  		DynMatrix<std::complex<T2> > &dst,DynMatrix<std::complex<T2> > &buf, int numThreads=1);
 
   ///2dfft computation
   /**Computes the 2D Fast-Fourier-Transformation for given data.
@@ -91,11 +96,12 @@ namespace icl{
      @param src datamatrix of size MxN
      @param dst destinationmatrix of size MxN
      @param buf buffermatrix of size NxM !!!
+     @param numThreads number of threads used by fft2D_cpp
      @return matrix of fftvalues for datamatrix
    */
   template<typename T1, typename T2> ICLMath_IMP
   DynMatrix<std::complex<T2> >& fft2D(const DynMatrix<T1> &src, DynMatrix<std::complex<T2> > &dst,
-  		DynMatrix<std::complex<T2> > &buf);
+  		DynMatrix<std::complex<T2> > &buf, int numThreads=1);
 
   ///1d dft computation
   /**Computes the 1D Diskrete-Fourier-Transformation for given data.
@@ -141,11 +147,13 @@ namespace icl{
      @param src datamatrix of size MxN
      @param dst destinationmatrix of size MxN
      @param buf buffermarix of size NxM
+     @param numThreads number of threads the rows and columns are distributed to
+            (1: calling thread only, 0: all threads of the global ThreadPool)
      @return matrix of ifftvalues for datamatrix
    */
   template<typename T1, typename T2> ICLMath_IMP
   DynMatrix<std::complex<T2> >&  ifft2D_cpp(const DynMatrix<T1>& src,
-  		DynMatrix<std::complex<T2> > &dst,DynMatrix<std::complex<T2> > &buf);
+  		DynMatrix<std::complex<T2> > &dst,DynMatrix<std::complex<T2> > &buf, int numThreads=1);
 
   ///2d ifft computation
   /**Computes the 2D Inverse-Fast-Fourier-Transformation.
@@ -155,11 +163,12 @@ namespace icl{
      @param src datamatrix of size MxN
      @param dst destinationmatrix of size MxN
      @param buf buffermarix of size NxM
+     @param numThreads number of threads used by ifft2D_cpp
      @return matrix of ifftvalues for datamatrix
    */
   template<typename T1, typename T2> ICLMath_IMP
   DynMatrix<std::complex<T2> >&   ifft2D(const DynMatrix<T1> &src, DynMatrix<std::complex<T2> > &dst,
-  		DynMatrix<std::complex<T2> > &buf);
+  		DynMatrix<std::complex<T2> > &buf, int numThreads=1);
 
   ///1d idft computation
   /**Computes the 1D Inverse-Diskrete-Fourier-Transformation for given data.
@@ -0,0 +1,88 @@
+#include "gtest/gtest.h"
+
+#include <ICLMath/FFTUtils.h>
+
+#include <cmath>
+#include <complex>
+
+using namespace icl;
+using namespace icl::math;
+using namespace icl::math::fft;
+
+namespace {
+  template<class T>
+  DynMatrix<T> create_fft_input(int cols, int rows) {
+    DynMatrix<T> m(cols, rows);
+    for (unsigned int i = 0; i < m.dim(); ++i) m[i] = (T)((i * 7919 + (i / 13) * 104729) % 256);
+    return m;
+  }
+
+  template<class T>
+  void expect_near(const DynMatrix<std::complex<T> > &a, const DynMatrix<std::complex<T> > &b, double eps) {
+    ASSERT_EQ(a.cols(), b.cols());
+    ASSERT_EQ(a.rows(), b.rows());
+    for (unsigned int i = 0; i < a.dim(); ++i) {
+      ASSERT_NEAR(a[i].real(), b[i].real(), eps) << "size " << a.cols() << "x" << a.rows() << ", element " << i;
+      ASSERT_NEAR(a[i].imag(), b[i].imag(), eps) << "size " << a.cols() << "x" << a.rows() << ", element " << i;
+    }
+  }
+
+  // 2, 3, 4, 5 and 7 radices, Bluestein sizes (11, 13, 22) and odd/even rows
+  const int sizes[][2] = { {1, 1}, {16, 8}, {12, 10}, {21, 9}, {11, 13}, {22, 5}, {49, 3} };
+}
+
+TEST(FFTUtilsTest, FFTMatchesDFT) {
+  for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    DynMatrix<icl8u> src = create_fft_input<icl8u>(sizes[i][0], sizes[i][1]);
+    DynMatrix<std::complex<icl64f> > a(src.cols(), src.rows()), b(src.cols(), src.rows()), buf;
+    fft2D(src, a, buf);
+    dft2D(src, b, buf);
+    expect_near(a, b, 1e-7);
+
+    DynMatrix<std::complex<icl32f> > c(src.cols(), src.rows()), d(src.cols(), src.rows()), buf32;
+    fft2D(src, c, buf32);
+    dft2D(src, d, buf32);
+    expect_near(c, d, 0.05);
+  }
+}
+
+TEST(FFTUtilsTest, InverseFFTRestoresInput) {
+  for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    DynMatrix<icl64f> src = create_fft_input<icl64f>(sizes[i][0], sizes[i][1]);
+    DynMatrix<std::complex<icl64f> > f(src.cols(), src.rows()), r(src.cols(), src.rows()), buf;
+    fft2D(src, f, buf);
+    ifft2D(f, r, buf);
+    for (unsigned int j = 0; j < src.dim(); ++j) {
+      ASSERT_NEAR(src[j], r[j].real(), 1e-9);
+      ASSERT_NEAR(0, r[j].imag(), 1e-9);
+    }
+
+    DynMatrix<std::complex<icl64f> > ri(src.cols(), src.rows()), di(src.cols(), src.rows());
+    ifft2D(src, ri, buf);
+    idft2D(src, di, buf);
+    expect_near(ri, di, 1e-9);
+  }
+}
+
+TEST(FFTUtilsTest, ParallelEqualsSequential) {
+  DynMatrix<icl32f> src = create_fft_input<icl32f>(160, 120);
+  DynMatrix<std::complex<icl32f> > a(160, 120), b(160, 120), buf;
+  fft2D(src, a, buf, 1);
+  fft2D(src, b, buf, 0);
+  for (unsigned int i = 0; i < a.dim(); ++i) ASSERT_EQ(a[i], b[i]);
+}
+
+TEST(FFTUtilsTest, FFT1DMatchesDFT) {
+  for (unsigned int n = 1; n < 40; ++n) {
+    std::vector<icl64f> x(n);
+    for (unsigned int i = 0; i < n; ++i) x[i] = std::sin(0.3 * i) + i % 5;
+    std::complex<icl64f> *a = fft::fft<icl64f, icl64f>(n, x.data());
+    std::complex<icl64f> *b = fft::dft<icl64f, icl64f>(n, x.data());
+    for (unsigned int i = 0; i < n; ++i) {
+      ASSERT_NEAR(a[i].real(), b[i].real(), 1e-9) << "n " << n;
+      ASSERT_NEAR(a[i].imag(), b[i].imag(), 1e-9) << "n " << n;
+    }
+    delete[] a;
+    delete[] b;
+  }
+}
@@ -0,0 +1,151 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLUtils/src/ICLUtils/CPUInfo.cpp                      **
+** Module : ICLUtils                                               **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#include <ICLUtils/CPUInfo.h>
+#include <ICLUtils/Macros.h>
+#include <atomic>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+  #define ICL_CPUINFO_X86
+  #ifdef _MSC_VER
+    #include <intrin.h>
+    #include <immintrin.h>
+  #else
+    #include <cpuid.h>
+  #endif
+#endif
+
+namespace icl{
+  namespace utils{
+
+    namespace{
+      struct Features{
+        bool supported[CPUInfo::FEATURE_COUNT];
+        std::atomic<bool> enabled[CPUInfo::FEATURE_COUNT];
+
+  #ifdef ICL_CPUINFO_X86
+        static void cpuid(int leaf, int sub, unsigned int r[4]){
+  #ifdef _MSC_VER
+          int regs[4];
+          __cpuidex(regs,leaf,sub);
+          for(int i=0;i<4;++i) r[i] = (unsigned int)regs[i];
+  #else
+          __cpuid_count(leaf,sub,r[0],r[1],r[2],r[3]);
+  #endif
+        }
+
+        /// returns the XCR0 register (states saved by the operating system)
+        static unsigned long long xgetbv(){
+  #ifdef _MSC_VER
+          return _xgetbv(0);
+  #else
+          unsigned int a=0, d=0;
+          __asm__ volatile("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+          return ((unsigned long long)d << 32) | a;
+  #endif
+        }
+  #endif
+
+        Features(){
+          for(int i=0;i<CPUInfo::FEATURE_COUNT;++i){
+            supported[i] = false;
+            enabled[i] = true;
+          }
+  #ifdef ICL_CPUINFO_X86
+          unsigned int r[4] = {0,0,0,0};
+          cpuid(0,0,r);
+          const unsigned int maxLeaf = r[0];
+          if(maxLeaf < 1) return;
+          cpuid(1,0,r);
+          const unsigned int ecx = r[2], edx = r[3];
+          supported[CPUInfo::SSE2] = edx & (1<<26);
+          supported[CPUInfo::SSE3] = ecx & (1<<0);
+          supported[CPUInfo::SSSE3] = ecx & (1<<9);
+          supported[CPUInfo::SSE41] = ecx & (1<<19);
+          supported[CPUInfo::SSE42] = ecx & (1<<20);
+
+          // AVX requires the operating system to save the ymm registers
+          const bool osxsave = ecx & (1<<27);
+          const bool ymmSaved = osxsave && ((xgetbv() & 6) == 6);
+          supported[CPUInfo::AVX] = ymmSaved && (ecx & (1<<28));
+          supported[CPUInfo::FMA] = supported[CPUInfo::AVX] && (ecx & (1<<12));
+          if(maxLeaf >= 7){
+            cpuid(7,0,r);
+            supported[CPUInfo::AVX2] = supported[CPUInfo::AVX] && (r[1] & (1<<5));
+          }
+  #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+          supported[CPUInfo::NEON] = true;
+  #endif
+        }
+      };
+
+      Features &features(){
+        static Features f;
+        return f;
+      }
+    }
+
+    bool CPUInfo::isSupported(Feature f){
+      ICLASSERT_RETURN_VAL(f >= 0 && f < FEATURE_COUNT, false);
+      return features().supported[f];
+    }
+
+    bool CPUInfo::isAvailable(Feature f){
+      ICLASSERT_RETURN_VAL(f >= 0 && f < FEATURE_COUNT, false);
+      const Features &fs = features();
+      return fs.supported[f] && fs.enabled[f];
+    }
+
+    void CPUInfo::setEnabled(Feature f, bool enabled){
+      ICLASSERT_RETURN(f >= 0 && f < FEATURE_COUNT);
+      features().enabled[f] = enabled;
+    }
+
+    const char *CPUInfo::getName(Feature f){
+      static const char *names[FEATURE_COUNT] = {
+        "sse2", "sse3", "ssse3", "sse4.1", "sse4.2", "avx", "avx2", "fma", "neon"
+      };
+      ICLASSERT_RETURN_VAL(f >= 0 && f < FEATURE_COUNT, "");
+      return names[f];
+    }
+
+    std::string CPUInfo::getAvailableFeatures(){
+      std::string s;
+      for(int i=0;i<FEATURE_COUNT;++i){
+        if(isAvailable((Feature)i)){
+          if(s.length()) s += ' ';
+          s += getName((Feature)i);
+        }
+      }
+      return s;
+    }
+
+  } // namespace utils
+}
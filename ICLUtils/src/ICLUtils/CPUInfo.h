@@ -0,0 +1,95 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLUtils/src/ICLUtils/CPUInfo.h                        **
+** Module : ICLUtils                                               **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#pragma once
+
+#include <ICLUtils/CompatMacros.h>
+#include <string>
+
+namespace icl{
+  namespace utils{
+
+    /// Runtime detection of the SIMD instruction sets of the current CPU \ingroup UTILS
+    /** The compile time macros of SSETypes.h (ICL_HAVE_SSE2 etc.) only tell, which
+        instruction sets the library was built for. Performance critical functions
+        can additionally provide implementations for newer instruction sets, that are
+        compiled separately and chosen at runtime, if the current CPU (and operating
+        system) supports them.
+
+        For benchmarking and testing, each feature can be disabled explicitly. Disabled
+        features are no longer reported by isAvailable(), so that dispatching functions
+        fall back to the next best implementation.
+
+        \code
+        if(CPUInfo::isAvailable(CPUInfo::AVX2)){
+          process_avx2(...);
+        }else{
+          process_sse2(...);
+        }
+        \endcode
+    */
+    class ICLUtils_API CPUInfo{
+      public:
+
+      /// instruction set extensions
+      enum Feature{
+        SSE2,   //!< x86 SSE2 (always available on x86_64)
+        SSE3,   //!< x86 SSE3
+        SSSE3,  //!< x86 supplemental SSE3
+        SSE41,  //!< x86 SSE 4.1
+        SSE42,  //!< x86 SSE 4.2
+        AVX,    //!< x86 AVX (including operating system support)
+        AVX2,   //!< x86 AVX2 (including operating system support)
+        FMA,    //!< x86 fused multiply add (FMA3)
+        NEON,   //!< ARM NEON
+        FEATURE_COUNT
+      };
+
+      /// returns whether the given feature is supported by the CPU
+      static bool isSupported(Feature f);
+
+      /// returns whether the given feature is supported and not disabled
+      static bool isAvailable(Feature f);
+
+      /// enables or disables the use of a feature (all supported features are enabled by default)
+      /** This is thread-safe. However, functions that select their implementation once
+          (e.g. the vectorized color conversions of core::cc) are only affected if this is
+          called before their first use. */
+      static void setEnabled(Feature f, bool enabled);
+
+      /// returns the name of the given feature (e.g. "avx2")
+      static const char *getName(Feature f);
+
+      /// returns a space separated list of all available features
+      static std::string getAvailableFeatures();
+    };
+
+  } // namespace utils
+}
@@ -55,8 +55,12 @@ namespace icl{
         operator of the MultiThreader. \n
 
         <b>Please note</b> This tool was written before openmp became popular
-        and part of compilers. Today we recommend to use openmp rather then the
-        Multithreader class.
+        and part of compilers. Today, the MultiThreader is only a thin wrapper
+        around the process wide utils::ThreadPool, which is recommended for
+        new code (see also utils::parallel_for). The given number of threads is
+        used as upper limit for the number of threads that process a WorkSet.
+        A WorkSet may contain more Work packages than there are threads. In this
+        case, the packages are distributed dynamically.
 
         \section __EX Example
         The following example explains how to parallelize a simple function-call
@@ -170,18 +174,13 @@ namespace icl{
         virtual void perform()=0;
       };
 
-      /** \cond */
-      /// internally used working Thread class
-      class MTWorkThread;
-      /** \endcond */
-
       /// set of work packages, that should be performed parallel
       typedef std::vector<Work*> WorkSet;
 
       /// Empty (null) constructor
       MultiThreader();
 
-      /// Default constructor with defined set of working threads
+      /// Default constructor with defined maximum number of working threads
       MultiThreader(int nThreads);
 
       /// applying operator (performs each Work* element of ws parallel)
@@ -0,0 +1,416 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLUtils/src/ICLUtils/ThreadPool.cpp                   **
+** Module : ICLUtils                                               **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#include <ICLUtils/ThreadPool.h>
+#include <ICLUtils/Macros.h>
+#include <ICLUtils/Mutex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <exception>
+#include <algorithm>
+
+#ifdef ICL_SYSTEM_WINDOWS
+  #include <Windows.h>
+#else
+  #include <unistd.h>
+#endif
+
+namespace icl{
+  namespace utils{
+
+    namespace{
+      /// capacity of each worker's task queue
+      const int QUEUE_CAPACITY = 1024;
+
+      /// maximum number of helper tasks that are spawned by a single parallelFor call
+      const int MAX_FOR_TASKS = 128;
+
+      /// number of chunks per participating thread if the grain is chosen automatically
+      const int CHUNKS_PER_THREAD = 4;
+
+      /// fixed size, mutex protected double ended task queue
+      /** The owning worker pushes and pops at the back (LIFO, cache friendly),
+          other threads steal from the front (FIFO, large work packages first) */
+      class TaskQueue : public Uncopyable{
+        Mutex m_mutex;
+        ThreadPool::Task *m_data[QUEUE_CAPACITY];
+        int m_front;
+        int m_size;
+
+        public:
+        TaskQueue():m_front(0),m_size(0){}
+
+        bool push(ThreadPool::Task *t){
+          Mutex::Locker lock(m_mutex);
+          if(m_size == QUEUE_CAPACITY) return false;
+          m_data[(m_front+m_size++)%QUEUE_CAPACITY] = t;
+          return true;
+        }
+
+        ThreadPool::Task *pop(){
+          Mutex::Locker lock(m_mutex);
+          if(!m_size) return 0;
+          return m_data[(m_front + --m_size)%QUEUE_CAPACITY];
+        }
+
+        ThreadPool::Task *steal(){
+          if(m_mutex.trylock()) return 0;
+          ThreadPool::Task *t = 0;
+          if(m_size){
+            t = m_data[m_front];
+            m_front = (m_front+1)%QUEUE_CAPACITY;
+            --m_size;
+          }
+          m_mutex.unlock();
+          return t;
+        }
+      };
+
+      /// shared state of a single parallelFor call
+      struct ForLoop{
+        ThreadPool::RangeBody *body;
+        std::atomic<int> next;
+        int end;
+        int grain;
+        Mutex errorMutex;
+        std::exception_ptr error;
+
+        void work(){
+          while(true){
+            int b = next.fetch_add(grain);
+            if(b >= end) return;
+            try{
+              (*body)(b,std::min(b+grain,end));
+            }catch(...){
+              Mutex::Locker lock(errorMutex);
+              if(!error) error = std::current_exception();
+              next = end;
+            }
+          }
+        }
+      };
+
+      /// helper task that processes chunks of a ForLoop
+      struct ForTask : public ThreadPool::Task{
+        ForLoop *loop;
+        ForTask():loop(0){}
+        virtual void perform(){
+          loop->work();
+        }
+      };
+    }
+
+    /** \cond */
+    struct ThreadPoolWorker{
+      ThreadPoolImpl *pool;
+      int index;
+      pthread_t thread;
+      TaskQueue queue;
+    };
+    /** \endcond */
+
+    /// worker of the current thread (null for non-worker threads)
+    static thread_local ThreadPoolWorker *tl_worker = 0;
+
+    class ThreadPoolImpl{
+      public:
+      std::vector<ThreadPoolWorker*> workers;
+      std::vector<int> affinity;
+      std::atomic<int> queued;
+      std::atomic<int> sleeping;
+      std::atomic<unsigned int> roundRobin;
+      bool stop;
+      pthread_mutex_t sleepMutex;
+      pthread_cond_t sleepCond;
+
+      ThreadPoolImpl():queued(0),sleeping(0),roundRobin(0),stop(false){
+        pthread_mutex_init(&sleepMutex,0);
+        pthread_cond_init(&sleepCond,0);
+      }
+
+      ~ThreadPoolImpl(){
+        stopWorkers();
+        pthread_cond_destroy(&sleepCond);
+        pthread_mutex_destroy(&sleepMutex);
+      }
+
+      static void *worker_main(void *data){
+        ThreadPoolWorker *w = static_cast<ThreadPoolWorker*>(data);
+        tl_worker = w;
+        w->pool->runWorker(w);
+        return 0;
+      }
+
+      void startWorkers(int n){
+        stop = false;
+        workers.resize(n);
+        for(int i=0;i<n;++i){
+          workers[i] = new ThreadPoolWorker;
+          workers[i]->pool = this;
+          workers[i]->index = i;
+        }
+        for(int i=0;i<n;++i){
+          pthread_create(&workers[i]->thread,0,worker_main,workers[i]);
+        }
+        applyAffinity();
+      }
+
+      void stopWorkers(){
+        pthread_mutex_lock(&sleepMutex);
+        stop = true;
+        pthread_cond_broadcast(&sleepCond);
+        pthread_mutex_unlock(&sleepMutex);
+        for(unsigned int i=0;i<workers.size();++i){
+          pthread_join(workers[i]->thread,0);
+          delete workers[i];
+        }
+        workers.clear();
+      }
+
+      bool applyAffinity(){
+#ifdef ICL_SYSTEM_LINUX
+        for(unsigned int i=0;i<workers.size();++i){
+          cpu_set_t set;
+          CPU_ZERO(&set);
+          if(affinity.size()){
+            CPU_SET(affinity[i%affinity.size()],&set);
+          }else{
+            for(int c=0;c<ThreadPool::getNumCores() && c<CPU_SETSIZE;++c) CPU_SET(c,&set);
+          }
+          if(pthread_setaffinity_np(workers[i]->thread,sizeof(cpu_set_t),&set)){
+            WARNING_LOG("unable to set the affinity of thread pool worker " << i);
+            return false;
+          }
+        }
+        return true;
+#else
+        return affinity.empty();
+#endif
+      }
+
+      /// returns the worker of the current thread if it belongs to this pool
+      inline ThreadPoolWorker *currentWorker(){
+        return (tl_worker && tl_worker->pool == this) ? tl_worker : 0;
+      }
+
+      ThreadPool::Task *findTask(ThreadPoolWorker *self){
+        ThreadPool::Task *t = self ? self->queue.pop() : 0;
+        const int n = (int)workers.size();
+        if(!t && queued.load() > 0){
+          int start = self ? self->index+1 : (int)(roundRobin.load()%n);
+          for(int i=0;i<n && !t;++i){
+            ThreadPoolWorker *v = workers[(start+i)%n];
+            if(v != self) t = v->queue.steal();
+          }
+        }
+        if(t) --queued;
+        return t;
+      }
+
+      static inline void execute(ThreadPool::Task *t){
+        ThreadPool::TaskGroup *g = t->m_group;
+        try{
+          t->perform();
+        }catch(const std::exception &e){
+          ERROR_LOG("uncaught exception in thread pool task: " << e.what());
+        }catch(...){
+          ERROR_LOG("uncaught exception in thread pool task");
+        }
+        // t must not be touched any more, since the group's owner might return now
+        g->m_pending.fetch_sub(1);
+      }
+
+      void runWorker(ThreadPoolWorker *w){
+        while(true){
+          ThreadPool::Task *t = findTask(w);
+          if(t){
+            execute(t);
+            continue;
+          }
+          pthread_mutex_lock(&sleepMutex);
+          ++sleeping;
+          while(!stop && queued.load() == 0){
+            pthread_cond_wait(&sleepCond,&sleepMutex);
+          }
+          --sleeping;
+          bool s = stop;
+          pthread_mutex_unlock(&sleepMutex);
+          if(s) return;
+        }
+      }
+
+      void submit(ThreadPool::Task *t, ThreadPool::TaskGroup *g){
+        t->m_group = g;
+        ++g->m_pending;
+        if(workers.empty()){
+          execute(t);
+          return;
+        }
+        ThreadPoolWorker *w = currentWorker();
+        if(!w) w = workers[roundRobin++ % workers.size()];
+        if(!w->queue.push(t)){
+          execute(t);
+          return;
+        }
+        ++queued;
+        if(sleeping.load() > 0){
+          pthread_mutex_lock(&sleepMutex);
+          pthread_cond_signal(&sleepCond);
+          pthread_mutex_unlock(&sleepMutex);
+        }
+      }
+
+      void wait(ThreadPool::TaskGroup *g){
+        ThreadPoolWorker *self = currentWorker();
+        int idle = 0;
+        while(g->m_pending.load() > 0){
+          ThreadPool::Task *t = workers.size() ? findTask(self) : 0;
+          if(t){
+            execute(t);
+            idle = 0;
+          }else if(++idle < 64){
+            sched_yield();
+          }else{
+            // pending tasks are being processed by other threads (which can take a while)
+#ifdef ICL_SYSTEM_WINDOWS
+            Sleep(0);
+#else
+            ::usleep(50);
+#endif
+          }
+        }
+      }
+    };
+
+    ThreadPool::TaskGroup::TaskGroup(ThreadPool *pool):
+      m_pool(pool ? pool : &ThreadPool::instance()),m_pending(0){
+    }
+
+    ThreadPool::TaskGroup::~TaskGroup(){
+      wait();
+    }
+
+    void ThreadPool::TaskGroup::run(Task *t){
+      ICLASSERT_RETURN(t);
+      m_pool->submit(t,this);
+    }
+
+    void ThreadPool::TaskGroup::wait(){
+      m_pool->wait(this);
+    }
+
+    ThreadPool::ThreadPool(int nThreads):m_impl(new ThreadPoolImpl){
+      m_impl->startWorkers(nThreads < 0 ? std::max(getNumCores()-1,0) : nThreads);
+    }
+
+    ThreadPool::~ThreadPool(){
+      delete m_impl;
+    }
+
+    ThreadPool &ThreadPool::instance(){
+      static ThreadPool pool;
+      return pool;
+    }
+
+    int ThreadPool::getNumCores(){
+#ifdef ICL_SYSTEM_WINDOWS
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      return std::max((int)info.dwNumberOfProcessors,1);
+#else
+      return std::max((int)sysconf(_SC_NPROCESSORS_ONLN),1);
+#endif
+    }
+
+    int ThreadPool::getNumThreads() const{
+      return (int)m_impl->workers.size();
+    }
+
+    void ThreadPool::setNumThreads(int nThreads){
+      ICLASSERT_RETURN(nThreads >= 0);
+      if(nThreads == getNumThreads()) return;
+      m_impl->stopWorkers();
+      m_impl->startWorkers(nThreads);
+    }
+
+    bool ThreadPool::setAffinity(const std::vector<int> &cores){
+      m_impl->affinity = cores;
+      return m_impl->applyAffinity();
+    }
+
+    const std::vector<int> &ThreadPool::getAffinity() const{
+      return m_impl->affinity;
+    }
+
+    void ThreadPool::submit(Task *t, TaskGroup *g){
+      m_impl->submit(t,g);
+    }
+
+    void ThreadPool::wait(TaskGroup *g){
+      m_impl->wait(g);
+    }
+
+    void ThreadPool::parallelForBody(int begin, int end, RangeBody &body, int grain, int maxThreads){
+      const int n = end-begin;
+      if(n <= 0) return;
+
+      int nThreads = getConcurrency();
+      if(maxThreads > 0 && maxThreads < nThreads) nThreads = maxThreads;
+      if(grain <= 0){
+        grain = std::max(1, (n + nThreads*CHUNKS_PER_THREAD - 1) / (nThreads*CHUNKS_PER_THREAD));
+      }
+      const int nChunks = (n + grain - 1) / grain;
+      const int nTasks = std::min(std::min(nThreads,nChunks)-1, MAX_FOR_TASKS);
+      if(nTasks <= 0){
+        body(begin,end);
+        return;
+      }
+
+      ForLoop loop;
+      loop.body = &body;
+      loop.next = begin;
+      loop.end = end;
+      loop.grain = grain;
+
+      ForTask tasks[MAX_FOR_TASKS];
+      {
+        TaskGroup group(this);
+        for(int i=0;i<nTasks;++i){
+          tasks[i].loop = &loop;
+          group.run(tasks+i);
+        }
+        loop.work();
+        group.wait();
+      }
+      if(loop.error) std::rethrow_exception(loop.error);
+    }
+
+  } // namespace utils
+}
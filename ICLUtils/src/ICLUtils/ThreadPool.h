@@ -0,0 +1,235 @@
+/********************************************************************
+**                Image Component Library (ICL)                    **
+**                                                                 **
+** Copyright (C) 2006-2013 CITEC, University of Bielefeld          **
+**                         Neuroinformatics Group                  **
+** Website: www.iclcv.org and                                      **
+**          http://opensource.cit-ec.de/projects/icl               **
+**                                                                 **
+** File   : ICLUtils/src/ICLUtils/ThreadPool.h                     **
+** Module : ICLUtils                                               **
+** Authors: Christof Elbrechter                                    **
+**                                                                 **
+**                                                                 **
+** GNU LESSER GENERAL PUBLIC LICENSE                               **
+** This file may be used under the terms of the GNU Lesser General **
+** Public License version 3.0 as published by the                  **
+**                                                                 **
+** Free Software Foundation and appearing in the file LICENSE.LGPL **
+** included in the packaging of this file.  Please review the      **
+** following information to ensure the license requirements will   **
+** be met: http://www.gnu.org/licenses/lgpl-3.0.txt                **
+**                                                                 **
+** The development of this software was supported by the           **
+** Excellence Cluster EXC 277 Cognitive Interaction Technology.    **
+** The Excellence Cluster EXC 277 is a grant of the Deutsche       **
+** Forschungsgemeinschaft (DFG) in the context of the German       **
+** Excellence Initiative.                                          **
+**                                                                 **
+********************************************************************/
+
+#pragma once
+
+#include <ICLUtils/CompatMacros.h>
+#include <ICLUtils/Uncopyable.h>
+#include <ICLUtils/Size.h>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+
+namespace icl{
+  namespace utils{
+
+    /** \cond */
+    class ThreadPoolImpl;
+    /** \endcond */
+
+    /// Persistent work-stealing thread pool \ingroup THREAD
+    /** \section OV Overview
+        The ThreadPool manages a fixed set of worker threads that are created
+        once and then reused for all parallel computations. Each worker owns a
+        small task queue. Tasks that are spawned from within a worker are pushed
+        to its own queue, idle workers steal tasks from the other queues. By
+        these means, unequally expensive work packages are balanced automatically
+        between the available cores.
+
+        Usually, the process wide instance that is returned by ThreadPool::instance()
+        is used. By default, it uses one worker less than there are cores, because
+        the calling thread always takes part in the computation.
+
+        \section NOALLOC No Heap Allocation
+        Tasks are not copied into the pool. Instead, the caller provides the
+        Task instances and keeps them alive until the corresponding TaskGroup
+        was waited for. The task queues have a fixed capacity, so submitting
+        and running tasks does not allocate memory. If a queue is full, the
+        task is executed directly by the submitting thread.
+
+        \section NESTED Nested Parallelism
+        A thread waiting for a TaskGroup does not block, but it helps
+        processing pending tasks. Therefore, parallelFor and TaskGroup
+        can be used from within tasks without running into dead-locks.
+
+        \section EX Example
+        \code
+        // functor, that processes a range of image rows
+        struct ProcessRows{
+          Img8u &image;
+          ProcessRows(Img8u &image):image(image){}
+          void operator()(int yStart, int yEnd) const{
+            for(int y=yStart;y<yEnd;++y){
+              process_row(image,y);
+            }
+          }
+        };
+
+        // process all rows of an image in parallel
+        utils::parallel_for(0,image.getHeight(),ProcessRows(image));
+        \endcode
+    */
+    class ICLUtils_API ThreadPool : public Uncopyable{
+      public:
+
+      class TaskGroup;
+
+      /// Interface for work packages that are processed by the pool
+      /** Task instances are owned by the caller */
+      class Task{
+        TaskGroup *m_group;
+        friend class ThreadPool;
+        friend class ThreadPoolImpl;
+        public:
+        /// Default constructor
+        Task():m_group(0){}
+
+        /// virtual destructor doing nothing
+        virtual ~Task(){}
+
+        /// abstract working function
+        virtual void perform()=0;
+      };
+
+      /// Set of tasks that can be waited for
+      /** The TaskGroup's destructor waits for all tasks that were
+          passed to run(). */
+      class ICLUtils_API TaskGroup : public Uncopyable{
+        ThreadPool *m_pool;
+        std::atomic<int> m_pending;
+        friend class ThreadPoolImpl;
+
+        public:
+        /// creates a new task group for the given pool (by default, the global instance)
+        TaskGroup(ThreadPool *pool=0);
+
+        /// Destructor (waits for all pending tasks)
+        ~TaskGroup();
+
+        /// schedules the given task (t must be alive until wait() returns)
+        void run(Task *t);
+
+        /// waits for all tasks (the calling thread processes pending tasks meanwhile)
+        void wait();
+      };
+
+      /// Interface for ranges that are processed by parallelFor
+      struct RangeBody{
+        /// virtual destructor doing nothing
+        virtual ~RangeBody(){}
+
+        /// processes the index range [begin,end)
+        virtual void operator()(int begin, int end)=0;
+      };
+
+      /// Creates a pool with given number of worker threads
+      /** if nThreads is negative, getNumCores()-1 workers are created */
+      explicit ThreadPool(int nThreads=-1);
+
+      /// Destructor (joins all worker threads)
+      ~ThreadPool();
+
+      /// returns the process wide ThreadPool instance
+      static ThreadPool &instance();
+
+      /// returns the number of available cores
+      static int getNumCores();
+
+      /// returns the number of worker threads
+      int getNumThreads() const;
+
+      /// returns the number of threads that take part in a computation (workers + caller)
+      int getConcurrency() const { return getNumThreads()+1; }
+
+      /// re-creates the worker threads
+      /** This must not be called while tasks of this pool are being processed */
+      void setNumThreads(int nThreads);
+
+      /// binds the worker threads to the given cores
+      /** Worker i is bound to cores[i % cores.size()]. If cores is empty,
+          existing bindings are removed. Returns false, if thread affinity is
+          not supported on the current platform. */
+      bool setAffinity(const std::vector<int> &cores);
+
+      /// returns the current affinity setting
+      const std::vector<int> &getAffinity() const;
+
+      /// processes the index range [begin,end) in parallel
+      /** The range is split into chunks of size grain, which are then handed out
+          dynamically to the participating threads. Each chunk is passed to the
+          given functor f(int begin, int end). If grain is <= 0, the chunk size is
+          chosen automatically. maxThreads limits the number of threads that work
+          on the range (including the calling thread). A value <= 0 means all
+          available threads, 1 means that f(begin,end) is called by the calling
+          thread directly. */
+      template<class F>
+      inline void parallelFor(int begin, int end, F f, int grain=0, int maxThreads=0){
+        FunctorBody<F> body(f);
+        parallelForBody(begin,end,body,grain,maxThreads);
+      }
+
+      /// non-template version of parallelFor
+      void parallelForBody(int begin, int end, RangeBody &body, int grain=0, int maxThreads=0);
+
+      private:
+
+      /** \cond */
+      template<class F>
+      struct FunctorBody : public RangeBody{
+        F &f;
+        FunctorBody(F &f):f(f){}
+        virtual void operator()(int begin, int end){ f(begin,end); }
+      };
+      /** \endcond */
+
+      /// schedules a task of the given group
+      void submit(Task *t, TaskGroup *g);
+
+      /// waits for the given group
+      void wait(TaskGroup *g);
+
+      /// internal implementation
+      ThreadPoolImpl *m_impl;
+    };
+
+    /// processes the index range [begin,end) in parallel using the global ThreadPool \ingroup THREAD
+    /** f is called with sub ranges (f(int begin, int end)). See ThreadPool::parallelFor.
+        If maxThreads is 1 or if the range contains less than two indices, f(begin,end)
+        is called directly by the calling thread (the global instance is not even created) */
+    template<class F>
+    inline void parallel_for(int begin, int end, F f, int grain=0, int maxThreads=0){
+      if(maxThreads == 1 || end - begin < 2){
+        if(end > begin) f(begin,end);
+        return;
+      }
+      ThreadPool::instance().parallelFor(begin,end,f,grain,maxThreads);
+    }
+
+    /// processes the rows [0,size.height) of an image with the given size using parallel_for \ingroup THREAD
+    /** Each chunk of rows contains at least minPixelsPerChunk pixels. Images with
+        less than 2*minPixelsPerChunk pixels are processed by the calling thread */
+    template<class F>
+    inline void parallel_for_rows(const Size &size, F f, int minPixelsPerChunk, int maxThreads=0){
+      const int grain = std::max(1,minPixelsPerChunk/std::max(1,size.width));
+      parallel_for(0,size.height,f,grain,size.getDim() < 2*minPixelsPerChunk ? 1 : maxThreads);
+    }
+
+  } // namespace utils
+}
@@ -33,6 +33,7 @@
 #include <ICLMath/FixedMatrix.h>
 #include <ICLUtils/CompatMacros.h>
 #include <ICLUtils/ConfigFile.h>
+#include <ICLUtils/CPUInfo.h>
 #include <ICLUtils/ConsoleProgress.h>
 #include <ICLMath/DynMatrixUtils.h>
 #include <ICLMath/DynVector.h>
@@ -41,6 +42,7 @@
 #include <ICLUtils/FPSLimiter.h>
 #include <ICLUtils/Timer.h>
 #include <ICLUtils/MultiThreader.h>
+#include <ICLUtils/ThreadPool.h>
 #include <ICLUtils/MultiTypeMap.h>
 #include <ICLUtils/ProgArg.h>
 #include <ICLUtils/Range.h>
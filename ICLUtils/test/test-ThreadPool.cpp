@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+#include "ICLUtils/ThreadPool.h"
+#include "ICLUtils/MultiThreader.h"
+
+#include <vector>
+
+using icl::utils::ThreadPool;
+using icl::utils::MultiThreader;
+using icl::utils::parallel_for;
+
+struct FillRange {
+  std::vector<int> &v;
+  FillRange(std::vector<int> &v) : v(v) {}
+  void operator()(int begin, int end) const {
+    for (int i = begin; i < end; ++i) v[i] += i;
+  }
+};
+
+struct NestedFill {
+  std::vector<std::vector<int> > &vs;
+  NestedFill(std::vector<std::vector<int> > &vs) : vs(vs) {}
+  void operator()(int begin, int end) const {
+    for (int i = begin; i < end; ++i) parallel_for(0, (int)vs[i].size(), FillRange(vs[i]));
+  }
+};
+
+struct ThrowAt {
+  int at;
+  ThrowAt(int at) : at(at) {}
+  void operator()(int begin, int end) const {
+    if (begin <= at && at < end) throw 42;
+  }
+};
+
+struct CountWork : public MultiThreader::Work {
+  int n;
+  CountWork() : n(0) {}
+  virtual void perform() { ++n; }
+};
+
+TEST(ThreadPoolTest, ParallelForCoversRangeOnce) {
+  ThreadPool pool(3);
+  std::vector<int> v(10007, 0);
+  pool.parallelFor(0, (int)v.size(), FillRange(v));
+  pool.parallelFor(0, (int)v.size(), FillRange(v), 7, 2);
+  for (unsigned int i = 0; i < v.size(); ++i) ASSERT_EQ(2 * (int)i, v[i]);
+}
+
+TEST(ThreadPoolTest, NestedParallelFor) {
+  std::vector<std::vector<int> > vs(32, std::vector<int>(1000, 0));
+  parallel_for(0, (int)vs.size(), NestedFill(vs), 1);
+  for (unsigned int i = 0; i < vs.size(); ++i) {
+    for (unsigned int j = 0; j < vs[i].size(); ++j) ASSERT_EQ((int)j, vs[i][j]);
+  }
+}
+
+TEST(ThreadPoolTest, ExceptionIsPropagated) {
+  ThreadPool pool(2);
+  EXPECT_THROW(pool.parallelFor(0, 100, ThrowAt(50), 1), int);
+}
+
+TEST(ThreadPoolTest, SetNumThreads) {
+  ThreadPool pool(1);
+  pool.setNumThreads(4);
+  EXPECT_EQ(4, pool.getNumThreads());
+  std::vector<int> v(100, 0);
+  pool.parallelFor(0, 100, FillRange(v));
+  EXPECT_EQ(99, v[99]);
+}
+
+TEST(ThreadPoolTest, MultiThreaderWorkSetLargerThanThreads) {
+  MultiThreader mt(2);
+  std::vector<CountWork> works(5);
+  MultiThreader::WorkSet ws(works.size());
+  for (unsigned int i = 0; i < works.size(); ++i) ws[i] = &works[i];
+  mt(ws);
+  mt(ws);
+  for (unsigned int i = 0; i < works.size(); ++i) EXPECT_EQ(2, works[i].n);
+}